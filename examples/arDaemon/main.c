@@ -0,0 +1,212 @@
+#define _GNU_SOURCE
+#define SISWA_ARCHIVE_IMPLEMENTATION
+#define SISWA_USE_DAEMON
+#include "libSUarchive.h"
+
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+/* A daemon that keeps archives opened, decompressed and indexed, so that the
+ * short-lived tools asking it for entries skip all of that work.
+ *
+ * Usage:
+ *     arDaemon serve socket              - runs the daemon until interrupted.
+ *     arDaemon list socket archive       - lists the entries of the archive.
+ *     arDaemon find socket archive name  - finds an entry of the archive.
+ *     arDaemon                           - benchmarks a daemon against loading
+ *                                          'BossPetra.ar.00' in every tool run. */
+
+#define SOCKET_PATH "arDaemon.sock"
+#define BENCH_RUNS 200
+#define BENCH_FINDS 100000
+
+
+static volatile int stopRequested = 0;
+
+static
+void onSignal(int sig) {
+	(void)sig;
+	stopRequested = 1;
+}
+
+static
+double now(void) {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+}
+
+static
+size_t writeStdout(void* user, const void* data, size_t len) {
+	const char* str = (const char*)data;
+	size_t i;
+	(void)user;
+
+	for (i = 0; i < len; i += 1) {
+		putchar(str[i] != '\0' ? str[i] : '\n');
+	}
+	return len;
+}
+
+
+static
+int serve(const char* socketPath) {
+	signal(SIGINT, onSignal);
+	signal(SIGTERM, onSignal);
+
+	if (!siswa_daemonServe(socketPath, &stopRequested)) {
+		fprintf(stderr, "Couldn't listen on '%s'.\n", socketPath);
+		return 1;
+	}
+	return 0;
+}
+
+static
+int request(int argc, char** argv) {
+	siDaemonClient client;
+	siArFile ar;
+	uint32_t id;
+
+	if (!siswa_daemonConnect(&client, argv[2])) {
+		fprintf(stderr, "No daemon on '%s'.\n", argv[2]);
+		return 1;
+	}
+	ar = siswa_daemonOpen(&client, argv[3], &id);
+	if (ar.type == SISWA_FILE_INVALID) {
+		fprintf(stderr, "The daemon couldn't open '%s'.\n", argv[3]);
+		return 1;
+	}
+
+	if (strcmp(argv[1], "list") == 0) {
+		siswa_daemonList(&client, id, writeStdout, NULL);
+	}
+	else if (argc > 4) {
+		siArEntry* entry = siswa_daemonFind(&client, ar, id, argv[4]);
+		if (entry == NULL) {
+			fprintf(stderr, "'%s' doesn't exist.\n", argv[4]);
+			return 1;
+		}
+		printf("%s: %u bytes at offset %lu\n", argv[4], siswa_arEntryGetDataSize(entry),
+			(unsigned long)((siByte*)siswa_arEntryGetData(entry) - ar.data));
+	}
+
+	siswa_arUnmap(ar);
+	siswa_daemonDisconnect(&client);
+	return 0;
+}
+
+
+/* The entries a tool run needs. */
+static const char* names[] = {
+	"Stage.stg.xml", "Boss.prm.xml", "Camera.set.xml", "Direct01.light",
+	"evqt_ptra_c06.inspire_resource.xml", "pr_ptrboss_light_125.light",
+	"ptrboss_col_stageA.phy.hkx"
+};
+#define NAME_COUNT (sizeof(names) / sizeof(*names))
+
+/* What every tool does without the daemon: load, decompress and search. */
+static
+size_t runLocal(const char* path) {
+	siArFile ar = siswa_arMake(path);
+	size_t size = (size_t)siswa_arGetDecompressedSize(ar), found = 0, i;
+
+	siswa_arDecompress(&ar, (siByte*)malloc(size), size, SISWA_TRUE);
+	for (i = 0; i < NAME_COUNT; i += 1) {
+		found += (siswa_arEntryFind(ar, names[i]) != NULL);
+	}
+	free(ar.data);
+	return found;
+}
+
+static
+size_t runDaemon(const char* path) {
+	siDaemonClient client;
+	siArFile ar;
+	uint32_t id;
+	size_t found = 0, i;
+
+	SISWA_ASSERT(siswa_daemonConnect(&client, SOCKET_PATH));
+	ar = siswa_daemonOpen(&client, path, &id);
+	SISWA_ASSERT(ar.type == SISWA_FILE_REGULAR);
+	for (i = 0; i < NAME_COUNT; i += 1) {
+		found += (siswa_daemonFind(&client, ar, id, names[i]) != NULL);
+	}
+	siswa_arUnmap(ar);
+	siswa_daemonDisconnect(&client);
+	return found;
+}
+
+static
+int benchmark(void) {
+	const char* path = "examples/decompressSegs/BossPetra.ar.00";
+	siDaemonClient client;
+	siArFile ar;
+	uint32_t id;
+	size_t found = 0, i;
+	double start, local, daemon, finds;
+	pid_t server;
+	int status;
+
+	server = fork();
+	SISWA_ASSERT(server != -1);
+	if (server == 0) {
+		exit(serve(SOCKET_PATH));
+	}
+	/* Waits for the daemon to start listening. */
+	for (i = 0; i < 1000 && !siswa_daemonConnect(&client, SOCKET_PATH); i += 1) {
+		struct timeval wait;
+		wait.tv_sec = 0;
+		wait.tv_usec = 1000;
+		select(0, NULL, NULL, NULL, &wait);
+	}
+	ar = siswa_daemonOpen(&client, path, &id);
+	SISWA_ASSERT(ar.type == SISWA_FILE_REGULAR);
+
+	start = now();
+	for (i = 0; i < BENCH_RUNS; i += 1) {
+		found += runLocal(path);
+	}
+	local = (now() - start) / BENCH_RUNS;
+
+	start = now();
+	for (i = 0; i < BENCH_RUNS; i += 1) {
+		found += runDaemon(path);
+	}
+	daemon = (now() - start) / BENCH_RUNS;
+
+	start = now();
+	for (i = 0; i < BENCH_FINDS; i += 1) {
+		found += (siswa_daemonFind(&client, ar, id, names[i % NAME_COUNT]) != NULL);
+	}
+	finds = (now() - start) / BENCH_FINDS;
+
+	printf("tool run, loading the archive itself: %10.1f us\n", local * 1e6);
+	printf("tool run, through the daemon:         %10.1f us\n", daemon * 1e6);
+	printf("lookup through the daemon:            %10.2f us (%.0f lookups/s)\n",
+		finds * 1e6, 1.0 / finds);
+	printf("%lu entries found\n", (unsigned long)found);
+
+	siswa_arUnmap(ar);
+	siswa_daemonDisconnect(&client);
+	kill(server, SIGTERM);
+	waitpid(server, &status, 0);
+	return 0;
+}
+
+
+int main(int argc, char** argv) {
+	if (argc == 1) {
+		return benchmark();
+	}
+	if (argc == 3 && strcmp(argv[1], "serve") == 0) {
+		return serve(argv[2]);
+	}
+	if ((argc == 4 && strcmp(argv[1], "list") == 0)
+			|| (argc == 5 && strcmp(argv[1], "find") == 0)) {
+		return request(argc, argv);
+	}
+
+	fprintf(stderr, "Usage: arDaemon [serve socket | list socket archive | find socket archive name]\n");
+	return 1;
+}
@@ -0,0 +1,369 @@
+#define _GNU_SOURCE
+#define SISWA_ARCHIVE_IMPLEMENTATION
+#include "libSUarchive.h"
+#include "../benchmark/bench.h"
+
+/* Differential benchmark of the built-in Deflate decoder against zlib and
+ * libdeflate. Every SEGS chunk of the given archives (BossPetra.ar.00 by default)
+ * gets decoded by each decoder, the outputs are verified to be byte-identical
+ * and the throughput is reported per decoder and per compressed chunk size.
+ *
+ * The other decoders are optional and get enabled at compile time:
+ *     gcc examples/benchDeflate/main.c -I. -DSISWA_BENCH_ZLIB -lz
+ *     gcc examples/benchDeflate/main.c -I. -DSISWA_BENCH_LIBDEFLATE -ldeflate
+ *
+ * When zlib is enabled, the XML files from 'examples/packAr' are also split into
+ * 64 KiB chunks and compressed at levels 1, 6 and 9 to widen the corpus.
+ *
+ * Usage: benchDeflate [--perf] [--iterations N] [archive.ar.00...] */
+
+#ifdef SISWA_BENCH_ZLIB
+	#include <zlib.h>
+#endif
+#ifdef SISWA_BENCH_LIBDEFLATE
+	#include <libdeflate.h>
+#endif
+
+#define countof(array) (sizeof(array) / sizeof(*array))
+#define SEGS_CHUNK_SIZE 0x10000
+
+
+typedef struct {
+	const siByte* data;
+	size_t zSize;
+	size_t size;
+	/* Set if 'data' was allocated by the benchmark itself. */
+	siBool owned;
+} chunk;
+
+typedef size_t (*decoderProc)(const chunk* c, siByte* out);
+
+typedef struct {
+	const char* name;
+	decoderProc proc;
+} decoder;
+
+typedef struct {
+	const char* name;
+	size_t maxZSize;
+} bucket;
+
+
+static chunk chunks[4096];
+static size_t chunkCount;
+
+static const bucket buckets[] = {
+	{"zsize<4K", 4 * 1024},
+	{"zsize<8K", 8 * 1024},
+	{"zsize<16K", 16 * 1024},
+	{"zsize<32K", 32 * 1024},
+	{"zsize<64K", 64 * 1024},
+};
+
+
+static
+size_t decodeBuiltin(const chunk* c, siByte* out) {
+	return siswa_decompressDeflate((siByte*)c->data, c->zSize, out, c->size);
+}
+
+#ifdef SISWA_BENCH_ZLIB
+static z_stream zlibStream;
+
+static
+size_t decodeZlib(const chunk* c, siByte* out) {
+	inflateReset(&zlibStream);
+	zlibStream.next_in = (Bytef*)c->data;
+	zlibStream.avail_in = (uInt)c->zSize;
+	zlibStream.next_out = out;
+	zlibStream.avail_out = (uInt)c->size;
+	inflate(&zlibStream, Z_FINISH);
+	return c->size - zlibStream.avail_out;
+}
+#endif
+
+#ifdef SISWA_BENCH_LIBDEFLATE
+static struct libdeflate_decompressor* libdeflateDecoder;
+
+static
+size_t decodeLibdeflate(const chunk* c, siByte* out) {
+	size_t len = 0;
+	libdeflate_deflate_decompress(libdeflateDecoder, c->data, c->zSize, out, c->size, &len);
+	return len;
+}
+#endif
+
+static const decoder decoders[] = {
+	{"builtin", decodeBuiltin},
+#ifdef SISWA_BENCH_ZLIB
+	{"zlib", decodeZlib},
+#endif
+#ifdef SISWA_BENCH_LIBDEFLATE
+	{"libdeflate", decodeLibdeflate},
+#endif
+};
+
+
+static
+size_t readBE16(const void* ptr) {
+	const siByte* p = (const siByte*)ptr;
+	return ((size_t)p[0] << 8) | p[1];
+}
+static
+size_t readBE32(const void* ptr) {
+	const siByte* p = (const siByte*)ptr;
+	return ((size_t)p[0] << 24) | ((size_t)p[1] << 16) | ((size_t)p[2] << 8) | p[3];
+}
+
+/* Adds every Deflate-compressed chunk of a SEGS archive into the corpus. */
+static
+void corpusAddSegs(siArFile ar) {
+	siSegsHeader* header = (siSegsHeader*)ar.data;
+	siSegsEntry* entry = (siSegsEntry*)(header + 1);
+	size_t i, count = readBE16(&header->chunks);
+
+	for (i = 0; i < count && chunkCount < countof(chunks); i += 1) {
+		size_t zSize = readBE16(&entry[i].zSize);
+		size_t size = readBE16(&entry[i].size);
+		size_t offset = readBE32(&entry[i].offset) - 1;
+
+		if (i == 0 && offset == 0) {
+			offset += sizeof(siSegsHeader) + count * sizeof(siSegsEntry);
+		}
+		size += (size == 0) * SEGS_CHUNK_SIZE;
+		if (size == zSize) {
+			continue; /* Stored as-is, nothing to decode. */
+		}
+
+		chunks[chunkCount].data = ar.data + offset;
+		chunks[chunkCount].zSize = zSize;
+		chunks[chunkCount].size = size;
+		chunks[chunkCount].owned = SISWA_FALSE;
+		chunkCount += 1;
+	}
+}
+
+#ifdef SISWA_BENCH_ZLIB
+/* Compresses 'data' into raw Deflate 64 KiB chunks, the same way SEGS does. */
+static
+void corpusAddCompressed(const siByte* data, size_t len, int level) {
+	size_t offset;
+
+	for (offset = 0; offset < len && chunkCount < countof(chunks); offset += SEGS_CHUNK_SIZE) {
+		z_stream stream;
+		siByte* out = (siByte*)malloc(compressBound(SEGS_CHUNK_SIZE));
+		size_t size = len - offset < SEGS_CHUNK_SIZE ? len - offset : SEGS_CHUNK_SIZE;
+
+		SISWA_MEMSET(&stream, 0, sizeof(stream));
+		deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+		stream.next_in = (Bytef*)data + offset;
+		stream.avail_in = (uInt)size;
+		stream.next_out = out;
+		stream.avail_out = (uInt)compressBound(SEGS_CHUNK_SIZE);
+		deflate(&stream, Z_FINISH);
+
+		chunks[chunkCount].data = out;
+		chunks[chunkCount].zSize = stream.total_out;
+		chunks[chunkCount].size = size;
+		chunks[chunkCount].owned = SISWA_TRUE;
+		chunkCount += 1;
+		deflateEnd(&stream);
+	}
+}
+#endif
+
+static
+size_t bucketOf(const chunk* c) {
+	size_t i;
+	for (i = 0; i < countof(buckets) - 1; i += 1) {
+		if (c->zSize < buckets[i].maxZSize) {
+			break;
+		}
+	}
+	return i;
+}
+
+/* Decodes every chunk with every decoder once and compares the outputs with
+ * the first decoder's. Returns the amount of mismatches. */
+static
+size_t verify(siByte* reference, siByte* out) {
+	size_t i, j, mismatches = 0;
+
+	for (i = 0; i < chunkCount; i += 1) {
+		size_t refLen = decoders[0].proc(&chunks[i], reference);
+		if (refLen != chunks[i].size) {
+			printf("chunk %lu: %s decoded %lu bytes, expected %lu\n", (unsigned long)i,
+				decoders[0].name, (unsigned long)refLen, (unsigned long)chunks[i].size);
+			mismatches += 1;
+		}
+
+		for (j = 1; j < countof(decoders); j += 1) {
+			size_t len = decoders[j].proc(&chunks[i], out);
+			if (len != refLen || memcmp(reference, out, len) != 0) {
+				printf("chunk %lu: '%s' and '%s' outputs differ\n", (unsigned long)i,
+					decoders[0].name, decoders[j].name);
+				mismatches += 1;
+			}
+		}
+	}
+
+	return mismatches;
+}
+
+static
+void run(const decoder* dec, size_t bucketIndex, size_t iterations, siByte* out) {
+	benchSample sample;
+	char name[64];
+	double start;
+	size_t i, it, bytes = 0;
+
+	for (i = 0; i < chunkCount; i += 1) {
+		if (bucketIndex == countof(buckets) || bucketOf(&chunks[i]) == bucketIndex) {
+			bytes += chunks[i].size;
+		}
+	}
+	if (bytes == 0) {
+		return;
+	}
+
+	sprintf(name, "%s/%s", dec->name,
+		bucketIndex == countof(buckets) ? "all" : buckets[bucketIndex].name);
+	if (!bench_selected(name)) {
+		return;
+	}
+
+	bench_perfStart();
+	start = bench_now();
+	for (it = 0; it < iterations; it += 1) {
+		for (i = 0; i < chunkCount; i += 1) {
+			if (bucketIndex == countof(buckets) || bucketOf(&chunks[i]) == bucketIndex) {
+				dec->proc(&chunks[i], out);
+			}
+		}
+	}
+	sample.seconds = bench_now() - start;
+	bench_perfStop(&sample);
+
+	bench_report(name, &sample, iterations, (double)bytes * iterations, "B",
+		(double)bytes * iterations);
+}
+
+
+int main(int argc, char** argv) {
+	siArFile ars[64];
+	size_t arCount = 0;
+	char* benchArgs[64];
+	int benchArgCount = 1;
+	size_t i, j, iterations = 20;
+	siByte* reference = (siByte*)malloc(SEGS_CHUNK_SIZE);
+	siByte* out = (siByte*)malloc(SEGS_CHUNK_SIZE);
+
+	/* Archives get opened, everything else is left for the harness. */
+	benchArgs[0] = argv[0];
+	for (i = 1; i < (size_t)argc; i += 1) {
+		if (strstr(argv[i], ".ar") != NULL && arCount < countof(ars)) {
+			ars[arCount] = siswa_arMake(argv[i]);
+			arCount += 1;
+		}
+		else if (benchArgCount < (int)countof(benchArgs)) {
+			benchArgs[benchArgCount] = argv[i];
+			benchArgCount += 1;
+		}
+	}
+	if (arCount == 0) {
+		ars[0] = siswa_arMake("examples/decompressSegs/BossPetra.ar.00");
+		arCount = 1;
+	}
+
+	bench_init(benchArgCount, benchArgs);
+	if (bench_iterations != 0) {
+		iterations = bench_iterations;
+	}
+
+	for (i = 0; i < arCount; i += 1) {
+		if (ars[i].type != SISWA_FILE_SEGS) {
+			fprintf(stderr, "Archive #%lu is not SEGS compressed, skipping.\n", (unsigned long)i);
+			continue;
+		}
+		corpusAddSegs(ars[i]);
+	}
+
+#ifdef SISWA_BENCH_ZLIB
+	SISWA_MEMSET(&zlibStream, 0, sizeof(zlibStream));
+	inflateInit2(&zlibStream, -15);
+	{
+		static const char* xmls[] = {
+			"examples/packAr/area22_enemyset.set.xml",
+			"examples/packAr/area03_gimmickset.set.xml",
+			"examples/packAr/system.set.xml",
+			"examples/packAr/BaseEvil.set.xml",
+		};
+		static const int levels[] = {1, 6, 9};
+
+		for (i = 0; i < countof(xmls); i += 1) {
+			FILE* file = fopen(xmls[i], "rb");
+			siByte* data;
+			size_t len;
+
+			SISWA_ASSERT_NOT_NULL(file);
+			fseek(file, 0, SEEK_END);
+			len = ftell(file);
+			rewind(file);
+			data = (siByte*)malloc(len);
+			fread(data, len, 1, file);
+			fclose(file);
+
+			for (j = 0; j < countof(levels); j += 1) {
+				corpusAddCompressed(data, len, levels[j]);
+			}
+			free(data);
+		}
+	}
+#endif
+#ifdef SISWA_BENCH_LIBDEFLATE
+	libdeflateDecoder = libdeflate_alloc_decompressor();
+#endif
+
+	{
+		size_t zBytes = 0, bytes = 0;
+		for (i = 0; i < chunkCount; i += 1) {
+			zBytes += chunks[i].zSize;
+			bytes += chunks[i].size;
+		}
+		printf("Corpus: %lu chunks, %lu compressed bytes, %lu decompressed bytes.\n",
+			(unsigned long)chunkCount, (unsigned long)zBytes, (unsigned long)bytes);
+	}
+
+	{
+		size_t mismatches = verify(reference, out);
+		printf("Verification: %s (%lu mismatches).\n", mismatches ? "FAILED" : "OK",
+			(unsigned long)mismatches);
+		if (mismatches) {
+			return 1;
+		}
+	}
+
+	for (j = 0; j < countof(buckets) + 1; j += 1) {
+		for (i = 0; i < countof(decoders); i += 1) {
+			run(&decoders[i], j, iterations, out);
+		}
+	}
+
+#ifdef SISWA_BENCH_ZLIB
+	inflateEnd(&zlibStream);
+#endif
+#ifdef SISWA_BENCH_LIBDEFLATE
+	libdeflate_free_decompressor(libdeflateDecoder);
+#endif
+	for (i = 0; i < chunkCount; i += 1) {
+		if (chunks[i].owned) {
+			free((void*)chunks[i].data);
+		}
+	}
+	for (i = 0; i < arCount; i += 1) {
+		free(ars[i].data);
+	}
+	free(reference);
+	free(out);
+
+	return 0;
+}
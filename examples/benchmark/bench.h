@@ -0,0 +1,283 @@
+/*
+bench.h - a tiny benchmark harness shared by the siswa benchmark programs.
+
+Every benchmark is timed with the wall clock. On Linux the harness can also
+read hardware performance counters through 'perf_event_open' (cycles,
+instructions, branch misses, L1D read misses and last level cache misses),
+which is enabled either with the '--perf' argument or by setting the
+'SISWA_BENCH_PERF' environment variable. Counters that the CPU or the kernel
+doesn't support (or that 'perf_event_paranoid' forbids) are simply left out
+of the report.
+
+The header must be included _after_ libSUarchive.h, in exactly one file.
+*/
+#ifndef SISWA_BENCH_H
+#define SISWA_BENCH_H
+
+#if defined(__linux__)
+	#include <unistd.h>
+	#include <sys/ioctl.h>
+	#include <sys/syscall.h>
+	#include <linux/perf_event.h>
+	#define SISWA_BENCH_HAS_PERF
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+	#include <time.h>
+	#include <sys/time.h>
+#else
+	#include <time.h>
+#endif
+
+
+typedef enum {
+	BENCH_CYCLES = 0,
+	BENCH_INSTRUCTIONS,
+	BENCH_BRANCH_MISSES,
+	BENCH_L1D_MISSES,
+	BENCH_LLC_MISSES,
+	BENCH_COUNTER_COUNT
+} benchCounter;
+
+static const char* bench_counterNames[BENCH_COUNTER_COUNT] = {
+	"cycles", "instructions", "branch-misses", "L1D-misses", "LLC-misses"
+};
+
+typedef struct {
+	/* Wall clock time of the entire measured run. */
+	double seconds;
+	/* Counter values, scaled when the kernel had to multiplex them. */
+	uint64_t counters[BENCH_COUNTER_COUNT];
+	/* Which of the counters actually got measured. */
+	siBool hasCounter[BENCH_COUNTER_COUNT];
+} benchSample;
+
+typedef void (*benchProc)(void* user);
+
+#if defined(__GNUC__) || defined(__clang__)
+	#define BENCH_FUNC static __attribute__((unused))
+#else
+	#define BENCH_FUNC static
+#endif
+
+static siBool bench_perfEnabled = SISWA_FALSE;
+static int bench_perfFds[BENCH_COUNTER_COUNT] = {-1, -1, -1, -1, -1};
+static size_t bench_iterations = 0;
+static const char* const* bench_filters = NULL;
+static size_t bench_filterCount = 0;
+
+
+BENCH_FUNC
+double bench_now(void) {
+#if defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#elif defined(__unix__) || defined(__APPLE__)
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+#else
+	return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+#ifdef SISWA_BENCH_HAS_PERF
+BENCH_FUNC
+int bench_perfOpen(uint32_t type, uint64_t config) {
+	struct perf_event_attr attr;
+	SISWA_MEMSET(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+/* Opens every supported counter. Returns 'SISWA_FALSE' if none of them could
+ * be opened, in which case only the wall clock gets reported. */
+BENCH_FUNC
+siBool bench_perfInit(void) {
+#ifdef SISWA_BENCH_HAS_PERF
+	size_t i;
+	siBool any = SISWA_FALSE;
+
+	bench_perfFds[BENCH_CYCLES] = bench_perfOpen(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+	bench_perfFds[BENCH_INSTRUCTIONS] = bench_perfOpen(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+	bench_perfFds[BENCH_BRANCH_MISSES] = bench_perfOpen(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+	bench_perfFds[BENCH_L1D_MISSES] = bench_perfOpen(
+		PERF_TYPE_HW_CACHE,
+		PERF_COUNT_HW_CACHE_L1D
+			| (PERF_COUNT_HW_CACHE_OP_READ << 8)
+			| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+	);
+	bench_perfFds[BENCH_LLC_MISSES] = bench_perfOpen(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+
+	for (i = 0; i < BENCH_COUNTER_COUNT; i += 1) {
+		if (bench_perfFds[i] < 0) {
+			fprintf(stderr, "bench: counter '%s' is unavailable.\n", bench_counterNames[i]);
+		}
+		else {
+			any = SISWA_TRUE;
+		}
+	}
+	bench_perfEnabled = any;
+	return any;
+#else
+	fprintf(stderr, "bench: hardware counters are only supported on Linux.\n");
+	return SISWA_FALSE;
+#endif
+}
+
+BENCH_FUNC
+void bench_perfStart(void) {
+#ifdef SISWA_BENCH_HAS_PERF
+	size_t i;
+	for (i = 0; i < BENCH_COUNTER_COUNT && bench_perfEnabled; i += 1) {
+		if (bench_perfFds[i] >= 0) {
+			ioctl(bench_perfFds[i], PERF_EVENT_IOC_RESET, 0);
+			ioctl(bench_perfFds[i], PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+#endif
+}
+
+BENCH_FUNC
+void bench_perfStop(benchSample* sample) {
+	size_t i;
+	for (i = 0; i < BENCH_COUNTER_COUNT; i += 1) {
+		sample->counters[i] = 0;
+		sample->hasCounter[i] = SISWA_FALSE;
+	}
+
+#ifdef SISWA_BENCH_HAS_PERF
+	for (i = 0; i < BENCH_COUNTER_COUNT && bench_perfEnabled; i += 1) {
+		uint64_t values[3]; /* value, time enabled, time running */
+		if (bench_perfFds[i] < 0) {
+			continue;
+		}
+		ioctl(bench_perfFds[i], PERF_EVENT_IOC_DISABLE, 0);
+
+		if (read(bench_perfFds[i], values, sizeof(values)) != sizeof(values) || values[2] == 0) {
+			continue;
+		}
+		sample->counters[i] = values[2] < values[1]
+			? (uint64_t)((double)values[0] * ((double)values[1] / (double)values[2]))
+			: values[0];
+		sample->hasCounter[i] = SISWA_TRUE;
+	}
+#endif
+}
+
+/* Parses the common benchmark arguments ('--perf', '--iterations N') and
+ * treats everything else as a filter for the benchmark names. */
+BENCH_FUNC
+void bench_init(int argc, char** argv) {
+	int i;
+	static const char* filters[64];
+	const char* env = getenv("SISWA_BENCH_PERF");
+	siBool perf = (env != NULL && *env != '\0' && *env != '0');
+
+	for (i = 1; i < argc; i += 1) {
+		if (strcmp(argv[i], "--perf") == 0) {
+			perf = SISWA_TRUE;
+		}
+		else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+			i += 1;
+			bench_iterations = (size_t)strtoul(argv[i], NULL, 10);
+		}
+		else if (bench_filterCount < sizeof(filters) / sizeof(*filters)) {
+			filters[bench_filterCount] = argv[i];
+			bench_filterCount += 1;
+		}
+	}
+	bench_filters = filters;
+
+	if (perf) {
+		bench_perfInit();
+	}
+}
+
+BENCH_FUNC
+siBool bench_selected(const char* name) {
+	size_t i;
+	if (bench_filterCount == 0) {
+		return SISWA_TRUE;
+	}
+
+	for (i = 0; i < bench_filterCount; i += 1) {
+		if (strstr(name, bench_filters[i]) != NULL) {
+			return SISWA_TRUE;
+		}
+	}
+	return SISWA_FALSE;
+}
+
+/* Prints a sample. 'units' is the amount of work done by the entire run (bytes,
+ * entries, lookups...) named by 'unitName', so that the counters can be
+ * reported per unit. 'bytes' is used for the throughput and can be 0. */
+BENCH_FUNC
+void bench_report(const char* name, const benchSample* s, size_t iterations,
+		double units, const char* unitName, double bytes) {
+	printf("%-36s %12.3f us/iter", name, s->seconds * 1e6 / (double)iterations);
+	if (bytes != 0) {
+		printf(" %10.2f MB/s", bytes / s->seconds / (1024.0 * 1024.0));
+	}
+	printf(" %9.2f ns/%s", s->seconds * 1e9 / units, unitName);
+
+	if (s->hasCounter[BENCH_CYCLES] && s->hasCounter[BENCH_INSTRUCTIONS]
+			&& s->counters[BENCH_CYCLES] != 0) {
+		printf(" | IPC %.2f", (double)s->counters[BENCH_INSTRUCTIONS] / (double)s->counters[BENCH_CYCLES]);
+		printf(", cycles/%s %.2f", unitName, (double)s->counters[BENCH_CYCLES] / units);
+	}
+	if (s->hasCounter[BENCH_BRANCH_MISSES]) {
+		printf(", br-miss/%s %.4f", unitName, (double)s->counters[BENCH_BRANCH_MISSES] / units);
+	}
+	if (s->hasCounter[BENCH_L1D_MISSES]) {
+		printf(", L1D-miss/%s %.4f", unitName, (double)s->counters[BENCH_L1D_MISSES] / units);
+	}
+	if (s->hasCounter[BENCH_LLC_MISSES]) {
+		printf(", LLC-miss/%s %.5f", unitName, (double)s->counters[BENCH_LLC_MISSES] / units);
+	}
+	printf("\n");
+}
+
+/* Runs 'proc' once as a warm-up and then 'iterations' times while measuring,
+ * unless '--iterations' overrode the count. 'unitsPerIter' and 'bytesPerIter'
+ * describe the work done by a single call of 'proc'. */
+BENCH_FUNC
+void bench_run(const char* name, benchProc proc, void* user, size_t iterations,
+		double unitsPerIter, const char* unitName, double bytesPerIter) {
+	benchSample sample;
+	double start;
+	size_t i;
+
+	if (!bench_selected(name)) {
+		return;
+	}
+	if (bench_iterations != 0) {
+		iterations = bench_iterations;
+	}
+
+	proc(user);
+
+	bench_perfStart();
+	start = bench_now();
+	for (i = 0; i < iterations; i += 1) {
+		proc(user);
+	}
+	sample.seconds = bench_now() - start;
+	bench_perfStop(&sample);
+
+	bench_report(
+		name, &sample, iterations, unitsPerIter * (double)iterations, unitName,
+		bytesPerIter * (double)iterations
+	);
+}
+
+#endif /* SISWA_BENCH_H */
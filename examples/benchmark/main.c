@@ -0,0 +1,633 @@
+#define _GNU_SOURCE
+#define SISWA_ARCHIVE_IMPLEMENTATION
+#define SISWA_USE_THREADS
+#include "libSUarchive.h"
+#include "bench.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+	#include <emmintrin.h>
+#endif
+
+/* Usage: benchmark [--perf] [--iterations N] [name filters...]
+ * Must be ran from the root of the repository, like the other examples, and
+ * linked with '-lpthread'. */
+
+
+typedef struct {
+	siArFile segs;
+	siByte* out;
+	size_t outLen;
+} decompressCtx;
+
+typedef struct {
+	siArFile ar;
+	size_t entryCount;
+	const char** names;
+} archiveCtx;
+
+typedef struct {
+	siArFile ars[3];
+	siByte* out;
+	size_t cap;
+} mergeCtx;
+
+typedef struct {
+	siArFile ar;
+	siArFile segs;
+	siByte* decompressed;
+	siManifestEntry* entries;
+	siByte* sha256;
+	size_t capacity;
+	size_t threads;
+} manifestCtx;
+
+typedef struct {
+	siArFile a;
+	siArFile b;
+	siManifestEntry* manifestA;
+	siManifestEntry* manifestB;
+	siDiffEntry changes[16];
+} diffCtx;
+
+typedef struct {
+	siArFile a;
+	siArFile b;
+	siMemoryStream patch;
+	siMemoryStream out;
+} patchCtx;
+
+typedef struct {
+	char* names;
+	size_t* lens;
+	size_t count;
+	size_t bytes;
+} hashCtx;
+
+typedef struct {
+	siArFile ar;
+	/* Names of the entries needed by every load, 'loadSize' names per load. */
+	const char** names;
+	size_t loadCount;
+	size_t loadSize;
+	/* Which 64 KiB chunks the current load already fetched. */
+	siByte* fetched;
+	siByte* chunk;
+	size_t chunksFetched;
+} replayCtx;
+
+typedef struct {
+	int fd;
+	size_t len;
+	/* Where entries that aren't aligned to 16 get copied to before being read. */
+	siByte* scratch;
+	size_t copied;
+} mappedCtx;
+
+
+static volatile size_t sink;
+
+
+static
+void bench_decompressSegs(void* user) {
+	decompressCtx* ctx = (decompressCtx*)user;
+	siArFile ar = ctx->segs;
+	siswa_arDecompressSegs(&ar, ctx->out, ctx->outLen, SISWA_FALSE);
+	sink += ar.len;
+}
+
+static
+void bench_entryPoll(void* user) {
+	archiveCtx* ctx = (archiveCtx*)user;
+	siArEntry* entry;
+	size_t total = 0;
+
+	while (siswa_arEntryPoll(&ctx->ar, &entry)) {
+		total += siswa_arEntryGetDataSize(entry);
+	}
+	sink += total;
+}
+
+static
+void bench_entryFind(void* user) {
+	archiveCtx* ctx = (archiveCtx*)user;
+	size_t i;
+
+	for (i = 0; i < ctx->entryCount; i += 1) {
+		sink += (size_t)siswa_arEntryFind(ctx->ar, ctx->names[i]);
+	}
+}
+
+static
+void bench_merge(void* user) {
+	mergeCtx* ctx = (mergeCtx*)user;
+	siArFile res = siswa_arMergeMul(ctx->ars, 3, ctx->out, ctx->cap);
+	sink += res.len;
+}
+
+
+static
+void bench_manifest(void* user) {
+	manifestCtx* ctx = (manifestCtx*)user;
+	sink += siswa_arManifestEx(ctx->ar, ctx->entries, ctx->capacity, ctx->sha256, ctx->threads);
+}
+
+/* Decompressing first and hashing afterwards, which goes over the data twice. */
+static
+void bench_manifestTwoPass(void* user) {
+	manifestCtx* ctx = (manifestCtx*)user;
+	siArFile ar = ctx->segs;
+	siswa_arDecompressSegs(&ar, ctx->decompressed, ctx->ar.len, SISWA_FALSE);
+	sink += siswa_arManifest(ar, ctx->entries, ctx->capacity);
+}
+
+static
+void bench_manifestSegs(void* user) {
+	manifestCtx* ctx = (manifestCtx*)user;
+	sink += siswa_arManifestSegs(ctx->segs, ctx->entries, ctx->capacity, NULL);
+}
+
+static
+void bench_diff(void* user) {
+	diffCtx* ctx = (diffCtx*)user;
+	sink += siswa_arDiffEx(ctx->a, ctx->manifestA, ctx->b, ctx->manifestB, ctx->changes, 16, 1);
+}
+
+static
+void bench_patchCreate(void* user) {
+	patchCtx* ctx = (patchCtx*)user;
+	ctx->patch.len = 0;
+	sink += siswa_arPatchCreate(ctx->a, ctx->b, siswa_memoryWrite, &ctx->patch);
+}
+
+static
+void bench_patchApply(void* user) {
+	patchCtx* ctx = (patchCtx*)user;
+	ctx->patch.pos = 0;
+	ctx->out.len = 0;
+	sink += siswa_arPatchApply(ctx->a, siswa_memoryRead, &ctx->patch, siswa_memoryWrite, &ctx->out);
+}
+
+/* Replays the loads of a trace, fetching every 64 KiB chunk that a load needs
+ * once. Fetching a chunk is just a copy here, the lowest that decompressing a
+ * SEGS chunk could ever cost. */
+static
+void bench_replay(void* user) {
+	replayCtx* ctx = (replayCtx*)user;
+	size_t chunkCount = (ctx->ar.len + 0xFFFF) / 0x10000;
+	size_t load, i, c;
+
+	ctx->chunksFetched = 0;
+	for (load = 0; load < ctx->loadCount; load += 1) {
+		SISWA_MEMSET(ctx->fetched, 0, chunkCount);
+
+		for (i = 0; i < ctx->loadSize; i += 1) {
+			siArEntry* entry = siswa_arEntryFind(ctx->ar, ctx->names[load * ctx->loadSize + i]);
+			size_t start = (size_t)((siByte*)entry - ctx->ar.data);
+			size_t end = start + siswa_arEntryGetSize(entry);
+
+			for (c = start / 0x10000; c <= (end - 1) / 0x10000; c += 1) {
+				size_t len = ctx->ar.len - c * 0x10000;
+				if (ctx->fetched[c]) {
+					continue;
+				}
+				ctx->fetched[c] = SISWA_TRUE;
+				SISWA_MEMCPY(ctx->chunk, &ctx->ar.data[c * 0x10000], len < 0x10000 ? len : 0x10000);
+				ctx->chunksFetched += 1;
+			}
+			sink += ((siByte*)siswa_arEntryGetData(entry))[0];
+		}
+	}
+}
+
+/* Counts the '<' characters of 16 byte aligned data with aligned loads, like a
+ * SIMD parser that only takes aligned input would. */
+static
+size_t countTags(const siByte* data, size_t len) {
+	size_t count = 0, i = 0;
+#ifdef __SSE2__
+	const __m128i tag = _mm_set1_epi8('<');
+	for (; i + 16 <= len; i += 16) {
+		__m128i block = _mm_load_si128((const __m128i*)&data[i]);
+		int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, tag));
+		while (mask != 0) {
+			count += 1;
+			mask &= mask - 1;
+		}
+	}
+#endif
+	for (; i < len; i += 1) {
+		count += (data[i] == '<');
+	}
+	return count;
+}
+
+/* Maps the archive and reads every entry in place, unless the entry's data
+ * isn't aligned to 16, in which case it has to be copied out first. */
+static
+void bench_mapped(void* user) {
+	mappedCtx* ctx = (mappedCtx*)user;
+	void* map = mmap(NULL, ctx->len, PROT_READ, MAP_PRIVATE, ctx->fd, 0);
+	siArFile ar;
+	siArEntry* entry;
+
+	SISWA_ASSERT(map != MAP_FAILED);
+	ar = siswa_arMakeBuffer(map, ctx->len);
+	ctx->copied = 0;
+
+	while (siswa_arEntryPoll(&ar, &entry)) {
+		const siByte* data = (const siByte*)siswa_arEntryGetData(entry);
+		if (((size_t)data & 15) != 0) {
+			SISWA_MEMCPY(ctx->scratch, data, siswa_arEntryGetDataSize(entry));
+			data = ctx->scratch;
+			ctx->copied += 1;
+		}
+		sink += countTags(data, siswa_arEntryGetDataSize(entry));
+	}
+	munmap(map, ctx->len);
+}
+
+/* The FNV-1a hash used before 'siswa_hash64', kept as a reference point. */
+static
+uint64_t hashFnv1a(const char* key, size_t len) {
+	uint64_t hash = ((uint64_t)0xcbf29ce4 << 32) | 0x84222325;
+	const char* p;
+	for (p = key; p < key + len; p++) {
+		hash ^= (uint64_t)(siByte)*p;
+		hash *= ((uint64_t)0x100 << 32) | 0x1b3;
+	}
+	return hash;
+}
+
+static
+void bench_hashFnv1a(void* user) {
+	hashCtx* ctx = (hashCtx*)user;
+	const char* name = ctx->names;
+	uint64_t total = 0;
+	size_t i;
+
+	for (i = 0; i < ctx->count; i += 1) {
+		total += hashFnv1a(name, ctx->lens[i]);
+		name += ctx->lens[i];
+	}
+	sink += (size_t)total;
+}
+
+static
+void bench_hash64(void* user) {
+	hashCtx* ctx = (hashCtx*)user;
+	const char* name = ctx->names;
+	uint64_t total = 0;
+	size_t i;
+
+	for (i = 0; i < ctx->count; i += 1) {
+		total += siswa_hash64(name, ctx->lens[i], 0);
+		name += ctx->lens[i];
+	}
+	sink += (size_t)total;
+}
+
+
+/* Generates 'count' names of 'minLen' to 'maxLen' characters, made to look like
+ * the asset paths found inside of the archives. */
+static
+void hashCtxMake(hashCtx* ctx, size_t count, size_t minLen, size_t maxLen) {
+	static const char chars[] = "abcdefghijklmnopqrstuvwxyz0123456789_/.";
+	uint32_t seed = 0x9e3779b9;
+	size_t i, j;
+	char* name;
+
+	ctx->count = count;
+	ctx->bytes = 0;
+	ctx->lens = (size_t*)malloc(count * sizeof(size_t));
+	for (i = 0; i < count; i += 1) {
+		seed = seed * 1664525 + 1013904223;
+		ctx->lens[i] = minLen + (seed >> 8) % (maxLen - minLen + 1);
+		ctx->bytes += ctx->lens[i];
+	}
+
+	ctx->names = (char*)malloc(ctx->bytes);
+	name = ctx->names;
+	for (i = 0; i < count; i += 1) {
+		for (j = 0; j < ctx->lens[i]; j += 1) {
+			seed = seed * 1664525 + 1013904223;
+			name[j] = chars[(seed >> 8) % (sizeof(chars) - 1)];
+		}
+		name += ctx->lens[i];
+	}
+}
+
+static
+void hashCtxFree(hashCtx* ctx) {
+	free(ctx->names);
+	free(ctx->lens);
+}
+
+static
+void archiveCtxMake(archiveCtx* ctx, siArFile ar) {
+	siArEntry* entry;
+	size_t i = 0;
+
+	ctx->ar = ar;
+	ctx->entryCount = siswa_arGetEntryCount(ar);
+	ctx->names = (const char**)malloc(ctx->entryCount * sizeof(const char*));
+
+	while (siswa_arEntryPoll(&ctx->ar, &entry)) {
+		ctx->names[i] = siswa_arEntryGetName(entry);
+		i += 1;
+	}
+}
+
+
+int main(int argc, char** argv) {
+	static const struct { const char* fnv; const char* hash; size_t min, max; } hashes[] = {
+		{"hash/fnv1a/short", "hash/siswa/short", 4, 16},
+		{"hash/fnv1a/medium", "hash/siswa/medium", 17, 48},
+		{"hash/fnv1a/long", "hash/siswa/long", 49, 160}
+	};
+	decompressCtx segs;
+	archiveCtx petra, pan;
+	mergeCtx merge;
+	manifestCtx manifest;
+	diffCtx diff;
+	patchCtx patch;
+	replayCtx replay;
+	hashCtx hash;
+	mappedCtx mapped;
+	siArFile decompressed;
+	size_t i;
+
+	bench_init(argc, argv);
+
+	segs.segs = siswa_arMake("examples/decompressSegs/BossPetra.ar.00");
+	segs.outLen = (size_t)siswa_arGetDecompressedSize(segs.segs);
+	segs.out = (siByte*)malloc(segs.outLen);
+	bench_run(
+		"decompressSegs/BossPetra", bench_decompressSegs, &segs, 50,
+		(double)segs.outLen, "B", (double)segs.outLen
+	);
+
+	decompressed = segs.segs;
+	siswa_arDecompressSegs(&decompressed, segs.out, segs.outLen, SISWA_FALSE);
+	archiveCtxMake(&petra, decompressed);
+	archiveCtxMake(&pan, siswa_arMake("examples/unpackAr/pan.ar.00"));
+
+	bench_run(
+		"entryPoll/BossPetra", bench_entryPoll, &petra, 100000,
+		(double)petra.entryCount, "entry", 0
+	);
+	bench_run(
+		"entryPoll/pan", bench_entryPoll, &pan, 100000,
+		(double)pan.entryCount, "entry", 0
+	);
+
+	/* The same loops on validated archives, which skip the bounds checks. */
+	siswa_arValidate(&petra.ar);
+	siswa_arValidate(&pan.ar);
+	bench_run(
+		"entryPoll/BossPetra/validated", bench_entryPoll, &petra, 100000,
+		(double)petra.entryCount, "entry", 0
+	);
+	bench_run(
+		"entryPoll/pan/validated", bench_entryPoll, &pan, 100000,
+		(double)pan.entryCount, "entry", 0
+	);
+	bench_run(
+		"entryFind/BossPetra", bench_entryFind, &petra, 10000,
+		(double)petra.entryCount, "lookup", 0
+	);
+	bench_run(
+		"entryFind/pan", bench_entryFind, &pan, 100000,
+		(double)pan.entryCount, "lookup", 0
+	);
+
+	merge.ars[0] = siswa_arMake("examples/mergeAr/test.ar.00");
+	merge.ars[1] = siswa_arMake("examples/mergeAr/gimmickSet.ar.00");
+	merge.ars[2] = siswa_arMake("examples/mergeAr/anotherGimmickSet.ar.00");
+	merge.cap = merge.ars[0].len + merge.ars[1].len + merge.ars[2].len;
+	merge.out = (siByte*)malloc(merge.cap);
+	bench_run(
+		"merge/mergeAr", bench_merge, &merge, 100000,
+		3, "archive", (double)merge.cap
+	);
+
+	/* Content hashing of every entry, serially, in parallel and while decompressing. */
+	manifest.ar = petra.ar;
+	manifest.segs = segs.segs;
+	manifest.decompressed = (siByte*)malloc(segs.outLen);
+	manifest.capacity = petra.entryCount;
+	manifest.entries = (siManifestEntry*)malloc(manifest.capacity * sizeof(siManifestEntry));
+	manifest.sha256 = NULL;
+	manifest.threads = 1;
+	bench_run(
+		"manifest/BossPetra/xxh64", bench_manifest, &manifest, 200,
+		(double)petra.ar.len, "B", (double)petra.ar.len
+	);
+	manifest.threads = 4;
+	bench_run(
+		"manifest/BossPetra/xxh64/4threads", bench_manifest, &manifest, 200,
+		(double)petra.ar.len, "B", (double)petra.ar.len
+	);
+	manifest.sha256 = (siByte*)malloc(manifest.capacity * SISWA_SHA256_SIZE);
+	manifest.threads = 1;
+	bench_run(
+		"manifest/BossPetra/sha256", bench_manifest, &manifest, 20,
+		(double)petra.ar.len, "B", (double)petra.ar.len
+	);
+	bench_run(
+		"manifest/BossPetra/twoPass", bench_manifestTwoPass, &manifest, 50,
+		(double)petra.ar.len, "B", (double)petra.ar.len
+	);
+	bench_run(
+		"manifest/BossPetra/segs", bench_manifestSegs, &manifest, 50,
+		(double)petra.ar.len, "B", (double)petra.ar.len
+	);
+	free(manifest.sha256);
+	free(manifest.entries);
+	free(manifest.decompressed);
+
+	/* Diffing two versions of BossPetra, with one entry changed. */
+	diff.a = petra.ar;
+	diff.b = siswa_arMakeBufferEx(
+		SISWA_MEMCPY(malloc(petra.ar.len), petra.ar.data, petra.ar.len),
+		petra.ar.len, petra.ar.len
+	);
+	{
+		siArEntry* entry = siswa_arEntryFind(diff.b, petra.names[petra.entryCount / 2]);
+		((siByte*)siswa_arEntryGetData(entry))[0] ^= 1;
+	}
+	diff.manifestA = NULL;
+	diff.manifestB = NULL;
+	bench_run(
+		"diff/BossPetra", bench_diff, &diff, 200,
+		(double)petra.entryCount, "entry", (double)petra.ar.len * 2
+	);
+	diff.manifestA = (siManifestEntry*)malloc(petra.entryCount * sizeof(siManifestEntry));
+	diff.manifestB = (siManifestEntry*)malloc(petra.entryCount * sizeof(siManifestEntry));
+	siswa_arManifest(diff.a, diff.manifestA, petra.entryCount);
+	siswa_arManifest(diff.b, diff.manifestB, petra.entryCount);
+	bench_run(
+		"diff/BossPetra/cachedManifests", bench_diff, &diff, 20000,
+		(double)petra.entryCount, "entry", 0
+	);
+	free(diff.manifestA);
+	free(diff.manifestB);
+
+	/* Patching BossPetra, with a byte changed in every 7th entry. */
+	patch.a = petra.ar;
+	patch.b = diff.b;
+	{
+		siArEntry* entry;
+		size_t i = 0;
+		while (siswa_arEntryPoll(&patch.b, &entry)) {
+			if (i % 7 == 0 && siswa_arEntryGetDataSize(entry) != 0) {
+				((siByte*)siswa_arEntryGetData(entry))[siswa_arEntryGetDataSize(entry) / 2] ^= 1;
+			}
+			i += 1;
+		}
+	}
+	patch.patch.cap = petra.ar.len;
+	patch.patch.data = (siByte*)malloc(patch.patch.cap);
+	patch.patch.len = patch.patch.pos = 0;
+	patch.out.cap = petra.ar.len;
+	patch.out.data = (siByte*)malloc(patch.out.cap);
+	patch.out.len = patch.out.pos = 0;
+	bench_run(
+		"patch/create/BossPetra", bench_patchCreate, &patch, 100,
+		(double)petra.ar.len, "B", (double)petra.ar.len
+	);
+	bench_run(
+		"patch/apply/BossPetra", bench_patchApply, &patch, 500,
+		(double)petra.ar.len, "B", (double)petra.ar.len
+	);
+	SISWA_ASSERT(patch.out.len == petra.ar.len || !bench_selected("patch/apply/BossPetra"));
+	free(patch.out.data);
+	free(patch.patch.data);
+	free(diff.b.data);
+
+	/* A trace of 4 loads, each needing 'Stage.stg.xml' and 12 scattered entries,
+	 * replayed against the original order and the order from the trace. */
+	{
+		static const size_t starts[] = {3, 40, 90, 150};
+		size_t load, j, originalChunks;
+		siMemoryStream reordered;
+
+		replay.loadCount = sizeof(starts) / sizeof(*starts);
+		replay.loadSize = 13;
+		replay.names = (const char**)malloc(replay.loadCount * replay.loadSize * sizeof(const char*));
+		for (load = 0; load < replay.loadCount; load += 1) {
+			replay.names[load * replay.loadSize] = "Stage.stg.xml";
+			for (j = 1; j < replay.loadSize; j += 1) {
+				replay.names[load * replay.loadSize + j] =
+					petra.names[(starts[load] + (j - 1) * 17) % petra.entryCount];
+			}
+		}
+		replay.fetched = (siByte*)malloc(petra.ar.len / 0x10000 + 1);
+		replay.chunk = (siByte*)malloc(0x10000);
+
+		replay.ar = petra.ar;
+		bench_run(
+			"trace/replay/original", bench_replay, &replay, 2000,
+			(double)replay.loadCount, "load", 0
+		);
+		originalChunks = replay.chunksFetched;
+
+		reordered.cap = petra.ar.len + (petra.entryCount + 1) * 64;
+		reordered.data = (siByte*)malloc(reordered.cap);
+		reordered.len = reordered.pos = 0;
+		siswa_arReorder(
+			petra.ar, replay.names, replay.loadCount * replay.loadSize,
+			siswa_memoryWrite, &reordered
+		);
+		replay.ar = siswa_arMakeBuffer(reordered.data, reordered.len);
+		siswa_arValidate(&replay.ar);
+		bench_run(
+			"trace/replay/reordered", bench_replay, &replay, 2000,
+			(double)replay.loadCount, "load", 0
+		);
+		if (bench_selected("trace/replay/")) {
+			printf("trace/replay: %lu chunks fetched originally, %lu reordered\n",
+				(unsigned long)originalChunks, (unsigned long)replay.chunksFetched);
+		}
+
+		free(reordered.data);
+		free(replay.chunk);
+		free(replay.fetched);
+		free((void*)replay.names);
+	}
+
+	/* BossPetra laid out again with its data packed right after the names and
+	 * aligned to 16, 64 and 4096 bytes, then mapped from a file and read. */
+	{
+		static const struct { const char* name; uint32_t alignment; } layouts[] = {
+			{"mmap/read/packed", 1}, {"mmap/read/align16", 16},
+			{"mmap/read/align64", 64}, {"mmap/read/align4096", 4096}
+		};
+		size_t cap = petra.ar.len + (petra.entryCount + 1) * 4096, maxSize = 0;
+		siByte* buffer = (siByte*)malloc(cap);
+		siArEntry* entry;
+
+		while (siswa_arEntryPoll(&petra.ar, &entry)) {
+			size_t size = siswa_arEntryGetDataSize(entry);
+			maxSize = (size > maxSize) ? size : maxSize;
+		}
+		mapped.scratch = (siByte*)malloc(maxSize + 16);
+
+		for (i = 0; i < sizeof(layouts) / sizeof(*layouts); i += 1) {
+			siArFile laidOut;
+			FILE* file;
+
+			if (!bench_selected(layouts[i].name)) {
+				continue;
+			}
+			laidOut = siswa_arMergeMulEx(&petra.ar, 1, buffer, cap, layouts[i].alignment);
+			file = tmpfile();
+			SISWA_ASSERT_NOT_NULL(file);
+			fwrite(laidOut.data, laidOut.len, 1, file);
+			fflush(file);
+
+			mapped.fd = fileno(file);
+			mapped.len = laidOut.len;
+			bench_run(
+				layouts[i].name, bench_mapped, &mapped, 500,
+				(double)petra.entryCount, "entry", (double)petra.ar.len
+			);
+			printf("%s: %lu bytes, %lu of %lu entries copied\n", layouts[i].name,
+				(unsigned long)laidOut.len, (unsigned long)mapped.copied,
+				(unsigned long)petra.entryCount);
+			fclose(file);
+		}
+
+		free(mapped.scratch);
+		free(buffer);
+	}
+
+	/* Name hashing over short, medium and long names. */
+	for (i = 0; i < sizeof(hashes) / sizeof(*hashes); i += 1) {
+		hashCtxMake(&hash, 4096, hashes[i].min, hashes[i].max);
+		bench_run(
+			hashes[i].fnv, bench_hashFnv1a, &hash, 2000,
+			(double)hash.count, "name", (double)hash.bytes
+		);
+		bench_run(
+			hashes[i].hash, bench_hash64, &hash, 2000,
+			(double)hash.count, "name", (double)hash.bytes
+		);
+		hashCtxFree(&hash);
+	}
+
+	free(merge.out);
+	free(merge.ars[0].data);
+	free(merge.ars[1].data);
+	free(merge.ars[2].data);
+	free((void*)pan.names);
+	free((void*)petra.names);
+	free(pan.ar.data);
+	free(segs.out);
+	free(segs.segs.data);
+
+	return 0;
+}
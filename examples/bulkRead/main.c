@@ -0,0 +1,207 @@
+#define _GNU_SOURCE
+#define SISWA_ARCHIVE_IMPLEMENTATION
+#define SISWA_USE_THREADS
+#define SISWA_USE_DIRECT_IO
+#include "libSUarchive.h"
+
+#include <sys/mman.h>
+#include <sys/time.h>
+
+/* Verifies archives the way a batch job would, reading every file once and
+ * hashing it, either with 'fread' or with a 'siDirectReader'. Afterwards, the
+ * amount of the files left in the page cache shows how much of the cache the
+ * job took away from everything else running on the machine.
+ *
+ * Usage: bulkRead [--fread | --direct] [archives...]
+ * Without any archives, 'bulk.ar.00' (64 MiB of BossPetra's entries) gets
+ * written first and both readers get compared on it. The files get dropped
+ * from the page cache before being read, as far as the OS allows it, so a file
+ * system without O_DIRECT (like tmpfs) gives less meaningful results.
+ * Must be linked with '-lpthread'. */
+
+#define BLOCK_SIZE 0x100000
+#define BULK_SIZE (64 * 0x100000)
+
+
+static
+double now(void) {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+}
+
+static
+void dropCache(const char* path) {
+	int fd = open(path, O_RDONLY);
+	if (fd != -1) {
+		fdatasync(fd);
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+	}
+}
+
+/* Percentage of the file's pages that are in the page cache. */
+static
+double cachedPercent(const char* path) {
+	struct stat st;
+	int fd = open(path, O_RDONLY);
+	size_t page = (size_t)sysconf(_SC_PAGESIZE), pages, resident = 0, i;
+	unsigned char* vec;
+	void* map;
+
+	if (fd == -1 || fstat(fd, &st) != 0 || st.st_size == 0) {
+		return 0;
+	}
+	map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return 0;
+	}
+
+	pages = ((size_t)st.st_size + page - 1) / page;
+	vec = (unsigned char*)malloc(pages);
+	if (mincore(map, (size_t)st.st_size, vec) == 0) {
+		for (i = 0; i < pages; i += 1) {
+			resident += (vec[i] & 1);
+		}
+	}
+	free(vec);
+	munmap(map, (size_t)st.st_size);
+	return 100.0 * (double)resident / (double)pages;
+}
+
+/* Hashes the whole file, returning the amount of bytes read. */
+static
+uint64_t verify(const char* path, siBool direct, uint64_t* hash, siBool* bypassed) {
+	static siByte buffer[BLOCK_SIZE];
+	siXxh64State state;
+	uint64_t total = 0;
+	size_t len;
+
+	siswa_xxh64Init(&state, 0);
+	*bypassed = SISWA_FALSE;
+
+	if (direct) {
+		siDirectReader reader;
+		if (!siswa_directReaderOpen(&reader, path, BLOCK_SIZE)) {
+			return 0;
+		}
+		*bypassed = reader.direct;
+		while ((len = siswa_directRead(&reader, buffer, sizeof(buffer))) != 0) {
+			siswa_xxh64Update(&state, buffer, len);
+			total += len;
+		}
+		siswa_directReaderClose(&reader);
+	}
+	else {
+		FILE* file = fopen(path, "rb");
+		if (file == NULL) {
+			return 0;
+		}
+		while ((len = fread(buffer, 1, sizeof(buffer), file)) != 0) {
+			siswa_xxh64Update(&state, buffer, len);
+			total += len;
+		}
+		fclose(file);
+	}
+
+	*hash = siswa_xxh64Digest(&state);
+	return total;
+}
+
+static
+void run(char** paths, int count, siBool direct) {
+	uint64_t total = 0;
+	double start, seconds, cached = 0;
+	int i;
+
+	for (i = 0; i < count; i += 1) {
+		dropCache(paths[i]);
+	}
+
+	start = now();
+	for (i = 0; i < count; i += 1) {
+		uint64_t hash = 0;
+		siBool bypassed;
+		uint64_t len = verify(paths[i], direct, &hash, &bypassed);
+
+		if (len == 0) {
+			fprintf(stderr, "Couldn't read '%s'.\n", paths[i]);
+			continue;
+		}
+		printf("%08lx%08lx  %s%s\n", (unsigned long)(hash >> 32), (unsigned long)(hash & 0xFFFFFFFF),
+			paths[i], (direct && !bypassed) ? " (no O_DIRECT, dropped from the cache instead)" : "");
+		total += len;
+	}
+	seconds = now() - start;
+
+	for (i = 0; i < count; i += 1) {
+		cached += cachedPercent(paths[i]);
+	}
+	printf(
+		"%-7s %.1f MiB in %.3f s, %.1f MiB/s, %.1f%% left in the page cache\n",
+		direct ? "direct:" : "fread:", (double)total / 0x100000, seconds,
+		(double)total / 0x100000 / seconds, cached / count
+	);
+}
+
+/* Writes 'BULK_SIZE' bytes worth of BossPetra's entries into one archive. */
+static
+void writeBulk(const char* path) {
+	siArFile ar = siswa_arMake("examples/decompressSegs/BossPetra.ar.00");
+	size_t size = (size_t)siswa_arGetDecompressedSize(ar);
+	siArWriter writer;
+	FILE* file;
+	size_t copy = 0;
+
+	siswa_arDecompress(&ar, (siByte*)malloc(size), size, SISWA_TRUE);
+	file = fopen(path, "wb");
+	SISWA_ASSERT_NOT_NULL(file);
+
+	siswa_arWriterInit(&writer, siswa_fileWrite, file, SISWA_DEFAULT_HEADER_ALIGNMENT);
+	while (writer.len < BULK_SIZE) {
+		siArEntry* entry;
+		siswa_arOffsetReset(&ar);
+		while (siswa_arEntryPoll(&ar, &entry)) {
+			char name[512];
+			sprintf(name, "%lu/%.400s", (unsigned long)copy, siswa_arEntryGetName(entry));
+			siswa_arWriterAdd(&writer, name, SISWA_STRLEN(name),
+				siswa_arEntryGetData(entry), siswa_arEntryGetDataSize(entry), entry->filedate);
+		}
+		copy += 1;
+	}
+	SISWA_ASSERT(siswa_arWriterEnd(&writer));
+	fclose(file);
+	free(ar.data);
+}
+
+
+int main(int argc, char** argv) {
+	static char* bulk[] = {"bulk.ar.00"};
+	siBool useFread = SISWA_TRUE, useDirect = SISWA_TRUE;
+	int first = 1;
+
+	if (argc > 1 && strcmp(argv[1], "--fread") == 0) {
+		useDirect = SISWA_FALSE;
+		first += 1;
+	}
+	else if (argc > 1 && strcmp(argv[1], "--direct") == 0) {
+		useFread = SISWA_FALSE;
+		first += 1;
+	}
+
+	if (first >= argc) {
+		writeBulk(bulk[0]);
+		argv = bulk;
+		argc = 1;
+		first = 0;
+	}
+
+	if (useFread) {
+		run(&argv[first], argc - first, SISWA_FALSE);
+	}
+	if (useDirect) {
+		run(&argv[first], argc - first, SISWA_TRUE);
+	}
+	return 0;
+}
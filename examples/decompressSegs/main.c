@@ -32,7 +32,8 @@ int main(void) {
 					"Size: %i\n\t"
 					"Data size: %i\n\t"
 					"Offset: %i\n",
-				filename, entry->size, entry->dataSize, entry->offset
+				filename, siswa_arEntryGetSize(entry), siswa_arEntryGetDataSize(entry),
+				siswa_arEntryGetOffset(entry)
 			);
 		}
 	}
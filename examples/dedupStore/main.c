@@ -0,0 +1,380 @@
+#define SISWA_ARCHIVE_IMPLEMENTATION
+#define SISWA_USE_THREADS
+#include "libSUarchive.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/* Finds the data that's duplicated between every archive in a directory, and
+ * can move all of it into a deduplicated content-addressed store. Every unique
+ * piece of data is stored once as 'objects/<SHA-256>', while every archive gets
+ * replaced by a reference list ('refs/<path>.refs', see 'siswa_arRefsCreate')
+ * that rebuilds the original archive on demand.
+ *
+ * Usage:
+ *     dedupStore scan [directory]
+ *     dedupStore build directory store
+ *     dedupStore restore store refs out.ar.00
+ * The directory gets searched recursively for '.ar' files, SEGS compressed
+ * archives get decompressed first (which is what 'restore' gives back).
+ * 'scan' defaults to the 'examples' directory. Must be linked with '-lpthread'. */
+
+#define MAX_PATH 1024
+#define MAX_ARCHIVES 4096
+#define THREAD_COUNT 4
+
+
+typedef struct {
+	char path[MAX_PATH];
+	siArFile ar;
+	size_t count;
+	siManifestEntry* manifest;
+	siByte* digests;
+} archive;
+
+typedef struct {
+	const siByte* sha256;
+	uint32_t dataSize;
+	size_t archive;
+	size_t entry;
+} blob;
+
+static archive archives[MAX_ARCHIVES];
+static size_t archiveCount = 0;
+
+
+static
+siBool isArchiveName(const char* name) {
+	size_t len = SISWA_STRLEN(name);
+	return strstr(name, ".ar.") != NULL || (len > 3 && strcmp(&name[len - 3], ".ar") == 0);
+}
+
+static
+void loadArchive(const char* path) {
+	archive* a = &archives[archiveCount];
+	siArFile ar;
+
+	if (archiveCount == MAX_ARCHIVES) {
+		fprintf(stderr, "Too many archives, skipping '%s'.\n", path);
+		return;
+	}
+
+	ar = siswa_arMake(path);
+	if (ar.type == SISWA_FILE_SEGS) {
+		size_t size = (size_t)siswa_arGetDecompressedSize(ar);
+		siswa_arDecompress(&ar, (siByte*)malloc(size), size, SISWA_TRUE);
+	}
+	if (ar.type != SISWA_FILE_REGULAR || ar.len < sizeof(siArHeader)) {
+		free(ar.data);
+		return;
+	}
+
+	strcpy(a->path, path);
+	a->ar = ar;
+	a->count = siswa_arGetEntryCount(ar);
+	a->manifest = (siManifestEntry*)malloc(a->count * sizeof(siManifestEntry) + 1);
+	a->digests = (siByte*)malloc(a->count * SISWA_SHA256_SIZE + 1);
+	siswa_arManifestEx(ar, a->manifest, a->count, a->digests, THREAD_COUNT);
+	archiveCount += 1;
+}
+
+static
+void scanDirectory(const char* path) {
+	DIR* dir = opendir(path);
+	struct dirent* ent;
+
+	if (dir == NULL) {
+		fprintf(stderr, "Couldn't open '%s'.\n", path);
+		return;
+	}
+
+	while ((ent = readdir(dir)) != NULL) {
+		char child[MAX_PATH * 2];
+		struct stat st;
+
+		if (ent->d_name[0] == '.'
+				|| SISWA_STRLEN(path) + SISWA_STRLEN(ent->d_name) + 2 > MAX_PATH) {
+			continue;
+		}
+		sprintf(child, "%s/%s", path, ent->d_name);
+		if (stat(child, &st) != 0) {
+			continue;
+		}
+
+		if (S_ISDIR(st.st_mode)) {
+			scanDirectory(child);
+		}
+		else if (S_ISREG(st.st_mode) && isArchiveName(ent->d_name)) {
+			loadArchive(child);
+		}
+	}
+	closedir(dir);
+}
+
+static
+int compareBlobs(const void* a, const void* b) {
+	const blob* x = (const blob*)a;
+	const blob* y = (const blob*)b;
+	int res = memcmp(x->sha256, y->sha256, SISWA_SHA256_SIZE);
+
+	if (res != 0) {
+		return res;
+	}
+	/* Keeps the first occurrence first, as 'qsort' isn't stable. */
+	if (x->archive != y->archive) {
+		return x->archive < y->archive ? -1 : 1;
+	}
+	return (x->entry > y->entry) - (x->entry < y->entry);
+}
+
+/* Gathers the data of every entry into 'out', sorted so that identical data is
+ * next to each other. Returns the amount of blobs. */
+static
+size_t collectBlobs(blob** out) {
+	size_t total = 0, i, j, n = 0;
+	blob* blobs;
+
+	for (i = 0; i < archiveCount; i += 1) {
+		total += archives[i].count;
+	}
+	blobs = (blob*)malloc(total * sizeof(blob) + 1);
+
+	for (i = 0; i < archiveCount; i += 1) {
+		for (j = 0; j < archives[i].count; j += 1) {
+			blobs[n].sha256 = &archives[i].digests[j * SISWA_SHA256_SIZE];
+			blobs[n].dataSize = archives[i].manifest[j].dataSize;
+			blobs[n].archive = i;
+			blobs[n].entry = j;
+			n += 1;
+		}
+	}
+	qsort(blobs, n, sizeof(blob), compareBlobs);
+
+	*out = blobs;
+	return n;
+}
+
+static
+const char* blobName(const blob* b) {
+	const archive* a = &archives[b->archive];
+	const siArEntry* entry = (const siArEntry*)&a->ar.data[a->manifest[b->entry].offset];
+	return siswa_arEntryGetName(entry);
+}
+
+static
+void hexDigest(const siByte* digest, char out[SISWA_SHA256_SIZE * 2 + 1]) {
+	size_t i;
+	for (i = 0; i < SISWA_SHA256_SIZE; i += 1) {
+		sprintf(&out[i * 2], "%02x", digest[i]);
+	}
+}
+
+
+static
+int scan(const char* path) {
+	size_t count, unique = 0, i, start;
+	double totalBytes = 0, uniqueBytes = 0;
+	blob* blobs;
+
+	scanDirectory(path);
+	count = collectBlobs(&blobs);
+
+	printf("Duplicated data:\n");
+	for (start = 0; start < count; start = i) {
+		size_t copies;
+		for (i = start + 1; i < count; i += 1) {
+			if (memcmp(blobs[i].sha256, blobs[start].sha256, SISWA_SHA256_SIZE) != 0) {
+				break;
+			}
+		}
+		copies = i - start;
+
+		unique += 1;
+		uniqueBytes += blobs[start].dataSize;
+		totalBytes += (double)blobs[start].dataSize * (double)copies;
+
+		if (copies > 1 && blobs[start].dataSize != 0) {
+			size_t j;
+			printf("\t%lu bytes x%lu:", (unsigned long)blobs[start].dataSize, (unsigned long)copies);
+			for (j = start; j < i; j += 1) {
+				printf(" %s:%s", archives[blobs[j].archive].path, blobName(&blobs[j]));
+			}
+			printf("\n");
+		}
+	}
+
+	printf(
+		"%lu archives, %lu entries, %lu unique.\n"
+		"Data: %.0f bytes, %.0f bytes unique (%.2f%% duplicated).\n",
+		(unsigned long)archiveCount, (unsigned long)count, (unsigned long)unique,
+		totalBytes, uniqueBytes,
+		totalBytes != 0 ? (totalBytes - uniqueBytes) * 100.0 / totalBytes : 0.0
+	);
+
+	free(blobs);
+	return 0;
+}
+
+static
+int build(const char* path, const char* store) {
+	char objectPath[MAX_PATH], refsPath[MAX_PATH * 2];
+	size_t count, written = 0, i;
+	double writtenBytes = 0;
+	blob* blobs;
+
+	if (SISWA_STRLEN(store) + 16 + SISWA_SHA256_SIZE * 2 > MAX_PATH) {
+		fprintf(stderr, "The store path is too long.\n");
+		return 1;
+	}
+
+	scanDirectory(path);
+	count = collectBlobs(&blobs);
+
+	mkdir(store, 0755);
+	sprintf(objectPath, "%s/objects", store);
+	mkdir(objectPath, 0755);
+	sprintf(refsPath, "%s/refs", store);
+	mkdir(refsPath, 0755);
+
+	/* Every unique piece of data gets stored once. */
+	for (i = 0; i < count; i += 1) {
+		const blob* b = &blobs[i];
+		const archive* a = &archives[b->archive];
+		const siArEntry* entry;
+		char hex[SISWA_SHA256_SIZE * 2 + 1];
+		struct stat st;
+		FILE* file;
+
+		if (i != 0 && memcmp(b->sha256, blobs[i - 1].sha256, SISWA_SHA256_SIZE) == 0) {
+			continue;
+		}
+		hexDigest(b->sha256, hex);
+		sprintf(objectPath, "%s/objects/%s", store, hex);
+		if (stat(objectPath, &st) == 0) {
+			continue; /* Already in the store from an earlier build. */
+		}
+
+		entry = (const siArEntry*)&a->ar.data[a->manifest[b->entry].offset];
+		file = fopen(objectPath, "wb");
+		SISWA_ASSERT_NOT_NULL(file);
+		fwrite(siswa_arEntryGetData(entry), 1, siswa_arEntryGetDataSize(entry), file);
+		fclose(file);
+
+		written += 1;
+		writtenBytes += siswa_arEntryGetDataSize(entry);
+	}
+
+	/* Archives get named by their path, with the directories flattened. */
+	for (i = 0; i < archiveCount; i += 1) {
+		const archive* a = &archives[i];
+		char* c;
+		FILE* file;
+		size_t size;
+
+		if (SISWA_STRLEN(store) + SISWA_STRLEN(a->path) + 12 > sizeof(refsPath)) {
+			fprintf(stderr, "Path of '%s' is too long.\n", a->path);
+			continue;
+		}
+		sprintf(refsPath, "%s/refs/%s.refs", store, a->path);
+		for (c = &refsPath[SISWA_STRLEN(store) + 6]; *c != '\0'; c += 1) {
+			if (*c == '/') {
+				*c = '_';
+			}
+		}
+
+		file = fopen(refsPath, "wb");
+		SISWA_ASSERT_NOT_NULL(file);
+		size = siswa_arRefsCreate(a->ar, a->digests, siswa_fileWrite, file);
+		fclose(file);
+		printf("%s: %lu bytes -> %lu bytes of references.\n",
+			refsPath, (unsigned long)a->ar.len, (unsigned long)size);
+	}
+
+	printf("Stored %lu new objects (%.0f bytes).\n", (unsigned long)written, writtenBytes);
+	free(blobs);
+	return 0;
+}
+
+
+typedef struct {
+	const char* store;
+	siByte buffer[16 * 1024];
+} fetchContext;
+
+static
+siBool fetchObject(void* user, const siByte sha256[SISWA_SHA256_SIZE], uint32_t dataSize,
+		siArWriter* writer) {
+	fetchContext* ctx = (fetchContext*)user;
+	char hex[SISWA_SHA256_SIZE * 2 + 1];
+	char path[MAX_PATH];
+	uint32_t left = dataSize;
+	FILE* file;
+
+	hexDigest(sha256, hex);
+	sprintf(path, "%s/objects/%s", ctx->store, hex);
+	file = fopen(path, "rb");
+	if (file == NULL) {
+		fprintf(stderr, "Object '%s' is missing.\n", hex);
+		return SISWA_FALSE;
+	}
+
+	while (left != 0) {
+		size_t n = fread(ctx->buffer, 1, left < sizeof(ctx->buffer) ? left : sizeof(ctx->buffer), file);
+		if (n == 0) {
+			break;
+		}
+		siswa_arWriterEntryWrite(writer, ctx->buffer, n);
+		left -= (uint32_t)n;
+	}
+	fclose(file);
+	return left == 0;
+}
+
+static
+int restore(const char* store, const char* refsPath, const char* outPath) {
+	static fetchContext ctx;
+	FILE* refs = fopen(refsPath, "rb");
+	FILE* out;
+	siBool ok;
+
+	if (refs == NULL || SISWA_STRLEN(store) + 16 + SISWA_SHA256_SIZE * 2 > MAX_PATH) {
+		fprintf(stderr, "Couldn't open '%s'.\n", refsPath);
+		return 1;
+	}
+	out = fopen(outPath, "wb");
+	SISWA_ASSERT_NOT_NULL(out);
+
+	ctx.store = store;
+	ok = siswa_arRefsRebuild(siswa_fileRead, refs, fetchObject, &ctx, siswa_fileWrite, out);
+	fclose(refs);
+	fclose(out);
+
+	if (!ok) {
+		fprintf(stderr, "The references or the store are corrupted.\n");
+		remove(outPath);
+		return 1;
+	}
+	return 0;
+}
+
+
+int main(int argc, char** argv) {
+	if (argc >= 2 && strcmp(argv[1], "build") == 0 && argc == 4) {
+		return build(argv[2], argv[3]);
+	}
+	else if (argc >= 2 && strcmp(argv[1], "restore") == 0 && argc == 5) {
+		return restore(argv[2], argv[3], argv[4]);
+	}
+	else if (argc <= 3 && (argc == 1 || strcmp(argv[1], "scan") == 0)) {
+		return scan(argc == 3 ? argv[2] : "examples");
+	}
+
+	fprintf(stderr,
+		"Usage:\n"
+		"\tdedupStore scan [directory]\n"
+		"\tdedupStore build directory store\n"
+		"\tdedupStore restore store refs out.ar.00\n"
+	);
+	return 1;
+}
@@ -0,0 +1,68 @@
+#define SISWA_ARCHIVE_IMPLEMENTATION
+#include "libSUarchive.h"
+
+/* Lists the entries that were added, removed or changed between two versions
+ * of an archive.
+ *
+ * Usage: diffAr [old.ar.00 new.ar.00]
+ * Without any arguments, a modified copy of 'pan.ar.00' gets compared to the
+ * original one. */
+
+
+int main(int argc, char** argv) {
+	siArFile a, b;
+	siDiffEntry* changes;
+	size_t count, i;
+
+	if (argc > 2) {
+		a = siswa_arMake(argv[1]);
+		b = siswa_arMake(argv[2]);
+	}
+	else {
+		static const char newData[] = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
+		a = siswa_arMake("examples/unpackAr/pan.ar.00");
+		b = siswa_arMakeEx("examples/unpackAr/pan.ar.00", 1024);
+
+		siswa_arEntryUpdate(&b, "area22_enemyset.set.xml", newData, sizeof(newData) - 1);
+		siswa_arEntryRemove(&b, "system.set.xml");
+		siswa_arEntryAdd(&b, "area99_enemyset.set.xml", newData, sizeof(newData) - 1);
+	}
+
+	/* Called once without a buffer to get the amount of changes. */
+	count = siswa_arDiff(a, b, NULL, 0);
+	changes = (siDiffEntry*)malloc((count + 1) * sizeof(siDiffEntry));
+	siswa_arDiff(a, b, changes, count);
+
+	for (i = 0; i < count; i += 1) {
+		const siDiffEntry* change = &changes[i];
+		switch (change->type) {
+			case SISWA_DIFF_ADDED: {
+				printf(
+					"+ %s (%i bytes)\n", siswa_arEntryGetName(change->b),
+					siswa_arEntryGetDataSize(change->b)
+				);
+				break;
+			}
+			case SISWA_DIFF_REMOVED: {
+				printf(
+					"- %s (%i bytes)\n", siswa_arEntryGetName(change->a),
+					siswa_arEntryGetDataSize(change->a)
+				);
+				break;
+			}
+			case SISWA_DIFF_CHANGED: {
+				printf(
+					"~ %s (%i -> %i bytes)\n", siswa_arEntryGetName(change->b),
+					siswa_arEntryGetDataSize(change->a), siswa_arEntryGetDataSize(change->b)
+				);
+				break;
+			}
+		}
+	}
+	printf("%lu change(s).\n", (unsigned long)count);
+
+	free(changes);
+	free(a.data);
+	free(b.data);
+	return 0;
+}
@@ -0,0 +1,199 @@
+#define _GNU_SOURCE
+#define SISWA_ARCHIVE_IMPLEMENTATION
+#define SISWA_USE_RELOAD
+#include "libSUarchive.h"
+
+#include <pthread.h>
+#include <sys/time.h>
+
+/* Keeps a few readers looking up entries while the archive they read keeps
+ * getting redeployed underneath them. Every deployment gets picked up in the
+ * background, and no lookup ever waits for it.
+ *
+ * Usage: hotReload [deployments]
+ * Deploys 'hotReload.ar' 20 times by default, alternating between
+ * 'BossPetra.ar.00' and a smaller archive made out of a few of its entries. */
+
+#define READER_COUNT 4
+#define LIVE_PATH "hotReload.ar"
+#define TEMP_PATH "hotReload.ar.tmp"
+
+
+typedef struct {
+	siReloadable* archive;
+	size_t index;
+	unsigned long lookups;
+	unsigned long missing;
+	unsigned long generations;
+	uint64_t checksum;
+	double totalLatency;
+	double maxLatency;
+} reader;
+
+static volatile int stopRequested = 0;
+
+/* The entries the readers look up, the last two are left out of the small archive. */
+static const char* names[] = {
+	"Stage.stg.xml", "Boss.prm.xml", "Camera.set.xml", "Direct01.light",
+	"pr_ptrboss_light_125.light", "ptrboss_col_stageA.phy.hkx"
+};
+#define NAME_COUNT (sizeof(names) / sizeof(*names))
+
+
+static
+double now(void) {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+}
+
+static
+void* readerProc(void* arg) {
+	reader* self = (reader*)arg;
+	uint64_t lastGeneration = (uint64_t)-1;
+	size_t i = self->index;
+
+	while (!stopRequested) {
+		double start = now(), latency;
+		const siArVersion* version = siswa_reloadableAcquire(self->archive, self->index);
+		siArEntry* entry = siswa_arVersionFind(version, names[i % NAME_COUNT]);
+
+		/* The version stays valid until it's released, even if it gets replaced. */
+		if (entry != NULL) {
+			self->checksum += siswa_hash64(siswa_arEntryGetData(entry),
+				siswa_arEntryGetDataSize(entry), 0);
+		}
+		else {
+			self->missing += 1;
+		}
+		if (version->generation != lastGeneration) {
+			lastGeneration = version->generation;
+			self->generations += 1;
+		}
+		siswa_reloadableRelease(self->archive, self->index);
+
+		latency = now() - start;
+		self->totalLatency += latency;
+		if (latency > self->maxLatency) {
+			self->maxLatency = latency;
+		}
+		self->lookups += 1;
+		i += 1;
+	}
+	return NULL;
+}
+
+static
+void* updaterProc(void* arg) {
+	siReloadable* archive = (siReloadable*)arg;
+	unsigned long* reloads = (unsigned long*)malloc(sizeof(unsigned long));
+
+	*reloads = 0;
+	while (!stopRequested) {
+		*reloads += siswa_reloadableUpdate(archive, 10);
+	}
+	return reloads;
+}
+
+
+/* Writes the archive next to the live one and renames it over, like a
+ * deployment would. */
+static
+void deploy(siByte* data, size_t len) {
+	FILE* file = fopen(TEMP_PATH, "wb");
+	SISWA_ASSERT_NOT_NULL(file);
+	fwrite(data, 1, len, file);
+	fclose(file);
+	SISWA_ASSERT(rename(TEMP_PATH, LIVE_PATH) == 0);
+}
+
+int main(int argc, char** argv) {
+	size_t deployments = (argc > 1) ? (size_t)strtoul(argv[1], NULL, 10) : 20;
+	siArFile big = siswa_arMake("examples/decompressSegs/BossPetra.ar.00");
+	siArFile small;
+	siByte* bigData;
+	size_t bigLen, i;
+	siReloadable archive;
+	reader readers[READER_COUNT];
+	pthread_t threads[READER_COUNT], updater;
+	unsigned long* reloads;
+	unsigned long lookups = 0, missing = 0;
+	double totalLatency = 0, maxLatency = 0;
+
+	bigLen = (size_t)siswa_arGetDecompressedSize(big);
+	bigData = (siByte*)malloc(bigLen);
+	siswa_arDecompress(&big, bigData, bigLen, SISWA_TRUE);
+
+	/* The small archive only keeps the entries the first four names need. */
+	small = siswa_arCreateContent(bigLen);
+	for (i = 0; i < 4; i += 1) {
+		siArEntry* entry = siswa_arEntryFind(big, names[i]);
+		SISWA_ASSERT_NOT_NULL(entry);
+		siswa_arEntryAddDated(&small, names[i], SISWA_STRLEN(names[i]),
+			siswa_arEntryGetData(entry), siswa_arEntryGetDataSize(entry),
+			siswa_arEntryGetFiledate(entry));
+	}
+	deploy(big.data, big.len);
+
+	if (!siswa_reloadableOpen(&archive, LIVE_PATH, READER_COUNT)) {
+		fprintf(stderr, "Couldn't open '%s'.\n", LIVE_PATH);
+		return 1;
+	}
+	pthread_create(&updater, NULL, updaterProc, &archive);
+	for (i = 0; i < READER_COUNT; i += 1) {
+		SISWA_MEMSET(&readers[i], 0, sizeof(reader));
+		readers[i].archive = &archive;
+		readers[i].index = i;
+		pthread_create(&threads[i], NULL, readerProc, &readers[i]);
+	}
+
+	for (i = 0; i < deployments; i += 1) {
+		struct timespec wait;
+		wait.tv_sec = 0;
+		wait.tv_nsec = 50000000;
+		nanosleep(&wait, NULL);
+
+		if (i % 2 == 0) {
+			deploy(small.data, small.len);
+		}
+		else {
+			deploy(big.data, big.len);
+		}
+	}
+	{
+		struct timespec wait;
+		wait.tv_sec = 0;
+		wait.tv_nsec = 100000000;
+		nanosleep(&wait, NULL);
+	}
+
+	stopRequested = 1;
+	for (i = 0; i < READER_COUNT; i += 1) {
+		pthread_join(threads[i], NULL);
+		lookups += readers[i].lookups;
+		missing += readers[i].missing;
+		totalLatency += readers[i].totalLatency;
+		if (readers[i].maxLatency > maxLatency) {
+			maxLatency = readers[i].maxLatency;
+		}
+		printf("reader %lu: %lu lookups, %lu generations seen\n", (unsigned long)i,
+			readers[i].lookups, readers[i].generations);
+	}
+	pthread_join(updater, (void**)&reloads);
+
+	printf("%lu deployments, %lu reloads, final generation %lu\n",
+		(unsigned long)deployments, *reloads,
+		(unsigned long)siswa_reloadableAcquire(&archive, 0)->generation);
+	siswa_reloadableRelease(&archive, 0);
+	/* Deployments that land before the previous one got loaded share a reload.
+	 * The slowest lookup is bound by the scheduler, not by the reloads. */
+	printf("%lu lookups (%lu missing), %.3f us on average, slowest %.1f us\n", lookups,
+		missing, totalLatency / (double)lookups * 1e6, maxLatency * 1e6);
+
+	free(reloads);
+	siswa_reloadableClose(&archive);
+	free(big.data);
+	free(small.data);
+	remove(LIVE_PATH);
+	return 0;
+}
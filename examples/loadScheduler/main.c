@@ -0,0 +1,149 @@
+#define _GNU_SOURCE
+#define SISWA_ARCHIVE_IMPLEMENTATION
+#define SISWA_USE_SCHEDULER
+#include "libSUarchive.h"
+
+/* Simulates a level loader that queues a lot of loads at once: background
+ * entries and archives, then a handful of entries the player is about to see.
+ * The same loads run twice, once first come first served and once with the
+ * visible entries at a higher priority and with a deadline, and the latencies
+ * of the visible entries get compared.
+ *
+ * Usage: loadScheduler [archive.ar.00]
+ * Loads entries of 'examples/decompressSegs/BossPetra.ar.00' by default. */
+
+#define BACKGROUND_COUNT 120
+#define FRAME_BUDGET 2000000 /* 2 ms of loading per frame. */
+#define VISIBLE_DEADLINE 20000000 /* The visible entries are needed within 20 ms. */
+
+
+static const char* visible[] = {
+	"Stage.stg.xml", "Boss.prm.xml", "Camera.set.xml", "Direct01.light"
+};
+#define VISIBLE_COUNT (sizeof(visible) / sizeof(*visible))
+
+static const char* archives[] = {
+	"examples/unpackAr/pan.ar.00", "examples/mergeAr/test.ar.00",
+	"examples/mergeAr/gimmickSet.ar.00", "examples/mergeAr/anotherGimmickSet.ar.00"
+};
+#define ARCHIVE_COUNT (sizeof(archives) / sizeof(*archives))
+
+
+static
+void freeResult(siLoadRequest* request) {
+	free(request->ar.data);
+	free(request->data);
+}
+
+static
+void run(const char* path, char** names, size_t nameCount, siBool prioritized) {
+	siScheduler s;
+	siLoadRequest* background[BACKGROUND_COUNT];
+	siLoadRequest* requests[VISIBLE_COUNT];
+	uint64_t start, queueSum = 0, queueMax = 0, serviceSum = 0, serviceMax = 0;
+	uint64_t bytes = 0, chunks = 0;
+	size_t frames = 0, visibleFrames = 0, missed = 0, i;
+	uint32_t seed = 12345;
+
+	siswa_schedulerInit(&s);
+	start = siswa_schedulerNow();
+
+	/* Background loads, mostly entries from the back of the archive, which
+	 * take the longest to get to. */
+	for (i = 0; i < BACKGROUND_COUNT; i += 1) {
+		seed = seed * 1103515245 + 12345;
+		if (i % 10 == 0) {
+			background[i] = siswa_schedulerSubmit(&s, SISWA_LOAD_ARCHIVE,
+				archives[(i / 10) % ARCHIVE_COUNT], NULL, 0, 0, NULL);
+		}
+		else {
+			const char* name = names[nameCount / 2 + (seed >> 8) % (nameCount - nameCount / 2)];
+			background[i] = siswa_schedulerSubmit(&s, SISWA_LOAD_ENTRY, path, name, 0, 0, NULL);
+		}
+	}
+	for (i = 0; i < VISIBLE_COUNT; i += 1) {
+		requests[i] = siswa_schedulerSubmit(&s, SISWA_LOAD_ENTRY, path, visible[i],
+			prioritized ? 10 : 0, prioritized ? start + VISIBLE_DEADLINE : 0, NULL);
+	}
+	/* The player turned away from what some loads were for. */
+	for (i = 1; i < BACKGROUND_COUNT; i += 7) {
+		siswa_schedulerCancel(&s, background[i]);
+	}
+
+	while (s.pending != 0) {
+		size_t done = 0;
+
+		siswa_schedulerRun(&s, FRAME_BUDGET);
+		frames += 1;
+		for (i = 0; i < VISIBLE_COUNT; i += 1) {
+			done += (requests[i]->state != SISWA_LOAD_PENDING);
+		}
+		if (done == VISIBLE_COUNT && visibleFrames == 0) {
+			visibleFrames = frames;
+		}
+	}
+	printf("%s:\n  visible entries done after %lu of %lu frames\n",
+		prioritized ? "prioritized" : "first come, first served",
+		(unsigned long)visibleFrames, (unsigned long)frames);
+
+	for (i = 0; i < VISIBLE_COUNT; i += 1) {
+		siLoadRequest* r = requests[i];
+		uint64_t queue = r->started - r->queued, service = r->finished - r->started;
+
+		SISWA_ASSERT(r->state == SISWA_LOAD_DONE);
+		queueSum += queue;
+		serviceSum += service;
+		queueMax = (queue > queueMax) ? queue : queueMax;
+		serviceMax = (service > serviceMax) ? service : serviceMax;
+		missed += (r->finished - start > VISIBLE_DEADLINE);
+		bytes += r->bytesRead;
+		chunks += r->chunksInflated;
+
+		freeResult(r);
+		siswa_schedulerRelease(&s, r);
+	}
+	for (i = 0; i < BACKGROUND_COUNT; i += 1) {
+		bytes += background[i]->bytesRead;
+		chunks += background[i]->chunksInflated;
+		freeResult(background[i]);
+		siswa_schedulerRelease(&s, background[i]);
+	}
+
+	printf("  visible queue latency   %8.2f ms avg %8.2f ms max\n",
+		(double)queueSum / VISIBLE_COUNT / 1e6, (double)queueMax / 1e6);
+	printf("  visible service latency %8.2f ms avg %8.2f ms max\n",
+		(double)serviceSum / VISIBLE_COUNT / 1e6, (double)serviceMax / 1e6);
+	printf("  %lu/%lu visible deadlines missed, everything done in %.2f ms "
+		"(%lu KiB read, %lu chunks inflated)\n\n",
+		(unsigned long)missed, (unsigned long)VISIBLE_COUNT,
+		(double)(siswa_schedulerNow() - start) / 1e6, (unsigned long)(bytes / 1024),
+		(unsigned long)chunks);
+
+	siswa_schedulerFree(&s);
+}
+
+int main(int argc, char** argv) {
+	const char* path = (argc > 1) ? argv[1] : "examples/decompressSegs/BossPetra.ar.00";
+	siArFile ar = siswa_arMake(path);
+	siArEntry* entry;
+	char** names;
+	size_t count = 0, size;
+
+	/* The names of every entry, to pick the background loads from. */
+	size = (size_t)siswa_arGetDecompressedSize(ar);
+	siswa_arDecompress(&ar, (siByte*)malloc(size), size, SISWA_TRUE);
+	names = (char**)malloc(siswa_arGetEntryCount(ar) * sizeof(char*));
+	while (siswa_arEntryPoll(&ar, &entry)) {
+		names[count] = siswa_arEntryGetName(entry);
+		count += 1;
+	}
+
+	printf("%lu background loads and %lu visible entries, %d ms per frame:\n",
+		(unsigned long)BACKGROUND_COUNT, (unsigned long)VISIBLE_COUNT, FRAME_BUDGET / 1000000);
+	run(path, names, count, SISWA_FALSE);
+	run(path, names, count, SISWA_TRUE);
+
+	free(names);
+	free(ar.data);
+	return 0;
+}
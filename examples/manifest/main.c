@@ -0,0 +1,97 @@
+#define SISWA_ARCHIVE_IMPLEMENTATION
+#define SISWA_USE_THREADS
+#include "libSUarchive.h"
+
+/* Prints the content-hash manifest of an archive, one line per entry:
+ *     <XXH64> <data size> <name, or offset for SEGS archives> [SHA-256]
+ *
+ * Usage: manifest [--sha256] [--threads N] [archive]
+ * SEGS compressed archives get hashed while they're being decompressed, without
+ * keeping the decompressed archive in memory. Must be linked with '-lpthread'. */
+
+
+static
+void printHash(uint64_t hash) {
+	printf("%08lx%08lx", (unsigned long)(hash >> 32), (unsigned long)(hash & 0xFFFFFFFF));
+}
+
+static
+void printSha256(const siByte* digest) {
+	size_t i;
+	for (i = 0; i < SISWA_SHA256_SIZE; i += 1) {
+		printf("%02x", digest[i]);
+	}
+}
+
+
+int main(int argc, char** argv) {
+	const char* path = "examples/unpackAr/pan.ar.00";
+	siBool sha256 = SISWA_FALSE;
+	size_t threads = 4, capacity, count, i;
+	siManifestEntry* manifest;
+	siByte* digests = NULL;
+	siArFile ar;
+	int arg;
+
+	for (arg = 1; arg < argc; arg += 1) {
+		if (SISWA_STRNCMP(argv[arg], "--sha256", 9) == 0) {
+			sha256 = SISWA_TRUE;
+		}
+		else if (SISWA_STRNCMP(argv[arg], "--threads", 10) == 0 && arg + 1 < argc) {
+			arg += 1;
+			threads = (size_t)strtoul(argv[arg], NULL, 10);
+		}
+		else {
+			path = argv[arg];
+		}
+	}
+
+	ar = siswa_arMake(path);
+	if (ar.type == SISWA_FILE_SEGS) {
+		/* The entry count isn't known before decompressing, so use the highest
+		 * amount of entries that could fit in the archive. */
+		capacity = (size_t)siswa_arGetDecompressedSize(ar) / (sizeof(siArEntry) + 1);
+	}
+	else if (ar.type == SISWA_FILE_REGULAR) {
+		capacity = siswa_arGetEntryCount(ar);
+	}
+	else {
+		fprintf(stderr, "Unsupported archive type.\n");
+		return 1;
+	}
+
+	manifest = (siManifestEntry*)malloc((capacity + 1) * sizeof(siManifestEntry));
+	if (sha256) {
+		digests = (siByte*)malloc((capacity + 1) * SISWA_SHA256_SIZE);
+	}
+
+	if (ar.type == SISWA_FILE_SEGS) {
+		count = siswa_arManifestSegs(ar, manifest, capacity, digests);
+	}
+	else {
+		count = siswa_arManifestEx(ar, manifest, capacity, digests, threads);
+	}
+
+	for (i = 0; i < count && i < capacity; i += 1) {
+		printHash(manifest[i].hash);
+		printf(" %10lu ", (unsigned long)manifest[i].dataSize);
+
+		if (ar.type == SISWA_FILE_SEGS) {
+			printf("@%lu", (unsigned long)manifest[i].offset);
+		}
+		else {
+			printf("%s", siswa_arEntryGetName((const siArEntry*)&ar.data[manifest[i].offset]));
+		}
+
+		if (digests != NULL) {
+			printf(" ");
+			printSha256(&digests[i * SISWA_SHA256_SIZE]);
+		}
+		printf("\n");
+	}
+
+	free(digests);
+	free(manifest);
+	free(ar.data);
+	return 0;
+}
@@ -0,0 +1,138 @@
+#define _GNU_SOURCE
+#define SISWA_ARCHIVE_IMPLEMENTATION
+#define SISWA_USE_MMAP
+#include "libSUarchive.h"
+
+#include <sys/resource.h>
+#include <time.h>
+
+/* Maps an archive and loads its entries a few at a time, like a game loading
+ * the assets of the next area every frame. With hints, the entries of the next
+ * frame get prefetched one frame ahead and the entries of the current frame get
+ * released once they're loaded, which keeps the resident memory of the mapping
+ * bounded. Without them, every cold page faults on the first read and stays
+ * resident until the archive gets unmapped.
+ *
+ * Usage: mapAr [archive.ar.00]
+ * By default 'BossPetra.ar.00' gets decompressed into 'mapped.ar.00' first, as
+ * SEGS archives have to be decompressed before they can be mapped. Both runs
+ * drop the file from the page cache first (as far as the OS allows it). */
+
+#define ENTRIES_PER_FRAME 8
+
+
+/* Resident memory of the whole process in KiB, or 0 if it's unknown. */
+static
+size_t residentKiB(void) {
+	FILE* file = fopen("/proc/self/statm", "r");
+	unsigned long size, resident = 0;
+
+	if (file != NULL) {
+		if (fscanf(file, "%lu %lu", &size, &resident) != 2) {
+			resident = 0;
+		}
+		fclose(file);
+	}
+	return (size_t)resident * ((size_t)sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static
+void dropCache(const char* path) {
+	int fd = open(path, O_RDONLY);
+	if (fd != -1) {
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+	}
+}
+
+static
+void load(const char* path, siBool hints) {
+	siArFile ar;
+	siArEntry** entries;
+	struct rusage before, after;
+	size_t count, frame, frameCount, i, sum = 0, base, peak = 0;
+	double start;
+
+	dropCache(path);
+	base = residentKiB();
+	getrusage(RUSAGE_SELF, &before);
+	start = (double)clock() / CLOCKS_PER_SEC;
+
+	ar = siswa_arMap(path);
+	SISWA_ASSERT(ar.type == SISWA_FILE_REGULAR && siswa_arValidate(&ar));
+
+	/* The entries get found once up front, so that the frames themselves only
+	 * touch the entries they load. */
+	count = siswa_arGetEntryCount(ar);
+	entries = (siArEntry**)malloc(count * sizeof(siArEntry*));
+	for (i = 0; siswa_arEntryPoll(&ar, &entries[i]); i += 1) {}
+	frameCount = (count + ENTRIES_PER_FRAME - 1) / ENTRIES_PER_FRAME;
+
+	for (frame = 0; frame < frameCount; frame += 1) {
+		size_t first = frame * ENTRIES_PER_FRAME;
+		size_t last = (first + ENTRIES_PER_FRAME < count) ? first + ENTRIES_PER_FRAME : count;
+		size_t resident;
+
+		if (hints) {
+			/* The first frame has nothing to overlap with. */
+			for (i = (frame == 0) ? first : last; i < last + ENTRIES_PER_FRAME && i < count; i += 1) {
+				siswa_arEntryPrefetch(ar, entries[i]);
+			}
+		}
+
+		/* "Loading" an entry reads every byte of it. */
+		for (i = first; i < last; i += 1) {
+			const siByte* data = (const siByte*)siswa_arEntryGetData(entries[i]);
+			size_t j;
+			for (j = 0; j < siswa_arEntryGetDataSize(entries[i]); j += 1) {
+				sum += data[j];
+			}
+		}
+
+		resident = residentKiB();
+		peak = (resident > peak) ? resident : peak;
+
+		if (hints) {
+			for (i = first; i < last; i += 1) {
+				siswa_arEntryRelease(ar, entries[i]);
+			}
+		}
+	}
+
+	getrusage(RUSAGE_SELF, &after);
+	printf(
+		"%-9s %lu frames in %.2f ms, %ld major and %ld minor faults, peak %lu KiB resident over %lu KiB (checksum %lu)\n",
+		hints ? "hints:" : "no hints:", (unsigned long)frameCount,
+		((double)clock() / CLOCKS_PER_SEC - start) * 1000.0,
+		after.ru_majflt - before.ru_majflt, after.ru_minflt - before.ru_minflt,
+		(unsigned long)(peak - base), (unsigned long)base, (unsigned long)sum
+	);
+
+	free(entries);
+	siswa_arUnmap(ar);
+}
+
+
+int main(int argc, char** argv) {
+	const char* path = "mapped.ar.00";
+
+	if (argc > 1) {
+		path = argv[1];
+	}
+	else {
+		siArFile ar = siswa_arMake("examples/decompressSegs/BossPetra.ar.00");
+		size_t size = (size_t)siswa_arGetDecompressedSize(ar);
+		FILE* file;
+
+		siswa_arDecompress(&ar, (siByte*)malloc(size), size, SISWA_TRUE);
+		file = fopen(path, "wb");
+		SISWA_ASSERT_NOT_NULL(file);
+		fwrite(ar.data, ar.len, 1, file);
+		fclose(file);
+		free(ar.data);
+	}
+
+	load(path, SISWA_FALSE);
+	load(path, SISWA_TRUE);
+	return 0;
+}
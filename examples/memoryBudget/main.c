@@ -0,0 +1,156 @@
+#define _GNU_SOURCE
+#define SISWA_ARCHIVE_IMPLEMENTATION
+#define SISWA_USE_BUDGETS
+#define SISWA_USE_VFS
+#include "libSUarchive.h"
+
+/* Loads a few archives, mounts them and shows how much memory every budget of
+ * the library takes. Then sets a cap a bit over that and fills a cache of
+ * entries, which the library shrinks through its callback every time an
+ * allocation would go over the cap.
+ *
+ * Usage: memoryBudget */
+
+#define CACHE_SLOTS 64
+#define CAP_HEADROOM (256 * 1024)
+
+
+/* An application cache of entries copied out of an archive. */
+typedef struct {
+	const char* name;
+	void* data;
+	size_t size;
+	uint64_t lastUsed;
+} CacheSlot;
+
+typedef struct {
+	CacheSlot slots[CACHE_SLOTS];
+	uint64_t clock;
+	size_t evictions;
+} Cache;
+
+/* Evicts the least recently used entries until 'bytes' got freed. */
+static
+size_t cacheShrink(void* user, size_t bytes) {
+	Cache* cache = (Cache*)user;
+	size_t freed = 0;
+
+	while (freed < bytes) {
+		CacheSlot* oldest = NULL;
+		size_t i;
+
+		for (i = 0; i < CACHE_SLOTS; i += 1) {
+			CacheSlot* slot = &cache->slots[i];
+			if (slot->data != NULL && (oldest == NULL || slot->lastUsed < oldest->lastUsed)) {
+				oldest = slot;
+			}
+		}
+		if (oldest == NULL) {
+			break;
+		}
+		siswa_free(oldest->data);
+		freed += oldest->size;
+		oldest->data = NULL;
+		cache->evictions += 1;
+	}
+	return freed;
+}
+
+static
+void cachePut(Cache* cache, siArEntry* entry) {
+	CacheSlot* slot = &cache->slots[cache->clock % CACHE_SLOTS];
+
+	if (slot->data != NULL) {
+		siswa_free(slot->data);
+		slot->data = NULL;
+	}
+	slot->name = siswa_arEntryGetName(entry);
+	slot->size = siswa_arEntryGetDataSize(entry);
+	slot->data = siswa_budgetMalloc(SISWA_BUDGET_CACHES, slot->size != 0 ? slot->size : 1);
+	SISWA_ASSERT_NOT_NULL(slot->data);
+	SISWA_MEMCPY(slot->data, siswa_arEntryGetData(entry), slot->size);
+	slot->lastUsed = ++cache->clock;
+}
+
+/* Returns the number of bytes in the cache. */
+static
+size_t cacheSize(const Cache* cache, size_t* count) {
+	size_t size = 0, i;
+
+	*count = 0;
+	for (i = 0; i < CACHE_SLOTS; i += 1) {
+		if (cache->slots[i].data != NULL) {
+			size += cache->slots[i].size;
+			*count += 1;
+		}
+	}
+	return size;
+}
+
+
+static
+void printBudgets(const char* title) {
+	size_t i;
+
+	printf("%s\n", title);
+	printf("  %-14s %12s %12s %12s\n", "budget", "current", "peak", "allocations");
+	for (i = 0; i < SISWA_BUDGET_COUNT; i += 1) {
+		siBudgetStats stats;
+		siswa_budgetStats((siBudget)i, &stats);
+		printf("  %-14s %12lu %12lu %12lu\n", stats.name, (unsigned long)stats.current,
+			(unsigned long)stats.peak, (unsigned long)stats.allocations);
+	}
+	printf("  %-14s %12lu\n\n", "total", (unsigned long)siswa_budgetTotal());
+}
+
+
+int main(void) {
+	static Cache cache;
+	siArFile pan, boss;
+	siArEntry* entry;
+	siVfs vfs;
+	size_t size, cap, count, i;
+
+	/* Archives read into memory, and a decompressed one. */
+	pan = siswa_arMake("examples/unpackAr/pan.ar.00");
+	boss = siswa_arMake("examples/decompressSegs/BossPetra.ar.00");
+	size = (size_t)siswa_arGetDecompressedSize(boss);
+	siswa_arDecompress(&boss, (siByte*)siswa_budgetMalloc(SISWA_BUDGET_DECOMPRESSION, size),
+		size, SISWA_TRUE);
+
+	/* A file system over a few more, which builds an index of every name. */
+	siswa_vfsInit(&vfs);
+	SISWA_ASSERT(siswa_vfsAddArchive(&vfs, "examples/mergeAr/gimmickSet.ar.00", 0));
+	SISWA_ASSERT(siswa_vfsAddArchive(&vfs, "examples/mergeAr/anotherGimmickSet.ar.00", 1));
+	SISWA_ASSERT(siswa_vfsAddArchive(&vfs, "examples/mergeAr/test.ar.00", 2));
+	siswa_vfsMount(&vfs);
+	printBudgets("After loading:");
+
+	/* Every entry of 'BossPetra.ar.00' goes through the cache twice, which only
+	 * fits under the cap by evicting the older ones. */
+	cap = siswa_budgetTotal() + CAP_HEADROOM;
+	siswa_budgetSetCap(cap);
+	siswa_budgetAddShrinker(cacheShrink, &cache);
+
+	for (i = 0; i < 2; i += 1) {
+		while (siswa_arEntryPoll(&boss, &entry)) {
+			cachePut(&cache, entry);
+		}
+		siswa_arOffsetReset(&boss);
+	}
+	size = cacheSize(&cache, &count);
+	printf("Cap of %lu bytes: %lu entries (%lu bytes) cached, %lu evicted, %lu overruns\n\n",
+		(unsigned long)cap, (unsigned long)count, (unsigned long)size,
+		(unsigned long)cache.evictions, (unsigned long)siswa_budgetOverruns());
+	printBudgets("With the cache filled:");
+
+	siswa_budgetRemoveShrinker(cacheShrink, &cache);
+	siswa_budgetSetCap(0);
+	cacheShrink(&cache, (size_t)-1);
+	siswa_vfsFree(&vfs);
+	siswa_arFree(boss);
+	siswa_arFree(pan);
+	printBudgets("After freeing everything:");
+
+	return 0;
+}
@@ -1,18 +1,22 @@
 #define SISWA_ARCHIVE_IMPLEMENTATION
 #include "libSUarchive.h"
 
+#include <sys/stat.h>
+
 #define countof(array) (sizeof(array) / sizeof(*array))
 
 
 typedef struct {
 	void* data;
 	size_t len;
+	uint64_t filedate;
 } fileInfo;
 
 
 fileInfo readFile(const char* filename) {
 	FILE* file;
 	fileInfo res;
+	struct stat st;
 
 	SISWA_ASSERT_NOT_NULL(filename);
 
@@ -27,6 +31,12 @@ fileInfo readFile(const char* filename) {
 	fread(res.data, res.len, 1, file);
 	fclose(file);
 
+	/* The modification date gets stored in the entry, which lets 'repackAr'
+	 * skip the files that haven't changed since. */
+	res.filedate = (stat(filename, &st) == 0)
+		? siswa_filedateFromUnix((uint64_t)st.st_mtime, 0)
+		: 0;
+
 	return res;
 }
 
@@ -40,22 +50,33 @@ static const char* filenames[] = {
 static fileInfo files[countof(filenames)];
 
 
-int main(void) {
+/* Usage: packAr [alignment]
+ * With an alignment (e.g. 16 or 4096), the data of every entry starts at a
+ * multiple of it from the start of the archive, so that it can be read in
+ * place from a mapped file. */
+int main(int argc, char** argv) {
 	size_t totalSize = 0;
+	uint32_t alignment = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : 0;
 	siArFile ar;
 	{ /* Read the contents of the files to pack. */
 		size_t i;
 		for (i = 0; i < countof(filenames); i += 1) {
 			files[i] = readFile(filenames[i]);
-			totalSize += files[i].len + strlen(filenames[i]) + sizeof(siArEntry) + 6;
+			totalSize += files[i].len + strlen(filenames[i]) + sizeof(siArEntry) + 6 + alignment;
 		}
 	}
 	ar = siswa_arCreateContent(totalSize);
+	if (alignment != 0) {
+		siswa_arGetHeader(ar)->alignment = alignment;
+	}
 
 	{ /* Pack them all into one archive. */
 		size_t i;
 		for (i = 0; i < countof(files); i += 1) {
-			siswa_arEntryAdd(&ar, filenames[i], files[i].data, files[i].len);
+			siswa_arEntryAddAligned(
+				&ar, filenames[i], strlen(filenames[i]), files[i].data, files[i].len,
+				files[i].filedate, alignment
+			);
 		}
 	}
 
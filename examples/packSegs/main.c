@@ -0,0 +1,113 @@
+#define SISWA_ARCHIVE_IMPLEMENTATION
+#include "libSUarchive.h"
+
+/* Compresses an archive into a SEGS archive. Chunks get cached on disk by the
+ * hash of their content and the compression level, so rebuilding an archive
+ * where only a few entries changed only compresses the chunks that changed.
+ *
+ * Usage: packSegs [--level N] [--cache directory] [input.ar.00] [output.ar.00]
+ * Compresses 'examples/decompressSegs/BossPetra.ar.00' into 'packed.ar.00' by
+ * default. SEGS compressed inputs get decompressed first. The cache directory
+ * must already exist.
+ *
+ * The library doesn't come with a Deflate compressor, so zlib has to be enabled
+ * at compile time, otherwise every chunk gets stored uncompressed:
+ *     gcc examples/packSegs/main.c -I. -DSISWA_PACK_ZLIB -lz
+ * zlib's level 9 recreates the game's archives byte for byte. */
+
+#ifdef SISWA_PACK_ZLIB
+	#include <zlib.h>
+#endif
+
+
+#ifdef SISWA_PACK_ZLIB
+static
+size_t compressZlib(void* user, const void* in, size_t inLen, void* out, size_t capacity,
+		int level) {
+	z_stream stream;
+	size_t res = 0;
+	(void)user;
+
+	SISWA_MEMSET(&stream, 0, sizeof(stream));
+	if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		return 0;
+	}
+	stream.next_in = (Bytef*)in;
+	stream.avail_in = (uInt)inLen;
+	stream.next_out = (Bytef*)out;
+	stream.avail_out = (uInt)capacity;
+
+	/* Anything other than the end of the stream means that it didn't fit. */
+	if (deflate(&stream, Z_FINISH) == Z_STREAM_END) {
+		res = stream.total_out;
+	}
+	deflateEnd(&stream);
+	return res;
+}
+#endif
+
+
+int main(int argc, char** argv) {
+	const char* inPath = "examples/decompressSegs/BossPetra.ar.00";
+	const char* outPath = "packed.ar.00";
+	siChunkCache cache;
+	siBool useCache = SISWA_FALSE;
+	siCompressProc compress = NULL;
+	siSegsStats stats;
+	int level = 9, arg, paths = 0;
+	size_t capacity;
+	siArFile ar, segs;
+	FILE* file;
+
+	for (arg = 1; arg < argc; arg += 1) {
+		if (strcmp(argv[arg], "--level") == 0 && arg + 1 < argc) {
+			arg += 1;
+			level = atoi(argv[arg]);
+		}
+		else if (strcmp(argv[arg], "--cache") == 0 && arg + 1 < argc) {
+			arg += 1;
+			cache.get = siswa_chunkCacheFileGet;
+			cache.put = siswa_chunkCacheFilePut;
+			cache.user = argv[arg];
+			useCache = SISWA_TRUE;
+		}
+		else if (paths == 0) {
+			inPath = argv[arg];
+			paths += 1;
+		}
+		else {
+			outPath = argv[arg];
+		}
+	}
+#ifdef SISWA_PACK_ZLIB
+	compress = compressZlib;
+#endif
+
+	ar = siswa_arMake(inPath);
+	if (ar.type == SISWA_FILE_SEGS) {
+		size_t size = (size_t)siswa_arGetDecompressedSize(ar);
+		siswa_arDecompress(&ar, (siByte*)malloc(size), size, SISWA_TRUE);
+	}
+
+	capacity = siswa_segsCompressBound(ar.len);
+	segs = siswa_arCompressSegs(
+		ar, malloc(capacity), capacity, level, compress, NULL,
+		useCache ? &cache : NULL, &stats
+	);
+
+	file = fopen(outPath, "wb");
+	SISWA_ASSERT_NOT_NULL(file);
+	fwrite(segs.data, segs.len, 1, file);
+	fclose(file);
+
+	printf(
+		"%lu -> %lu bytes, %lu chunks (%lu cached, %lu compressed, %lu stored).\n",
+		(unsigned long)ar.len, (unsigned long)segs.len, (unsigned long)stats.chunks,
+		(unsigned long)stats.cached, (unsigned long)stats.compressed,
+		(unsigned long)stats.stored
+	);
+
+	free(segs.data);
+	free(ar.data);
+	return 0;
+}
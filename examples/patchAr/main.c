@@ -0,0 +1,106 @@
+#define SISWA_ARCHIVE_IMPLEMENTATION
+#include "libSUarchive.h"
+
+/* Creates and applies binary delta patches between two versions of an archive.
+ *
+ * Usage:
+ *     patchAr create old.ar.00 new.ar.00 out.patch
+ *     patchAr apply old.ar.00 in.patch out.ar.00
+ * Without any arguments, a patch between 'pan.ar.00' and a modified copy of it
+ * gets created and applied in memory. */
+
+
+static
+int create(const char* oldPath, const char* newPath, const char* patchPath) {
+	siArFile a = siswa_arMake(oldPath);
+	siArFile b = siswa_arMake(newPath);
+	FILE* file = fopen(patchPath, "wb");
+	size_t size;
+
+	SISWA_ASSERT_NOT_NULL(file);
+	size = siswa_arPatchCreate(a, b, siswa_fileWrite, file);
+	fclose(file);
+	printf("Created a patch of %lu bytes (new archive: %lu bytes).\n",
+		(unsigned long)size, (unsigned long)b.len);
+
+	free(a.data);
+	free(b.data);
+	return size == 0;
+}
+
+static
+int apply(const char* oldPath, const char* patchPath, const char* outPath) {
+	siArFile a = siswa_arMake(oldPath);
+	FILE* patch = fopen(patchPath, "rb");
+	FILE* out = fopen(outPath, "wb");
+	siBool ok;
+
+	SISWA_ASSERT_NOT_NULL(patch);
+	SISWA_ASSERT_NOT_NULL(out);
+
+	/* Neither the patch nor the new archive are ever fully in memory. */
+	ok = siswa_arPatchApply(a, siswa_fileRead, patch, siswa_fileWrite, out);
+	fclose(patch);
+	fclose(out);
+	free(a.data);
+
+	if (!ok) {
+		fprintf(stderr, "The patch is corrupted or made for a different archive.\n");
+		remove(outPath);
+		return 1;
+	}
+	return 0;
+}
+
+static
+int demo(void) {
+	static const char newData[] = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
+	siArFile a = siswa_arMake("examples/unpackAr/pan.ar.00");
+	siArFile b = siswa_arMakeEx("examples/unpackAr/pan.ar.00", 1024);
+	siMemoryStream patch, out;
+	siArEntry* entry;
+	siBool ok;
+
+	/* A one byte change inside of a big entry, a removed and an added entry. */
+	entry = siswa_arEntryFind(b, "BaseEvil.set.xml");
+	((siByte*)siswa_arEntryGetData(entry))[1000] = 'X';
+	siswa_arEntryRemove(&b, "system.set.xml");
+	siswa_arEntryAdd(&b, "area99_enemyset.set.xml", newData, sizeof(newData) - 1);
+
+	patch.data = (siByte*)malloc(b.len);
+	patch.len = patch.pos = 0;
+	patch.cap = b.len;
+	siswa_arPatchCreate(a, b, siswa_memoryWrite, &patch);
+
+	out.data = (siByte*)malloc(b.len);
+	out.len = out.pos = 0;
+	out.cap = b.len;
+	ok = siswa_arPatchApply(a, siswa_memoryRead, &patch, siswa_memoryWrite, &out);
+
+	printf(
+		"Patch: %lu bytes, new archive: %lu bytes, applied: %s, identical: %s\n",
+		(unsigned long)patch.len, (unsigned long)b.len, ok ? "yes" : "no",
+		(out.len == b.len && memcmp(out.data, b.data, b.len) == 0) ? "yes" : "no"
+	);
+
+	free(out.data);
+	free(patch.data);
+	free(a.data);
+	free(b.data);
+	return !ok;
+}
+
+
+int main(int argc, char** argv) {
+	if (argc == 5 && strcmp(argv[1], "create") == 0) {
+		return create(argv[2], argv[3], argv[4]);
+	}
+	if (argc == 5 && strcmp(argv[1], "apply") == 0) {
+		return apply(argv[2], argv[3], argv[4]);
+	}
+	if (argc != 1) {
+		fprintf(stderr, "Usage: %s <create old new patch | apply old patch out>\n", argv[0]);
+		return 1;
+	}
+	return demo();
+}
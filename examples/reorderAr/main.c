@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <time.h>
+
+/* Records every entry that gets looked up (see 'SISWA_TRACE_ACCESS'). */
+static void traceAccess(const void* entry);
+#define SISWA_TRACE_ACCESS(arFile, entry) traceAccess(entry)
+
+#define SISWA_ARCHIVE_IMPLEMENTATION
+#include "libSUarchive.h"
+
+/* Reorders the entries of an archive by the loads that accessed them, so that
+ * the entries of a load end up next to each other. A load then touches fewer
+ * pages of an uncompressed archive and has to decompress fewer chunks of a SEGS
+ * archive. The trace of the loads gets replayed against both layouts to show
+ * the difference.
+ *
+ * Usage: reorderAr [trace.txt archive.ar.00 out.ar.00]
+ * A trace has a line for every access ('<seconds> <name>'), with every load
+ * starting with a line beginning with '#'. Entries accessed by the same loads
+ * get grouped together (see 'siswa_traceCluster'), entries that never got
+ * accessed go last.
+ *
+ * Without any arguments, a few loads of 'BossPetra.ar.00' get simulated while
+ * 'SISWA_TRACE_ACCESS' records them into 'trace.txt', which then gets used for
+ * writing 'reordered.ar.00'. */
+
+#define PAGE_SIZE 4096
+#define CHUNK_SIZE 0x10000
+#define MAX_NAME 256
+
+
+static FILE* traceFile = NULL;
+
+static
+void traceAccess(const void* entry) {
+	if (traceFile != NULL) {
+		fprintf(traceFile, "%.6f %s\n", (double)clock() / CLOCKS_PER_SEC,
+			siswa_arEntryGetName((const siArEntry*)entry));
+	}
+}
+
+
+typedef struct {
+	/* Names of every access, in order. */
+	char (*names)[MAX_NAME];
+	/* Index of the load of every access. */
+	uint32_t* loads;
+	size_t count;
+	size_t loadCount;
+} trace;
+
+static
+siBool traceRead(const char* path, trace* t) {
+	FILE* file = fopen(path, "r");
+	char line[MAX_NAME + 64];
+	size_t cap = 0;
+
+	if (file == NULL) {
+		return SISWA_FALSE;
+	}
+	t->names = NULL;
+	t->loads = NULL;
+	t->count = 0;
+	t->loadCount = 0;
+
+	while (fgets(line, sizeof(line), file) != NULL) {
+		char* name = strchr(line, ' ');
+		size_t len;
+
+		if (line[0] == '#') {
+			t->loadCount += 1;
+			continue;
+		}
+		if (name == NULL) {
+			continue;
+		}
+		name += 1;
+		len = SISWA_STRLEN(name);
+		while (len != 0 && (name[len - 1] == '\n' || name[len - 1] == '\r')) {
+			len -= 1;
+		}
+		if (len == 0 || len >= MAX_NAME) {
+			continue;
+		}
+
+		if (t->count == cap) {
+			cap = (cap == 0) ? 256 : cap * 2;
+			t->names = (char (*)[MAX_NAME])realloc(t->names, cap * MAX_NAME);
+			t->loads = (uint32_t*)realloc(t->loads, cap * sizeof(uint32_t));
+			SISWA_ASSERT(t->names != NULL && t->loads != NULL);
+		}
+		SISWA_MEMCPY(t->names[t->count], name, len);
+		t->names[t->count][len] = '\0';
+		t->loads[t->count] = (uint32_t)((t->loadCount != 0) ? t->loadCount - 1 : 0);
+		t->count += 1;
+	}
+	t->loadCount += (t->loadCount == 0 && t->count != 0);
+
+	fclose(file);
+	return SISWA_TRUE;
+}
+
+/* Replays every load of the trace against the layout, counting the pages and
+ * the 64 KiB SEGS chunks that the loads touch. */
+static
+void replay(siArFile ar, const trace* t, const char* label) {
+	size_t pageCount = (ar.len + PAGE_SIZE - 1) / PAGE_SIZE;
+	siByte* pages = (siByte*)malloc(pageCount + 1);
+	siByte* chunks = (siByte*)malloc(ar.len / CHUNK_SIZE + 1);
+	size_t totalPages = 0, totalChunks = 0, load, i;
+	FILE* saved = traceFile;
+
+	/* The replay itself mustn't end up in the trace. */
+	traceFile = NULL;
+	for (load = 0; load < t->loadCount; load += 1) {
+		SISWA_MEMSET(pages, 0, pageCount + 1);
+		SISWA_MEMSET(chunks, 0, ar.len / CHUNK_SIZE + 1);
+
+		for (i = 0; i < t->count; i += 1) {
+			siArEntry* entry;
+			size_t start, end, p;
+
+			if (t->loads[i] != load) {
+				continue;
+			}
+			entry = siswa_arEntryFind(ar, t->names[i]);
+			if (entry == NULL) {
+				continue;
+			}
+
+			start = (size_t)((siByte*)entry - ar.data);
+			end = start + siswa_arEntryGetSize(entry);
+			for (p = start / PAGE_SIZE; p <= (end - 1) / PAGE_SIZE; p += 1) {
+				totalPages += !pages[p];
+				pages[p] = SISWA_TRUE;
+			}
+			for (p = start / CHUNK_SIZE; p <= (end - 1) / CHUNK_SIZE; p += 1) {
+				totalChunks += !chunks[p];
+				chunks[p] = SISWA_TRUE;
+			}
+		}
+	}
+	traceFile = saved;
+
+	printf(
+		"%-10s %lu loads: %lu pages touched, %lu chunks decompressed (%.1f pages, %.1f chunks per load).\n",
+		label, (unsigned long)t->loadCount, (unsigned long)totalPages, (unsigned long)totalChunks,
+		(double)totalPages / (double)t->loadCount, (double)totalChunks / (double)t->loadCount
+	);
+	free(pages);
+	free(chunks);
+}
+
+/* Simulates a few loads, each needing a scattered set of entries along with a
+ * few of the entries of another load (e.g. shared assets). */
+static
+void simulateLoads(siArFile ar, const char* tracePath) {
+	static const size_t starts[] = {3, 40, 90, 150};
+	size_t count = siswa_arGetEntryCount(ar), load, i;
+	size_t loadCount = sizeof(starts) / sizeof(*starts);
+
+	traceFile = fopen(tracePath, "w");
+	SISWA_ASSERT_NOT_NULL(traceFile);
+
+	for (load = 0; load < loadCount; load += 1) {
+		fprintf(traceFile, "# load %lu\n", (unsigned long)load);
+		siswa_arEntryFind(ar, "Stage.stg.xml");
+
+		for (i = 0; i < 16; i += 1) {
+			size_t index = (i < 12)
+				? (starts[load] + i * 17) % count
+				: (starts[(load + 2) % loadCount] + (i - 12) * 17) % count;
+			siArEntry* entry = NULL;
+			siArFile iter = ar;
+
+			/* Lookups by name, like the game would do. */
+			while (siswa_arEntryPoll(&iter, &entry) && index != 0) {
+				index -= 1;
+			}
+			if (entry != NULL) {
+				siswa_arEntryFind(ar, siswa_arEntryGetName(entry));
+			}
+		}
+	}
+
+	fclose(traceFile);
+	traceFile = NULL;
+}
+
+
+int main(int argc, char** argv) {
+	const char* tracePath = "trace.txt";
+	const char* inPath = "examples/decompressSegs/BossPetra.ar.00";
+	const char* outPath = "reordered.ar.00";
+	const char** names;
+	const char** order;
+	siMemoryStream out;
+	siArFile ar, reordered;
+	trace t;
+	size_t alignment, orderCount, i;
+
+	if (argc == 4) {
+		tracePath = argv[1];
+		inPath = argv[2];
+		outPath = argv[3];
+	}
+	else if (argc != 1) {
+		fprintf(stderr, "Usage: reorderAr [trace.txt archive.ar.00 out.ar.00]\n");
+		return 1;
+	}
+
+	ar = siswa_arMake(inPath);
+	if (ar.type == SISWA_FILE_SEGS) {
+		size_t size = (size_t)siswa_arGetDecompressedSize(ar);
+		siswa_arDecompress(&ar, (siByte*)malloc(size), size, SISWA_TRUE);
+	}
+	if (ar.type != SISWA_FILE_REGULAR || !siswa_arValidate(&ar)) {
+		fprintf(stderr, "'%s' isn't a valid archive.\n", inPath);
+		return 1;
+	}
+
+	if (argc == 1) {
+		simulateLoads(ar, tracePath);
+	}
+	if (!traceRead(tracePath, &t)) {
+		fprintf(stderr, "Couldn't read '%s'.\n", tracePath);
+		return 1;
+	}
+
+	names = (const char**)malloc((t.count + 1) * sizeof(const char*));
+	order = (const char**)malloc((t.count + 1) * sizeof(const char*));
+	for (i = 0; i < t.count; i += 1) {
+		names[i] = t.names[i];
+	}
+	orderCount = siswa_traceCluster(names, t.loads, t.count, order);
+
+	/* Every entry can need up to an alignment's worth of more padding. */
+	alignment = siswa_arGetHeader(ar)->alignment;
+	out.cap = ar.len + (siswa_arGetEntryCount(ar) + 1) * (alignment != 0 ? alignment : 1);
+	out.data = (siByte*)malloc(out.cap);
+	out.len = out.pos = 0;
+	if (!siswa_arReorder(ar, order, orderCount, siswa_memoryWrite, &out)) {
+		fprintf(stderr, "Reordering failed.\n");
+		return 1;
+	}
+	reordered = siswa_arMakeBuffer(out.data, out.len);
+
+	replay(ar, &t, "original:");
+	replay(reordered, &t, "reordered:");
+
+	{
+		FILE* file = fopen(outPath, "wb");
+		SISWA_ASSERT_NOT_NULL(file);
+		fwrite(out.data, out.len, 1, file);
+		fclose(file);
+	}
+
+	free(names);
+	free(order);
+	free(t.names);
+	free(t.loads);
+	free(out.data);
+	free(ar.data);
+	return 0;
+}
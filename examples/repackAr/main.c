@@ -0,0 +1,237 @@
+#define SISWA_ARCHIVE_IMPLEMENTATION
+#include "libSUarchive.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/* Brings an archive up to date with a directory of source files, while only
+ * reading the files that changed since the archive was packed. The modification
+ * date of every file is compared against the date stored in its entry, and
+ * unchanged entries get copied over from the old archive as-is.
+ *
+ * Usage: repackAr sourceDirectory archive.ar.00 [out.ar.00]
+ * Every regular file in the directory becomes an entry named after the file.
+ * Entries keep their order in the old archive and new files get added after
+ * them. The archive gets replaced unless a separate output is given, and gets
+ * created if it doesn't exist yet. */
+
+#define MAX_PATH 1024
+
+
+typedef struct {
+	const char* directory;
+	siByte* buffer;
+	size_t cap;
+} readContext;
+
+typedef struct {
+	siRepackSource source;
+	/* Position in the old archive, or the amount of old entries for new files. */
+	size_t order;
+} sourceFile;
+
+
+static
+int compareNames(const void* a, const void* b) {
+	return strcmp(((const sourceFile*)a)->source.name, ((const sourceFile*)b)->source.name);
+}
+
+static
+int compareOrder(const void* a, const void* b) {
+	const sourceFile* x = (const sourceFile*)a;
+	const sourceFile* y = (const sourceFile*)b;
+	if (x->order != y->order) {
+		return x->order < y->order ? -1 : 1;
+	}
+	return strcmp(x->source.name, y->source.name);
+}
+
+/* Lists every regular file in the directory. Returns the amount of files. */
+static
+size_t listSources(const char* directory, sourceFile** out) {
+	DIR* dir = opendir(directory);
+	struct dirent* ent;
+	sourceFile* files = NULL;
+	size_t count = 0, cap = 0;
+
+	if (dir == NULL) {
+		return 0;
+	}
+
+	while ((ent = readdir(dir)) != NULL) {
+		char path[MAX_PATH * 2];
+		struct stat st;
+		char* name;
+
+		if (SISWA_STRLEN(directory) + SISWA_STRLEN(ent->d_name) + 2 > MAX_PATH) {
+			continue;
+		}
+		sprintf(path, "%s/%s", directory, ent->d_name);
+		if (stat(path, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size > 0xFFFFFFFF) {
+			continue;
+		}
+
+		if (count == cap) {
+			cap = (cap == 0) ? 64 : cap * 2;
+			files = (sourceFile*)realloc(files, cap * sizeof(sourceFile));
+			SISWA_ASSERT_NOT_NULL(files);
+		}
+		name = (char*)malloc(SISWA_STRLEN(ent->d_name) + 1);
+		strcpy(name, ent->d_name);
+
+		files[count].source.name = name;
+		files[count].source.nameLen = SISWA_STRLEN(name);
+		files[count].source.dataSize = (uint32_t)st.st_size;
+		files[count].source.filedate = siswa_filedateFromUnix((uint64_t)st.st_mtime, 0);
+		files[count].source.user = NULL;
+		count += 1;
+	}
+	closedir(dir);
+
+	*out = files;
+	return count;
+}
+
+static
+const void* readSource(void* user, const siRepackSource* source) {
+	readContext* ctx = (readContext*)user;
+	char path[MAX_PATH * 2];
+	FILE* file;
+	size_t len;
+
+	if (source->dataSize > ctx->cap) {
+		ctx->cap = source->dataSize;
+		ctx->buffer = (siByte*)realloc(ctx->buffer, ctx->cap);
+		SISWA_ASSERT_NOT_NULL(ctx->buffer);
+	}
+
+	sprintf(path, "%s/%s", ctx->directory, source->name);
+	file = fopen(path, "rb");
+	if (file == NULL) {
+		return NULL;
+	}
+	len = fread(ctx->buffer, 1, source->dataSize, file);
+	fclose(file);
+
+	if (len != source->dataSize) {
+		fprintf(stderr, "'%s' changed while being read.\n", path);
+		return NULL;
+	}
+	return ctx->buffer != NULL ? ctx->buffer : (const siByte*)"";
+}
+
+
+int main(int argc, char** argv) {
+	const char* directory;
+	const char* archivePath;
+	char outPath[MAX_PATH + 8];
+	sourceFile* files = NULL;
+	siRepackSource* sources;
+	siRepackStats stats;
+	readContext ctx;
+	struct stat st;
+	size_t count, oldCount, i;
+	siArFile old;
+	siBool ok;
+	FILE* out;
+
+	if (argc < 3 || SISWA_STRLEN(argv[2]) >= MAX_PATH) {
+		fprintf(stderr, "Usage: repackAr sourceDirectory archive.ar.00 [out.ar.00]\n");
+		return 1;
+	}
+	directory = argv[1];
+	archivePath = argv[2];
+
+	if (stat(archivePath, &st) == 0) {
+		old = siswa_arMake(archivePath);
+		if (old.type == SISWA_FILE_SEGS) {
+			size_t size = (size_t)siswa_arGetDecompressedSize(old);
+			siswa_arDecompress(&old, (siByte*)malloc(size), size, SISWA_TRUE);
+		}
+		if (old.type != SISWA_FILE_REGULAR || !siswa_arValidate(&old)) {
+			fprintf(stderr, "'%s' isn't a valid archive.\n", archivePath);
+			return 1;
+		}
+	}
+	else {
+		old = siswa_arCreateContent(sizeof(siArHeader));
+	}
+
+	count = listSources(directory, &files);
+	if (count == 0) {
+		fprintf(stderr, "No source files in '%s'.\n", directory);
+		return 1;
+	}
+
+	/* Old entries keep their position, new files go after them by name. */
+	oldCount = siswa_arGetEntryCount(old);
+	qsort(files, count, sizeof(sourceFile), compareNames);
+	for (i = 0; i < count; i += 1) {
+		files[i].order = oldCount;
+	}
+	{
+		siArEntry* entry;
+		size_t index = 0;
+		while (siswa_arEntryPoll(&old, &entry)) {
+			sourceFile key;
+			sourceFile* match;
+
+			key.source.name = siswa_arEntryGetName(entry);
+			match = (sourceFile*)bsearch(&key, files, count, sizeof(sourceFile), compareNames);
+			if (match != NULL) {
+				match->order = index;
+			}
+			index += 1;
+		}
+	}
+	qsort(files, count, sizeof(sourceFile), compareOrder);
+
+	sources = (siRepackSource*)malloc(count * sizeof(siRepackSource));
+	for (i = 0; i < count; i += 1) {
+		sources[i] = files[i].source;
+	}
+
+	/* Written next to the archive first, so that a failure never leaves a
+	 * half-written archive behind. */
+	if (argc > 3) {
+		sprintf(outPath, "%.*s", MAX_PATH - 1, argv[3]);
+	}
+	else {
+		sprintf(outPath, "%s.tmp", archivePath);
+	}
+	out = fopen(outPath, "wb");
+	SISWA_ASSERT_NOT_NULL(out);
+
+	ctx.directory = directory;
+	ctx.buffer = NULL;
+	ctx.cap = 0;
+	ok = siswa_arRepack(old, sources, count, readSource, &ctx, siswa_fileWrite, out, &stats);
+	ok &= (fclose(out) == 0);
+
+	if (!ok) {
+		fprintf(stderr, "Repacking failed.\n");
+		remove(outPath);
+		return 1;
+	}
+	if (argc <= 3 && rename(outPath, archivePath) != 0) {
+		fprintf(stderr, "Couldn't replace '%s'.\n", archivePath);
+		return 1;
+	}
+
+	printf(
+		"%lu reused, %lu touched, %lu changed, %lu added, %lu removed.\n",
+		(unsigned long)stats.reused, (unsigned long)stats.touched,
+		(unsigned long)stats.changed, (unsigned long)stats.added,
+		(unsigned long)stats.removed
+	);
+
+	for (i = 0; i < count; i += 1) {
+		free((char*)sources[i].name);
+	}
+	free(sources);
+	free(files);
+	free(ctx.buffer);
+	free(old.data);
+	return 0;
+}
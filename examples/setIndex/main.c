@@ -0,0 +1,122 @@
+#define _GNU_SOURCE
+#define SISWA_ARCHIVE_IMPLEMENTATION
+#define SISWA_USE_SET_INDEX
+#define SISWA_USE_THREADS
+#include "libSUarchive.h"
+
+#include <sys/time.h>
+
+/* Indexes the objects of every set ('.set.xml') in the example archives, then
+ * looks them up by their ID and type, and finds everything referring to an ID.
+ *
+ * Usage: setIndex [id] [type] */
+
+#define BENCH_RUNS 50
+#define BENCH_LOOKUPS 1000000
+#define THREAD_COUNT 8
+
+
+static
+double now(void) {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+}
+
+static
+void printObject(const siSetIndex* index, const char* const* paths, uint32_t i) {
+	const siSetObject* object = &index->objects[i];
+
+	printf("    %.*s %u in %s/%s", (int)object->typeLen, object->type, object->id,
+		paths[object->archive], siswa_arEntryGetName(object->entry));
+	if (object->hasPosition) {
+		printf(" at (%.2f, %.2f, %.2f)", object->position[0], object->position[1],
+			object->position[2]);
+	}
+	printf("\n");
+}
+
+
+int main(int argc, char** argv) {
+	static const char* paths[] = {
+		"examples/unpackAr/pan.ar.00",
+		"examples/decompressSegs/BossPetra.ar.00",
+		"examples/mergeAr/gimmickSet.ar.00",
+		"examples/mergeAr/anotherGimmickSet.ar.00",
+		"examples/mergeAr/test.ar.00"
+	};
+	siArFile ars[sizeof(paths) / sizeof(*paths)];
+	uint32_t id = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : 2143441;
+	const char* type = (argc > 2) ? argv[2] : "EnemyObjEnemyHole";
+	const uint32_t* found;
+	siSetIndex index;
+	size_t count = sizeof(paths) / sizeof(*paths), n, i, run;
+	double start, single, threaded, lookups;
+
+	for (i = 0; i < count; i += 1) {
+		ars[i] = siswa_arMake(paths[i]);
+		if (ars[i].type != SISWA_FILE_REGULAR) {
+			size_t size = (size_t)siswa_arGetDecompressedSize(ars[i]);
+			siswa_arDecompress(&ars[i], (siByte*)malloc(size), size, SISWA_TRUE);
+		}
+	}
+
+	start = now();
+	for (run = 0; run < BENCH_RUNS; run += 1) {
+		siswa_setIndexBuild(&index, ars, count, 1);
+		siswa_setIndexFree(&index);
+	}
+	single = (now() - start) / BENCH_RUNS;
+
+	start = now();
+	for (run = 0; run < BENCH_RUNS; run += 1) {
+		siswa_setIndexFree(&index);
+		siswa_setIndexBuild(&index, ars, count, THREAD_COUNT);
+	}
+	threaded = (now() - start) / BENCH_RUNS;
+
+	printf("%lu sets (%lu bytes): %lu objects, %lu references\n",
+		(unsigned long)index.sets, (unsigned long)index.bytes,
+		(unsigned long)index.objectCount, (unsigned long)index.refCount);
+	printf("    1 thread:        %8.2f ms (%.1f MB/s)\n", single * 1e3,
+		(double)index.bytes / single / 1e6);
+	printf("    up to %d threads: %8.2f ms (%.1f MB/s)\n\n", THREAD_COUNT, threaded * 1e3,
+		(double)index.bytes / threaded / 1e6);
+
+	n = siswa_setIndexFindId(&index, id, &found);
+	printf("Objects with the ID %u: %lu\n", id, (unsigned long)n);
+	for (i = 0; i < n; i += 1) {
+		printObject(&index, paths, found[i]);
+	}
+
+	n = siswa_setIndexFindType(&index, type, &found);
+	printf("Objects of the type '%s': %lu\n", type, (unsigned long)n);
+	for (i = 0; i < n && i < 5; i += 1) {
+		printObject(&index, paths, found[i]);
+	}
+	if (n > 5) {
+		printf("    ...\n");
+	}
+
+	n = siswa_setIndexFindRefs(&index, id, &found);
+	printf("Objects referring to the ID %u: %lu\n", id, (unsigned long)n);
+	for (i = 0; i < n; i += 1) {
+		const siSetRef* ref = &index.refs[found[i]];
+		printf("  through '%.*s':\n", (int)ref->listLen, ref->list);
+		printObject(&index, paths, ref->object);
+	}
+
+	/* Lookups of every ID in turn. */
+	start = now();
+	for (run = 0, n = 0; run < BENCH_LOOKUPS; run += 1) {
+		n += siswa_setIndexFindId(&index, index.objects[run % index.objectCount].id, NULL);
+	}
+	lookups = (now() - start) / BENCH_LOOKUPS;
+	printf("\nlookup by ID: %.0f ns (%lu found)\n", lookups * 1e9, (unsigned long)n);
+
+	siswa_setIndexFree(&index);
+	for (i = 0; i < count; i += 1) {
+		siswa_arFree(ars[i]);
+	}
+	return 0;
+}
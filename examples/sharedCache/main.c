@@ -0,0 +1,100 @@
+#define _GNU_SOURCE
+#define SISWA_ARCHIVE_IMPLEMENTATION
+#define SISWA_USE_SHARED_CACHE
+#include "libSUarchive.h"
+
+#include <sys/time.h>
+#include <sys/wait.h>
+
+/* Starts a few processes that all load the same archive through a shared
+ * cache, at the same time. Only one of them decompresses it, the rest wait for
+ * it and map the same pages. Running it again with '--keep' shows every process
+ * getting the archive straight from the cache.
+ *
+ * Usage: sharedCache [--keep] [archive.ar.00]
+ * Loads 'examples/decompressSegs/BossPetra.ar.00' by default. Unless '--keep'
+ * is given, the cache gets deleted at the end. */
+
+#define PROCESS_COUNT 4
+#define CACHE_NAME "siswa-example"
+
+
+static
+double now(void) {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+}
+
+static
+int child(const char* path, size_t index) {
+	siSharedCache cache;
+	siManifestEntry* manifest;
+	siArFile ar;
+	siBool built;
+	size_t count;
+	double start = now();
+
+	if (!siswa_sharedCacheOpen(&cache, CACHE_NAME)) {
+		fprintf(stderr, "Couldn't open the shared cache.\n");
+		return 1;
+	}
+	ar = siswa_sharedCacheGet(&cache, path, &built);
+	siswa_sharedCacheClose(&cache);
+	if (ar.type != SISWA_FILE_REGULAR || !siswa_arValidate(&ar)) {
+		fprintf(stderr, "Couldn't get '%s' from the cache.\n", path);
+		return 1;
+	}
+
+	/* Some work on the archive, so that every process actually reads it. */
+	count = siswa_arGetEntryCount(ar);
+	manifest = (siManifestEntry*)malloc(count * sizeof(siManifestEntry));
+	siswa_arManifest(ar, manifest, count);
+
+	printf(
+		"process %lu: %s %lu bytes in %.3f ms, %lu entries, first hash %08lx\n",
+		(unsigned long)index, built ? "decompressed" : "mapped      ",
+		(unsigned long)ar.len, (now() - start) * 1000.0, (unsigned long)count,
+		(unsigned long)(manifest[0].hash & 0xFFFFFFFF)
+	);
+
+	free(manifest);
+	siswa_arUnmap(ar);
+	return 0;
+}
+
+
+int main(int argc, char** argv) {
+	const char* path = "examples/decompressSegs/BossPetra.ar.00";
+	siBool keep = SISWA_FALSE;
+	int arg, failed = 0;
+	size_t i;
+
+	for (arg = 1; arg < argc; arg += 1) {
+		if (strcmp(argv[arg], "--keep") == 0) {
+			keep = SISWA_TRUE;
+		}
+		else {
+			path = argv[arg];
+		}
+	}
+
+	fflush(stdout);
+	for (i = 0; i < PROCESS_COUNT; i += 1) {
+		pid_t pid = fork();
+		if (pid == 0) {
+			exit(child(path, i));
+		}
+		SISWA_ASSERT(pid != -1);
+	}
+	for (i = 0; i < PROCESS_COUNT; i += 1) {
+		int status;
+		wait(&status);
+		failed |= !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+	}
+
+	if (!keep) {
+		siswa_sharedCacheUnlink(CACHE_NAME);
+	}
+	return failed;
+}
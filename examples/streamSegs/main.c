@@ -0,0 +1,150 @@
+#define SISWA_ARCHIVE_IMPLEMENTATION
+#include "libSUarchive.h"
+
+/* Decompresses a SEGS archive from a stream (a pipe, a socket...) without ever
+ * holding an entire chunk in memory. The input is read in small pieces and the
+ * output is written in small pieces as well.
+ *
+ * Usage: streamSegs [input.ar.00] [output.ar.00]
+ * Reads from stdin and writes to stdout by default, e.g.:
+ *     cat examples/decompressSegs/BossPetra.ar.00 | ./streamSegs > output.ar.00 */
+
+#define READ_SIZE 4096
+#define WRITE_SIZE 8192
+
+
+static
+uint32_t readBE(const siByte* ptr, size_t len) {
+	uint32_t res = 0;
+	size_t i;
+	for (i = 0; i < len; i += 1) {
+		res = (res << 8) | ptr[i];
+	}
+	return res;
+}
+
+/* Reads exactly 'len' bytes, as pipes can return less than what was asked. */
+static
+siBool readExact(FILE* file, void* out, size_t len) {
+	return fread(out, 1, len, file) == len;
+}
+
+
+int main(int argc, char** argv) {
+	static siByte window[SISWA_INFLATE_WINDOW_SIZE];
+	static siInflateState state;
+	siByte input[READ_SIZE];
+	siByte output[WRITE_SIZE];
+	siByte header[sizeof(siSegsHeader)];
+	siByte* table;
+	size_t chunks, i;
+	size_t position;
+	FILE* in = (argc > 1) ? fopen(argv[1], "rb") : stdin;
+	FILE* out = (argc > 2) ? fopen(argv[2], "wb") : stdout;
+
+	SISWA_ASSERT_NOT_NULL(in);
+	SISWA_ASSERT_NOT_NULL(out);
+
+	/* The header and the chunk table come first. */
+	if (!readExact(in, header, sizeof(header))
+			|| SISWA_STRNCMP((const char*)header, "segs", 4) != 0) {
+		fprintf(stderr, "Not a SEGS archive.\n");
+		return 1;
+	}
+	chunks = readBE(&header[6], 2);
+	table = (siByte*)malloc(chunks * sizeof(siSegsEntry));
+	if (!readExact(in, table, chunks * sizeof(siSegsEntry))) {
+		fprintf(stderr, "Truncated chunk table.\n");
+		return 1;
+	}
+	position = sizeof(siSegsHeader) + chunks * sizeof(siSegsEntry);
+
+	for (i = 0; i < chunks; i += 1) {
+		const siByte* entry = &table[i * sizeof(siSegsEntry)];
+		size_t zSize = readBE(&entry[0], 2);
+		size_t size = readBE(&entry[2], 2);
+		size_t offset = readBE(&entry[4], 4) - 1;
+		size_t left = zSize;
+		siInflateStatus status = SISWA_INFLATE_NEED_INPUT;
+
+		if (i == 0 && offset == 0) {
+			offset = position;
+		}
+		size += (size == 0) * 0x10000;
+
+		/* Skip the padding between the chunks. */
+		SISWA_ASSERT_MSG(offset >= position, "Chunks must be in stream order");
+		while (position < offset) {
+			size_t n = offset - position < READ_SIZE ? offset - position : READ_SIZE;
+			if (!readExact(in, input, n)) {
+				fprintf(stderr, "Truncated archive.\n");
+				return 1;
+			}
+			position += n;
+		}
+
+		if (size == zSize) {
+			/* Stored chunk, copied as-is. */
+			while (left != 0) {
+				size_t n = left < READ_SIZE ? left : READ_SIZE;
+				if (!readExact(in, input, n)) {
+					fprintf(stderr, "Truncated archive.\n");
+					return 1;
+				}
+				fwrite(input, n, 1, out);
+				left -= n;
+			}
+			position += zSize;
+			continue;
+		}
+
+		siswa_decompressDeflateInit(&state, window);
+		state.out = output;
+		state.outLen = sizeof(output);
+
+		while (status != SISWA_INFLATE_DONE) {
+			if (state.inLen == 0) {
+				size_t n = left < READ_SIZE ? left : READ_SIZE;
+				if (n == 0 || !readExact(in, input, n)) {
+					fprintf(stderr, "Truncated chunk #%lu.\n", (unsigned long)i);
+					return 1;
+				}
+				state.in = input;
+				state.inLen = n;
+				left -= n;
+			}
+
+			status = siswa_decompressDeflateStream(&state);
+			if (status == SISWA_INFLATE_ERROR) {
+				fprintf(stderr, "Chunk #%lu is corrupted.\n", (unsigned long)i);
+				return 1;
+			}
+
+			if (status == SISWA_INFLATE_NEED_OUTPUT || status == SISWA_INFLATE_DONE) {
+				fwrite(output, (size_t)(state.out - output), 1, out);
+				state.out = output;
+				state.outLen = sizeof(output);
+			}
+		}
+
+		/* Whatever's left of the chunk is padding. */
+		while (left != 0) {
+			size_t n = left < READ_SIZE ? left : READ_SIZE;
+			if (!readExact(in, input, n)) {
+				break;
+			}
+			left -= n;
+		}
+		position += zSize;
+		SISWA_ASSERT_MSG(state.totalOut == size, "Chunk decompressed into the wrong size");
+	}
+
+	free(table);
+	if (in != stdin) {
+		fclose(in);
+	}
+	if (out != stdout) {
+		fclose(out);
+	}
+	return 0;
+}
@@ -0,0 +1,167 @@
+#define _GNU_SOURCE
+#define SISWA_ARCHIVE_IMPLEMENTATION
+#include "libSUarchive.h"
+
+#include <unistd.h>
+#include <sys/time.h>
+
+/* Converts tar streams into archives and back, in one pass from one file
+ * descriptor to another, so that it can sit in the middle of a pipeline.
+ *
+ * Usage:
+ *     tarAr toAr [alignment] < input.tar > output.ar.00
+ *     tarAr toTar < input.ar.00 > output.tar
+ *     tarAr       - converts the example archives to tar and back, checking
+ *                   that they come out the same, and measures the throughput.
+ * E.g. 'tar -cf - -C assets . | ./tarAr toAr 64 > assets.ar.00'. */
+
+#define BENCH_RUNS 200
+
+
+/* 'siReadProc' over a file descriptor. Pipes return less than what was asked
+ * for, so it only stops short at the end of the stream. */
+static
+size_t fdRead(void* user, void* out, size_t len) {
+	int fd = *(int*)user;
+	size_t total = 0;
+
+	while (total < len) {
+		ssize_t n = read(fd, (char*)out + total, len - total);
+		if (n <= 0) {
+			break;
+		}
+		total += (size_t)n;
+	}
+	return total;
+}
+
+static
+size_t fdWrite(void* user, const void* data, size_t len) {
+	int fd = *(int*)user;
+	size_t total = 0;
+
+	while (total < len) {
+		ssize_t n = write(fd, (const char*)data + total, len - total);
+		if (n <= 0) {
+			break;
+		}
+		total += (size_t)n;
+	}
+	return total;
+}
+
+static
+double now(void) {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+}
+
+
+/* Whether both archives have the same entries, regardless of their padding. */
+static
+siBool sameEntries(siArFile a, siArFile b) {
+	siArEntry* entry;
+
+	if (!siswa_arValidate(&b) || siswa_arGetEntryCount(a) != siswa_arGetEntryCount(b)) {
+		return SISWA_FALSE;
+	}
+	while (siswa_arEntryPoll(&a, &entry)) {
+		siArEntry* other = siswa_arEntryFind(b, siswa_arEntryGetName(entry));
+		if (other == NULL || siswa_arEntryGetDataSize(other) != siswa_arEntryGetDataSize(entry)
+				|| siswa_arEntryGetFiledate(other) != siswa_arEntryGetFiledate(entry)
+				|| memcmp(siswa_arEntryGetData(other), siswa_arEntryGetData(entry),
+					siswa_arEntryGetDataSize(entry)) != 0) {
+			return SISWA_FALSE;
+		}
+	}
+	return SISWA_TRUE;
+}
+
+
+static
+int benchmark(void) {
+	static const char* paths[] = {
+		"examples/unpackAr/pan.ar.00",
+		"examples/decompressSegs/BossPetra.ar.00",
+		"examples/mergeAr/test.ar.00"
+	};
+	size_t i;
+
+	for (i = 0; i < sizeof(paths) / sizeof(*paths); i += 1) {
+		siArFile ar = siswa_arMake(paths[i]);
+		siMemoryStream source, tar, back;
+		double start, toTar, toAr;
+		size_t run;
+
+		if (ar.type != SISWA_FILE_REGULAR) {
+			size_t size = (size_t)siswa_arGetDecompressedSize(ar);
+			siswa_arDecompress(&ar, (siByte*)malloc(size), size, SISWA_TRUE);
+		}
+
+		/* Every entry can take up to four more blocks: its header, a pax header
+		 * with its records, and the padding of its data. */
+		source.data = ar.data;
+		source.len = source.cap = ar.len;
+		tar.cap = ar.len + (siswa_arGetEntryCount(ar) * 4 + 2) * 512;
+		tar.data = (siByte*)malloc(tar.cap);
+		/* Archives made by other tools might not be padded to their alignment. */
+		back.cap = ar.len + siswa_arGetEntryCount(ar) * siswa_arGetHeader(ar)->alignment;
+		back.data = (siByte*)malloc(back.cap);
+
+		start = now();
+		for (run = 0; run < BENCH_RUNS; run += 1) {
+			source.pos = tar.len = 0;
+			SISWA_ASSERT(siswa_arToTar(siswa_memoryRead, &source, siswa_memoryWrite, &tar));
+		}
+		toTar = (now() - start) / BENCH_RUNS;
+
+		start = now();
+		for (run = 0; run < BENCH_RUNS; run += 1) {
+			tar.pos = back.len = 0;
+			SISWA_ASSERT(siswa_tarToAr(siswa_memoryRead, &tar, siswa_memoryWrite, &back,
+				siswa_arGetHeader(ar)->alignment));
+		}
+		toAr = (now() - start) / BENCH_RUNS;
+
+		printf("%s: %lu entries, %lu byte tar, round trip %s\n", paths[i],
+			(unsigned long)siswa_arGetEntryCount(ar), (unsigned long)tar.len,
+			(back.len == ar.len && memcmp(back.data, ar.data, ar.len) == 0)
+				? "identical"
+				: (sameEntries(ar, siswa_arMakeBuffer(back.data, back.len)) ? "with new padding" : "DIFFERENT"));
+		printf("    ar -> tar: %8.1f MB/s\n", (double)ar.len / toTar / 1e6);
+		printf("    tar -> ar: %8.1f MB/s\n", (double)ar.len / toAr / 1e6);
+
+		free(back.data);
+		free(tar.data);
+		siswa_arFree(ar);
+	}
+	return 0;
+}
+
+
+int main(int argc, char** argv) {
+	int in = STDIN_FILENO, out = STDOUT_FILENO;
+
+	if (argc == 1) {
+		return benchmark();
+	}
+	if (strcmp(argv[1], "toAr") == 0 && argc <= 3) {
+		uint32_t alignment = (argc == 3) ? (uint32_t)strtoul(argv[2], NULL, 10) : 64;
+		if (!siswa_tarToAr(fdRead, &in, fdWrite, &out, alignment)) {
+			fprintf(stderr, "Couldn't convert the tar (corrupted, or a file is too big).\n");
+			return 1;
+		}
+		return 0;
+	}
+	if (strcmp(argv[1], "toTar") == 0 && argc == 2) {
+		if (!siswa_arToTar(fdRead, &in, fdWrite, &out)) {
+			fprintf(stderr, "Couldn't convert the archive (corrupted or compressed).\n");
+			return 1;
+		}
+		return 0;
+	}
+
+	fprintf(stderr, "Usage: tarAr [toAr [alignment] | toTar]\n");
+	return 1;
+}
@@ -11,7 +11,7 @@ int main(void) {
 		void* data = siswa_arEntryGetData(entry);
 
 		FILE* file = fopen(filename, "wb");
-		fwrite(data, entry->dataSize, 1, file);
+		fwrite(data, siswa_arEntryGetDataSize(entry), 1, file);
 		fclose(file);
 	}
 
@@ -0,0 +1,176 @@
+#define _GNU_SOURCE
+#define SISWA_ARCHIVE_IMPLEMENTATION
+#define SISWA_USE_VFS
+#include "libSUarchive.h"
+
+#include <sys/time.h>
+
+/* Mounts a base game split into 'Base.ar.00' and 'Base.ar.01' (made out of
+ * 'BossPetra.ar.00'), a mod archive and a directory of loose files on top of
+ * each other, and shows which layer every file comes from. Then benchmarks
+ * lookups through the merged index against searching every layer in order.
+ *
+ * Usage: vfs [--keep]
+ * Everything gets written into 'vfsExample/', which gets deleted at the end
+ * unless '--keep' is given. */
+
+#define LOOKUPS 1000000
+
+
+static
+double now(void) {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+}
+
+static
+void writeFile(const char* path, const void* data, size_t len) {
+	FILE* file = fopen(path, "wb");
+	SISWA_ASSERT_NOT_NULL(file);
+	fwrite(data, 1, len, file);
+	fclose(file);
+}
+
+static
+void setup(void) {
+	siArFile boss = siswa_arMake("examples/decompressSegs/BossPetra.ar.00");
+	siArFile splits[2], mod;
+	siArlFile arl;
+	siArEntry* entry;
+	size_t size = (size_t)siswa_arGetDecompressedSize(boss), count = 0, i;
+
+	siswa_arDecompress(&boss, (siByte*)malloc(size), size, SISWA_TRUE);
+	splits[0] = siswa_arCreateContent(size);
+	splits[1] = siswa_arCreateContent(size);
+
+	/* The first half of the entries goes into the first split. */
+	while (siswa_arEntryPoll(&boss, &entry)) {
+		const char* name = siswa_arEntryGetName(entry);
+		siArFile* split = &splits[count < siswa_arGetEntryCount(boss) / 2 ? 0 : 1];
+
+		siswa_arEntryAddDated(split, name, SISWA_STRLEN(name), siswa_arEntryGetData(entry),
+			siswa_arEntryGetDataSize(entry), siswa_arEntryGetFiledate(entry));
+		count += 1;
+	}
+
+	mod = siswa_arCreateContent(4096);
+	siswa_arEntryAdd(&mod, "Boss.prm.xml", "<Boss mod=\"archive\"/>", 21);
+	siswa_arEntryAdd(&mod, "Camera.set.xml", "<Camera mod=\"archive\"/>", 23);
+	siswa_arEntryAdd(&mod, "ModOnly.txt", "only in the mod archive", 23);
+
+	arl = siswa_arlCreateFromArMul(splits, 2, malloc(1 << 16), 1 << 16);
+
+	mkdir("vfsExample", 0755);
+	mkdir("vfsExample/loose", 0755);
+	mkdir("vfsExample/loose/sub", 0755);
+	writeFile("vfsExample/Base.ar.00", splits[0].data, splits[0].len);
+	writeFile("vfsExample/Base.ar.01", splits[1].data, splits[1].len);
+	writeFile("vfsExample/Base.arl", arl.data, arl.len);
+	writeFile("vfsExample/Mod.ar.00", mod.data, mod.len);
+	writeFile("vfsExample/loose/Camera.set.xml", "<Camera mod=\"loose\"/>", 21);
+	writeFile("vfsExample/loose/sub/Extra.txt", "a loose file in a subdirectory", 30);
+
+	for (i = 0; i < 2; i += 1) {
+		free(splits[i].data);
+	}
+	free(mod.data);
+	free(arl.data);
+	free(boss.data);
+}
+
+static
+void cleanup(void) {
+	remove("vfsExample/loose/sub/Extra.txt");
+	remove("vfsExample/loose/Camera.set.xml");
+	rmdir("vfsExample/loose/sub");
+	rmdir("vfsExample/loose");
+	remove("vfsExample/Base.ar.00");
+	remove("vfsExample/Base.ar.01");
+	remove("vfsExample/Base.arl");
+	remove("vfsExample/Mod.ar.00");
+	rmdir("vfsExample");
+}
+
+
+static const char* names[] = {
+	"Stage.stg.xml", "Boss.prm.xml", "Camera.set.xml", "ModOnly.txt",
+	"sub/Extra.txt", "ptrboss_col_stageA.phy.hkx", "Missing.xml"
+};
+#define NAME_COUNT (sizeof(names) / sizeof(*names))
+
+/* What finding a file without the merged index takes: every layer gets searched
+ * from the highest priority down. */
+static
+siBool findLayered(const siVfs* vfs, const char* name) {
+	size_t i, j;
+
+	for (i = vfs->layerCount; i != 0; i -= 1) {
+		const siVfsLayer* layer = &vfs->layers[i - 1];
+		for (j = 0; j < layer->arCount; j += 1) {
+			if (siswa_arEntryFind(layer->ars[j], name) != NULL) {
+				return SISWA_TRUE;
+			}
+		}
+	}
+	return SISWA_FALSE;
+}
+
+int main(int argc, char** argv) {
+	static const char* types[] = {"", "directory", "archive", "split"};
+	siVfs vfs;
+	size_t found = 0, i;
+	double start, indexed, layered;
+
+	setup();
+	siswa_vfsInit(&vfs);
+	SISWA_ASSERT(siswa_vfsAddSplit(&vfs, "vfsExample/Base.arl", 0));
+	SISWA_ASSERT(siswa_vfsAddArchive(&vfs, "vfsExample/Mod.ar.00", 10));
+	SISWA_ASSERT(siswa_vfsAddDirectory(&vfs, "vfsExample/loose", 20));
+	siswa_vfsMount(&vfs);
+
+	for (i = 0; i < vfs.layerCount; i += 1) {
+		const siVfsLayer* layer = &vfs.layers[i];
+		printf("layer %lu: %-9s priority %2d, %4lu files, %s\n", (unsigned long)i,
+			types[layer->type], (int)layer->priority, (unsigned long)layer->fileCount,
+			layer->path);
+	}
+	printf("%lu files mounted\n\n", (unsigned long)vfs.fileCount);
+
+	for (i = 0; i < NAME_COUNT; i += 1) {
+		siVfsFile file;
+		if (!siswa_vfsOpen(&vfs, names[i], &file)) {
+			printf("%-28s doesn't exist\n", names[i]);
+			continue;
+		}
+		printf("%-28s %6lu bytes from %-28s %s\n", names[i], (unsigned long)file.size,
+			file.layer->path, file.layer->type == SISWA_VFS_DIRECTORY ? "(read)" : "(in place)");
+		if (file.size < 40) {
+			printf("%28s '%.*s'\n", "", (int)file.size, (const char*)file.data);
+		}
+		siswa_vfsClose(&file);
+	}
+
+	/* Loose files are left out, as opening them is dominated by the file system. */
+	start = now();
+	for (i = 0; i < LOOKUPS; i += 1) {
+		found += (siswa_vfsFind(&vfs, names[i % 4 == 3 ? 5 : i % 4]) != NULL);
+	}
+	indexed = (now() - start) / LOOKUPS;
+
+	start = now();
+	for (i = 0; i < LOOKUPS; i += 1) {
+		found += findLayered(&vfs, names[i % 4 == 3 ? 5 : i % 4]);
+	}
+	layered = (now() - start) / LOOKUPS;
+
+	printf("\nlookup through the merged index: %8.1f ns\n", indexed * 1e9);
+	printf("lookup layer by layer:           %8.1f ns\n", layered * 1e9);
+	printf("%lu files found\n", (unsigned long)found);
+
+	siswa_vfsFree(&vfs);
+	if (argc < 2 || strcmp(argv[1], "--keep") != 0) {
+		cleanup();
+	}
+	return 0;
+}
@@ -15,7 +15,7 @@ Adventure's/Unleashed's archive file formats (.ar/.arl).
 	one is using 'siswa_<ar/arl>Make(const char*)`, which utilizes the C standard
 	library's IO functions, and its heap memory allocation functions. Making use
 	of this method requires the C standard, as well as to call 'siswa_<ar/arl>Free`
-	or simply `free(var.data)` at the end.
+	or simply `siswa_free(var.data)` at the end.
 
 	If you cannot use the IO functions or want to specify your own buffer, the
 	`siswa_<ar/arl>MakeBuffer(void*, size_t)` functions achieve the same results
@@ -62,16 +62,114 @@ Adventure's/Unleashed's archive file formats (.ar/.arl).
 		- Disables siswa's implementation of Deflate decompression, but keeps
 		intact SEGS decompression functions like 'siswa_arDecompressSegs'.
 		In turn the user must  implement their own 'siswa_decompressDeflate'
-		function inside their source.
+		function inside their source. The resumable 'siswa_decompressDeflateStream'
+		API is unavailable in that case.
 
 	6. SISWA_USE_PRAGMA_PACK
 		- Uses '#pragma pack(push, 1)' for every struct inside the file to achieve
 		guaranteed correct struct sizes. Turned off by default for portability reasons.
 
-	7. SISWA_MEMCPY, SISWA_STRLEN, SISWA_STRNCMP or SISWA_MEMSET
+	7. SISWA_MEMCPY, SISWA_MEMMOVE, SISWA_STRLEN, SISWA_STRNCMP, SISWA_MEMSET or SISWA_MEMCHR
 		- Replaces base C standard library version of the function with the
 		specified custom one when they're called in the library.
 
+	8. SISWA_NO_SIMD
+		- Disables the SSE2/AVX2/NEON code paths (name comparisons, Deflate match
+		copying) in favour of plain C ones. AVX2 is only used when the compiler
+		targets it (e.g. '-mavx2').
+
+	9. SISWA_HASH64
+		- Replaces the hash function used for the name indices of the library
+		(e.g. when merging). Must have the same signature as 'siswa_hash64'.
+
+	10. SISWA_USE_THREADS
+		- Allows functions like 'siswa_arManifestEx' to split their work across
+		multiple threads (pthreads, or Win32 threads on Windows). On POSIX the
+		program must then be linked with '-lpthread'. Without it, every
+		function runs on the calling thread only.
+
+	11. SISWA_TRACE_ACCESS(arFile, entry)
+		- Gets called with every entry found by 'siswa_arEntryFind(Ex)', e.g.
+		to record which entries get loaded and when, so that the archive can
+		be reordered to match (see 'siswa_traceCluster', 'siswa_arReorder' and
+		'examples/reorderAr').
+		Not defined by default, in which case tracing costs nothing.
+
+	12. SISWA_USE_MMAP
+		- Enables 'siswa_arMap', which maps an archive file into memory instead
+		of reading all of it, and the functions for prefetching and releasing
+		the pages of its entries ('siswa_arPrefetch', 'siswa_arRelease'...).
+		Uses mmap/madvise on POSIX (glibc needs '_DEFAULT_SOURCE' or '_GNU_SOURCE'
+		with a strict '-std='), and file mappings on Windows.
+
+	13. SISWA_USE_DIRECT_IO
+		- Enables 'siDirectReader', a 'siReadProc' source that reads a file past
+		the page cache (O_DIRECT on Linux, F_NOCACHE on macOS), so that reading
+		a lot of archives once doesn't push everything else out of the cache.
+		With 'SISWA_USE_THREADS', the next block gets read while the current one
+		is being processed. POSIX only, glibc needs '_GNU_SOURCE' for O_DIRECT.
+
+	14. SISWA_USE_SHARED_CACHE
+		- Enables 'siSharedCache', which keeps decompressed archives in named
+		shared memory, so that only the first process on the machine to load an
+		archive decompresses it and the rest map the same pages. Implies
+		'SISWA_USE_MMAP'. POSIX only (shm_open, which older glibc versions have
+		in '-lrt'), and requires GCC/Clang for the atomics.
+
+	15. SISWA_USE_DAEMON
+		- Enables 'siswa_daemonServe', a daemon that keeps archives opened and
+		indexed for other processes over a Unix domain socket, and the client
+		functions for talking to it ('siswa_daemonConnect'...). Archives get
+		handed to the clients as file descriptors, which they map themselves.
+		Implies 'SISWA_USE_MMAP'. POSIX only.
+
+	16. SISWA_USE_RELOAD
+		- Enables 'siReloadable', an archive that gets reloaded in the background
+		whenever its file gets replaced, while readers keep going without ever
+		taking a lock (versions get freed once the last reader is done with
+		them). Uses inotify on Linux, elsewhere the file gets polled. Implies
+		'SISWA_USE_MMAP'. POSIX only, and requires GCC/Clang for the atomics.
+
+	17. SISWA_USE_VFS
+		- Enables 'siVfs', which layers loose directories, archives and split
+		archives (through their '.arl') on top of each other by priority, e.g. for
+		mods overriding the base game's files. Mounting builds one index of every
+		layer, and files from archives are opened without being copied. Implies
+		'SISWA_USE_MMAP'. POSIX only.
+
+	18. SISWA_USE_SCHEDULER
+		- Enables 'siScheduler', which queues archive and entry loads with
+		priorities and deadlines, and works through them one file block or SEGS
+		chunk at a time, so that the most important load always goes next.
+		'SISWA_SCHEDULER_BLOCK_SIZE' sets the size of the reads (256 KiB by
+		default). On POSIX, glibc needs '_DEFAULT_SOURCE' or '_GNU_SOURCE' with a
+		strict '-std=' for 'clock_gettime'.
+
+	19. SISWA_USE_BUDGETS
+		- Attributes every allocation of the library to a budget (archives,
+		decompression, indexes, caches, other) that can be queried at runtime,
+		and sets an optional global cap, over which the registered shrinkers
+		(e.g. the daemon's cache) get called to give memory back. Buffers the
+		library returns must be freed with 'siswa_free'/'siswa_arFree' to get
+		subtracted. Memory in shared memory segments isn't counted.
+
+	20. SISWA_LITTLE_ENDIAN / SISWA_BIG_ENDIAN
+		- The byte order of the target, which gets detected at compile time from
+		the compiler's macros. Only needs to be defined by hand if the compiler
+		doesn't provide them. On little-endian targets the archive fields get
+		read as is, big-endian ones swap them (and the SEGS tables the other way
+		around). Archives are always little-endian on disk, so the fields of an
+		'siArEntry' should be read with 'siswa_arEntryGetSize', '...GetDataSize'
+		and '...GetOffset' instead of directly, which only works on little-endian
+		targets.
+
+	21. SISWA_USE_SET_INDEX
+		- Adds 'siswa_setScan' and the 'siSetIndex' functions, which index the
+		objects of every '.set.xml' entry in the archives by their ID, type and
+		the IDs they refer to, without parsing the sets into a DOM. The scan
+		skips to the tags with SIMD and, with 'SISWA_USE_THREADS', runs on
+		multiple threads.
+
 3. Other
 ===========================================================================
 CREDITS:
@@ -150,6 +248,16 @@ extern "C" {
 	#define SISWA_STRLEN strlen
 #endif
 
+#ifndef SISWA_MEMCHR
+	#include <string.h>
+	#define SISWA_MEMCHR memchr
+#endif
+
+#ifndef SISWA_MEMMOVE
+	#include <string.h>
+	#define SISWA_MEMMOVE memmove
+#endif
+
 
 #define SISWA_ASSERT_NOT_NULL(ptr) SISWA_ASSERT_MSG((ptr) != NULL, #ptr " must not be NULL.")
 #define SISWA_ASSERT(condition) SISWA_ASSERT_MSG(condition, "Assertion '" #condition "` failed")
@@ -217,8 +325,22 @@ typedef uint32_t siBool;
 
 /* Used for storing string pointers. The higher the value, the less likely a hash
  * collision will happen. 8kb is a good middleground balance on the major OSses,
- * but probably not for actual embedded systems.*/
+ * but probably not for actual embedded systems. Bigger tables go on the heap.*/
+#ifndef SISWA_DEFAULT_STACK_SIZE
 #define SISWA_DEFAULT_STACK_SIZE (8 * 1024)
+#endif
+
+/* Size of the buffer that streamed input (patches, tar files) gets read into,
+ * which is kept on the stack. Pipes are read about twice as fast with 64 KiB
+ * as with 4 KiB, so raise it if the stack has the room. */
+#ifndef SISWA_READER_BUFFER_SIZE
+#define SISWA_READER_BUFFER_SIZE SISWA_DEFAULT_STACK_SIZE
+#endif
+
+#if (defined(SISWA_USE_SHARED_CACHE) || defined(SISWA_USE_DAEMON) || defined(SISWA_USE_RELOAD) \
+		|| defined(SISWA_USE_VFS)) && !defined(SISWA_USE_MMAP)
+	#define SISWA_USE_MMAP
+#endif
 
 #define SISWA_TRUE    1
 #define SISWA_FALSE   0
@@ -281,6 +403,8 @@ SISWA_STATIC_ASSERT(sizeof(siXCompEntry) == 4);
 
 
 
+/* The fields of 'siArHeader' and 'siArEntry' are little-endian like in the
+ * files, so big-endian hosts have to byte-swap them before using them. */
 typedef struct {
 	/* Always 0. */
 	uint32_t unknown;
@@ -294,6 +418,9 @@ typedef struct {
 SISWA_STATIC_ASSERT(sizeof(siArHeader) == 16);
 
 
+/* NOTE: The fields are stored little-endian as they are on disk, so they should
+ * be read with 'siswa_arEntryGetSize', 'siswa_arEntryGetDataSize' and
+ * 'siswa_arEntryGetOffset' to get the right values on big-endian hosts too. */
 typedef struct {
 	/* Entire size of the entry. Equivalent to '.dataSize + .offset + sizeof(siArEntry) = .size'. */
 	uint32_t size;
@@ -319,6 +446,10 @@ typedef struct {
 
 	/* Type of file. Denotes if the provided data is compressed or even valid. */
 	siFileType type;
+	/* Set by 'siswa_arValidate' when every entry of the archive is in bounds and
+	 * well-formed. Validated archives skip all of the per-entry bounds checks,
+	 * while unvalidated ones get checked on every access. */
+	siBool validated;
 	/* Current entry offset, modified by 'siswa_<ar/arl>EntryPoll'. Should not
 	 * be modified by the user under normal circumstances.*/
 	size_t __curOffset;
@@ -340,6 +471,75 @@ siArFile siswa_arMakeBuffer(const void* data, size_t len);
  * length and full capacity. */
 siArFile siswa_arMakeBufferEx(const void* data, size_t len, size_t capacity);
 
+#ifdef SISWA_USE_MMAP
+typedef enum {
+	/* The range is going to be read soon, so the OS should start reading it in. */
+	SISWA_ADVISE_WILLNEED = 1,
+	/* The range isn't going to be read for a while, so its pages can be dropped
+	 * (they get read back in from the file if they're touched again). */
+	SISWA_ADVISE_DONTNEED
+} siAdvice;
+
+/* Maps the file read-only into memory and returns a 'siArFile' of it. Pages only
+ * get read from the file once they're touched, so entries that never get used
+ * cost nothing. The archive can't be modified.
+ * NOTE: The returned structure must be unmapped with 'siswa_arUnmap'. */
+siArFile siswa_arMap(const char* path);
+/* Unmaps an archive mapped by 'siswa_arMap'. */
+void siswa_arUnmap(siArFile arFile);
+
+/* Gives the OS advice about the bytes [offset, offset + len) of a mapped archive.
+ * 'SISWA_ADVISE_WILLNEED' covers every page that the range touches, while
+ * 'SISWA_ADVISE_DONTNEED' only covers the pages that are completely inside of
+ * it, so that neighbouring data stays in memory. Returns 'SISWA_FALSE' if the
+ * OS doesn't support the advice. */
+siBool siswa_arAdvise(siArFile arFile, size_t offset, size_t len, siAdvice advice);
+/* Starts reading the entire entry (its header, name and data) in, so that it's
+ * already in memory once it gets used. */
+siBool siswa_arEntryPrefetch(siArFile arFile, const siArEntry* entry);
+/* Lets the OS drop the pages of the entry, e.g. after it was loaded. */
+siBool siswa_arEntryRelease(siArFile arFile, const siArEntry* entry);
+/* Prefetches every entry in 'names', with entries that sit next to each other
+ * getting merged into one request. Returns the amount of entries that were found.
+ * NOTE: Finding the entries touches the headers of every entry before them, so a
+ * loader should find its entries once and keep them around for
+ * 'siswa_arEntryPrefetch' if the archive is big. */
+size_t siswa_arPrefetch(siArFile arFile, const char* const* names, size_t count);
+/* Releases every entry in 'names', the same way as 'siswa_arPrefetch'. */
+size_t siswa_arRelease(siArFile arFile, const char* const* names, size_t count);
+#endif
+
+#if defined(SISWA_USE_SHARED_CACHE) && !defined(SISWA_NO_STDLIB) && !defined(_WIN32)
+/* Maximum amount of archives in a shared cache. */
+#define SISWA_SHARED_CACHE_SLOTS 1024
+
+typedef struct {
+	/* Directory of the cache, which is shared between every process using it. */
+	void* __directory;
+	char __name[64];
+} siSharedCache;
+
+/* Opens the shared cache called 'name' (letters, digits, '-' and '_' only),
+ * creating it if no process has yet. Returns 'SISWA_FALSE' on failure. */
+siBool siswa_sharedCacheOpen(siSharedCache* cache, const char* name);
+/* Closes the cache. Archives gotten from it stay mapped. */
+void siswa_sharedCacheClose(siSharedCache* cache);
+/* Gets the decompressed contents of the archive file from the cache, read-only.
+ * Archives are keyed by their path. When the file's modification date or size
+ * changed, it gets cached again in place of the old one, which processes that
+ * still have it mapped keep. If no other process cached the archive yet, it
+ * gets read (and decompressed) into the cache, while the other processes asking
+ * for it wait for it to be done. A failed build gets retried by the next call.
+ * 'built' gets set if it was this call that did it, unless it's NULL. Returns
+ * an archive of 'SISWA_FILE_INVALID' type if it couldn't be cached (e.g. the
+ * file doesn't exist, isn't a regular or SEGS archive, or the cache is full).
+ * NOTE: The returned structure must be unmapped with 'siswa_arUnmap'. */
+siArFile siswa_sharedCacheGet(siSharedCache* cache, const char* path, siBool* built);
+/* Deletes the cache and every archive in it. Processes that still have them
+ * mapped keep them until they unmap them. */
+void siswa_sharedCacheUnlink(const char* name);
+#endif
+
 /* Allocates 'sizeof(siArHeader) + capacity' amount of memory into the heap and
  * writes an autocompleted archive header into it.
  * NOTE: The returned structure's '.data' member must be freed after use. */
@@ -347,6 +547,13 @@ siArFile siswa_arCreateContent(size_t capacity);
 /* Writes an autocompleted archive header into the specified buffer. */
 siArFile siswa_arCreateContentEx(void* buffer, size_t capacity);
 
+/* Checks the header and the entire entry chain of the archive (entry sizes,
+ * data offsets and sizes, name termination and that everything is inside of
+ * '.len'). On success 'arFile->validated' is set, after which polling, finding
+ * and getting the data of entries skips the bounds checks. Returns 'SISWA_FAILURE'
+ * if the archive is malformed or truncated. */
+siBool siswa_arValidate(siArFile* arFile);
+
 /* Gets the header of the archive file. */
 siArHeader* siswa_arGetHeader(siArFile arFile);
 /* Gets the total entry count of the archive file. */
@@ -354,7 +561,8 @@ size_t siswa_arGetEntryCount(siArFile arFile);
 
 /* Polls for the next entry in the archive, as the pointer to the data gets written
  * to 'outEntry' Returns 'SISWA_TRUE' if an entry was polled, 'SISWA_FALSE' if
- * there are no more  entries in the ar file. */
+ * there are no more  entries in the ar file. If the archive isn't validated,
+ * polling also stops at the first entry that is malformed or out of bounds. */
 siBool siswa_arEntryPoll(siArFile* arFile, siArEntry** outEntry);
 /* Resets the entry offset back to the start. */
 void siswa_arOffsetReset(siArFile* arFile);
@@ -368,6 +576,27 @@ siArEntry* siswa_arEntryFindEx(siArFile arFile, const char* name, size_t nameLen
 char* siswa_arEntryGetName(const siArEntry* entry);
 /* Gets the data of the provided entry. */
 void* siswa_arEntryGetData(const siArEntry* entry);
+/* Gets the data of the provided entry, while making sure that the entry and its
+ * data are inside of the archive. Returns NULL if they aren't. The checks get
+ * skipped for validated archives. */
+void* siswa_arEntryGetDataEx(siArFile arFile, const siArEntry* entry);
+/* Gets the entire size of the provided entry in the host's byte order. */
+uint32_t siswa_arEntryGetSize(const siArEntry* entry);
+/* Gets the size of the provided entry's data in the host's byte order. */
+uint32_t siswa_arEntryGetDataSize(const siArEntry* entry);
+/* Gets the offset from the provided entry to its data in the host's byte order. */
+uint32_t siswa_arEntryGetOffset(const siArEntry* entry);
+/* Gets the file date of the provided entry, see 'siswa_filedateFromUnix'. */
+uint64_t siswa_arEntryGetFiledate(const siArEntry* entry);
+/* Sets the file date of the provided entry. */
+void siswa_arEntrySetFiledate(siArEntry* entry, uint64_t filedate);
+
+/* Converts a Unix timestamp into a file date, which counts 100 nanosecond
+ * intervals since 1601-01-01 (same as a Windows FILETIME). */
+uint64_t siswa_filedateFromUnix(uint64_t seconds, uint32_t nanoseconds);
+/* Converts a file date back into a Unix timestamp in seconds. Dates before 1970
+ * become 0. */
+uint64_t siswa_filedateToUnix(uint64_t filedate);
 
 /* Adds a new entry in the archive. Fails if the entry name already exists or
  * the capacity is too low. */
@@ -377,6 +606,16 @@ siBool siswa_arEntryAdd(siArFile* arFile, const char* name, const void* data,
  * the capacity is too low. */
 siBool siswa_arEntryAddEx(siArFile* arFile, const char* name, size_t nameLen,
 		const void* data, uint32_t dataSize);
+/* Same as 'siswa_arEntryAddEx', except the entry's file date gets set to 'filedate'
+ * (e.g. the modification date of the source file) instead of 0. */
+siBool siswa_arEntryAddDated(siArFile* arFile, const char* name, size_t nameLen,
+		const void* data, uint32_t dataSize, uint64_t filedate);
+/* Same as 'siswa_arEntryAddDated', except the entry's offset gets padded so that
+ * its data starts at a multiple of 'alignment' from the start of the archive
+ * (e.g. 16 for SIMD loads, 4096 for mapping it straight from a file). 0 or 1
+ * means no padding. Every entry can take up to 'alignment - 1' more bytes. */
+siBool siswa_arEntryAddAligned(siArFile* arFile, const char* name, size_t nameLen,
+		const void* data, uint32_t dataSize, uint64_t filedate, uint32_t alignment);
 /* Removes an entry in the archive. Fails if the entry doesn't exist. */
 siBool siswa_arEntryRemove(siArFile* arFile, const char* name);
 /* Removes an entry in the archive. Fails if the entry doesn't exist. */
@@ -397,29 +636,45 @@ siArFile siswa_arMerge(const siArFile ars[2], void* outBuffer, size_t capacity);
  * Fails if the capacity is too low to fit all of the archive files in 'outBuffer'. */
 siArFile siswa_arMergeMul(const siArFile* arrayOfArs, size_t arrayLen, void* outBuffer,
 		size_t capacity);
+/* Same as 'siswa_arMergeMul', except the entries get laid out again so that
+ * their data starts at a multiple of 'alignment' from the start of the archive,
+ * which also gets set as the header's alignment. 0 keeps the entries as they
+ * are, 1 packs them without any padding. Every entry can take up to
+ * 'alignment - 1' more bytes. */
+siArFile siswa_arMergeMulEx(const siArFile* arrayOfArs, size_t arrayLen, void* outBuffer,
+		size_t capacity, uint32_t alignment);
 
 #ifndef SISWA_NO_DECOMPRESSION
 /* Decompresses the given archive file depending on the contents of the data and
  * writes the decompressed data into 'out'. This also sets 'arl.data' to 'out'.
- * Setting 'freeCompData' to true will do 'free(arl.data)', freeing the compressed
+ * Setting 'freeCompData' to true will do 'siswa_free(arl.data)', freeing the compressed
  * data from memory. */
 void siswa_arDecompress(siArFile* ar, siByte* out, size_t capacity, siBool freeCompData);
 /* Decompresses the given archive linker file using SEGS decompression and writes
  * the decompressed data into 'out'. This also sets 'arl.data' to 'out'. Setting
- * 'freeCompData' to true will do 'free(arl.data)', freeing the compressed
+ * 'freeCompData' to true will do 'siswa_free(arl.data)', freeing the compressed
  * data from memory. */
 void siswa_arDecompressSegs(siArFile* ar, siByte* out, size_t capacity, siBool freeCompData);
 /*  Decompresses the given archive file using XCompression (LZX) decompression
  * and writes the decompressed data into 'out'. This also sets 'arl.data' to 'out'.
- * Setting 'freeCompData' to true will do 'free(arl.data)', freeing the compressed
+ * Setting 'freeCompData' to true will do 'siswa_free(arl.data)', freeing the compressed
  * data from memory. */
 void siswa_arDecompressXComp(siArFile* ar, siByte* out, size_t capacity, siBool freeCompData);
 /* Gets the exact, raw decompressed size of the data if it's X or SEGS compressed. */
 uint64_t siswa_arGetDecompressedSize(siArFile ar);
 #endif
 
-/* Frees arFile.buffer. Same as doing free(arFile.data) */
+/* Frees arFile.buffer. Same as doing siswa_free(arFile.data) */
 void siswa_arFree(siArFile arFile);
+/* Frees memory that the library allocated (e.g. 'ar.data' from 'siswa_arMake'
+ * or the output of 'siswa_vfsOpen'). Same as 'free', except that with
+ * 'SISWA_USE_BUDGETS' the memory also stops being counted. */
+void siswa_free(void* ptr);
+
+/* Hashes 'len' bytes of 'data', 8 bytes at a time (a wyhash variant). Used for
+ * the name indices of the library unless 'SISWA_HASH64' is defined. Names don't
+ * have to be NULL-terminated, so AR and ARL names hash the same way. */
+uint64_t siswa_hash64(const void* data, size_t len, uint64_t seed);
 
 typedef struct {
 	/* 'ARL2' at the start of the file. */
@@ -510,28 +765,961 @@ siBool siswa_arlEntryUpdateEx(siArlFile* arlFile, const char* name, uint8_t name
 #ifndef SISWA_NO_DECOMPRESSION
 /* Decompresses the given archive linker file depending on the contents of the data
  * and writes the decompressed data into 'out'. This also sets 'arl.data' to 'out'.
- * Setting 'freeCompData' to true will do 'free(arl.data)', freeing the compressed
+ * Setting 'freeCompData' to true will do 'siswa_free(arl.data)', freeing the compressed
  * data from memory. */
 void siswa_arlDecompress(siArlFile* arl, siByte* out, size_t capacity, siBool freeCompData);
 /* Decompresses the given archive linker file using SEGS (Deflate) decompression
  * and writes the decompressed data into 'out'. This also sets 'arl.data' to 'out'.
- * Setting 'freeCompData' to true will do 'free(arl.data)', freeing the compressed
+ * Setting 'freeCompData' to true will do 'siswa_free(arl.data)', freeing the compressed
  * data from memory. */
 void siswa_arlDecompressSegs(siArlFile* arl, siByte* out, size_t capacity, siBool freeCompessedData);
 /*  Decompresses the given archive linker file using XCompression (LZX) decompression
  * and writes the decompressed data into 'out'. This also sets 'arl.data' to 'out'.
- * Setting 'freeCompData' to true will do 'free(arl.data)', freeing the compressed
+ * Setting 'freeCompData' to true will do 'siswa_free(arl.data)', freeing the compressed
  * data from memory. */
 void siswa_arlDecompressXComp(siArlFile* arl, siByte* out, size_t capacity, siBool freeCompData);
 /* Gets the exact, raw decompressed size of the data if it's X or SEGS compressed. */
 uint64_t siswa_arlGetDecompressedSize(siArFile ar);
 #endif
 
-/* Frees arlFile.buffer. Same as doing free(arlFile.data) */
+/* Frees arlFile.buffer. Same as doing siswa_free(arlFile.data) */
 void siswa_arlFree(siArlFile arlFile);
 
 
 
+/* Size of a SHA-256 digest in bytes. */
+#define SISWA_SHA256_SIZE 32
+
+typedef struct {
+	/* Internal state of the hash, must not be modified by the user. */
+	uint64_t __acc[4];
+	uint64_t __seed;
+	uint64_t __total;
+	siByte __buf[32];
+	uint32_t __bufLen;
+} siXxh64State;
+
+typedef struct {
+	/* Internal state of the hash, must not be modified by the user. */
+	uint32_t __h[8];
+	uint64_t __total;
+	siByte __buf[64];
+	uint32_t __bufLen;
+} siSha256State;
+
+typedef struct {
+	/* XXH64 hash (seed 0) of the entry's data. */
+	uint64_t hash;
+	/* Size of the entry's data. */
+	uint32_t dataSize;
+	/* Offset of the entry from the start of the (decompressed) archive. */
+	uint32_t offset;
+} siManifestEntry;
+SISWA_STATIC_ASSERT(sizeof(siManifestEntry) == 16);
+
+
+/* Hashes the buffer with XXH64. */
+uint64_t siswa_xxh64(const void* data, size_t len, uint64_t seed);
+/* Starts a streaming XXH64 hash, which gives the same result as 'siswa_xxh64'
+ * on the concatenation of every updated piece. */
+void siswa_xxh64Init(siXxh64State* state, uint64_t seed);
+/* Hashes the next piece of the data. */
+void siswa_xxh64Update(siXxh64State* state, const void* data, size_t len);
+/* Returns the hash of everything updated so far. The state stays intact. */
+uint64_t siswa_xxh64Digest(const siXxh64State* state);
+
+/* Starts a streaming SHA-256 hash. */
+void siswa_sha256Init(siSha256State* state);
+/* Hashes the next piece of the data. */
+void siswa_sha256Update(siSha256State* state, const void* data, size_t len);
+/* Writes the final digest into 'out'. The state must be initialized again
+ * before being reused. */
+void siswa_sha256Final(siSha256State* state, siByte out[SISWA_SHA256_SIZE]);
+
+/* Hashes the data of every entry in the archive with XXH64, writing the manifest
+ * entries into 'out' in the same order as the entries. Returns the entry count
+ * of the archive, of which only the first 'capacity' entries get written. */
+size_t siswa_arManifest(siArFile arFile, siManifestEntry* out, size_t capacity);
+/* Same as 'siswa_arManifest', except that 'SISWA_SHA256_SIZE' bytes of SHA-256
+ * digest per entry also get written to 'sha256Out', unless it's NULL. The work
+ * gets split between 'threadCount' threads (including the calling one) when
+ * 'SISWA_USE_THREADS' is defined and the archive is big enough for it to pay off. */
+size_t siswa_arManifestEx(siArFile arFile, siManifestEntry* out, size_t capacity,
+		siByte* sha256Out, size_t threadCount);
+#if !defined(SISWA_NO_DECOMPRESSION) && !defined(SISWA_DEFINE_CUSTOM_DEFLATE_DECOMPRESSION) \
+	&& !defined(SISWA_NO_STDLIB)
+/* Creates the manifest of a SEGS compressed archive without decompressing it
+ * into memory first, hashing the entries while their chunks get decompressed.
+ * The results match 'siswa_arManifestEx' on the decompressed archive. Returns
+ * the entry count, or only the amount of complete entries if the archive turns
+ * out to be truncated or corrupted. */
+size_t siswa_arManifestSegs(siArFile segs, siManifestEntry* out, size_t capacity,
+		siByte* sha256Out);
+#endif
+
+
+typedef enum {
+	/* The entry only exists in the new archive. */
+	SISWA_DIFF_ADDED = 1,
+	/* The entry only exists in the old archive. */
+	SISWA_DIFF_REMOVED,
+	/* The entry exists in both, but its data is different. */
+	SISWA_DIFF_CHANGED
+} siDiffType;
+
+typedef struct {
+	siDiffType type;
+	/* The entry in the old archive, NULL if the entry was added. */
+	siArEntry* a;
+	/* The entry in the new archive, NULL if the entry was removed. */
+	siArEntry* b;
+} siDiffEntry;
+
+/* Compares the old archive 'a' to the new archive 'b' and writes every added,
+ * changed and removed entry into 'out'. Entries are matched by their names, and
+ * their data gets compared by its size first and its hash second (file dates
+ * are ignored). Added and changed entries come first in the order of 'b',
+ * followed by the removed ones in the order of 'a'. Returns the amount of
+ * changes, of which only the first 'capacity' get written. */
+size_t siswa_arDiff(siArFile a, siArFile b, siDiffEntry* out, size_t capacity);
+/* Same as 'siswa_arDiff', except that the manifests of the archives can be given
+ * to skip the hashing. A manifest must be the full output of 'siswa_arManifest'
+ * for that archive, so they can be kept around and reused for the next diffs.
+ * Without a manifest, only entries whose names and sizes match get hashed, on
+ * 'threadCount' threads (see 'siswa_arManifestEx'), which requires the C
+ * standard library. */
+size_t siswa_arDiffEx(siArFile a, const siManifestEntry* manifestA, siArFile b,
+		const siManifestEntry* manifestB, siDiffEntry* out, size_t capacity,
+		size_t threadCount);
+
+
+
+/* Callbacks for streaming data in and out of the library. Both return the amount
+ * of bytes that were actually written/read, where anything less than 'len'
+ * means failure or, when reading, the end of the stream. */
+typedef size_t (*siWriteProc)(void* user, const void* data, size_t len);
+typedef size_t (*siReadProc)(void* user, void* out, size_t len);
+
+typedef struct {
+	/* Buffer of the stream. */
+	siByte* data;
+	/* Amount of bytes written into the buffer. */
+	size_t len;
+	/* Total capacity of the buffer. Writes past it fail. */
+	size_t cap;
+	/* Current read position. */
+	size_t pos;
+} siMemoryStream;
+
+/* 'siWriteProc' that appends the data to the 'siMemoryStream' in 'user'. */
+size_t siswa_memoryWrite(void* user, const void* data, size_t len);
+/* 'siReadProc' that reads the data from the 'siMemoryStream' in 'user'. */
+size_t siswa_memoryRead(void* user, void* out, size_t len);
+#ifndef SISWA_NO_STDLIB
+/* 'siWriteProc' that writes to the 'FILE*' in 'user'. */
+size_t siswa_fileWrite(void* user, const void* data, size_t len);
+/* 'siReadProc' that reads from the 'FILE*' in 'user'. */
+size_t siswa_fileRead(void* user, void* out, size_t len);
+#endif
+
+#if defined(SISWA_USE_DIRECT_IO) && !defined(SISWA_NO_STDLIB) && !defined(_WIN32)
+typedef struct {
+	/* Size of the file. */
+	uint64_t size;
+	/* Whether the page cache is actually bypassed. When the file system doesn't
+	 * support it, the file gets read normally and every block gets dropped from
+	 * the cache after it was read instead. */
+	siBool direct;
+	/* Set if reading the file failed, as opposed to reaching its end. */
+	siBool failed;
+	/* Internal state, must not be modified by the user. */
+	void* __state;
+} siDirectReader;
+
+/* Opens the file for reading in blocks of 'blockSize' bytes (rounded up to 4
+ * KiB, 0 means 1 MiB), two of which get allocated. Returns 'SISWA_FALSE' if the
+ * file couldn't be opened. */
+siBool siswa_directReaderOpen(siDirectReader* reader, const char* path, size_t blockSize);
+/* 'siReadProc' that reads from the 'siDirectReader' in 'user'. */
+size_t siswa_directRead(void* user, void* out, size_t len);
+/* Closes the file and frees the blocks. */
+void siswa_directReaderClose(siDirectReader* reader);
+/* Same as 'siswa_arMake', except the file gets read with a 'siDirectReader'.
+ * Returns an archive of 'SISWA_FILE_INVALID' type if it couldn't be read.
+ * NOTE: The returned structure's '.data' member must be freed after use. */
+siArFile siswa_arMakeDirect(const char* path);
+#endif
+
+#if defined(SISWA_USE_DAEMON) && !defined(SISWA_NO_STDLIB) && !defined(_WIN32)
+#define SISWA_DAEMON_MAGIC 0x44415753 /* "SWAD" */
+
+typedef enum {
+	/* Opens the archive at the path following the request (decompressing it if
+	 * needed). Answered with its id and length, along with a file descriptor of
+	 * the decompressed archive, so that the client can map it itself. */
+	SISWA_DAEMON_OPEN = 1,
+	/* Finds the entry named after the request in the archive of '.id'. Answered
+	 * with the offset of the entry from the start of the archive. */
+	SISWA_DAEMON_FIND,
+	/* Lists the entries of the archive of '.id'. Answered with the length of
+	 * the names, which then follow the response, each one NULL-terminated. */
+	SISWA_DAEMON_LIST
+} siDaemonOp;
+
+typedef struct {
+	/* Always 'SISWA_DAEMON_MAGIC'. */
+	uint32_t magic;
+	/* 'siDaemonOp'. */
+	uint32_t op;
+	/* Id of the archive, not used by 'SISWA_DAEMON_OPEN'. */
+	uint32_t id;
+	/* Length of the path or name that follows the request. */
+	uint32_t len;
+} siDaemonRequest;
+SISWA_STATIC_ASSERT(sizeof(siDaemonRequest) == 16);
+
+typedef struct {
+	/* 'SISWA_TRUE' if the request succeeded. */
+	uint32_t ok;
+	/* Id of the archive. */
+	uint32_t id;
+	/* Depends on the request (see 'siDaemonOp'). */
+	uint64_t value;
+} siDaemonResponse;
+SISWA_STATIC_ASSERT(sizeof(siDaemonResponse) == 16);
+
+/* Runs a daemon on the Unix domain socket at 'socketPath', which keeps every
+ * archive it gets asked about opened and indexed by name, so that short-lived
+ * clients don't have to read, decompress or index anything themselves. Runs
+ * until '*stop' becomes non-zero (e.g. from a signal handler), checked at least
+ * every 100 ms. Returns 'SISWA_FALSE' if the socket couldn't be set up.
+ * NOTE: The socket gets created with mode 0600, as the daemon opens whatever
+ * path its clients ask for with its own permissions. */
+siBool siswa_daemonServe(const char* socketPath, const volatile int* stop);
+
+typedef struct {
+	int __fd;
+} siDaemonClient;
+
+/* Connects to a daemon. Returns 'SISWA_FALSE' if there's none on the socket. */
+siBool siswa_daemonConnect(siDaemonClient* client, const char* socketPath);
+/* Disconnects from the daemon. Archives opened through it stay mapped. */
+void siswa_daemonDisconnect(siDaemonClient* client);
+/* Opens the archive through the daemon and maps it read-only, writing the id
+ * used for its requests into 'id'. Returns an archive of 'SISWA_FILE_INVALID'
+ * type on failure.
+ * NOTE: The returned structure must be unmapped with 'siswa_arUnmap'. */
+siArFile siswa_daemonOpen(siDaemonClient* client, const char* path, uint32_t* id);
+/* Finds the entry through the daemon's index, returning a pointer to it inside
+ * of 'arFile' (the archive of 'id'), or NULL if it doesn't exist. */
+siArEntry* siswa_daemonFind(siDaemonClient* client, siArFile arFile, uint32_t id,
+		const char* name);
+/* Writes the names of every entry of the archive into 'proc', each one
+ * NULL-terminated. Returns the amount of bytes written. */
+size_t siswa_daemonList(siDaemonClient* client, uint32_t id, siWriteProc proc, void* user);
+#endif
+
+#if defined(SISWA_USE_RELOAD) && !defined(SISWA_NO_STDLIB) && !defined(_WIN32)
+typedef struct siArVersion {
+	/* The archive, read-only. */
+	siArFile ar;
+	/* Starts at 0 and goes up by one with every reload. */
+	uint64_t generation;
+	/* Internal state, must not be modified by the user. */
+	void* __index;
+	siBool __mapped;
+	uint64_t __retired;
+	struct siArVersion* __next;
+} siArVersion;
+
+typedef struct {
+	/* Internal state, must not be modified by the user. */
+	siArVersion* volatile __current;
+	volatile uint64_t __epoch;
+	void* __readers;
+	size_t __readerCount;
+	siArVersion* __retired;
+	char* __path;
+	int __watch;
+	uint64_t __mtime;
+	uint64_t __size;
+} siReloadable;
+
+/* Opens the archive for 'readerCount' reader threads, each of which gets its
+ * own index. The archive gets reloaded whenever the file gets replaced (see
+ * 'siswa_reloadableUpdate'), without the readers ever waiting on a lock. Returns
+ * 'SISWA_FALSE' if the archive couldn't be loaded.
+ * NOTE: New versions should be deployed by renaming them over the file, as
+ * writing into the file in place changes the pages under the readers' feet. */
+siBool siswa_reloadableOpen(siReloadable* r, const char* path, size_t readerCount);
+/* Frees every version. No reader may be using any of them anymore. */
+void siswa_reloadableClose(siReloadable* r);
+
+/* Gets the current version for the reader 'reader', which stays valid until the
+ * reader calls 'siswa_reloadableRelease', even if a newer version gets published
+ * in the meantime. Never blocks. */
+const siArVersion* siswa_reloadableAcquire(siReloadable* r, size_t reader);
+/* Lets go of the version gotten from 'siswa_reloadableAcquire'. */
+void siswa_reloadableRelease(siReloadable* r, size_t reader);
+/* Finds an entry in the version through its name index. */
+siArEntry* siswa_arVersionFind(const siArVersion* version, const char* name);
+
+/* Waits up to 'timeoutMs' for the file to change (with inotify on Linux, by
+ * checking its date and size elsewhere), in which case the new version gets
+ * loaded, indexed and published. Versions that no reader uses anymore get freed.
+ * Meant to be called in a loop on a background thread, as this is the only
+ * function that does any actual work. Returns 'SISWA_TRUE' if a new version got
+ * published. A file that isn't a valid archive gets ignored. */
+siBool siswa_reloadableUpdate(siReloadable* r, int timeoutMs);
+#endif
+
+#if defined(SISWA_USE_VFS) && !defined(SISWA_NO_STDLIB) && !defined(_WIN32)
+typedef enum {
+	/* A directory of loose files, named by their path inside of it ('a/b.xml'). */
+	SISWA_VFS_DIRECTORY = 1,
+	/* A single archive, compressed or not. */
+	SISWA_VFS_ARCHIVE,
+	/* The '.ar.NN' splits of an archive linker. */
+	SISWA_VFS_SPLIT
+} siVfsLayerType;
+
+typedef struct {
+	/* Path the layer got added from. */
+	char* path;
+	siVfsLayerType type;
+	/* Layers with a higher priority override the files of lower ones. Layers
+	 * with the same priority get overridden by the ones added after them. */
+	int32_t priority;
+	/* The archives of the layer, none for directories. */
+	siArFile* ars;
+	size_t arCount;
+	/* The number of files the layer has. */
+	size_t fileCount;
+
+	/* Internal state, must not be modified by the user. */
+	siBool* __mapped;
+	char* __names;
+	uint64_t* __sizes;
+} siVfsLayer;
+
+typedef struct {
+	/* The layer and its archive that the file comes from. */
+	uint32_t layer;
+	uint32_t archive;
+	/* Size of the file. */
+	size_t size;
+	/* Data of the file, NULL for loose files as they only get read on open. */
+	const void* data;
+} siVfsNode;
+
+typedef struct {
+	siVfsLayer* layers;
+	size_t layerCount;
+	/* Number of unique files across every layer, set when mounting. */
+	size_t fileCount;
+
+	/* Internal state, must not be modified by the user. */
+	size_t __layerCapacity;
+	void* __index;
+	siVfsNode* __nodes;
+} siVfs;
+
+typedef struct {
+	/* The contents of the file, read-only. */
+	const void* data;
+	size_t size;
+	/* Layer the file comes from. */
+	const siVfsLayer* layer;
+
+	/* Internal state, must not be modified by the user. */
+	siBool __owned;
+} siVfsFile;
+
+/* Initializes an empty VFS. */
+void siswa_vfsInit(siVfs* vfs);
+/* Unmaps and frees every layer and the index. Files that are still opened from
+ * archive layers become invalid. */
+void siswa_vfsFree(siVfs* vfs);
+
+/* Adds every regular file under the directory as a layer, recursively. Returns
+ * 'SISWA_FALSE' if the directory couldn't be opened. */
+siBool siswa_vfsAddDirectory(siVfs* vfs, const char* path, int32_t priority);
+/* Adds the archive as a layer. The archive gets mapped, unless it's compressed,
+ * in which case it gets decompressed into memory. Returns 'SISWA_FALSE' if the
+ * file isn't a valid archive. */
+siBool siswa_vfsAddArchive(siVfs* vfs, const char* path, int32_t priority);
+/* Adds every '.ar.NN' split of the archive linker as one layer, which get
+ * looked up next to it ('Stage.arl' gives 'Stage.ar.00', 'Stage.ar.01'...).
+ * Returns 'SISWA_FALSE' if the linker or any of its splits isn't valid. */
+siBool siswa_vfsAddSplit(siVfs* vfs, const char* arlPath, int32_t priority);
+
+/* Builds the merged index of every layer, where each name resolves to the file
+ * of its highest priority layer. Has to be called again after adding layers.
+ * Lookups take the same time no matter the number of layers. */
+void siswa_vfsMount(siVfs* vfs);
+
+/* Finds the file through the index. Returns NULL if it doesn't exist. */
+const siVfsNode* siswa_vfsFind(const siVfs* vfs, const char* name);
+/* Opens the file. Files from archives don't get copied, 'file->data' points
+ * into the archive itself. Loose files get read into memory. Returns
+ * 'SISWA_FALSE' if the file doesn't exist or couldn't be read.
+ * NOTE: The file must be closed with 'siswa_vfsClose'. */
+siBool siswa_vfsOpen(const siVfs* vfs, const char* name, siVfsFile* file);
+/* Closes the file. */
+void siswa_vfsClose(siVfsFile* file);
+/* Copies the file into 'out', reading loose files straight into it. Returns
+ * the size of the file, or 0 if it doesn't exist, is bigger than 'capacity'
+ * or couldn't be read. */
+size_t siswa_vfsRead(const siVfs* vfs, const char* name, void* out, size_t capacity);
+#endif
+
+#if defined(SISWA_USE_SCHEDULER) && !defined(SISWA_NO_STDLIB)
+/* The most the scheduler reads from a file in one step. */
+#ifndef SISWA_SCHEDULER_BLOCK_SIZE
+#define SISWA_SCHEDULER_BLOCK_SIZE 0x40000
+#endif
+
+typedef enum {
+	/* Reads (and decompresses) the entire archive into 'request->ar'. */
+	SISWA_LOAD_ARCHIVE = 1,
+	/* Reads only as much of the archive as it takes to get the entry, which gets
+	 * copied into 'request->data'. Parts of uncompressed archives that come
+	 * before the entry get skipped, and SEGS archives only get decompressed up
+	 * to the entry. */
+	SISWA_LOAD_ENTRY
+} siLoadType;
+
+typedef enum {
+	SISWA_LOAD_PENDING = 1,
+	SISWA_LOAD_DONE,
+	/* The file couldn't be read, isn't a valid archive or doesn't have the entry. */
+	SISWA_LOAD_FAILED,
+	SISWA_LOAD_CANCELLED
+} siLoadState;
+
+typedef struct {
+	siLoadType type;
+	siLoadState state;
+	/* Requests with a higher priority go first, then the ones with the earliest
+	 * deadline, then the ones submitted first. */
+	int32_t priority;
+	/* When the request should be done by, in 'siswa_schedulerNow' time. 0 if
+	 * it has none. */
+	uint64_t deadline;
+	void* user;
+
+	/* The archive of a 'SISWA_LOAD_ARCHIVE' request, whose '.data' member must be
+	 * freed by the user. */
+	siArFile ar;
+	/* The data of a 'SISWA_LOAD_ENTRY' request, which must be freed by the user. */
+	void* data;
+	size_t size;
+
+	/* When the request got submitted, first got worked on and finished (or got
+	 * cancelled). 'started - queued' is the time it spent waiting in the queue,
+	 * 'finished - started' the time it took to service. */
+	uint64_t queued;
+	uint64_t started;
+	uint64_t finished;
+	/* Bytes read from the file and SEGS chunks decompressed for the request. */
+	uint64_t bytesRead;
+	uint32_t chunksInflated;
+
+	/* Internal state, must not be modified by the user. */
+	void* __job;
+} siLoadRequest;
+
+typedef struct {
+	/* Number of requests that aren't finished yet. */
+	size_t pending;
+
+	/* Internal state, must not be modified by the user. */
+	siLoadRequest** __queue;
+	size_t __capacity;
+	uint64_t __submitted;
+} siScheduler;
+
+/* Returns the current time of the scheduler's clock in nanoseconds. */
+uint64_t siswa_schedulerNow(void);
+
+/* Initializes an empty scheduler. */
+void siswa_schedulerInit(siScheduler* s);
+/* Cancels every pending request and frees the queue. The requests themselves
+ * still have to be released. */
+void siswa_schedulerFree(siScheduler* s);
+
+/* Queues a load of the archive at 'path', or of its entry 'name' for
+ * 'SISWA_LOAD_ENTRY'. No work gets done until the scheduler is stepped. The
+ * request stays valid until 'siswa_schedulerRelease'. */
+siLoadRequest* siswa_schedulerSubmit(siScheduler* s, siLoadType type, const char* path,
+		const char* name, int32_t priority, uint64_t deadline, void* user);
+/* Changes the priority and deadline of a pending request, e.g. when the player
+ * turns towards what it loads. Work already done on it is kept. */
+void siswa_schedulerUpdate(siScheduler* s, siLoadRequest* request, int32_t priority,
+		uint64_t deadline);
+/* Cancels a pending request, freeing everything it has loaded so far. */
+void siswa_schedulerCancel(siScheduler* s, siLoadRequest* request);
+/* Frees the request, cancelling it first if it's still pending. The results
+ * ('ar', 'data') are left for the user to free. */
+void siswa_schedulerRelease(siScheduler* s, siLoadRequest* request);
+
+/* Does one unit of work for the request that goes first: reads one block of
+ * its file or decompresses one of its SEGS chunks. Requests only get switched
+ * between units, so a more important request never waits for more than one
+ * unit. Returns the request if it finished with this step, NULL otherwise. */
+siLoadRequest* siswa_schedulerStep(siScheduler* s);
+/* Steps the scheduler until there's nothing left to do or 'budget' nanoseconds
+ * have passed (e.g. the time left in a frame). 0 means no limit. Returns the
+ * number of requests that finished. */
+size_t siswa_schedulerRun(siScheduler* s, uint64_t budget);
+#endif
+
+#if defined(SISWA_USE_BUDGETS) && !defined(SISWA_NO_STDLIB)
+/* The most shrink callbacks that can be registered at once. */
+#define SISWA_BUDGET_MAX_SHRINKERS 16
+
+typedef enum {
+	/* Archives read into memory ('siswa_arMake', 'siswa_arlMake', 'siswa_arCreateContent',
+	 * loads of the scheduler...). */
+	SISWA_BUDGET_ARCHIVES = 0,
+	/* Decompressed archives that the library made itself (reloadable archives,
+	 * VFS layers, scheduler loads...). */
+	SISWA_BUDGET_DECOMPRESSION,
+	/* Name indices (VFS, reloadable archives, the daemon, merging...). */
+	SISWA_BUDGET_INDEXES,
+	/* Memory kept around only to make later calls faster (the daemon's
+	 * decompressed archives). */
+	SISWA_BUDGET_CACHES,
+	/* Everything else: bookkeeping of objects, temporary buffers... */
+	SISWA_BUDGET_OTHER,
+	SISWA_BUDGET_COUNT
+} siBudget;
+
+typedef struct {
+	/* Name of the budget, e.g. "archives". */
+	const char* name;
+	/* Bytes currently allocated and the most there ever were. */
+	size_t current;
+	size_t peak;
+	/* Number of allocations ever made. */
+	uint64_t allocations;
+} siBudgetStats;
+
+/* Gets called when the library goes over the cap, to free at least 'bytes' if
+ * it can. Returns the number of bytes it freed.
+ * NOTE: Shrinkers run on whichever thread made the allocation that went over
+ * the cap, so they must be thread-safe. Only one round runs at a time. */
+typedef size_t (*siShrinkProc)(void* user, size_t bytes);
+
+/* Allocates memory that counts towards the budget, e.g. for the output of
+ * 'siswa_arDecompress' or an application's own cache. Freed with 'siswa_free'. */
+void* siswa_budgetMalloc(siBudget budget, size_t size);
+/* Gets the statistics of the budget. */
+void siswa_budgetStats(siBudget budget, siBudgetStats* out);
+/* Returns the number of bytes currently allocated by the library in total. */
+size_t siswa_budgetTotal(void);
+/* Returns how many times an allocation went over the cap even after every
+ * shrinker was called. Such allocations still succeed. */
+uint64_t siswa_budgetOverruns(void);
+
+/* Sets the global cap for the library's memory. Whenever an allocation would
+ * go over it, the registered shrinkers get called first. 0 means no cap. */
+void siswa_budgetSetCap(size_t cap);
+/* Registers a shrinker, e.g. for an application cache that should give memory
+ * back along with the library's own. Returns 'SISWA_FALSE' if there's no room. */
+siBool siswa_budgetAddShrinker(siShrinkProc proc, void* user);
+/* Unregisters the shrinker. Waits for a round that's running on another thread
+ * to finish first, so it doesn't get called afterwards. */
+void siswa_budgetRemoveShrinker(siShrinkProc proc, void* user);
+/* Asks the shrinkers to free 'bytes', in the order they got registered. Returns
+ * the number of bytes they freed. */
+size_t siswa_budgetShrink(size_t bytes);
+#endif
+
+#ifdef SISWA_USE_SET_INDEX
+/* An object placed by a set ('.set.xml'), i.e. an element right under its
+ * 'SetObject' root. */
+typedef struct {
+	/* Type of the object, i.e. the name of its element. Points into the payload,
+	 * so it isn't NULL-terminated. */
+	const char* type;
+	uint32_t typeLen;
+	/* 'SetObjectID' of the object, 0 if it doesn't have one. */
+	uint32_t id;
+	/* 'Position' of the object (x, y, z), if 'hasPosition' is set. */
+	float position[3];
+	siBool hasPosition;
+	/* The object's references are 'refs[firstRef]' to 'refs[firstRef + refCount - 1]'. */
+	uint32_t firstRef;
+	uint32_t refCount;
+	/* Offset of the object's element in the payload. */
+	uint32_t offset;
+	/* Archive (its index in the array given to 'siswa_setIndexBuild') and entry
+	 * of the object. Only set by the index. */
+	uint32_t archive;
+	const siArEntry* entry;
+} siSetObject;
+
+/* Another object that an object refers to by its 'SetObjectID', e.g. in its
+ * 'TargetListEnter'. */
+typedef struct {
+	/* Name of the element of the object that holds the reference (e.g.
+	 * 'TargetListEnter' or 'DialId'). Not NULL-terminated. */
+	const char* list;
+	uint32_t listLen;
+	/* 'SetObjectID' that gets referred to. */
+	uint32_t id;
+	/* Index of the object that the reference belongs to. */
+	uint32_t object;
+} siSetRef;
+
+/* Scans the payload of a '.set.xml' for its objects in one pass, skipping from
+ * tag to tag with SIMD where available. Writes up to 'capacity' objects into
+ * 'out' and up to 'refCapacity' of their references into 'refs', and returns
+ * the total amount of objects, with the total amount of references written to
+ * 'refCount' (can be NULL). If either is over its capacity, the scan has to be
+ * repeated with more room. Payloads without a 'SetObject' root have no objects.
+ * Only the subset of XML used by sets is understood (no entities or CDATA). */
+size_t siswa_setScan(const void* data, size_t len, siSetObject* out, size_t capacity,
+		siSetRef* refs, size_t refCapacity, size_t* refCount);
+
+#ifndef SISWA_NO_STDLIB
+typedef struct {
+	/* Every object of every set, in the order of the archives and their entries. */
+	siSetObject* objects;
+	size_t objectCount;
+	/* The references of all of the objects. */
+	siSetRef* refs;
+	size_t refCount;
+	/* Amount of sets that got scanned and their total size. */
+	size_t sets;
+	size_t bytes;
+
+	/* Internal lookup tables, must not be modified by the user. */
+	uint32_t* __byId;
+	uint32_t* __refsById;
+	uint32_t* __byType;
+	uint32_t* __typeRanges;
+	void* __types;
+} siSetIndex;
+
+/* Builds an index of the objects in every '.set.xml' entry of the archives,
+ * scanning them on 'threadCount' threads (see 'siswa_arManifestEx'). The
+ * archives must be decompressed (mapped ones work too) and have to outlive the
+ * index, as the names in it point into them. */
+void siswa_setIndexBuild(siSetIndex* index, const siArFile* ars, size_t count,
+		size_t threadCount);
+/* Frees the index. */
+void siswa_setIndexFree(siSetIndex* index);
+/* Finds the objects with the 'SetObjectID' (there can be more than one across
+ * archives). Writes a pointer to their indices in 'objects' into 'out' and
+ * returns their amount. */
+size_t siswa_setIndexFindId(const siSetIndex* index, uint32_t id, const uint32_t** out);
+/* Finds every object of the type (e.g. 'EnemyObjEnemyHole'), the same way as
+ * 'siswa_setIndexFindId'. */
+size_t siswa_setIndexFindType(const siSetIndex* index, const char* type, const uint32_t** out);
+/* Finds every reference to the 'SetObjectID', writing a pointer to their
+ * indices in 'refs' into 'out'. Returns their amount. */
+size_t siswa_setIndexFindRefs(const siSetIndex* index, uint32_t id, const uint32_t** out);
+#endif
+#endif
+
+
+typedef struct {
+	/* Where the archive gets written to. */
+	siWriteProc proc;
+	void* user;
+	/* Total amount of bytes written so far. */
+	size_t len;
+	/* The data of every entry starts at a multiple of this (from the start of
+	 * the archive). 1 or 0 means no padding. */
+	uint32_t alignment;
+	/* Set to 'SISWA_FALSE' once a write fails, after which nothing else gets written. */
+	siBool ok;
+
+	/* Data and padding of the current entry that's still left to write. */
+	uint32_t __left;
+	uint32_t __trailing;
+} siArWriter;
+
+/* Starts writing a new archive into 'proc', beginning with its header. Unlike
+ * 'siArFile', the archive never has to fit in memory. */
+void siswa_arWriterInit(siArWriter* writer, siWriteProc proc, void* user, uint32_t alignment);
+/* Starts a new entry, whose data must then be given with 'siswa_arWriterEntryWrite'
+ * in one or more pieces, totaling 'dataSize' bytes. 'filedate' can be NULL. */
+siBool siswa_arWriterEntryBegin(siArWriter* writer, const char* name, size_t nameLen,
+		uint32_t dataSize, const uint8_t filedate[8]);
+/* Same as 'siswa_arWriterEntryBegin', except the header of the entry is given
+ * as-is, so that existing entries can be written without changing their layout.
+ * Any padding gets written as zeroes. */
+siBool siswa_arWriterEntryBeginRaw(siArWriter* writer, const siArEntry* header,
+		const char* name, size_t nameLen);
+/* Writes the next piece of the current entry's data. */
+siBool siswa_arWriterEntryWrite(siArWriter* writer, const void* data, size_t len);
+/* Writes an entire entry at once. */
+siBool siswa_arWriterAdd(siArWriter* writer, const char* name, size_t nameLen,
+		const void* data, uint32_t dataSize, const uint8_t filedate[8]);
+/* Finishes the archive. Returns 'SISWA_FALSE' if any of the writes failed. */
+siBool siswa_arWriterEnd(siArWriter* writer);
+
+
+#define SISWA_IDENTIFIER_PATCH 0x48435053
+#define SISWA_PATCH_VERSION 1
+
+/* Every field of the patch is little-endian, like the archives. */
+
+typedef enum {
+	/* The entry gets copied from the old archive as-is. */
+	SISWA_PATCH_KEEP = 1,
+	/* The data of the entry is stored in the patch. */
+	SISWA_PATCH_ADD,
+	/* The data of the entry is made out of copy/insert operations against the
+	 * data of the old entry. */
+	SISWA_PATCH_DELTA
+} siPatchType;
+
+typedef struct {
+	/* 'SPCH' at the start of the file. */
+	uint32_t identifier;
+	uint32_t version;
+	/* Amount of entries in the new archive, each having its own record. */
+	uint32_t recordCount;
+	/* Header alignment of the new archive. */
+	uint32_t alignment;
+	/* Length of the archive that the patch applies to. */
+	uint32_t oldLen;
+	/* Length and the XXH64 hash of the archive that applying the patch gives. */
+	uint32_t newLen;
+	uint64_t newHash;
+} siPatchHeader;
+SISWA_STATIC_ASSERT(sizeof(siPatchHeader) == 32);
+
+/* Followed by the name ('nameLen' bytes) and the payload ('payloadSize' bytes).
+ * Delta payloads are a list of operations, each starting with a LEB128 varint
+ * of '(length << 1) | isCopy'. Copies are followed by another varint of the
+ * offset in the old data, inserts by 'length' bytes of new data. */
+typedef struct {
+	/* Type of the record, see 'siPatchType'. */
+	uint32_t type;
+	/* Offset of the old entry in the old archive (KEEP and DELTA only). */
+	uint32_t source;
+	/* Length of the name. 0 if it's the same as the old entry's name. */
+	uint32_t nameLen;
+	uint32_t payloadSize;
+	/* Header of the entry in the new archive. */
+	siArEntry entry;
+} siPatchRecord;
+SISWA_STATIC_ASSERT(sizeof(siPatchRecord) == 36);
+
+#ifndef SISWA_NO_STDLIB
+/* Creates a patch that turns the archive 'a' into 'b' and writes it to 'proc'.
+ * Unchanged entries are only referenced, changed entries get stored as binary
+ * deltas against their old versions (found with a rolling hash), and only new
+ * entries are stored whole. Returns the size of the patch, or 0 if writing failed. */
+size_t siswa_arPatchCreate(siArFile a, siArFile b, siWriteProc proc, void* user);
+#endif
+/* Applies the patch read from 'patch' to the archive 'a', writing the new archive
+ * into 'out'. Both the patch and the output are streamed in one sequential pass
+ * with a fixed amount of memory. Returns 'SISWA_FAILURE' if the patch is corrupted,
+ * made for a different archive, or if the result doesn't match the patch's hash
+ * (in which case the output is incomplete or wrong and must be thrown away). */
+siBool siswa_arPatchApply(siArFile a, siReadProc patch, void* patchUser,
+		siWriteProc out, void* outUser);
+
+
+#define SISWA_IDENTIFIER_REFS 0x53464552
+#define SISWA_REFS_VERSION 1
+
+/* Every field of the reference list is little-endian, like the archives. */
+
+typedef struct {
+	/* 'REFS' at the start of the file. */
+	uint32_t identifier;
+	uint32_t version;
+	/* Amount of entries in the archive, each having its own record. */
+	uint32_t entryCount;
+	/* Header alignment of the archive. */
+	uint32_t alignment;
+	/* Length and XXH64 hash of the rebuilt archive. */
+	uint32_t len;
+	uint32_t reserved;
+	uint64_t hash;
+} siRefsHeader;
+SISWA_STATIC_ASSERT(sizeof(siRefsHeader) == 32);
+
+/* Followed by the name of the entry ('nameLen' bytes). */
+typedef struct {
+	/* SHA-256 digest of the entry's data, used as its key in a content store. */
+	siByte sha256[SISWA_SHA256_SIZE];
+	/* Length of the name. */
+	uint32_t nameLen;
+	/* Header of the entry in the archive. */
+	siArEntry entry;
+} siRefsRecord;
+SISWA_STATIC_ASSERT(sizeof(siRefsRecord) == 56);
+
+/* Called for every entry while rebuilding an archive from its reference list.
+ * Must write the 'dataSize' bytes of data with the 'sha256' digest into 'writer'
+ * with 'siswa_arWriterEntryWrite'. Returns 'SISWA_FALSE' if the data couldn't
+ * be found. */
+typedef siBool (*siFetchProc)(void* user, const siByte sha256[SISWA_SHA256_SIZE],
+		uint32_t dataSize, siArWriter* writer);
+
+/* Writes the reference list of the archive into 'proc': the layout and the
+ * names of every entry with the SHA-256 digests of their data instead of the
+ * data itself, so that identical data only has to be stored once (e.g. in a
+ * content-addressed store). 'sha256' are the digests of every entry in order
+ * as given by 'siswa_arManifestEx', or NULL to compute them. Returns the size
+ * of the list, or 0 if writing failed. */
+size_t siswa_arRefsCreate(siArFile ar, const siByte* sha256, siWriteProc proc, void* user);
+/* Rebuilds the archive from the reference list read from 'refs', getting the
+ * data of the entries from 'fetch' and writing the archive into 'out' in one
+ * streaming pass. Returns 'SISWA_FAILURE' if the list is corrupted, data is
+ * missing, or the result doesn't match the list's hash. */
+siBool siswa_arRefsRebuild(siReadProc refs, void* refsUser, siFetchProc fetch,
+		void* fetchUser, siWriteProc out, void* outUser);
+
+
+/* Converts the tar stream read from 'in' into an archive written into 'out'
+ * (with its entries aligned to 'alignment', see 'siswa_arWriterInit'), in one
+ * pass with a fixed amount of memory, so that neither side ever has to be a
+ * file. Regular files become entries, named by their full path in the tar
+ * (without a leading "./"), with long names taken from pax or GNU headers.
+ * Everything else (directories, links...) gets skipped. Files with a
+ * modification date of 0 keep a file date of 0. Returns 'SISWA_FAILURE' if
+ * the tar is corrupted, has a file of 4 GiB or more or a name of 1024 bytes or
+ * more, or if writing failed. */
+siBool siswa_tarToAr(siReadProc in, void* inUser, siWriteProc out, void* outUser,
+		uint32_t alignment);
+/* Converts the uncompressed archive read from 'in' into a POSIX tar stream
+ * written into 'out', the same way as 'siswa_tarToAr'. Every entry becomes a
+ * regular file with its file date as the modification date, and names longer
+ * than a tar header allows get a pax header. Returns 'SISWA_FAILURE' if the
+ * archive is corrupted, has a name of 1024 bytes or more, or if writing failed. */
+siBool siswa_arToTar(siReadProc in, void* inUser, siWriteProc out, void* outUser);
+
+
+typedef struct {
+	/* Name of the entry. */
+	const char* name;
+	size_t nameLen;
+	/* Size and modification date (see 'siswa_filedateFromUnix') of the source. */
+	uint32_t dataSize;
+	uint64_t filedate;
+	/* Given back to the 'siSourceProc'. */
+	void* user;
+} siRepackSource;
+
+typedef struct {
+	/* Entries whose size and date matched, copied over from the old archive. */
+	size_t reused;
+	/* Entries that had to be read, but whose data turned out to be the same. */
+	size_t touched;
+	/* Entries whose data changed. */
+	size_t changed;
+	/* Entries that weren't in the old archive. */
+	size_t added;
+	/* Entries of the old archive without a source. */
+	size_t removed;
+} siRepackStats;
+
+/* Reads the data of the source ('source->dataSize' bytes), which has to stay
+ * valid until the next call. Returns NULL if the source couldn't be read. */
+typedef const void* (*siSourceProc)(void* user, const siRepackSource* source);
+
+#ifndef SISWA_NO_STDLIB
+/* Writes a new version of the 'old' archive into 'out' with an entry for every
+ * source, in the same order. Sources whose size and date match the old entry
+ * of the same name get copied from the old archive without being read, only the
+ * rest get read with 'read'. The old archive's alignment is kept. 'stats' can
+ * be NULL. Returns 'SISWA_FAILURE' if a source couldn't be read or writing failed. */
+siBool siswa_arRepack(siArFile old, const siRepackSource* sources, size_t count,
+		siSourceProc read, void* readUser, siWriteProc out, void* outUser,
+		siRepackStats* stats);
+#endif
+
+
+/* Writes the archive into 'proc' with its entries reordered: the entries named
+ * by 'names' come first in the same order, followed by the rest in their
+ * original order. Names that aren't in the archive or that repeat get skipped.
+ * Used for putting entries that get loaded together next to each other (see
+ * 'SISWA_TRACE_ACCESS' and 'siswa_traceCluster'). Returns 'SISWA_FALSE' if
+ * writing failed. */
+siBool siswa_arReorder(siArFile ar, const char* const* names, size_t count,
+		siWriteProc proc, void* user);
+#ifndef SISWA_NO_STDLIB
+/* Orders the names of an access trace for 'siswa_arReorder' by which loads
+ * accessed them, where 'loads[i]' is the load of the access 'names[i]' and
+ * must never be smaller than that of an earlier access. Entries accessed by the
+ * exact same loads form a cluster, so a load reads either all of a cluster or
+ * none of it. Every cluster is followed by the one sharing the most loads with
+ * it, relative to their total, and ties go to the earliest accessed. Inside a
+ * cluster the entries keep the order of their first access. Writes every name
+ * once into 'out', which needs room for 'count' names, and returns the amount. */
+size_t siswa_traceCluster(const char* const* names, const uint32_t* loads, size_t count,
+		const char** out);
+#endif
+
+
+/* Compresses 'inLen' bytes of 'in' into a raw Deflate stream (without a zlib
+ * header) at 'level', writing at most 'capacity' bytes into 'out'. Returns the
+ * compressed size, or 0 if it didn't fit. */
+typedef size_t (*siCompressProc)(void* user, const void* in, size_t inLen, void* out,
+		size_t capacity, int level);
+
+typedef struct {
+	/* SHA-256 digest of the chunk's uncompressed data. */
+	siByte sha256[SISWA_SHA256_SIZE];
+	/* Uncompressed size of the chunk. */
+	uint32_t size;
+	/* Compression level the chunk was compressed at. */
+	int32_t level;
+} siChunkKey;
+
+/* Cache of compressed SEGS chunks, so that unchanged chunks don't have to be
+ * compressed again when an archive gets rebuilt. */
+typedef struct {
+	/* Copies the compressed chunk of 'key' into 'out'. Returns its size, or 0
+	 * if it isn't cached or doesn't fit in 'capacity'. */
+	size_t (*get)(void* user, const siChunkKey* key, void* out, size_t capacity);
+	/* Stores the compressed chunk of 'key'. */
+	void (*put)(void* user, const siChunkKey* key, const void* data, size_t len);
+	void* user;
+} siChunkCache;
+
+typedef struct {
+	/* Amount of chunks in the archive. */
+	size_t chunks;
+	/* Chunks taken from the cache. */
+	size_t cached;
+	/* Chunks that had to be compressed. */
+	size_t compressed;
+	/* Chunks stored uncompressed, as they didn't get any smaller. */
+	size_t stored;
+} siSegsStats;
+
+/* Gets the highest amount of bytes that compressing 'len' bytes into a SEGS
+ * archive can take. */
+size_t siswa_segsCompressBound(size_t len);
+/* Compresses the archive into a SEGS archive, written into 'out'. Every 64 KiB
+ * chunk gets compressed with 'compress' (or stored if it's NULL or the chunk
+ * doesn't get smaller), unless 'cache' already has the chunk for 'level'. 'cache'
+ * and 'stats' can be NULL. Returns the SEGS archive, which uses 'out' as its data.
+ * Fails if 'capacity' is less than 'siswa_segsCompressBound(ar.len)'. */
+siArFile siswa_arCompressSegs(siArFile ar, void* out, size_t capacity, int level,
+		siCompressProc compress, void* compressUser, const siChunkCache* cache,
+		siSegsStats* stats);
+#ifndef SISWA_NO_STDLIB
+/* 'siChunkCache' functions that keep every chunk as a file in a directory, whose
+ * path is given as the cache's 'user'. The directory must already exist. */
+size_t siswa_chunkCacheFileGet(void* directory, const siChunkKey* key, void* out,
+		size_t capacity);
+void siswa_chunkCacheFilePut(void* directory, const siChunkKey* key, const void* data,
+		size_t len);
+#endif
+
+
+
 #ifndef SISWA_NO_DECOMPRESSION
 /* Decompresses the given buffer using Deflate decompression and writes it into
  * 'out'. Returns the length of the decompressed data. */
@@ -540,11 +1728,106 @@ size_t siswa_decompressDeflate(siByte* data, size_t length, siByte* out, size_t
  * it into 'out'. Returns the length of the decompressed data. */
 size_t siswa_decompressLZXDelta(siByte* data, size_t length, siByte* out, size_t capacity);
 
+#ifndef SISWA_DEFINE_CUSTOM_DEFLATE_DECOMPRESSION
+/* Size of the history window that's needed to resume Deflate decompression
+ * into a different output buffer. */
+#define SISWA_INFLATE_WINDOW_SIZE (32 * 1024)
+
+#define SISWA_INFLATE_PRE_TBL_SIZE 128
+#define SISWA_INFLATE_LIT_TBL_SIZE 1334
+#define SISWA_INFLATE_OFF_TBL_SIZE 402
+
+typedef enum {
+	/* The last block of the stream was decompressed. */
+	SISWA_INFLATE_DONE = 0,
+	/* The entire input window was consumed, '.in' must be given more data. */
+	SISWA_INFLATE_NEED_INPUT,
+	/* The output window is full, '.out' must be given more space. */
+	SISWA_INFLATE_NEED_OUTPUT,
+	/* The data isn't valid Deflate. Every following call fails as well. */
+	SISWA_INFLATE_ERROR
+} siInflateStatus;
+
+typedef struct {
+	/* The current input window. Advanced by the amount of consumed bytes. */
+	const siByte* in;
+	size_t inLen;
+	/* The current output window. Advanced by the amount of written bytes. */
+	siByte* out;
+	size_t outLen;
+	/* Total amount of consumed and written bytes since the initialization. */
+	size_t totalIn;
+	size_t totalOut;
+
+	/* Internal state of the decompressor, must not be modified by the user. */
+	siByte* __window;
+	size_t __windowPos;
+	size_t __windowLen;
+	uint64_t __bitbuf;
+	int32_t __bitcnt;
+	uint32_t __state;
+	uint32_t __last;
+	uint32_t __len;
+	uint32_t __dist;
+	uint32_t __index;
+	uint32_t __nlit;
+	uint32_t __ndist;
+	uint32_t __nlen;
+	siByte __lens[288 + 32];
+	uint32_t __hlens[SISWA_INFLATE_PRE_TBL_SIZE];
+	uint32_t __lits[SISWA_INFLATE_LIT_TBL_SIZE];
+	uint32_t __dsts[SISWA_INFLATE_OFF_TBL_SIZE];
+} siInflateState;
+
+/* Initializes a resumable Deflate decompressor. 'window' must either be a buffer
+ * of 'SISWA_INFLATE_WINDOW_SIZE' bytes, which keeps the history of the stream
+ * so that every output window can be a different buffer, or NULL, in which case
+ * each new output window must directly follow the previous one in memory (e.g.
+ * all of them being parts of one big buffer). */
+void siswa_decompressDeflateInit(siInflateState* state, siByte* window);
+/* Decompresses as much of '.in' into '.out' as possible, advancing both of the
+ * windows. Input can be fed in pieces of any size, and the output windows can
+ * be of any size too. Returns 'SISWA_INFLATE_DONE' once the stream ends, after
+ * which '.in' points right after the end of the Deflate stream. */
+siInflateStatus siswa_decompressDeflateStream(siInflateState* state);
+#endif
+
 #endif
 
 
 #if defined(SISWA_ARCHIVE_IMPLEMENTATION)
 
+#if !defined(SISWA_LITTLE_ENDIAN) && !defined(SISWA_BIG_ENDIAN)
+	#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		#define SISWA_BIG_ENDIAN
+	#elif defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		#define SISWA_LITTLE_ENDIAN
+	#elif defined(__BIG_ENDIAN__) || defined(__ARMEB__) || defined(__AARCH64EB__) \
+			|| defined(__THUMBEB__) || defined(__MIPSEB__) || defined(_MIPSEB) \
+			|| defined(__sparc) || defined(__s390__) || defined(__hppa__)
+		#define SISWA_BIG_ENDIAN
+	#elif defined(__LITTLE_ENDIAN__) || defined(_WIN32) || defined(__i386__) \
+			|| defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64) \
+			|| defined(_M_ARM) || defined(_M_ARM64) || defined(__ARMEL__) \
+			|| defined(__AARCH64EL__) || defined(__MIPSEL__) || defined(_MIPSEL) \
+			|| defined(__riscv)
+		#define SISWA_LITTLE_ENDIAN
+	#else
+		#error "Couldn't detect the byte order, define 'SISWA_LITTLE_ENDIAN' or 'SISWA_BIG_ENDIAN'"
+	#endif
+#endif
+
+#if (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 8))) \
+		|| defined(__clang__)
+	#define siswa_swap16(x) __builtin_bswap16((uint16_t)(x))
+	#define siswa_swap32(x) __builtin_bswap32((uint32_t)(x))
+	#define siswa_swap64(x) __builtin_bswap64((uint64_t)(x))
+#elif defined(_MSC_VER)
+	#include <stdlib.h>
+	#define siswa_swap16(x) _byteswap_ushort((unsigned short)(x))
+	#define siswa_swap32(x) ((uint32_t)_byteswap_ulong((unsigned long)(x)))
+	#define siswa_swap64(x) _byteswap_uint64((uint64_t)(x))
+#else
 #define siswa_swap16(x) \
 	((uint16_t)((((x) >> 8) & 0xff) | (((x) & 0xff) << 8)))
 #define siswa_swap32(x)					\
@@ -559,121 +1842,826 @@ size_t siswa_decompressLZXDelta(siByte* data, size_t length, siByte* out, size_t
    | (((x) & (uint64_t)0x0000000000FF0000) << 24)	\
    | (((x) & (uint64_t)0x000000000000FF00) << 40)	\
    | (((x) & (uint64_t)0x00000000000000FF) << 56))
+#endif
 
+/* Converts a little or big-endian value of the formats to the host's byte order
+ * and back. Either way is the same operation, which compiles to nothing when
+ * the byte orders match. */
+#if defined(SISWA_BIG_ENDIAN)
+	#define SISWA__LE16(x) siswa_swap16(x)
+	#define SISWA__LE32(x) siswa_swap32(x)
+	#define SISWA__LE64(x) siswa_swap64(x)
+	#define SISWA__BE16(x) ((uint16_t)(x))
+	#define SISWA__BE32(x) ((uint32_t)(x))
+	#define SISWA__BE64(x) ((uint64_t)(x))
+#else
+	#define SISWA__LE16(x) ((uint16_t)(x))
+	#define SISWA__LE32(x) ((uint32_t)(x))
+	#define SISWA__LE64(x) ((uint64_t)(x))
+	#define SISWA__BE16(x) siswa_swap16(x)
+	#define SISWA__BE32(x) siswa_swap32(x)
+	#define SISWA__BE64(x) siswa_swap64(x)
+#endif
 
-#if 1
 
-static
-siBool siswa_isLittleEndian(void) {
-	int32_t val = 1;
-	return (int32_t)*((uint8_t*)&val) == 1;
-}
+#if !defined(SISWA_NO_SIMD)
+	#if defined(__AVX2__)
+		#include <immintrin.h>
+		#define SISWA__SIMD_AVX2
+	#endif
+	#if defined(__SSE2__) || defined(__x86_64__) || defined(_M_X64)
+		#include <emmintrin.h>
+		#define SISWA__SIMD_SSE2
+	#elif defined(__aarch64__) || defined(__ARM_NEON)
+		#include <arm_neon.h>
+		#define SISWA__SIMD_NEON
+	#endif
+#else
+	#define SINFL_NO_SIMD
+#endif
+
+#ifdef SISWA_USE_THREADS
+	#if defined(_WIN32)
+		#include <windows.h>
+	#else
+		#include <pthread.h>
+	#endif
+#endif
+
+#ifdef SISWA_USE_MMAP
+	#if defined(_WIN32)
+		#include <windows.h>
+	#else
+		#include <sys/mman.h>
+		#include <sys/stat.h>
+		#include <fcntl.h>
+		#include <unistd.h>
+	#endif
+#endif
+
+#if defined(SISWA_USE_DIRECT_IO) && !defined(SISWA_NO_STDLIB) && !defined(_WIN32)
+	#include <sys/types.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#if defined(SISWA_USE_SHARED_CACHE) && !defined(SISWA_NO_STDLIB) && !defined(_WIN32)
+	#include <errno.h>
+	#include <signal.h>
+	#include <time.h>
+#endif
+
+#if defined(SISWA_USE_DAEMON) && !defined(SISWA_NO_STDLIB) && !defined(_WIN32)
+	#include <errno.h>
+	#include <poll.h>
+	#include <sys/socket.h>
+	#include <sys/un.h>
+#endif
+
+#if defined(SISWA_USE_RELOAD) && !defined(SISWA_NO_STDLIB) && !defined(_WIN32)
+	#include <poll.h>
+	#include <time.h>
+	#ifdef __linux__
+		#include <sys/inotify.h>
+	#endif
+#endif
+
+#if defined(SISWA_USE_VFS) && !defined(SISWA_NO_STDLIB) && !defined(_WIN32)
+	#include <dirent.h>
+	#include <limits.h>
+#endif
+
+#if defined(SISWA_USE_SCHEDULER) && !defined(SISWA_NO_STDLIB)
+	#if defined(_WIN32)
+		#include <windows.h>
+	#else
+		#include <time.h>
+	#endif
+#endif
+
+#if defined(SISWA_USE_BUDGETS) && !defined(SISWA_NO_STDLIB)
+/* Every allocation of the library gets recorded in a table keyed by its pointer,
+ * so that it can be attributed back to its budget when it gets freed. Memory
+ * that wasn't allocated by the library isn't in the table and gets freed as is. */
+typedef struct {
+	void* ptr;
+	size_t size;
+	uint32_t budget;
+} siswa__budgetRecord;
 
 typedef struct {
-	char** entries;
+	siShrinkProc proc;
+	void* user;
+} siswa__budgetShrinker;
+
+static struct {
+	siswa__budgetRecord* records;
 	size_t capacity;
-} siHashTable;
+	size_t count;
+
+	size_t current[SISWA_BUDGET_COUNT];
+	size_t peak[SISWA_BUDGET_COUNT];
+	uint64_t allocations[SISWA_BUDGET_COUNT];
+	size_t total;
+	size_t cap;
+	uint64_t overruns;
 
-#define SI_FNV_OFFSET 14695981039346656037UL
-#define SI_FNV_PRIME 1099511628211UL
+	siswa__budgetShrinker shrinkers[SISWA_BUDGET_MAX_SHRINKERS];
+	size_t shrinkerCount;
+	volatile int lock;
+	/* Held for a whole round of shrinkers, which can't be under 'lock'. */
+	volatile int shrinkLock;
+} siswa__budget;
+
+#if defined(__GNUC__) || defined(__clang__)
+	#define SISWA__BUDGET_LOCK() while (__sync_lock_test_and_set(&siswa__budget.lock, 1)) {}
+	#define SISWA__BUDGET_UNLOCK() __sync_lock_release(&siswa__budget.lock)
+	#define SISWA__BUDGET_SHRINK_LOCK() while (__sync_lock_test_and_set(&siswa__budget.shrinkLock, 1)) {}
+	#define SISWA__BUDGET_SHRINK_UNLOCK() __sync_lock_release(&siswa__budget.shrinkLock)
+	#define SISWA__THREAD_LOCAL __thread
+#else
+	#define SISWA__BUDGET_LOCK() (void)0
+	#define SISWA__BUDGET_UNLOCK() (void)0
+	#define SISWA__BUDGET_SHRINK_LOCK() (void)0
+	#define SISWA__BUDGET_SHRINK_UNLOCK() (void)0
+	#define SISWA__THREAD_LOCAL
+#endif
+
+/* Set while the thread is running shrinkers, so that their own allocations (or
+ * calls into the budget API) don't wait on the round they're part of. */
+static SISWA__THREAD_LOCAL int siswa__budgetShrinking;
+
+static
+size_t siswa__budgetSlot(const void* ptr, size_t capacity) {
+	uint64_t key = (uint64_t)(size_t)ptr;
+	return (size_t)((key * 0x9E3779B97F4A7C15) >> 32) & (capacity - 1);
+}
 
+/* Returns the record of the pointer, or NULL if it isn't there. */
 static
-uint64_t siswa__hashKey(const char* key) {
-	uint64_t hash = SI_FNV_OFFSET;
-	const char* p;
-	for (p = key; *p; p++) {
-		hash ^= (uint64_t)(*p);
-		hash *= SI_FNV_PRIME;
+siswa__budgetRecord* siswa__budgetFind(const void* ptr) {
+	size_t index;
+
+	if (siswa__budget.capacity == 0) {
+		return NULL;
+	}
+	index = siswa__budgetSlot(ptr, siswa__budget.capacity);
+	while (siswa__budget.records[index].ptr != NULL) {
+		if (siswa__budget.records[index].ptr == ptr) {
+			return &siswa__budget.records[index];
+		}
+		index = (index + 1) & (siswa__budget.capacity - 1);
 	}
-	return hash;
+	return NULL;
 }
 
 static
-siHashTable* siswa__hashtableMakeReserve(void* mem, size_t capacity) {
-	siHashTable* table = (siHashTable*)mem;
-	table->capacity = capacity;
-	table->entries = (char**)(table + 1);
-	SISWA_MEMSET(table->entries, 0, capacity * sizeof(char*));
+void siswa__budgetAdd(siBudget budget, size_t size) {
+	siswa__budget.current[budget] += size;
+	siswa__budget.total += size;
+	if (siswa__budget.current[budget] > siswa__budget.peak[budget]) {
+		siswa__budget.peak[budget] = siswa__budget.current[budget];
+	}
+}
 
-	return table;
+static
+void siswa__budgetSub(siBudget budget, size_t size) {
+	siswa__budget.current[budget] -= size;
+	siswa__budget.total -= size;
 }
 
+/* Removes the record, moving the ones after it back so that probing never has
+ * to skip over holes. */
 static
-uint32_t siswa__hashtableExists(siHashTable* ht, const char* key) {
-	uint64_t hash = siswa__hashKey(key);
-	size_t index = (size_t)(hash & (uint64_t)(ht->capacity - 1));
+void siswa__budgetRemove(siswa__budgetRecord* record) {
+	size_t mask = siswa__budget.capacity - 1;
+	size_t hole = (size_t)(record - siswa__budget.records);
+	size_t index = hole;
 
-	char** entry = &ht->entries[index];
-	char** oldEntry = entry;
-	char** end = &ht->entries[ht->capacity];
-	do {
-		if (*entry == NULL) {
-			goto increment_entry;
-		}
+	siswa__budgetSub((siBudget)record->budget, record->size);
+	siswa__budget.count -= 1;
 
-		if (
-			*key == **entry
-			&& strcmp(key + 1, *entry + 1) == 0) {
-			return SISWA_SUCCESS;
-		}
+	for (;;) {
+		size_t home;
 
-increment_entry:
-		entry += 1;
-		if (entry == end) {
-			entry = ht->entries;
+		index = (index + 1) & mask;
+		if (siswa__budget.records[index].ptr == NULL) {
+			break;
 		}
-	} while (entry != oldEntry);
-
-	return SISWA_FAILURE;
+		home = siswa__budgetSlot(siswa__budget.records[index].ptr, siswa__budget.capacity);
+		if (((index - home) & mask) >= ((index - hole) & mask)) {
+			siswa__budget.records[hole] = siswa__budget.records[index];
+			hole = index;
+		}
+	}
+	siswa__budget.records[hole].ptr = NULL;
 }
 
 static
-char** siswa__hashtableSet(siHashTable* ht, const char* allocatedStr) {
-	uint64_t hash = siswa__hashKey(allocatedStr);
-	size_t index = (size_t)(hash & (uint64_t)(ht->capacity - 1));
+void siswa__budgetInsert(void* ptr, size_t size, siBudget budget) {
+	siswa__budgetRecord* record;
+	size_t index;
+
+	/* A pointer that's still in the table got freed without the library's
+	 * knowing and reused since. */
+	record = siswa__budgetFind(ptr);
+	if (record != NULL) {
+		siswa__budgetRemove(record);
+	}
 
-	char** entry = ht->entries + index;
-	char** end = ht->entries + ht->capacity;
+	if ((siswa__budget.count + 1) * 2 > siswa__budget.capacity) {
+		siswa__budgetRecord* old = siswa__budget.records;
+		size_t oldCapacity = siswa__budget.capacity, i;
+
+		siswa__budget.capacity = (oldCapacity != 0) ? oldCapacity * 2 : 256;
+		siswa__budget.records = (siswa__budgetRecord*)calloc(
+			siswa__budget.capacity, sizeof(siswa__budgetRecord)
+		);
+		SISWA_ASSERT_NOT_NULL(siswa__budget.records);
 
-	while (*entry != NULL) {
-		entry += 1;
-		if (entry == end) {
-			entry = ht->entries;
+		for (i = 0; i < oldCapacity; i += 1) {
+			if (old[i].ptr != NULL) {
+				index = siswa__budgetSlot(old[i].ptr, siswa__budget.capacity);
+				while (siswa__budget.records[index].ptr != NULL) {
+					index = (index + 1) & (siswa__budget.capacity - 1);
+				}
+				siswa__budget.records[index] = old[i];
+			}
 		}
+		free(old);
 	}
-	*entry = (char*)allocatedStr;
-
-	return &ht->entries[index];
-}
-#undef SI_FNV_OFFSET
-#undef SI_FNV_PRIME
 
-#endif
+	index = siswa__budgetSlot(ptr, siswa__budget.capacity);
+	while (siswa__budget.records[index].ptr != NULL) {
+		index = (index + 1) & (siswa__budget.capacity - 1);
+	}
+	siswa__budget.records[index].ptr = ptr;
+	siswa__budget.records[index].size = size;
+	siswa__budget.records[index].budget = (uint32_t)budget;
+	siswa__budget.count += 1;
 
+	siswa__budgetAdd(budget, size);
+	siswa__budget.allocations[budget] += 1;
+}
 
-siArFile siswa_arMake(const char* path) {
-	return siswa_arMakeEx(path, 0);
+/* Calls every registered shrinker until 'bytes' get freed. The caller must
+ * hold the shrink lock, unless it's already part of a round. */
+static
+size_t siswa__budgetRunShrinkers(size_t bytes) {
+	siswa__budgetShrinker shrinkers[SISWA_BUDGET_MAX_SHRINKERS];
+	size_t count, freed = 0, i;
+
+	/* The shrinkers run unlocked, as they free (and may allocate) memory. */
+	SISWA__BUDGET_LOCK();
+	count = siswa__budget.shrinkerCount;
+	SISWA_MEMCPY(shrinkers, siswa__budget.shrinkers, count * sizeof(siswa__budgetShrinker));
+	SISWA__BUDGET_UNLOCK();
+
+	siswa__budgetShrinking += 1;
+	for (i = 0; i < count && freed < bytes; i += 1) {
+		freed += shrinkers[i].proc(shrinkers[i].user, bytes - freed);
+	}
+	siswa__budgetShrinking -= 1;
+	return freed;
 }
-#ifndef SISWA_NO_STDLIB
-siArFile siswa_arMakeEx(const char* path, size_t additionalAllocSpace) {
-	FILE* file;
-	siByte* data;
-	size_t dataLen;
-	siArFile ar;
 
-	SISWA_ASSERT_NOT_NULL(path);
+/* Returns how far over the cap the library would be with 'size' more bytes, of
+ * which 'released' get freed by the allocation itself. */
+static
+size_t siswa__budgetExcess(size_t size, size_t released) {
+	size_t total, cap;
 
-	file = fopen(path, "rb");
-	SISWA_ASSERT_NOT_NULL(file);
+	SISWA__BUDGET_LOCK();
+	total = siswa__budget.total - released + size;
+	cap = siswa__budget.cap;
+	SISWA__BUDGET_UNLOCK();
 
-	fseek(file, 0, SEEK_END);
-	dataLen = ftell(file);
-	rewind(file);
+	return (cap != 0 && total > cap) ? total - cap : 0;
+}
 
-	data = (siByte*)malloc(dataLen + additionalAllocSpace);
-	fread(data, dataLen, 1, file);
+/* Makes room for 'size' more bytes (of which 'released' get freed by the
+ * allocation itself) by calling the shrinkers if the cap would be exceeded. */
+static
+void siswa__budgetReserve(size_t size, size_t released) {
+	size_t excess = siswa__budgetExcess(size, released);
+	siBool overrun;
 
-	ar = siswa_arMakeBufferEx(data, dataLen, dataLen + additionalAllocSpace);
+	if (excess == 0) {
+		return;
+	}
+	/* Shrinkers allocating memory themselves don't start another round. */
+	if (siswa__budgetShrinking) {
+		overrun = SISWA_TRUE;
+	}
+	else {
+		/* Another thread's round might've made enough room while this one
+		 * waited for it. */
+		SISWA__BUDGET_SHRINK_LOCK();
+		excess = siswa__budgetExcess(size, released);
+		overrun = (excess != 0 && siswa__budgetRunShrinkers(excess) < excess);
+		SISWA__BUDGET_SHRINK_UNLOCK();
+	}
+
+	if (overrun) {
+		SISWA__BUDGET_LOCK();
+		siswa__budget.overruns += 1;
+		SISWA__BUDGET_UNLOCK();
+	}
+}
+
+static
+void* siswa__budgetAlloc(siBudget budget, void* old, size_t size) {
+	siswa__budgetRecord* record;
+	size_t oldSize = 0;
+	void* ptr;
+
+	SISWA__BUDGET_LOCK();
+	record = (old != NULL) ? siswa__budgetFind(old) : NULL;
+	if (record != NULL) {
+		oldSize = record->size;
+	}
+	SISWA__BUDGET_UNLOCK();
+	siswa__budgetReserve(size, oldSize);
+
+	ptr = (old != NULL) ? realloc(old, size) : malloc(size);
+	if (ptr == NULL) {
+		return NULL;
+	}
+
+	SISWA__BUDGET_LOCK();
+	if (old != NULL) {
+		record = siswa__budgetFind(old);
+		if (record != NULL) {
+			siswa__budgetRemove(record);
+		}
+	}
+	siswa__budgetInsert(ptr, size, budget);
+	SISWA__BUDGET_UNLOCK();
+	return ptr;
+}
+
+#if defined(SISWA_USE_DAEMON) && !defined(_WIN32)
+/* Counts memory that doesn't come from 'malloc' (e.g. mappings) towards the
+ * budget, or stops counting it if 'release' is set. */
+static
+void siswa__budgetCharge(siBudget budget, size_t size, siBool release) {
+	if (!release) {
+		siswa__budgetReserve(size, 0);
+	}
+	SISWA__BUDGET_LOCK();
+	if (release) {
+		siswa__budgetSub(budget, size);
+	}
+	else {
+		siswa__budgetAdd(budget, size);
+		siswa__budget.allocations[budget] += 1;
+	}
+	SISWA__BUDGET_UNLOCK();
+}
+#endif
+
+void siswa_free(void* ptr) {
+	siswa__budgetRecord* record;
+
+	if (ptr == NULL) {
+		return;
+	}
+	SISWA__BUDGET_LOCK();
+	record = siswa__budgetFind(ptr);
+	if (record != NULL) {
+		siswa__budgetRemove(record);
+	}
+	SISWA__BUDGET_UNLOCK();
+	free(ptr);
+}
+
+void* siswa_budgetMalloc(siBudget budget, size_t size) {
+	SISWA_ASSERT((uint32_t)budget < SISWA_BUDGET_COUNT);
+	return siswa__budgetAlloc(budget, NULL, size);
+}
+
+void siswa_budgetStats(siBudget budget, siBudgetStats* out) {
+	static const char* names[SISWA_BUDGET_COUNT] = {
+		"archives", "decompression", "indexes", "caches", "other"
+	};
+
+	SISWA_ASSERT((uint32_t)budget < SISWA_BUDGET_COUNT);
+	SISWA_ASSERT_NOT_NULL(out);
+
+	SISWA__BUDGET_LOCK();
+	out->name = names[budget];
+	out->current = siswa__budget.current[budget];
+	out->peak = siswa__budget.peak[budget];
+	out->allocations = siswa__budget.allocations[budget];
+	SISWA__BUDGET_UNLOCK();
+}
+
+size_t siswa_budgetTotal(void) {
+	size_t total;
+
+	SISWA__BUDGET_LOCK();
+	total = siswa__budget.total;
+	SISWA__BUDGET_UNLOCK();
+	return total;
+}
+
+uint64_t siswa_budgetOverruns(void) {
+	uint64_t overruns;
+
+	SISWA__BUDGET_LOCK();
+	overruns = siswa__budget.overruns;
+	SISWA__BUDGET_UNLOCK();
+	return overruns;
+}
+
+void siswa_budgetSetCap(size_t cap) {
+	size_t total;
+
+	SISWA__BUDGET_LOCK();
+	siswa__budget.cap = cap;
+	total = siswa__budget.total;
+	SISWA__BUDGET_UNLOCK();
+
+	if (cap != 0 && total > cap) {
+		siswa_budgetShrink(total - cap);
+	}
+}
+
+siBool siswa_budgetAddShrinker(siShrinkProc proc, void* user) {
+	siBool res = SISWA_FALSE;
+
+	SISWA_ASSERT_NOT_NULL(proc);
+	SISWA__BUDGET_LOCK();
+	if (siswa__budget.shrinkerCount < SISWA_BUDGET_MAX_SHRINKERS) {
+		siswa__budget.shrinkers[siswa__budget.shrinkerCount].proc = proc;
+		siswa__budget.shrinkers[siswa__budget.shrinkerCount].user = user;
+		siswa__budget.shrinkerCount += 1;
+		res = SISWA_TRUE;
+	}
+	SISWA__BUDGET_UNLOCK();
+	return res;
+}
+
+void siswa_budgetRemoveShrinker(siShrinkProc proc, void* user) {
+	size_t i;
+
+	if (!siswa__budgetShrinking) {
+		SISWA__BUDGET_SHRINK_LOCK();
+	}
+	SISWA__BUDGET_LOCK();
+	for (i = 0; i < siswa__budget.shrinkerCount; i += 1) {
+		if (siswa__budget.shrinkers[i].proc == proc && siswa__budget.shrinkers[i].user == user) {
+			siswa__budget.shrinkerCount -= 1;
+			SISWA_MEMMOVE(&siswa__budget.shrinkers[i], &siswa__budget.shrinkers[i + 1],
+				(siswa__budget.shrinkerCount - i) * sizeof(siswa__budgetShrinker));
+			break;
+		}
+	}
+	SISWA__BUDGET_UNLOCK();
+	if (!siswa__budgetShrinking) {
+		SISWA__BUDGET_SHRINK_UNLOCK();
+	}
+}
+
+size_t siswa_budgetShrink(size_t bytes) {
+	size_t freed;
+
+	if (siswa__budgetShrinking) {
+		return siswa__budgetRunShrinkers(bytes);
+	}
+	SISWA__BUDGET_SHRINK_LOCK();
+	freed = siswa__budgetRunShrinkers(bytes);
+	SISWA__BUDGET_SHRINK_UNLOCK();
+	return freed;
+}
+
+#define SISWA__MALLOC(budget, size) siswa__budgetAlloc(budget, NULL, size)
+#define SISWA__REALLOC(budget, ptr, size) siswa__budgetAlloc(budget, ptr, size)
+#define SISWA__FREE(ptr) siswa_free(ptr)
+
+#elif !defined(SISWA_NO_STDLIB)
+void siswa_free(void* ptr) {
+	free(ptr);
+}
+
+#define SISWA__MALLOC(budget, size) malloc(size)
+#define SISWA__REALLOC(budget, ptr, size) realloc(ptr, size)
+#define SISWA__FREE(ptr) free(ptr)
+#else
+#define SISWA__FREE(ptr) free(ptr)
+#endif
+
+#if 1
+
+/* Checks if two strings of 'len' bytes are equal, 32 or 16 bytes at a time. The
+ * lengths must be compared beforehand, as neither string is required to be
+ * NULL-terminated. */
+static
+siBool siswa__nameEquals(const char* a, const char* b, size_t len) {
+#if defined(SISWA__SIMD_AVX2)
+	while (len >= 32) {
+		__m256i x = _mm256_loadu_si256((const __m256i*)(const void*)a);
+		__m256i y = _mm256_loadu_si256((const __m256i*)(const void*)b);
+		if ((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != 0xFFFFFFFFu) {
+			return SISWA_FALSE;
+		}
+		a += 32;
+		b += 32;
+		len -= 32;
+	}
+#endif
+#if defined(SISWA__SIMD_SSE2)
+	while (len >= 16) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(const void*)a);
+		__m128i y = _mm_loadu_si128((const __m128i*)(const void*)b);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF) {
+			return SISWA_FALSE;
+		}
+		a += 16;
+		b += 16;
+		len -= 16;
+	}
+#elif defined(SISWA__SIMD_NEON)
+	while (len >= 16) {
+		uint8x16_t eq = vceqq_u8(vld1q_u8((const uint8_t*)a), vld1q_u8((const uint8_t*)b));
+		uint64x2_t eq64 = vreinterpretq_u64_u8(eq);
+		if ((vgetq_lane_u64(eq64, 0) & vgetq_lane_u64(eq64, 1)) != ~(uint64_t)0) {
+			return SISWA_FALSE;
+		}
+		a += 16;
+		b += 16;
+		len -= 16;
+	}
+#endif
+	while (len >= 8) {
+		uint64_t x, y;
+		SISWA_MEMCPY(&x, a, sizeof(x));
+		SISWA_MEMCPY(&y, b, sizeof(y));
+		if (x != y) {
+			return SISWA_FALSE;
+		}
+		a += 8;
+		b += 8;
+		len -= 8;
+	}
+	while (len != 0) {
+		if (*a != *b) {
+			return SISWA_FALSE;
+		}
+		a += 1;
+		b += 1;
+		len -= 1;
+	}
+
+	return SISWA_TRUE;
+}
+
+/* Checks if the entry's name is exactly 'name'. The length of the entry's name
+ * is bounded by its data offset, so nothing past the entry gets read. */
+static
+siBool siswa__arEntryNameEquals(const siArEntry* entry, const char* name, size_t nameLen) {
+	const char* entryName = (const char*)entry + sizeof(siArEntry);
+	return SISWA__LE32(entry->offset) > sizeof(siArEntry) + nameLen
+		&& entryName[nameLen] == '\0'
+		&& siswa__nameEquals(entryName, name, nameLen);
+}
+
+typedef struct {
+	/* NULL if the slot is empty. Not required to be NULL-terminated. */
+	const char* name;
+	size_t len;
+	/* Stored so that probing never has to hash the names again. */
+	uint64_t hash;
+} siHashEntry;
+
+typedef struct {
+	siHashEntry* entries;
+	/* Always a power of two. */
+	size_t capacity;
+} siHashTable;
+
+#define SISWA__U64(hi, lo) (((uint64_t)(hi) << 32) | (uint64_t)(lo))
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__SIZEOF_INT128__)
+	__extension__ typedef unsigned __int128 siswa__uint128;
+#endif
+
+/* Multiplies two 64-bit numbers into a 128-bit one, written back as its low and
+ * high halves. */
+static
+void siswa__mul128(uint64_t* a, uint64_t* b) {
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__SIZEOF_INT128__)
+	siswa__uint128 r = (siswa__uint128)*a * *b;
+	*a = (uint64_t)r;
+	*b = (uint64_t)(r >> 64);
+#else
+	uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+	uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	uint64_t t = rl + (rm0 << 32);
+	uint64_t lo = t + (rm1 << 32);
+	uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl) + (lo < t);
+	*a = lo;
+	*b = hi;
+#endif
+}
+static
+uint64_t siswa__mix64(uint64_t a, uint64_t b) {
+	siswa__mul128(&a, &b);
+	return a ^ b;
+}
+/* Unaligned loads and stores of the formats' fields. */
+static
+uint64_t siswa__read64le(const siByte* p) {
+	uint64_t n;
+	SISWA_MEMCPY(&n, p, sizeof(n));
+	return SISWA__LE64(n);
+}
+static
+uint64_t siswa__read32le(const siByte* p) {
+	uint32_t n;
+	SISWA_MEMCPY(&n, p, sizeof(n));
+	return SISWA__LE32(n);
+}
+static
+uint32_t siswa__read32be(const siByte* p) {
+	uint32_t n;
+	SISWA_MEMCPY(&n, p, sizeof(n));
+	return SISWA__BE32(n);
+}
+/* Only the SEGS readers that parse the chunk table themselves need it. */
+#if !defined(SISWA_NO_DECOMPRESSION) && !defined(SISWA_NO_STDLIB) \
+	&& (!defined(SISWA_DEFINE_CUSTOM_DEFLATE_DECOMPRESSION) || defined(SISWA_USE_SCHEDULER))
+static
+uint16_t siswa__read16be(const siByte* p) {
+	uint16_t n;
+	SISWA_MEMCPY(&n, p, sizeof(n));
+	return SISWA__BE16(n);
+}
+#endif
+static
+void siswa__write32be(siByte* p, uint32_t n) {
+	n = SISWA__BE32(n);
+	SISWA_MEMCPY(p, &n, sizeof(n));
+}
+static
+void siswa__write16be(siByte* p, uint16_t n) {
+	n = SISWA__BE16(n);
+	SISWA_MEMCPY(p, &n, sizeof(n));
+}
+
+uint64_t siswa_hash64(const void* data, size_t len, uint64_t seed) {
+	static const uint64_t secret[4] = {
+		SISWA__U64(0x2d358dcc, 0xaa6c78a5), SISWA__U64(0x8bb84b93, 0x962eacc9),
+		SISWA__U64(0x4b33a62e, 0xd433d4a3), SISWA__U64(0x4d5a2da5, 0x1de1aa47)
+	};
+	const siByte* p = (const siByte*)data;
+	uint64_t a, b;
+
+	seed ^= siswa__mix64(seed ^ secret[0], secret[1]);
+
+	if (len <= 16) {
+		if (len >= 4) {
+			/* Two (possibly overlapping) 4-byte reads from each end. */
+			a = (siswa__read32le(p) << 32) | siswa__read32le(p + ((len >> 3) << 2));
+			b = (siswa__read32le(p + len - 4) << 32) | siswa__read32le(p + len - 4 - ((len >> 3) << 2));
+		}
+		else if (len > 0) {
+			a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+			b = 0;
+		}
+		else {
+			a = b = 0;
+		}
+	}
+	else {
+		size_t i = len;
+		if (i > 48) {
+			uint64_t see1 = seed, see2 = seed;
+			do {
+				seed = siswa__mix64(siswa__read64le(p) ^ secret[1], siswa__read64le(p + 8) ^ seed);
+				see1 = siswa__mix64(siswa__read64le(p + 16) ^ secret[2], siswa__read64le(p + 24) ^ see1);
+				see2 = siswa__mix64(siswa__read64le(p + 32) ^ secret[3], siswa__read64le(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+			seed ^= see1 ^ see2;
+		}
+		while (i > 16) {
+			seed = siswa__mix64(siswa__read64le(p) ^ secret[1], siswa__read64le(p + 8) ^ seed);
+			i -= 16;
+			p += 16;
+		}
+		a = siswa__read64le(p + i - 16);
+		b = siswa__read64le(p + i - 8);
+	}
+
+	a ^= secret[1];
+	b ^= seed;
+	siswa__mul128(&a, &b);
+	return siswa__mix64(a ^ secret[0] ^ (uint64_t)len, b ^ secret[1]);
+}
+
+#ifndef SISWA_HASH64
+	#define SISWA_HASH64 siswa_hash64
+#endif
+
+static
+uint64_t siswa__hashKey(const char* key, size_t len) {
+	return SISWA_HASH64(key, len, 0);
+}
+
+/* Returns the memory needed for a table that can hold 'count' keys. */
+static
+size_t siswa__hashtableCapacity(size_t count) {
+	size_t capacity = 16;
+	while (capacity < count * 2) {
+		capacity <<= 1;
+	}
+	return capacity;
+}
+
+static
+siHashTable* siswa__hashtableMakeReserve(void* mem, size_t capacity) {
+	siHashTable* table = (siHashTable*)mem;
+	SISWA_ASSERT_MSG((capacity & (capacity - 1)) == 0, "The capacity must be a power of two");
+
+	table->capacity = capacity;
+	table->entries = (siHashEntry*)(table + 1);
+	SISWA_MEMSET(table->entries, 0, capacity * sizeof(siHashEntry));
+
+	return table;
+}
+
+static
+siHashEntry* siswa__hashtableGet(siHashTable* ht, const char* key, size_t len,
+		uint64_t hash) {
+	size_t mask = ht->capacity - 1;
+	size_t index = (size_t)(hash & (uint64_t)mask);
+
+	siHashEntry* entry = &ht->entries[index];
+	while (entry->name != NULL) {
+		if (entry->hash == hash && entry->len == len
+				&& siswa__nameEquals(entry->name, key, len)) {
+			return entry;
+		}
+		index = (index + 1) & mask;
+		entry = &ht->entries[index];
+	}
+
+	return NULL;
+}
+
+static
+uint32_t siswa__hashtableExists(siHashTable* ht, const char* key, size_t len,
+		uint64_t hash) {
+	return siswa__hashtableGet(ht, key, len, hash) != NULL ? SISWA_SUCCESS : SISWA_FAILURE;
+}
+
+static
+siHashEntry* siswa__hashtableSet(siHashTable* ht, const char* allocatedStr, size_t len,
+		uint64_t hash) {
+	size_t mask = ht->capacity - 1;
+	size_t index = (size_t)(hash & (uint64_t)mask);
+
+	siHashEntry* entry = &ht->entries[index];
+	while (entry->name != NULL) {
+		index = (index + 1) & mask;
+		entry = &ht->entries[index];
+	}
+	entry->name = allocatedStr;
+	entry->len = len;
+	entry->hash = hash;
+
+	return entry;
+}
+
+#endif
+
+
+siArFile siswa_arMake(const char* path) {
+	return siswa_arMakeEx(path, 0);
+}
+#ifndef SISWA_NO_STDLIB
+siArFile siswa_arMakeEx(const char* path, size_t additionalAllocSpace) {
+	FILE* file;
+	siByte* data;
+	size_t dataLen;
+	siArFile ar;
+
+	SISWA_ASSERT_NOT_NULL(path);
+
+	file = fopen(path, "rb");
+	SISWA_ASSERT_NOT_NULL(file);
+
+	fseek(file, 0, SEEK_END);
+	dataLen = ftell(file);
+	rewind(file);
+
+	data = (siByte*)SISWA__MALLOC(SISWA_BUDGET_ARCHIVES, dataLen + additionalAllocSpace);
+	fread(data, dataLen, 1, file);
+
+	ar = siswa_arMakeBufferEx(data, dataLen, dataLen + additionalAllocSpace);
 	fclose(file);
 
 	return ar;
@@ -689,11 +2677,10 @@ siArFile siswa_arMakeBufferEx(const void* data, size_t len, size_t capacity) {
 	SISWA_ASSERT_NOT_NULL(data);
 	SISWA_ASSERT_MSG(len <= capacity, "The length cannot be larger than the capacity");
 
-	identifier = siswa_isLittleEndian()
-		? *(uint32_t*)data
-		: siswa_swap32(*(uint32_t*)data);
+	identifier = (uint32_t)siswa__read32le((const siByte*)data);
 
 	switch (identifier) {
+		case 0: ar.type = SISWA_FILE_REGULAR; break; /* 'siArHeader.unknown' is always 0. */
 		case SISWA_IDENTIFIER_ARL2: SISWA_PANIC(); break;
 		case SISWA_IDENTIFIER_XCOMPRESSION: ar.type = SISWA_FILE_XCOMPRESS; break;
 		case SISWA_IDENTIFIER_SEGS: ar.type = SISWA_FILE_SEGS; break;
@@ -703,6 +2690,7 @@ siArFile siswa_arMakeBufferEx(const void* data, size_t len, size_t capacity) {
 	ar.data = (siByte*)data;
 	ar.len = len;
 	ar.cap = capacity;
+	ar.validated = SISWA_FALSE;
 	ar.__curOffset = sizeof(siArHeader);
 
 	return ar;
@@ -710,7 +2698,7 @@ siArFile siswa_arMakeBufferEx(const void* data, size_t len, size_t capacity) {
 
 #ifndef SISWA_NO_STDLIB
 siArFile siswa_arCreateContent(size_t capacity) {
-	return siswa_arCreateContentEx(malloc(capacity + sizeof(siArHeader)), capacity);
+	return siswa_arCreateContentEx(SISWA__MALLOC(SISWA_BUDGET_ARCHIVES, capacity + sizeof(siArHeader)), capacity);
 }
 #endif
 siArFile siswa_arCreateContentEx(void* buffer, size_t capacity) {
@@ -723,20 +2711,78 @@ siArFile siswa_arCreateContentEx(void* buffer, size_t capacity) {
 	);
 
 	header.unknown = 0;
-	header.headerSizeof = sizeof(siArHeader);
-	header.entrySizeof = sizeof(siArEntry);
-	header.alignment = SISWA_DEFAULT_HEADER_ALIGNMENT;
+	header.headerSizeof = SISWA__LE32(sizeof(siArHeader));
+	header.entrySizeof = SISWA__LE32(sizeof(siArEntry));
+	header.alignment = SISWA__LE32(SISWA_DEFAULT_HEADER_ALIGNMENT);
 	SISWA_MEMCPY(buffer, &header, sizeof(siArHeader));
 
 	ar.data = (siByte*)buffer;
 	ar.len = sizeof(siArHeader);
 	ar.cap = capacity;
 	ar.type = SISWA_FILE_REGULAR;
+	ar.validated = SISWA_TRUE;
 	ar.__curOffset = sizeof(siArHeader);
 
 	return ar;
 }
 
+/* Checks if the entry at 'offset' is well-formed and completely inside of the
+ * archive's length. */
+static
+siBool siswa__arEntryIsValid(const siArFile* arFile, size_t offset) {
+	const siArEntry* entry;
+	size_t left = arFile->len - offset;
+	uint32_t bad;
+
+	if (offset >= arFile->len || left < sizeof(siArEntry) + 1) {
+		return SISWA_FALSE;
+	}
+	entry = (const siArEntry*)&arFile->data[offset];
+
+	/* Accumulate every check so that the common case is a single branch. */
+	bad = (SISWA__LE32(entry->size) > left);
+	bad |= (SISWA__LE32(entry->offset) <= sizeof(siArEntry));
+	bad |= (SISWA__LE32(entry->offset) > SISWA__LE32(entry->size));
+	bad |= (SISWA__LE32(entry->dataSize) > SISWA__LE32(entry->size) - SISWA__LE32(entry->offset));
+	if (bad) {
+		return SISWA_FALSE;
+	}
+
+	return SISWA_MEMCHR(
+		(const siByte*)entry + sizeof(siArEntry), '\0', SISWA__LE32(entry->offset) - sizeof(siArEntry)
+	) != NULL;
+}
+
+siBool siswa_arValidate(siArFile* arFile) {
+	const siArHeader* header;
+	size_t offset;
+
+	SISWA_ASSERT_NOT_NULL(arFile);
+	arFile->validated = SISWA_FALSE;
+
+	if (arFile->type != SISWA_FILE_REGULAR || arFile->len < sizeof(siArHeader)
+			|| arFile->len > arFile->cap) {
+		return SISWA_FAILURE;
+	}
+
+	header = (const siArHeader*)arFile->data;
+	if (SISWA__LE32(header->unknown) != 0 || SISWA__LE32(header->headerSizeof) != sizeof(siArHeader)
+			|| SISWA__LE32(header->entrySizeof) != sizeof(siArEntry)) {
+		return SISWA_FAILURE;
+	}
+
+	offset = sizeof(siArHeader);
+	while (offset < arFile->len) {
+		if (!siswa__arEntryIsValid(arFile, offset)) {
+			return SISWA_FAILURE;
+		}
+		offset += SISWA__LE32(((const siArEntry*)&arFile->data[offset])->size);
+	}
+
+	arFile->validated = SISWA_TRUE;
+	return SISWA_SUCCESS;
+}
+
 siArHeader* siswa_arGetHeader(siArFile arFile) {
 	return (siArHeader*)arFile.data;
 }
@@ -752,12 +2798,13 @@ size_t siswa_arGetEntryCount(siArFile arFile) {
 
 siBool siswa_arEntryPoll(siArFile* arFile, siArEntry** outEntry) {
 	siArEntry* entry = (siArEntry*)&arFile->data[arFile->__curOffset];
-	if (arFile->__curOffset >= arFile->len) {
+	if (arFile->__curOffset >= arFile->len
+			|| (!arFile->validated && !siswa__arEntryIsValid(arFile, arFile->__curOffset))) {
 		siswa_arOffsetReset(arFile);
 		return SISWA_FALSE;
 	}
 
-	arFile->__curOffset += entry->size;
+	arFile->__curOffset += SISWA__LE32(entry->size);
 	*outEntry = entry;
 	return SISWA_TRUE;
 }
@@ -768,26 +2815,100 @@ void siswa_arOffsetReset(siArFile* arFile) {
 siArEntry* siswa_arEntryFind(siArFile arFile, const char* name) {
 	return siswa_arEntryFindEx(arFile, name, SISWA_STRLEN(name));
 }
-siArEntry* siswa_arEntryFindEx(siArFile arFile, const char* name, size_t nameLen) {
+/* Same as 'siswa_arEntryFindEx', without tracing the access. */
+static
+siArEntry* siswa__arEntryFind(siArFile arFile, const char* name, size_t nameLen) {
 	siArEntry* entry;
 	SISWA_ASSERT_NOT_NULL(name);
 
 	arFile.__curOffset = sizeof(siArHeader);
 	while (siswa_arEntryPoll(&arFile, &entry)) {
-		char* entryName = siswa_arEntryGetName(entry);
-		if (*name == *entryName && SISWA_STRNCMP(name + 1, entryName + 1, nameLen - 1) == 0) {
+		if (siswa__arEntryNameEquals(entry, name, nameLen)) {
 			return entry;
 		}
 	}
 
 	return NULL;
 }
+siArEntry* siswa_arEntryFindEx(siArFile arFile, const char* name, size_t nameLen) {
+	siArEntry* entry = siswa__arEntryFind(arFile, name, nameLen);
+#ifdef SISWA_TRACE_ACCESS
+	if (entry != NULL) {
+		SISWA_TRACE_ACCESS(arFile, entry);
+	}
+#endif
+	return entry;
+}
 
 char* siswa_arEntryGetName(const siArEntry* entry) {
 	return (char*)entry + sizeof(siArEntry);
 }
 void* siswa_arEntryGetData(const siArEntry* entry) {
-	return (siByte*)entry + entry->offset;
+	return (siByte*)entry + SISWA__LE32(entry->offset);
+}
+void* siswa_arEntryGetDataEx(siArFile arFile, const siArEntry* entry) {
+	SISWA_ASSERT_NOT_NULL(entry);
+
+	if (!arFile.validated) {
+		const siByte* ptr = (const siByte*)entry;
+		if (ptr < arFile.data + sizeof(siArHeader) || ptr >= arFile.data + arFile.len
+				|| !siswa__arEntryIsValid(&arFile, (size_t)(ptr - arFile.data))) {
+			return NULL;
+		}
+	}
+
+	return (siByte*)entry + SISWA__LE32(entry->offset);
+}
+
+uint32_t siswa_arEntryGetSize(const siArEntry* entry) {
+	SISWA_ASSERT_NOT_NULL(entry);
+	return SISWA__LE32(entry->size);
+}
+uint32_t siswa_arEntryGetDataSize(const siArEntry* entry) {
+	SISWA_ASSERT_NOT_NULL(entry);
+	return SISWA__LE32(entry->dataSize);
+}
+uint32_t siswa_arEntryGetOffset(const siArEntry* entry) {
+	SISWA_ASSERT_NOT_NULL(entry);
+	return SISWA__LE32(entry->offset);
+}
+
+uint64_t siswa_arEntryGetFiledate(const siArEntry* entry) {
+	uint64_t res = 0;
+	size_t i;
+	SISWA_ASSERT_NOT_NULL(entry);
+
+	/* Always stored as little-endian, like the rest of the archive. */
+	for (i = sizeof(entry->filedate); i != 0; i -= 1) {
+		res = (res << 8) | entry->filedate[i - 1];
+	}
+	return res;
+}
+void siswa_arEntrySetFiledate(siArEntry* entry, uint64_t filedate) {
+	size_t i;
+	SISWA_ASSERT_NOT_NULL(entry);
+
+	for (i = 0; i < sizeof(entry->filedate); i += 1) {
+		entry->filedate[i] = (uint8_t)(filedate >> (i * 8));
+	}
+}
+
+/* 100 nanosecond intervals between 1601-01-01 and 1970-01-01. */
+#define SISWA__FILEDATE_UNIX_EPOCH SISWA__U64(0x019DB1DE, 0xD53E8000)
+
+uint64_t siswa_filedateFromUnix(uint64_t seconds, uint32_t nanoseconds) {
+	return SISWA__FILEDATE_UNIX_EPOCH + seconds * 10000000 + nanoseconds / 100;
+}
+uint64_t siswa_filedateToUnix(uint64_t filedate) {
+	return (filedate > SISWA__FILEDATE_UNIX_EPOCH)
+		? (filedate - SISWA__FILEDATE_UNIX_EPOCH) / 10000000
+		: 0;
+}
+
+/* Gets the amount of padding needed for 'offset' to become a multiple of 'alignment'. */
+static
+size_t siswa__alignPadding(size_t offset, uint32_t alignment) {
+	return (alignment > 1) ? (alignment - offset % alignment) % alignment : 0;
 }
 
 siBool siswa_arEntryAdd(siArFile* arFile, const char* name, const void* data,
@@ -796,9 +2917,19 @@ siBool siswa_arEntryAdd(siArFile* arFile, const char* name, const void* data,
 }
 siBool siswa_arEntryAddEx(siArFile* arFile, const char* name, size_t nameLen,
 		const void* data, uint32_t dataSize) {
-	siArEntry newEntry;
+	return siswa_arEntryAddDated(arFile, name, nameLen, data, dataSize, 0);
+}
+siBool siswa_arEntryAddDated(siArFile* arFile, const char* name, size_t nameLen,
+		const void* data, uint32_t dataSize, uint64_t filedate) {
+	return siswa_arEntryAddAligned(arFile, name, nameLen, data, dataSize, filedate, 0);
+}
+siBool siswa_arEntryAddAligned(siArFile* arFile, const char* name, size_t nameLen,
+		const void* data, uint32_t dataSize, uint64_t filedate, uint32_t alignment) {
+	siArEntry newEntry;
 	siByte* dataPtr;
 	size_t offset = sizeof(siArHeader);
+	size_t padding;
+	uint32_t entrySize;
 
 	SISWA_ASSERT_NOT_NULL(arFile);
 	SISWA_ASSERT_NOT_NULL(name);
@@ -809,22 +2940,22 @@ siBool siswa_arEntryAddEx(siArFile* arFile, const char* name, size_t nameLen,
 		siArFile tmpArFile = *arFile;
 
 		while (siswa_arEntryPoll(&tmpArFile, &entry)) {
-			const char* entryName = siswa_arEntryGetName(entry);
 			offset = tmpArFile.__curOffset;
 
-			if (*name == *entryName
-				&& SISWA_STRNCMP(&name[1], &entryName[1], nameLen - 1) == 0) {
+			if (siswa__arEntryNameEquals(entry, name, nameLen)) {
 				return SISWA_FAILURE;
 			}
 		}
 	}
-	newEntry.size = dataSize + nameLen + 1 + sizeof(siArEntry);
-	newEntry.dataSize = dataSize;
-	newEntry.offset = nameLen + 1 + sizeof(siArEntry);
-	SISWA_MEMSET(newEntry.filedate, 0, sizeof(uint64_t));
+	padding = siswa__alignPadding(offset + sizeof(siArEntry) + nameLen + 1, alignment);
+	entrySize = (uint32_t)(sizeof(siArEntry) + nameLen + 1 + padding) + dataSize;
+	newEntry.offset = SISWA__LE32(entrySize - dataSize);
+	newEntry.size = SISWA__LE32(entrySize);
+	newEntry.dataSize = SISWA__LE32(dataSize);
+	siswa_arEntrySetFiledate(&newEntry, filedate);
 
 	SISWA_ASSERT_MSG(
-		offset + newEntry.size < arFile->cap,
+		offset + entrySize < arFile->cap,
 		"Not enough space inside the buffer to add a new entry"
 	);
 	dataPtr = arFile->data + offset;
@@ -834,11 +2965,11 @@ siBool siswa_arEntryAddEx(siArFile* arFile, const char* name, size_t nameLen,
 
 	SISWA_MEMCPY(dataPtr, name, nameLen);
 	dataPtr += nameLen;
-	*dataPtr = '\0';
-	dataPtr += 1;
+	SISWA_MEMSET(dataPtr, 0, 1 + padding);
+	dataPtr += 1 + padding;
 
 	SISWA_MEMCPY(dataPtr, data, dataSize);
-	arFile->len += newEntry.size;
+	arFile->len += entrySize;
 
 	return SISWA_SUCCESS;
 }
@@ -852,7 +2983,7 @@ siBool siswa_arEntryRemoveEx(siArFile* arFile, const char* name, size_t nameLen)
 
 	SISWA_ASSERT_NOT_NULL(name);
 
-	entry = siswa_arEntryFindEx(*arFile, name, nameLen);
+	entry = siswa__arEntryFind(*arFile, name, nameLen);
 	entryPtr = (siByte*)entry;
 
 	if (entry == NULL) {
@@ -860,8 +2991,8 @@ siBool siswa_arEntryRemoveEx(siArFile* arFile, const char* name, size_t nameLen)
 	}
 	offset = (size_t)entry - (size_t)arFile->data;
 
-	arFile->len -= entry->size;
-	SISWA_MEMCPY(entryPtr, entryPtr + entry->size, arFile->len - offset);
+	arFile->len -= SISWA__LE32(entry->size);
+	SISWA_MEMMOVE(entryPtr, entryPtr + SISWA__LE32(entry->size), arFile->len - offset);
 
 	return SISWA_SUCCESS;
 }
@@ -878,7 +3009,7 @@ siBool siswa_arEntryUpdateEx(siArFile* arFile, const char* name, size_t nameLen,
 	SISWA_ASSERT_NOT_NULL(name);
 	SISWA_ASSERT_NOT_NULL(name);
 
-	entry = siswa_arEntryFindEx(*arFile, name, nameLen);
+	entry = siswa__arEntryFind(*arFile, name, nameLen);
 	entryPtr = (siByte*)entry;
 
 	if (entry == NULL) {
@@ -887,26 +3018,29 @@ siBool siswa_arEntryUpdateEx(siArFile* arFile, const char* name, size_t nameLen,
 	offset = (size_t)entry - (size_t)arFile->data;
 
 	{
-		int64_t oldSize = entry->size;
+		int64_t oldSize = SISWA__LE32(entry->size);
+		/* The name and its padding stay the same. */
+		uint32_t dataOffset = SISWA__LE32(entry->offset);
+		uint32_t newSize = dataOffset + dataSize;
 
-		entry->size = dataSize + nameLen + 1 + sizeof(siArEntry);
-		entry->dataSize = dataSize;
+		entry->size = SISWA__LE32(newSize);
+		entry->dataSize = SISWA__LE32(dataSize);
 
 		SISWA_ASSERT_MSG(
-			offset + entry->size < arFile->cap,
+			offset + newSize < arFile->cap,
 			"Not enough space inside the buffer to update the entry"
 		);
 
 		/* Copy the data _after_ the entry so that it doesn't get overwritten. */
-		SISWA_MEMCPY(
-			entryPtr + entry->size,
+		SISWA_MEMMOVE(
+			entryPtr + newSize,
 			entryPtr + (size_t)oldSize,
 			arFile->len - offset - oldSize
 		);
 		/* Copy the new data into the entry. */
-		SISWA_MEMCPY(entryPtr + entry->offset, data, dataSize);
+		SISWA_MEMCPY(entryPtr + dataOffset, data, dataSize);
 
-		arFile->len -= oldSize - (int64_t)entry->size;
+		arFile->len -= oldSize - (int64_t)newSize;
 	}
 
 
@@ -918,6 +3052,10 @@ siArFile siswa_arMerge(const siArFile ars[2], void* outBuffer, size_t capacity)
 }
 siArFile siswa_arMergeMul(const siArFile* arrayOfArs, size_t arrayLen, void* outBuffer,
 		size_t capacity) {
+	return siswa_arMergeMulEx(arrayOfArs, arrayLen, outBuffer, capacity, 0);
+}
+siArFile siswa_arMergeMulEx(const siArFile* arrayOfArs, size_t arrayLen, void* outBuffer,
+		size_t capacity, uint32_t alignment) {
 	siByte* ogBuffer = (siByte*)outBuffer;
 	siByte* buffer = ogBuffer;
 	siArHeader* header;
@@ -925,47 +3063,109 @@ siArFile siswa_arMergeMul(const siArFile* arrayOfArs, size_t arrayLen, void* out
 	size_t i;
 	siHashTable* ht;
 	size_t totalSize = sizeof(siArHeader);
+	size_t htCapacity, htSize;
+	void* htMemory;
 
 	siArEntry* entry;
 	uint32_t res;
 	siArFile curAr;
+	siBool validated = SISWA_TRUE;
 	char allocator[SISWA_DEFAULT_STACK_SIZE];
 
 
 	SISWA_ASSERT_NOT_NULL(arrayOfArs);
 	SISWA_ASSERT_NOT_NULL(outBuffer);
 
-	ht = siswa__hashtableMakeReserve(allocator, SISWA_DEFAULT_STACK_SIZE / sizeof(char*) - sizeof(siHashTable));
+	{
+		/* The names of every archive except for the last one get indexed. The table
+		 * only goes on the heap when it doesn't fit on the stack. */
+		size_t count = 0;
+		for (i = 0; i + 1 < arrayLen; i++) {
+			count += siswa_arGetEntryCount(arrayOfArs[i]);
+		}
+		htCapacity = siswa__hashtableCapacity(count);
+		htSize = sizeof(siHashTable) + htCapacity * sizeof(siHashEntry);
+		htMemory = allocator;
+
+		if (htSize > sizeof(allocator)) {
+#ifndef SISWA_NO_STDLIB
+			htMemory = SISWA__MALLOC(SISWA_BUDGET_INDEXES, htSize);
+			SISWA_ASSERT_NOT_NULL(htMemory);
+#else
+			SISWA_ASSERT_MSG(htSize <= sizeof(allocator),
+				"Too many entries to merge, increase 'SISWA_DEFAULT_STACK_SIZE'");
+#endif
+		}
+	}
+	ht = siswa__hashtableMakeReserve(htMemory, htCapacity);
 
 	header = (siArHeader*)buffer;
 	header->unknown = 0;
-	header->headerSizeof = sizeof(siArHeader);
-	header->entrySizeof = sizeof(siArEntry);
-	header->alignment = SISWA_DEFAULT_HEADER_ALIGNMENT;
+	header->headerSizeof = SISWA__LE32(sizeof(siArHeader));
+	header->entrySizeof = SISWA__LE32(sizeof(siArEntry));
+	header->alignment = SISWA__LE32((alignment != 0) ? alignment : SISWA_DEFAULT_HEADER_ALIGNMENT);
 	buffer += sizeof(siArHeader);
 
 	for (i = 0; i < arrayLen; i++) {
 		curAr = arrayOfArs[i];
+		validated &= curAr.validated;
 		while (siswa_arEntryPoll(&curAr, &entry)) {
 			char* name = siswa_arEntryGetName(entry);
-			res = siswa__hashtableExists(ht, name);
+			size_t nameLen = SISWA_STRLEN(name);
+			uint64_t hash = siswa__hashKey(name, nameLen);
+			res = siswa__hashtableExists(ht, name, nameLen, hash);
 
 			if (res == SISWA_FAILURE) {
 				if (i != arrayLen - 1) {
-					siswa__hashtableSet(ht, name);
+					siswa__hashtableSet(ht, name, nameLen, hash);
+				}
+
+				if (alignment == 0) {
+					uint32_t entrySize = SISWA__LE32(entry->size);
+					totalSize += entrySize;
+					SISWA_ASSERT_MSG(capacity >= totalSize,
+						"Not enough space inside the buffer to merge all archive files"
+					);
+					SISWA_MEMCPY(buffer, entry, entrySize);
+					buffer += entrySize;
+				}
+				else {
+					siArEntry newEntry;
+					uint32_t dataSize = SISWA__LE32(entry->dataSize);
+					size_t padding = siswa__alignPadding(
+						totalSize + sizeof(siArEntry) + nameLen + 1, alignment
+					);
+					uint32_t dataOffset = (uint32_t)(sizeof(siArEntry) + nameLen + 1 + padding);
+
+					newEntry.offset = SISWA__LE32(dataOffset);
+					newEntry.size = SISWA__LE32(dataOffset + dataSize);
+					newEntry.dataSize = SISWA__LE32(dataSize);
+					SISWA_MEMCPY(newEntry.filedate, entry->filedate, sizeof(newEntry.filedate));
+
+					totalSize += dataOffset + dataSize;
+					SISWA_ASSERT_MSG(capacity >= totalSize,
+						"Not enough space inside the buffer to merge all archive files"
+					);
+					SISWA_MEMCPY(buffer, &newEntry, sizeof(siArEntry));
+					SISWA_MEMCPY(buffer + sizeof(siArEntry), name, nameLen);
+					SISWA_MEMSET(buffer + sizeof(siArEntry) + nameLen, 0, 1 + padding);
+					SISWA_MEMCPY(buffer + dataOffset, siswa_arEntryGetData(entry), dataSize);
+					buffer += dataOffset + dataSize;
 				}
-				totalSize += entry->size;
-				SISWA_ASSERT_MSG(capacity >= totalSize,
-					"Not enough space inside the buffer to merge all archive files"
-				);
-				SISWA_MEMCPY(buffer, entry, entry->size);
-				buffer += entry->size;
 			}
 		}
 	}
 
+#ifndef SISWA_NO_STDLIB
+	if (htMemory != allocator) {
+		SISWA__FREE(htMemory);
+	}
+#endif
+
 	{
+		/* Every copied entry was already checked if the inputs were validated. */
 		siArFile ar = siswa_arMakeBufferEx(ogBuffer, totalSize, capacity);
+		ar.validated = validated;
 		return ar;
 	}
 }
@@ -986,7 +3186,7 @@ uint64_t siswa_arGetDecompressedSize(siArFile ar) {
 
 #ifndef SISWA_NO_STDLIB
 void siswa_arFree(siArFile arFile) {
-	free(arFile.data);
+	SISWA__FREE(arFile.data);
 }
 #endif
 
@@ -1010,7 +3210,7 @@ siArlFile siswa_arlMakeEx(const char* path, size_t additionalAllocSpace) {
 	dataLen = ftell(file);
 	rewind(file);
 
-	data = (siByte*)malloc(dataLen + additionalAllocSpace);
+	data = (siByte*)SISWA__MALLOC(SISWA_BUDGET_ARCHIVES, dataLen + additionalAllocSpace);
 	fread(data, dataLen, 1, file);
 
 	arl = siswa_arlMakeBufferEx(data, dataLen, dataLen + additionalAllocSpace);
@@ -1029,9 +3229,7 @@ siArlFile siswa_arlMakeBufferEx(void* data, size_t len, size_t capacity) {
 	SISWA_ASSERT_NOT_NULL(data);
 	SISWA_ASSERT_MSG(len <= capacity, "The length cannot be larger than the capacity");
 
-	identifier = siswa_isLittleEndian()
-		? *(uint32_t*)data
-		: siswa_swap32(*(uint32_t*)data);
+	identifier = (uint32_t)siswa__read32le((const siByte*)data);
 
 	switch (identifier) {
 		case SISWA_IDENTIFIER_ARL2: arl.type = SISWA_FILE_REGULAR; break;
@@ -1043,6 +3241,7 @@ siArlFile siswa_arlMakeBufferEx(void* data, size_t len, size_t capacity) {
 	arl.data = (siByte*)data;
 	arl.len = len;
 	arl.cap = capacity;
+	arl.validated = SISWA_FALSE;
 	arl.__curOffset = sizeof(siArHeader);
 
 	return arl;
@@ -1054,7 +3253,7 @@ siArlFile siswa_arlCreateContent(size_t capacity, size_t archiveCount) {
 		capacity + (sizeof(siArlHeader) - sizeof(uint32_t)) + archiveCount * sizeof(uint32_t);
 
 	return siswa_arlCreateContentEx(
-		malloc(newCap),
+		SISWA__MALLOC(SISWA_BUDGET_ARCHIVES, newCap),
 		newCap,
 		archiveCount
 	);
@@ -1073,8 +3272,8 @@ siArlFile siswa_arlCreateContentEx(void* buffer, size_t capacity, size_t archive
 	);
 	SISWA_ASSERT_MSG(archiveCount != 0, "Array length cannot be zero");
 
-	header.identifier = SISWA_IDENTIFIER_ARL2;
-	header.archiveCount = archiveCount;
+	header.identifier = SISWA__LE32(SISWA_IDENTIFIER_ARL2);
+	header.archiveCount = SISWA__LE32(archiveCount);
 	SISWA_MEMCPY(buffer, &header, length);
 	SISWA_MEMSET((siByte*)buffer + length, 0, archiveCount * sizeof(uint32_t));
 	length += archiveCount * sizeof(uint32_t);
@@ -1083,6 +3282,7 @@ siArlFile siswa_arlCreateContentEx(void* buffer, size_t capacity, size_t archive
 	arl.len = length;
 	arl.cap = capacity;
 	arl.type = SISWA_FILE_REGULAR;
+	arl.validated = SISWA_FALSE;
 	arl.__curOffset = length;
 
 	return arl;
@@ -1127,7 +3327,7 @@ size_t siswa_arlGetEntryCount(siArlFile arFile) {
 }
 size_t siswa_arlGetHeaderLength(siArlFile arlFile) {
 	siArlHeader* header = siswa_arlGetHeader(arlFile);
-	return (sizeof(siArlHeader) - sizeof(uint32_t)) + header->archiveCount * sizeof(uint32_t);
+	return (sizeof(siArlHeader) - sizeof(uint32_t)) + SISWA__LE32(header->archiveCount) * sizeof(uint32_t);
 }
 
 siBool siswa_arlEntryPoll(siArlFile* arlFile, siArlEntry** outEntry) {
@@ -1163,8 +3363,7 @@ siArlEntry* siswa_arlEntryFindEx(siArlFile arFile, const char* name, size_t name
 	SISWA_ASSERT(arFile.type == SISWA_FILE_REGULAR);
 
 	while (siswa_arlEntryPoll(&arFile, &entry)) {
-		if (*name == *entry->string
-			&& SISWA_STRNCMP(&name[1], &entry->string[1], nameLen - 1) == 0) {
+		if (entry->len == nameLen && siswa__nameEquals(entry->string, name, nameLen)) {
 			return entry;
 		}
 	}
@@ -1186,17 +3385,15 @@ siBool siswa_arlEntryAddEx(siArlFile* arlFile, const char* name, uint8_t nameLen
 	SISWA_ASSERT_NOT_NULL(arlFile);
 	SISWA_ASSERT_NOT_NULL(name);
 	SISWA_ASSERT_MSG(
-		archiveIndex < header->archiveCount,
+		archiveIndex < SISWA__LE32(header->archiveCount),
 		"The provided archive index is too high than the linker's archive count"
 	);
 
 
 	while (siswa_arlEntryPoll(&tmpArFile, &entry)) {
-		const char* entryName = entry->string;
 		offset = tmpArFile.__curOffset;
 
-		if (*name == *entryName
-			&& SISWA_STRNCMP(&name[1], &entryName[1], nameLen - 1) == 0) {
+		if (entry->len == nameLen && siswa__nameEquals(entry->string, name, nameLen)) {
 			return SISWA_FAILURE;
 		}
 	}
@@ -1211,7 +3408,9 @@ siBool siswa_arlEntryAddEx(siArlFile* arlFile, const char* name, uint8_t nameLen
 
 	SISWA_MEMCPY(dataPtr, name, nameLen);
 	arlFile->len += sizeof(uint8_t) + nameLen;
-	header->archiveSizes[archiveIndex] += sizeof(siArEntry) + nameLen + 1;
+	header->archiveSizes[archiveIndex] = SISWA__LE32(
+		SISWA__LE32(header->archiveSizes[archiveIndex]) + sizeof(siArEntry) + nameLen + 1
+	);
 
 	return SISWA_SUCCESS;
 }
@@ -1227,7 +3426,7 @@ siBool siswa_arlEntryRemoveEx(siArlFile* arlFile, const char* name, uint8_t name
 
 	SISWA_ASSERT_NOT_NULL(name);
 	SISWA_ASSERT_MSG(
-		archiveIndex < header->archiveCount,
+		archiveIndex < SISWA__LE32(header->archiveCount),
 		"The specified archive index higher than the linker's archive count"
 	);
 
@@ -1245,7 +3444,9 @@ siBool siswa_arlEntryRemoveEx(siArlFile* arlFile, const char* name, uint8_t name
 		&entryPtr[sizeof(uint8_t) + nameLen],
 		arlFile->len - offset
 	);
-	header->archiveSizes[archiveIndex] -= sizeof(uint8_t) + nameLen;
+	header->archiveSizes[archiveIndex] = SISWA__LE32(
+		SISWA__LE32(header->archiveSizes[archiveIndex]) - sizeof(uint8_t) - nameLen
+	);
 
 	return SISWA_SUCCESS;
 }
@@ -1269,7 +3470,7 @@ siBool siswa_arlEntryUpdateEx(siArlFile* arlFile, const char* oldName, uint8_t o
 
 	header = siswa_arlGetHeader(*arlFile);
 	SISWA_ASSERT_MSG(
-		archiveIndex < header->archiveCount,
+		archiveIndex < SISWA__LE32(header->archiveCount),
 		"The provided archive index is too high than the linker's archive count."
 	);
 
@@ -1300,7 +3501,9 @@ siBool siswa_arlEntryUpdateEx(siArlFile* arlFile, const char* oldName, uint8_t o
 
 	dif = (int32_t)oldLen - (int32_t)newLen;
 	arlFile->len -= dif;
-	header->archiveSizes[archiveIndex] -= dif;
+	header->archiveSizes[archiveIndex] = SISWA__LE32(
+		SISWA__LE32(header->archiveSizes[archiveIndex]) - dif
+	);
 
 	return SISWA_SUCCESS;
 }
@@ -1323,6 +3526,47 @@ void siswa_arlDecompress(siArlFile* arl, siByte* out, size_t capacity, siBool fr
 		default: SISWA_PANIC();
 	}
 }
+/* Number of SEGS table entries that get converted at once. */
+#define SISWA__SEGS_BATCH 256
+
+/* Converts 'count' entries of a SEGS table (all big-endian) to the host's byte
+ * order, 2 or 4 entries at a time where SIMD is available. */
+static
+void siswa__segsTableLoad(siSegsEntry* out, const siSegsEntry* table, size_t count) {
+#if defined(SISWA_BIG_ENDIAN)
+	SISWA_MEMCPY(out, table, count * sizeof(siSegsEntry));
+#else
+	size_t i = 0;
+
+#if defined(SISWA__SIMD_SSE2)
+	/* Swaps the bytes of every 16-bit lane, then the two lanes of 'offset'. */
+	for (; i + 2 <= count; i += 2) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(const void*)&table[i]);
+		x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+		x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 1, 0));
+		x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 1, 0));
+		_mm_storeu_si128((__m128i*)(void*)&out[i], x);
+	}
+#elif defined(SISWA__SIMD_NEON)
+	/* 16-bit swaps for the sizes and a 32-bit one for 'offset'. */
+	static const uint8_t lanes[16] = {
+		0xFF, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0
+	};
+	uint8x16_t mask = vld1q_u8(lanes);
+	for (; i + 2 <= count; i += 2) {
+		uint8x16_t x = vld1q_u8((const uint8_t*)&table[i]);
+		x = vbslq_u8(mask, vrev16q_u8(x), vrev32q_u8(x));
+		vst1q_u8((uint8_t*)&out[i], x);
+	}
+#endif
+	for (; i < count; i += 1) {
+		out[i].zSize = SISWA__BE16(table[i].zSize);
+		out[i].size = SISWA__BE16(table[i].size);
+		out[i].offset = SISWA__BE32(table[i].offset);
+	}
+#endif
+}
+
 void siswa_arlDecompressSegs(siArlFile* arl, siByte* out, size_t capacity,
 		siBool freeCompessedData) {
 	siSegsHeader* header;
@@ -1332,9 +3576,9 @@ void siswa_arlDecompressSegs(siArlFile* arl, siByte* out, size_t capacity,
 	siByte* curOutOffset;
 	siByte* curDataOffset;
 	size_t baseOffset;
-	siSegsEntry* entry;
-	siSegsEntry* end;
-	size_t leftCapacity;
+	const siSegsEntry* table;
+	siSegsEntry batch[SISWA__SEGS_BATCH];
+	size_t leftCapacity, i;
 
 
 	SISWA_ASSERT_NOT_NULL(arl);
@@ -1342,12 +3586,8 @@ void siswa_arlDecompressSegs(siArlFile* arl, siByte* out, size_t capacity,
 	SISWA_ASSERT_MSG(arl->type == SISWA_FILE_SEGS, "Wrong compression type");
 
 	header = (siSegsHeader*)arl->data;
-	chunks = header->chunks;
-	fullSize = header->fullSize;
-	if (siswa_isLittleEndian()) {
-		chunks = siswa_swap16(chunks);
-		fullSize = siswa_swap32(fullSize);
-	}
+	chunks = SISWA__BE16(header->chunks);
+	fullSize = SISWA__BE32(header->fullSize);
 
 	SISWA_ASSERT_MSG(
 		capacity >= fullSize,
@@ -1358,172 +3598,6375 @@ void siswa_arlDecompressSegs(siArlFile* arl, siByte* out, size_t capacity,
 	baseOffset = sizeof(siSegsHeader) + (chunks * sizeof(siSegsEntry));
 	curDataOffset = arl->data;
 
-	entry = (siSegsEntry*)(header + 1);
-	end = &entry[chunks];
+	table = (const siSegsEntry*)(header + 1);
 	leftCapacity = capacity;
 
-	for (; entry < end; entry += 1) {
-		uint32_t size = entry->size;
-		uint32_t zSize = entry->zSize;
-		uint32_t offset = entry->offset;
-		if (siswa_isLittleEndian()) {
-			size = siswa_swap16(size);
-			zSize = siswa_swap16(zSize);
-			offset = siswa_swap32(offset);
+	/* The table gets converted a batch at a time, as the archive itself might
+	 * be read-only. */
+	for (i = 0; i < chunks; i += SISWA__SEGS_BATCH) {
+		size_t count = (chunks - i < SISWA__SEGS_BATCH) ? chunks - i : SISWA__SEGS_BATCH;
+		siSegsEntry* entry = batch;
+		siSegsEntry* end = &batch[count];
+
+		siswa__segsTableLoad(batch, &table[i], count);
+		/* The first chunk can also start right after the table. */
+		if (i == 0 && batch[0].offset == 1) {
+			batch[0].offset += (uint32_t)baseOffset;
 		}
-		offset -= 1;
 
-		if (entry == (siSegsEntry*)(header + 1) && offset == 0) {
-			offset += baseOffset;
+		for (; entry < end; entry += 1) {
+			uint32_t size = entry->size + (uint32_t)(entry->size == 0) * 0x10000;
+			uint32_t zSize = entry->zSize;
+			uint32_t offset = entry->offset - 1;
+
+			if (size == zSize) {
+				SISWA_MEMCPY(curOutOffset, &curDataOffset[offset], size);
+			}
+			else {
+				siswa_decompressDeflate(&curDataOffset[offset], zSize, curOutOffset, leftCapacity);
+			}
+
+			curOutOffset += size;
+			leftCapacity -= size;
 		}
+	}
 
-		size += (size == 0) * 0xFFFF;
-		if (size == zSize) {
-			SISWA_MEMCPY(curOutOffset, &curDataOffset[offset], size);
+	arl->len = fullSize;
+	arl->cap = capacity;
+
+	if (freeCompessedData) {
+		SISWA__FREE(arl->data);
+	}
+
+	arl->data = out;
+	arl->type = SISWA_FILE_REGULAR;
+	arl->validated = SISWA_FALSE;
+}
+void siswa_arlDecompressXComp(siArlFile* arl, siByte* out, size_t capacity, siBool freeCompData) {
+	siXCompHeader* header;
+	uint32_t uncompBlockSize;
+	uint32_t compBlockMax;
+	uint64_t fullSize;
+
+#if 0
+	siByte* curDataOffset;
+	siByte* curOutOffset;
+	size_t baseOffset;
+	siSegsEntry* entry;
+	siSegsEntry* end;
+	size_t leftCapacity;
+#endif
+
+
+	SISWA_ASSERT_NOT_NULL(arl);
+	SISWA_ASSERT_NOT_NULL(out);
+	SISWA_ASSERT_MSG(arl->type == SISWA_FILE_XCOMPRESS, "Wrong compression type.");
+
+	header = (siXCompHeader*)arl->data;
+	uncompBlockSize = SISWA__BE32(header->uncompressedBlockSize);
+	compBlockMax = SISWA__BE32(header->compressedBlockSizeMax);
+	fullSize = SISWA__BE64(header->uncompressedSize);
+	/* Only needed by the block loop below, which isn't implemented yet. */
+	(void)uncompBlockSize;
+	(void)compBlockMax;
+
+	SISWA_ASSERT_MSG(
+		capacity >= fullSize,
+		"Capacity must be equal to or be higher than 'siswa_<ar/arl>GetDecompressedSize()'"
+	);
+#if 0
+	curDataOffset = arl->data;
+#endif
+
+	while (SISWA_TRUE) {
+
+
+#if 0
+		unknown = *(uint8_t*)curDataOffset;
+		curDataOffset += sizeof(uint8_t);
+
+		if (unknown == 0) {
+			break;
+		}
+
+		uncompressedBlockSize = *(uint16_t*)curDataOffset;
+		curDataOffset += 20;
+
+
+		compressedBlockSize = SISWA__BE32(compressedBlockSize);
+		uncompressedBlockSize = SISWA__BE16(uncompressedBlockSize);
+		SISWA_ASSERT_MSG(uncompressedBlockSize == uncompressedBlockSize, "Cannot decompress this XCompressed file.");
+
+		if (uncompressedBlockSize == uncompBlockSize) {
+			SISWA_MEMCPY(out, curDataOffset, uncompressedBlockSize);
 		}
 		else {
-			siswa_decompressDeflate(&curDataOffset[offset], zSize, curOutOffset, leftCapacity);
+			siswa_decompressLZXDelta(data, compressedBlockSize, out, leftCapacity);
+
 		}
 
-		curOutOffset += size + 1;
-		leftCapacity -= size;
+		curDataOffset += compressedBlockSize;
+#endif
 	}
 
 	arl->len = fullSize;
 	arl->cap = capacity;
 
-	if (freeCompessedData) {
-		free(arl->data);
+	if (freeCompData) {
+		SISWA__FREE(arl->data);
+	}
+	arl->data = out;
+	arl->type = SISWA_FILE_REGULAR;
+	arl->validated = SISWA_FALSE;
+}
+
+uint64_t siswa_arlGetDecompressedSize(siArlFile arl) {
+	switch (arl.type) {
+		case SISWA_FILE_REGULAR: return arl.len;
+		case SISWA_FILE_XCOMPRESS: {
+			return SISWA__BE64(((siXCompHeader*)arl.data)->uncompressedSize);
+		}
+		case SISWA_FILE_SEGS: {
+			return SISWA__BE32(((siSegsHeader*)arl.data)->fullSize);
+		}
+		default: SISWA_PANIC();
+	}
+}
+
+#endif
+
+#ifndef SISWA_NO_STDLIB
+void siswa_arlFree(siArlFile arlFile) {
+	SISWA__FREE(arlFile.data);
+}
+#endif
+
+
+#ifdef SISWA_USE_THREADS
+#if defined(_WIN32)
+typedef HANDLE siswa__thread;
+#define SISWA__THREAD_PROC(name) DWORD WINAPI name(LPVOID arg)
+#define SISWA__THREAD_RETURN return 0
+
+static
+siBool siswa__threadCreate(siswa__thread* thread, LPTHREAD_START_ROUTINE proc, void* arg) {
+	*thread = CreateThread(NULL, 0, proc, arg, 0, NULL);
+	return *thread != NULL;
+}
+static
+void siswa__threadJoin(siswa__thread thread) {
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+}
+#else
+typedef pthread_t siswa__thread;
+#define SISWA__THREAD_PROC(name) void* name(void* arg)
+#define SISWA__THREAD_RETURN return NULL
+
+static
+siBool siswa__threadCreate(siswa__thread* thread, void* (*proc)(void*), void* arg) {
+	return pthread_create(thread, NULL, proc, arg) == 0;
+}
+static
+void siswa__threadJoin(siswa__thread thread) {
+	pthread_join(thread, NULL);
+}
+#endif
+#endif
+
+
+#define SISWA__XXH_P1 SISWA__U64(0x9E3779B1, 0x85EBCA87)
+#define SISWA__XXH_P2 SISWA__U64(0xC2B2AE3D, 0x27D4EB4F)
+#define SISWA__XXH_P3 SISWA__U64(0x165667B1, 0x9E3779F9)
+#define SISWA__XXH_P4 SISWA__U64(0x85EBCA77, 0xC2B2AE63)
+#define SISWA__XXH_P5 SISWA__U64(0x27D4EB2F, 0x165667C5)
+#define siswa__rotl64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+#define siswa__rotr32(x, r) (((x) >> (r)) | ((x) << (32 - (r))))
+
+static
+uint64_t siswa__xxhRound(uint64_t acc, uint64_t input) {
+	acc += input * SISWA__XXH_P2;
+	acc = siswa__rotl64(acc, 31);
+	return acc * SISWA__XXH_P1;
+}
+static
+uint64_t siswa__xxhMergeRound(uint64_t acc, uint64_t val) {
+	acc ^= siswa__xxhRound(0, val);
+	return acc * SISWA__XXH_P1 + SISWA__XXH_P4;
+}
+/* Consumes every full 32-byte stripe of the buffer, returns the amount of bytes
+ * that were consumed. */
+static
+size_t siswa__xxhStripes(uint64_t acc[4], const siByte* p, size_t len) {
+	const siByte* start = p;
+	const siByte* end = p + (len & ~(size_t)31);
+	uint64_t v1 = acc[0], v2 = acc[1], v3 = acc[2], v4 = acc[3];
+
+	for (; p < end; p += 32) {
+		v1 = siswa__xxhRound(v1, siswa__read64le(p));
+		v2 = siswa__xxhRound(v2, siswa__read64le(p + 8));
+		v3 = siswa__xxhRound(v3, siswa__read64le(p + 16));
+		v4 = siswa__xxhRound(v4, siswa__read64le(p + 24));
+	}
+	acc[0] = v1;
+	acc[1] = v2;
+	acc[2] = v3;
+	acc[3] = v4;
+
+	return (size_t)(p - start);
+}
+
+void siswa_xxh64Init(siXxh64State* state, uint64_t seed) {
+	SISWA_ASSERT_NOT_NULL(state);
+	state->__acc[0] = seed + SISWA__XXH_P1 + SISWA__XXH_P2;
+	state->__acc[1] = seed + SISWA__XXH_P2;
+	state->__acc[2] = seed;
+	state->__acc[3] = seed - SISWA__XXH_P1;
+	state->__seed = seed;
+	state->__total = 0;
+	state->__bufLen = 0;
+}
+void siswa_xxh64Update(siXxh64State* state, const void* data, size_t len) {
+	const siByte* p = (const siByte*)data;
+	size_t read;
+	SISWA_ASSERT_NOT_NULL(state);
+
+	state->__total += len;
+	if (state->__bufLen != 0) {
+		size_t n = 32 - state->__bufLen;
+		if (n > len) {
+			n = len;
+		}
+		SISWA_MEMCPY(&state->__buf[state->__bufLen], p, n);
+		state->__bufLen += (uint32_t)n;
+		p += n;
+		len -= n;
+
+		if (state->__bufLen != 32) {
+			return;
+		}
+		siswa__xxhStripes(state->__acc, state->__buf, 32);
+		state->__bufLen = 0;
+	}
+
+	read = siswa__xxhStripes(state->__acc, p, len);
+	SISWA_MEMCPY(state->__buf, p + read, len - read);
+	state->__bufLen = (uint32_t)(len - read);
+}
+uint64_t siswa_xxh64Digest(const siXxh64State* state) {
+	const siByte* p = state->__buf;
+	const siByte* end = p + state->__bufLen;
+	uint64_t h;
+
+	if (state->__total >= 32) {
+		const uint64_t* acc = state->__acc;
+		h = siswa__rotl64(acc[0], 1) + siswa__rotl64(acc[1], 7)
+			+ siswa__rotl64(acc[2], 12) + siswa__rotl64(acc[3], 18);
+		h = siswa__xxhMergeRound(h, acc[0]);
+		h = siswa__xxhMergeRound(h, acc[1]);
+		h = siswa__xxhMergeRound(h, acc[2]);
+		h = siswa__xxhMergeRound(h, acc[3]);
+	}
+	else {
+		h = state->__seed + SISWA__XXH_P5;
+	}
+	h += state->__total;
+
+	for (; p + 8 <= end; p += 8) {
+		h ^= siswa__xxhRound(0, siswa__read64le(p));
+		h = siswa__rotl64(h, 27) * SISWA__XXH_P1 + SISWA__XXH_P4;
+	}
+	if (p + 4 <= end) {
+		h ^= siswa__read32le(p) * SISWA__XXH_P1;
+		h = siswa__rotl64(h, 23) * SISWA__XXH_P2 + SISWA__XXH_P3;
+		p += 4;
+	}
+	for (; p < end; p += 1) {
+		h ^= *p * SISWA__XXH_P5;
+		h = siswa__rotl64(h, 11) * SISWA__XXH_P1;
+	}
+
+	h ^= h >> 33;
+	h *= SISWA__XXH_P2;
+	h ^= h >> 29;
+	h *= SISWA__XXH_P3;
+	h ^= h >> 32;
+	return h;
+}
+uint64_t siswa_xxh64(const void* data, size_t len, uint64_t seed) {
+	siXxh64State state;
+	siswa_xxh64Init(&state, seed);
+	siswa_xxh64Update(&state, data, len);
+	return siswa_xxh64Digest(&state);
+}
+
+
+static const uint32_t siswa__sha256K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static
+void siswa__sha256Block(uint32_t h[8], const siByte* p) {
+	uint32_t w[64];
+	uint32_t a, b, c, d, e, f, g, k;
+	size_t i;
+
+	for (i = 0; i < 16; i += 1) {
+		w[i] = ((uint32_t)p[i * 4] << 24) | ((uint32_t)p[i * 4 + 1] << 16)
+			| ((uint32_t)p[i * 4 + 2] << 8) | (uint32_t)p[i * 4 + 3];
+	}
+	for (i = 16; i < 64; i += 1) {
+		uint32_t s0 = siswa__rotr32(w[i - 15], 7) ^ siswa__rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		uint32_t s1 = siswa__rotr32(w[i - 2], 17) ^ siswa__rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	a = h[0]; b = h[1]; c = h[2]; d = h[3];
+	e = h[4]; f = h[5]; g = h[6]; k = h[7];
+	for (i = 0; i < 64; i += 1) {
+		uint32_t s1 = siswa__rotr32(e, 6) ^ siswa__rotr32(e, 11) ^ siswa__rotr32(e, 25);
+		uint32_t t1 = k + s1 + ((e & f) ^ (~e & g)) + siswa__sha256K[i] + w[i];
+		uint32_t s0 = siswa__rotr32(a, 2) ^ siswa__rotr32(a, 13) ^ siswa__rotr32(a, 22);
+		uint32_t t2 = s0 + ((a & b) ^ (a & c) ^ (b & c));
+
+		k = g; g = f; f = e;
+		e = d + t1;
+		d = c; c = b; b = a;
+		a = t1 + t2;
+	}
+	h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+	h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+void siswa_sha256Init(siSha256State* state) {
+	static const uint32_t init[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+	SISWA_ASSERT_NOT_NULL(state);
+	SISWA_MEMCPY(state->__h, init, sizeof(init));
+	state->__total = 0;
+	state->__bufLen = 0;
+}
+void siswa_sha256Update(siSha256State* state, const void* data, size_t len) {
+	const siByte* p = (const siByte*)data;
+	SISWA_ASSERT_NOT_NULL(state);
+
+	state->__total += len;
+	if (state->__bufLen != 0) {
+		size_t n = 64 - state->__bufLen;
+		if (n > len) {
+			n = len;
+		}
+		SISWA_MEMCPY(&state->__buf[state->__bufLen], p, n);
+		state->__bufLen += (uint32_t)n;
+		p += n;
+		len -= n;
+
+		if (state->__bufLen != 64) {
+			return;
+		}
+		siswa__sha256Block(state->__h, state->__buf);
+		state->__bufLen = 0;
+	}
+
+	for (; len >= 64; len -= 64, p += 64) {
+		siswa__sha256Block(state->__h, p);
+	}
+	SISWA_MEMCPY(state->__buf, p, len);
+	state->__bufLen = (uint32_t)len;
+}
+void siswa_sha256Final(siSha256State* state, siByte out[SISWA_SHA256_SIZE]) {
+	uint64_t bits = state->__total * 8;
+	size_t i;
+
+	state->__buf[state->__bufLen] = 0x80;
+	state->__bufLen += 1;
+	if (state->__bufLen > 56) {
+		SISWA_MEMSET(&state->__buf[state->__bufLen], 0, 64 - state->__bufLen);
+		siswa__sha256Block(state->__h, state->__buf);
+		state->__bufLen = 0;
+	}
+	SISWA_MEMSET(&state->__buf[state->__bufLen], 0, 56 - state->__bufLen);
+	for (i = 0; i < 8; i += 1) {
+		state->__buf[56 + i] = (siByte)(bits >> (56 - i * 8));
+	}
+	siswa__sha256Block(state->__h, state->__buf);
+
+	for (i = 0; i < 8; i += 1) {
+		out[i * 4] = (siByte)(state->__h[i] >> 24);
+		out[i * 4 + 1] = (siByte)(state->__h[i] >> 16);
+		out[i * 4 + 2] = (siByte)(state->__h[i] >> 8);
+		out[i * 4 + 3] = (siByte)state->__h[i];
+	}
+}
+
+
+/* Archives with less data than this per thread get hashed on fewer threads. */
+#define SISWA__MANIFEST_MIN_THREAD_BYTES (256 * 1024)
+
+typedef struct {
+	const siByte* base;
+	siManifestEntry* entries;
+	siByte* sha256;
+	/* Indexes of the entries to hash, or NULL for all of them. */
+	const uint32_t* indices;
+	size_t start;
+	size_t end;
+} siswa__manifestJob;
+
+#define SISWA__MANIFEST_INDEX(job, i) (((job)->indices != NULL) ? (job)->indices[i] : (i))
+
+static
+void siswa__manifestHash(siswa__manifestJob* job) {
+	size_t i;
+	for (i = job->start; i < job->end; i += 1) {
+		size_t index = SISWA__MANIFEST_INDEX(job, i);
+		siManifestEntry* m = &job->entries[index];
+		const siByte* data = (const siByte*)siswa_arEntryGetData(
+			(const siArEntry*)&job->base[m->offset]
+		);
+
+		m->hash = siswa_xxh64(data, m->dataSize, 0);
+		if (job->sha256 != NULL) {
+			siSha256State sha;
+			siswa_sha256Init(&sha);
+			siswa_sha256Update(&sha, data, m->dataSize);
+			siswa_sha256Final(&sha, &job->sha256[index * SISWA_SHA256_SIZE]);
+		}
+	}
+}
+
+#ifdef SISWA_USE_THREADS
+static
+SISWA__THREAD_PROC(siswa__manifestThread) {
+	siswa__manifestHash((siswa__manifestJob*)arg);
+	SISWA__THREAD_RETURN;
+}
+#endif
+
+/* Writes the offsets and sizes of the entries into 'out' without hashing them,
+ * with 'totalBytes' getting the size of their data. Returns the entry count. */
+static
+size_t siswa__manifestGather(siArFile arFile, siManifestEntry* out, size_t capacity,
+		size_t* totalBytes) {
+	siArEntry* entry;
+	size_t count = 0;
+
+	*totalBytes = 0;
+	arFile.__curOffset = sizeof(siArHeader);
+	while (siswa_arEntryPoll(&arFile, &entry)) {
+		if (count < capacity) {
+			out[count].hash = 0;
+			out[count].dataSize = SISWA__LE32(entry->dataSize);
+			out[count].offset = (uint32_t)((siByte*)entry - arFile.data);
+			*totalBytes += SISWA__LE32(entry->dataSize);
+		}
+		count += 1;
+	}
+	return count;
+}
+
+/* Hashes the entries of the job, split between up to 'threadCount' threads by
+ * the amount of bytes. */
+static
+void siswa__manifestRun(siswa__manifestJob job, size_t totalBytes, size_t threadCount) {
+#ifdef SISWA_USE_THREADS
+	if (threadCount > totalBytes / SISWA__MANIFEST_MIN_THREAD_BYTES) {
+		threadCount = totalBytes / SISWA__MANIFEST_MIN_THREAD_BYTES;
+	}
+	if (threadCount > 64) {
+		threadCount = 64;
+	}
+
+	if (threadCount > 1) {
+		siswa__thread threads[64];
+		siswa__manifestJob jobs[64];
+		siBool running[64];
+		size_t t, i = 0;
+
+		/* Give every thread an equal amount of bytes, with the calling thread
+		 * taking whatever is left in the end. */
+		for (t = 0; t < threadCount - 1; t += 1) {
+			size_t target = totalBytes / threadCount, bytes = 0;
+
+			jobs[t] = job;
+			jobs[t].start = i;
+			while (i < job.end && bytes < target) {
+				bytes += job.entries[SISWA__MANIFEST_INDEX(&job, i)].dataSize;
+				i += 1;
+			}
+			jobs[t].end = i;
+
+			running[t] = siswa__threadCreate(&threads[t], siswa__manifestThread, &jobs[t]);
+			if (!running[t]) {
+				siswa__manifestHash(&jobs[t]);
+			}
+		}
+		job.start = i;
+		siswa__manifestHash(&job);
+
+		for (t = 0; t < threadCount - 1; t += 1) {
+			if (running[t]) {
+				siswa__threadJoin(threads[t]);
+			}
+		}
+		return;
+	}
+#else
+	(void)threadCount;
+	(void)totalBytes;
+#endif
+
+	siswa__manifestHash(&job);
+}
+
+size_t siswa_arManifest(siArFile arFile, siManifestEntry* out, size_t capacity) {
+	return siswa_arManifestEx(arFile, out, capacity, NULL, 1);
+}
+size_t siswa_arManifestEx(siArFile arFile, siManifestEntry* out, size_t capacity,
+		siByte* sha256Out, size_t threadCount) {
+	siswa__manifestJob job;
+	size_t count, totalBytes;
+
+	SISWA_ASSERT_NOT_NULL(out);
+	SISWA_ASSERT_MSG(arFile.type == SISWA_FILE_REGULAR, "The archive must be decompressed");
+
+	/* Gather the entries first, so that the hashing can be split by bytes. */
+	count = siswa__manifestGather(arFile, out, capacity, &totalBytes);
+
+	job.base = arFile.data;
+	job.entries = out;
+	job.sha256 = sha256Out;
+	job.indices = NULL;
+	job.start = 0;
+	job.end = (count < capacity) ? count : capacity;
+	siswa__manifestRun(job, totalBytes, threadCount);
+	return count;
+}
+
+
+/* Indexes the names of the archive's entries in the table, with 'slots' mapping
+ * every used slot of the table back to the entry's manifest index. */
+static
+void siswa__arNameIndex(siArFile ar, const siManifestEntry* manifest, size_t count,
+		siHashTable* ht, uint32_t* slots) {
+	size_t i;
+	for (i = 0; i < count; i += 1) {
+		const char* name = siswa_arEntryGetName((siArEntry*)&ar.data[manifest[i].offset]);
+		size_t nameLen = SISWA_STRLEN(name);
+		siHashEntry* slot = siswa__hashtableSet(ht, name, nameLen, siswa__hashKey(name, nameLen));
+		slots[slot - ht->entries] = (uint32_t)i;
+	}
+}
+
+/* Used by the patch creation to also get the entries that didn't change. */
+#define SISWA__DIFF_UNCHANGED ((siDiffType)0)
+/* What an entry of 'b' got matched with, if not an index into 'a'. */
+#define SISWA__DIFF_NO_MATCH 0xFFFFFFFF
+#define SISWA__DIFF_REPEATED 0xFFFFFFFE
+
+#ifndef SISWA_NO_STDLIB
+/* Hashes the entries of the manifest listed in 'indices'. */
+static
+void siswa__arDiffHash(siArFile ar, siManifestEntry* manifest, const uint32_t* indices,
+		size_t count, size_t threadCount) {
+	siswa__manifestJob job;
+	size_t totalBytes = 0, i;
+
+	for (i = 0; i < count; i += 1) {
+		totalBytes += manifest[indices[i]].dataSize;
+	}
+	job.base = ar.data;
+	job.entries = manifest;
+	job.sha256 = NULL;
+	job.indices = indices;
+	job.start = 0;
+	job.end = count;
+	siswa__manifestRun(job, totalBytes, threadCount);
+}
+#endif
+
+static
+size_t siswa__arDiff(siArFile a, const siManifestEntry* manifestA, siArFile b,
+		const siManifestEntry* manifestB, siDiffEntry* out, size_t capacity,
+		size_t threadCount, siBool withUnchanged) {
+	size_t countA = siswa_arGetEntryCount(a);
+	size_t countB = siswa_arGetEntryCount(b);
+	size_t htCapacity, memSize, changes = 0, i;
+	siManifestEntry* ownManifests = NULL;
+	siHashTable* ht;
+	uint32_t* slots;
+	uint32_t* matches;
+	siByte* matched;
+	void* memory;
+	char allocator[SISWA_DEFAULT_STACK_SIZE];
+
+	SISWA_ASSERT(out != NULL || capacity == 0);
+
+	if (manifestA == NULL || manifestB == NULL) {
+#ifndef SISWA_NO_STDLIB
+		size_t totalBytes;
+
+		/* Only the offsets and sizes are needed for matching the entries, the
+		 * data only gets hashed once the names and sizes of two entries match. */
+		ownManifests = (siManifestEntry*)SISWA__MALLOC(SISWA_BUDGET_OTHER, (countA + countB + 1) * sizeof(siManifestEntry));
+		SISWA_ASSERT_NOT_NULL(ownManifests);
+		if (manifestA == NULL) {
+			siswa__manifestGather(a, ownManifests, countA, &totalBytes);
+			manifestA = ownManifests;
+		}
+		if (manifestB == NULL) {
+			siswa__manifestGather(b, &ownManifests[countA], countB, &totalBytes);
+			manifestB = &ownManifests[countA];
+		}
+#else
+		SISWA_ASSERT_MSG(SISWA_FALSE, "Both manifests must be given without the C standard library");
+#endif
+	}
+
+	/* The names of 'a' get indexed. */
+	htCapacity = siswa__hashtableCapacity(countA);
+	memSize = sizeof(siHashTable) + htCapacity * (sizeof(siHashEntry) + sizeof(uint32_t))
+		+ countB * sizeof(uint32_t) + countA;
+	memory = allocator;
+	if (memSize > sizeof(allocator)) {
+#ifndef SISWA_NO_STDLIB
+		memory = SISWA__MALLOC(SISWA_BUDGET_INDEXES, memSize);
+		SISWA_ASSERT_NOT_NULL(memory);
+#else
+		SISWA_ASSERT_MSG(memSize <= sizeof(allocator),
+			"Too many entries to diff, increase 'SISWA_DEFAULT_STACK_SIZE'");
+#endif
+	}
+	ht = siswa__hashtableMakeReserve(memory, htCapacity);
+	slots = (uint32_t*)(void*)&ht->entries[htCapacity];
+	matches = &slots[htCapacity];
+	matched = (siByte*)&matches[countB];
+	SISWA_MEMSET(matched, 0, countA);
+	siswa__arNameIndex(a, manifestA, countA, ht, slots);
+
+	/* Every entry of 'b' gets matched with the entry of 'a' with the same name.
+	 * Names repeating in 'b' after that get skipped. */
+	for (i = 0; i < countB; i += 1) {
+		const char* name = siswa_arEntryGetName((siArEntry*)&b.data[manifestB[i].offset]);
+		size_t nameLen = SISWA_STRLEN(name);
+		siHashEntry* slot = siswa__hashtableGet(ht, name, nameLen, siswa__hashKey(name, nameLen));
+
+		matches[i] = SISWA__DIFF_NO_MATCH;
+		if (slot != NULL) {
+			uint32_t index = slots[slot - ht->entries];
+			matches[i] = matched[index] ? SISWA__DIFF_REPEATED : index;
+			matched[index] = SISWA_TRUE;
+		}
+	}
+
+#ifndef SISWA_NO_STDLIB
+	if (ownManifests != NULL) {
+		/* Only matches of the same size need their hashes compared. */
+		uint32_t* pendingA = (uint32_t*)SISWA__MALLOC(SISWA_BUDGET_OTHER, (2 * countB + 1) * sizeof(uint32_t));
+		uint32_t* pendingB = &pendingA[countB];
+		size_t countPendingA = 0, countPendingB = 0;
+
+		SISWA_ASSERT_NOT_NULL(pendingA);
+		for (i = 0; i < countB; i += 1) {
+			uint32_t index = matches[i];
+			if (index >= SISWA__DIFF_REPEATED || manifestA[index].dataSize != manifestB[i].dataSize) {
+				continue;
+			}
+			if (manifestA == ownManifests) {
+				pendingA[countPendingA] = index;
+				countPendingA += 1;
+			}
+			if (manifestB == &ownManifests[countA]) {
+				pendingB[countPendingB] = (uint32_t)i;
+				countPendingB += 1;
+			}
+		}
+		siswa__arDiffHash(a, ownManifests, pendingA, countPendingA, threadCount);
+		siswa__arDiffHash(b, &ownManifests[countA], pendingB, countPendingB, threadCount);
+		SISWA__FREE(pendingA);
+	}
+#else
+	(void)threadCount;
+#endif
+
+	for (i = 0; i < countB; i += 1) {
+		const siManifestEntry* mb = &manifestB[i];
+		siDiffType type = SISWA_DIFF_ADDED;
+		siArEntry* entryA = NULL;
+
+		if (matches[i] == SISWA__DIFF_REPEATED) {
+			continue;
+		}
+		if (matches[i] != SISWA__DIFF_NO_MATCH) {
+			const siManifestEntry* ma = &manifestA[matches[i]];
+			entryA = (siArEntry*)&a.data[ma->offset];
+
+			type = SISWA_DIFF_CHANGED;
+			if (ma->dataSize == mb->dataSize && ma->hash == mb->hash) {
+				if (!withUnchanged) {
+					continue;
+				}
+				type = SISWA__DIFF_UNCHANGED;
+			}
+		}
+
+		if (changes < capacity) {
+			out[changes].type = type;
+			out[changes].a = entryA;
+			out[changes].b = (siArEntry*)&b.data[mb->offset];
+		}
+		changes += 1;
+	}
+
+	for (i = 0; i < countA; i += 1) {
+		if (matched[i]) {
+			continue;
+		}
+		if (changes < capacity) {
+			out[changes].type = SISWA_DIFF_REMOVED;
+			out[changes].a = (siArEntry*)&a.data[manifestA[i].offset];
+			out[changes].b = NULL;
+		}
+		changes += 1;
+	}
+
+#ifndef SISWA_NO_STDLIB
+	if (memory != allocator) {
+		SISWA__FREE(memory);
+	}
+	SISWA__FREE(ownManifests);
+#endif
+
+	return changes;
+}
+
+size_t siswa_arDiff(siArFile a, siArFile b, siDiffEntry* out, size_t capacity) {
+	return siswa__arDiff(a, NULL, b, NULL, out, capacity, 1, SISWA_FALSE);
+}
+size_t siswa_arDiffEx(siArFile a, const siManifestEntry* manifestA, siArFile b,
+		const siManifestEntry* manifestB, siDiffEntry* out, size_t capacity,
+		size_t threadCount) {
+	return siswa__arDiff(a, manifestA, b, manifestB, out, capacity, threadCount, SISWA_FALSE);
+}
+
+
+#ifdef SISWA_USE_SET_INDEX
+#if defined(SISWA__SIMD_AVX2) || defined(SISWA__SIMD_SSE2) || defined(SISWA__SIMD_NEON)
+static
+uint32_t siswa__ctz64(uint64_t n) {
+#ifdef _MSC_VER
+	unsigned long res;
+	if (_BitScanForward(&res, (unsigned long)n)) {
+		return res;
+	}
+	_BitScanForward(&res, (unsigned long)(n >> 32));
+	return res + 32;
+#elif defined(__GNUC__) || defined(__clang__)
+	return (uint32_t)__builtin_ctzll(n);
+#else
+	uint32_t res = 0;
+	while ((n & 1) == 0) {
+		n >>= 1;
+		res += 1;
+	}
+	return res;
+#endif
+}
+#endif
+
+/* Finds the first 'c' in 'p' to 'end', 32 or 16 bytes at a time. Returns 'end'
+ * if there isn't one. */
+static
+const char* siswa__setFind(const char* p, const char* end, char c) {
+#if defined(SISWA__SIMD_AVX2)
+	{
+		__m256i needle = _mm256_set1_epi8(c);
+		while (end - p >= 32) {
+			__m256i x = _mm256_loadu_si256((const __m256i*)(const void*)p);
+			uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, needle));
+			if (mask != 0) {
+				return p + siswa__ctz64(mask);
+			}
+			p += 32;
+		}
+	}
+#endif
+#if defined(SISWA__SIMD_SSE2)
+	{
+		__m128i needle = _mm_set1_epi8(c);
+		while (end - p >= 16) {
+			__m128i x = _mm_loadu_si128((const __m128i*)(const void*)p);
+			uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, needle));
+			if (mask != 0) {
+				return p + siswa__ctz64(mask);
+			}
+			p += 16;
+		}
+	}
+#elif defined(SISWA__SIMD_NEON)
+	{
+		uint8x16_t needle = vdupq_n_u8((uint8_t)c);
+		while (end - p >= 16) {
+			uint8x16_t eq = vceqq_u8(vld1q_u8((const uint8_t*)p), needle);
+			/* NEON has no movemask, so every byte gets narrowed to 4 bits instead. */
+			uint64_t mask = vget_lane_u64(
+				vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0
+			);
+			if (mask != 0) {
+				return p + (siswa__ctz64(mask) >> 2);
+			}
+			p += 16;
+		}
+	}
+#endif
+	while (p < end && *p != c) {
+		p += 1;
+	}
+	return p;
+}
+
+#define SISWA__SET_IS_SPACE(c) ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r')
+
+static
+uint32_t siswa__setParseId(const char* p, const char* end) {
+	uint32_t value = 0;
+
+	while (p < end && SISWA__SET_IS_SPACE(*p)) {
+		p += 1;
+	}
+	while (p < end && *p >= '0' && *p <= '9') {
+		value = value * 10 + (uint32_t)(*p - '0');
+		p += 1;
+	}
+	return value;
+}
+
+/* Parses a number like '-182.87' or '1E-05', which is all that sets have. */
+static
+float siswa__setParseFloat(const char* p, const char* end) {
+	double value = 0, scale = 1;
+	siBool negative = SISWA_FALSE;
+
+	while (p < end && SISWA__SET_IS_SPACE(*p)) {
+		p += 1;
+	}
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = (*p == '-');
+		p += 1;
+	}
+	while (p < end && *p >= '0' && *p <= '9') {
+		value = value * 10 + (*p - '0');
+		p += 1;
+	}
+	if (p < end && *p == '.') {
+		for (p += 1; p < end && *p >= '0' && *p <= '9'; p += 1) {
+			scale /= 10;
+			value += (*p - '0') * scale;
+		}
+	}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		siBool negativeExp = SISWA_FALSE;
+		int exponent = 0;
+
+		p += 1;
+		if (p < end && (*p == '-' || *p == '+')) {
+			negativeExp = (*p == '-');
+			p += 1;
+		}
+		while (p < end && *p >= '0' && *p <= '9' && exponent < 100) {
+			exponent = exponent * 10 + (*p - '0');
+			p += 1;
+		}
+		while (exponent != 0) {
+			value = negativeExp ? value / 10 : value * 10;
+			exponent -= 1;
+		}
+	}
+	return (float)(negative ? -value : value);
+}
+
+size_t siswa_setScan(const void* data, size_t len, siSetObject* out, size_t capacity,
+		siSetRef* refs, size_t refCapacity, size_t* refCount) {
+	const char* start = (const char*)data;
+	const char* end = start + len;
+	const char* p = start;
+	/* Amount of open elements, i.e. 1 inside of 'SetObject' and 2 inside of an
+	 * object. */
+	size_t depth = 0, count = 0, refTotal = 0;
+	siBool inObject = SISWA_FALSE, inPosition = SISWA_FALSE;
+	const char* child = NULL;
+	size_t childLen = 0;
+	siSetObject object;
+
+	SISWA_ASSERT(data != NULL || len == 0);
+	SISWA_ASSERT(out != NULL || capacity == 0);
+	SISWA_ASSERT(refs != NULL || refCapacity == 0);
+	SISWA_MEMSET(&object, 0, sizeof(object));
+
+	while ((p = siswa__setFind(p, end, '<')) < end) {
+		const char* name;
+		size_t nameLen;
+		siBool closing, selfClosing;
+
+		p += 1;
+		if (p == end) {
+			break;
+		}
+		if (*p == '?' || *p == '!') {
+			/* Declarations and comments, where comments only end at '-->'. */
+			if (end - p >= 3 && p[1] == '-' && p[2] == '-') {
+				for (p += 3; ; p += 1) {
+					p = siswa__setFind(p, end, '>');
+					if (p == end || (p[-1] == '-' && p[-2] == '-')) {
+						break;
+					}
+				}
+			}
+			else {
+				p = siswa__setFind(p, end, '>');
+			}
+			continue;
+		}
+
+		closing = (*p == '/');
+		p += closing;
+		name = p;
+		while (p < end && *p != '>' && *p != '/' && !SISWA__SET_IS_SPACE(*p)) {
+			p += 1;
+		}
+		nameLen = (size_t)(p - name);
+		p = siswa__setFind(p, end, '>');
+		if (p == end) {
+			break;
+		}
+		selfClosing = (!closing && p[-1] == '/');
+		p += 1;
+
+		if (closing) {
+			if (depth == 0) {
+				break;
+			}
+			depth -= 1;
+			if (depth == 1 && inObject) {
+				if (count < capacity) {
+					out[count] = object;
+				}
+				count += 1;
+				inObject = SISWA_FALSE;
+			}
+			else if (depth == 2) {
+				child = NULL;
+				inPosition = SISWA_FALSE;
+			}
+			continue;
+		}
+
+		if (depth == 0) {
+			if (nameLen != 9 || !siswa__nameEquals(name, "SetObject", 9)) {
+				break;
+			}
+		}
+		else if (depth == 1) {
+			/* 'LayerDefine' holds the settings of the set itself. */
+			if (nameLen != 11 || !siswa__nameEquals(name, "LayerDefine", 11)) {
+				SISWA_MEMSET(&object, 0, sizeof(object));
+				object.type = name;
+				object.typeLen = (uint32_t)nameLen;
+				object.firstRef = (uint32_t)refTotal;
+				object.offset = (uint32_t)(name - 1 - start);
+				inObject = !selfClosing;
+
+				if (selfClosing) {
+					if (count < capacity) {
+						out[count] = object;
+					}
+					count += 1;
+				}
+			}
+		}
+		else if (inObject) {
+			if (depth == 2) {
+				child = name;
+				childLen = nameLen;
+				inPosition = (nameLen == 8 && siswa__nameEquals(name, "Position", 8));
+			}
+
+			if (selfClosing) {
+				/* Empty, like most of the unused target lists. */
+			}
+			else if (nameLen == 11 && siswa__nameEquals(name, "SetObjectID", 11)) {
+				uint32_t id = siswa__setParseId(p, end);
+
+				if (depth == 2) {
+					object.id = id;
+				}
+				else {
+					if (refTotal < refCapacity) {
+						refs[refTotal].list = child;
+						refs[refTotal].listLen = (uint32_t)childLen;
+						refs[refTotal].id = id;
+						refs[refTotal].object = (uint32_t)count;
+					}
+					refTotal += 1;
+					object.refCount += 1;
+				}
+			}
+			else if (inPosition && depth == 3 && nameLen == 1 && *name >= 'x' && *name <= 'z') {
+				object.position[*name - 'x'] = siswa__setParseFloat(p, end);
+				object.hasPosition = SISWA_TRUE;
+			}
+		}
+
+		depth += !selfClosing;
+	}
+
+	if (refCount != NULL) {
+		*refCount = refTotal;
+	}
+	return count;
+}
+
+
+#ifndef SISWA_NO_STDLIB
+/* Sets with less data than this per thread get scanned on fewer threads. */
+#define SISWA__SET_MIN_THREAD_BYTES (256 * 1024)
+
+typedef struct {
+	uint32_t archive;
+	const siArEntry* entry;
+} siswa__setItem;
+
+typedef struct {
+	const siswa__setItem* items;
+	size_t start;
+	size_t end;
+
+	/* Every job collects its objects separately, which get merged in the end. */
+	siSetObject* objects;
+	size_t objectCount;
+	size_t objectCap;
+	siSetRef* refs;
+	size_t refCount;
+	size_t refCap;
+} siswa__setJob;
+
+static
+void siswa__setScanJob(siswa__setJob* job) {
+	size_t i;
+
+	for (i = job->start; i < job->end; i += 1) {
+		const siswa__setItem* item = &job->items[i];
+		const void* data = siswa_arEntryGetData(item->entry);
+		size_t len = SISWA__LE32(item->entry->dataSize);
+
+		for (;;) {
+			size_t objectRoom = job->objectCap - job->objectCount;
+			size_t refRoom = job->refCap - job->refCount;
+			size_t count, refCount, k;
+
+			count = siswa_setScan(
+				data, len, &job->objects[job->objectCount], objectRoom,
+				&job->refs[job->refCount], refRoom, &refCount
+			);
+
+			if (count <= objectRoom && refCount <= refRoom) {
+				for (k = job->objectCount; k < job->objectCount + count; k += 1) {
+					job->objects[k].firstRef += (uint32_t)job->refCount;
+					job->objects[k].archive = item->archive;
+					job->objects[k].entry = item->entry;
+				}
+				for (k = job->refCount; k < job->refCount + refCount; k += 1) {
+					job->refs[k].object += (uint32_t)job->objectCount;
+				}
+				job->objectCount += count;
+				job->refCount += refCount;
+				break;
+			}
+
+			/* Didn't fit, so the set gets scanned again with enough room. */
+			if (job->objectCap < job->objectCount + count) {
+				job->objectCap = (job->objectCap * 2 > job->objectCount + count)
+					? job->objectCap * 2
+					: job->objectCount + count;
+				job->objects = (siSetObject*)SISWA__REALLOC(SISWA_BUDGET_INDEXES,
+					job->objects, job->objectCap * sizeof(siSetObject));
+				SISWA_ASSERT_NOT_NULL(job->objects);
+			}
+			if (job->refCap < job->refCount + refCount) {
+				job->refCap = (job->refCap * 2 > job->refCount + refCount)
+					? job->refCap * 2
+					: job->refCount + refCount;
+				job->refs = (siSetRef*)SISWA__REALLOC(SISWA_BUDGET_INDEXES,
+					job->refs, job->refCap * sizeof(siSetRef));
+				SISWA_ASSERT_NOT_NULL(job->refs);
+			}
+		}
+	}
+}
+
+#ifdef SISWA_USE_THREADS
+static
+SISWA__THREAD_PROC(siswa__setThread) {
+	siswa__setScanJob((siswa__setJob*)arg);
+	SISWA__THREAD_RETURN;
+}
+#endif
+
+/* Sorts the indices by their keys a byte at a time (LSD radix sort), which keeps
+ * the objects with the same key in order. Bytes that are the same for every key
+ * get skipped. */
+static
+void siswa__setSort(uint32_t* indices, uint32_t* keys, size_t count) {
+	uint32_t* tmp;
+	uint32_t* from[2];
+	uint32_t* to[2];
+	uint32_t shift;
+
+	if (count < 2) {
+		return;
+	}
+	tmp = (uint32_t*)SISWA__MALLOC(SISWA_BUDGET_INDEXES, count * 2 * sizeof(uint32_t));
+	SISWA_ASSERT_NOT_NULL(tmp);
+	from[0] = indices; from[1] = keys;
+	to[0] = tmp; to[1] = tmp + count;
+
+	for (shift = 0; shift < 32; shift += 8) {
+		size_t buckets[256];
+		size_t i, sum = 0;
+		uint32_t* swap;
+
+		SISWA_MEMSET(buckets, 0, sizeof(buckets));
+		for (i = 0; i < count; i += 1) {
+			buckets[(from[1][i] >> shift) & 0xFF] += 1;
+		}
+		if (buckets[(from[1][0] >> shift) & 0xFF] == count) {
+			continue;
+		}
+		for (i = 0; i < 256; i += 1) {
+			size_t n = buckets[i];
+			buckets[i] = sum;
+			sum += n;
+		}
+		for (i = 0; i < count; i += 1) {
+			size_t dst = buckets[(from[1][i] >> shift) & 0xFF]++;
+			to[0][dst] = from[0][i];
+			to[1][dst] = from[1][i];
+		}
+
+		swap = from[0]; from[0] = to[0]; to[0] = swap;
+		swap = from[1]; from[1] = to[1]; to[1] = swap;
+	}
+
+	if (from[0] != indices) {
+		SISWA_MEMCPY(indices, from[0], count * sizeof(uint32_t));
+	}
+	SISWA__FREE(tmp);
+}
+
+/* Returns the ID of 'items[i]', which is 'idOffset' bytes into the item. */
+static
+uint32_t siswa__setId(const void* items, size_t stride, size_t idOffset, uint32_t i) {
+	uint32_t id;
+	SISWA_MEMCPY(&id, (const siByte*)items + (size_t)i * stride + idOffset, sizeof(id));
+	return id;
+}
+
+/* Returns a new array of the indices sorted by their IDs. */
+static
+uint32_t* siswa__setSortedIds(const void* items, size_t stride, size_t idOffset,
+		size_t count) {
+	uint32_t* indices = (uint32_t*)SISWA__MALLOC(SISWA_BUDGET_INDEXES,
+		(count != 0 ? count : 1) * 2 * sizeof(uint32_t));
+	uint32_t* keys = indices + count;
+	size_t i;
+
+	SISWA_ASSERT_NOT_NULL(indices);
+	for (i = 0; i < count; i += 1) {
+		indices[i] = (uint32_t)i;
+		keys[i] = siswa__setId(items, stride, idOffset, (uint32_t)i);
+	}
+	siswa__setSort(indices, keys, count);
+
+	/* Only the indices are kept, the IDs get looked up through them. */
+	return (uint32_t*)SISWA__REALLOC(SISWA_BUDGET_INDEXES, indices,
+		(count != 0 ? count : 1) * sizeof(uint32_t));
+}
+
+/* Finds the range of 'sorted' that has the ID. */
+static
+size_t siswa__setFindRange(const uint32_t* sorted, size_t count, const void* items,
+		size_t stride, size_t idOffset, uint32_t id, const uint32_t** out) {
+	size_t low = 0, high = count, first;
+
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		if (siswa__setId(items, stride, idOffset, sorted[mid]) < id) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+	first = low;
+	high = count;
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		if (siswa__setId(items, stride, idOffset, sorted[mid]) <= id) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+
+	if (out != NULL) {
+		*out = &sorted[first];
+	}
+	return low - first;
+}
+
+void siswa_setIndexBuild(siSetIndex* index, const siArFile* ars, size_t count,
+		size_t threadCount) {
+	siswa__setItem* items = NULL;
+	siswa__setJob jobs[64];
+	siHashTable* ht;
+	size_t itemCount = 0, itemCap = 0, jobCount = 1, capacity, i, t;
+	uint32_t* starts;
+	uint32_t* ends;
+	uint32_t sum;
+
+	SISWA_ASSERT_NOT_NULL(index);
+	SISWA_ASSERT(ars != NULL || count == 0);
+	SISWA_MEMSET(index, 0, sizeof(*index));
+
+	/* Gather the sets first, so that the scanning can be split by bytes. */
+	for (i = 0; i < count; i += 1) {
+		siArFile ar = ars[i];
+		siArEntry* entry;
+
+		SISWA_ASSERT_MSG(ar.type == SISWA_FILE_REGULAR, "The archive must be decompressed");
+		ar.__curOffset = sizeof(siArHeader);
+		while (siswa_arEntryPoll(&ar, &entry)) {
+			const char* name = siswa_arEntryGetName(entry);
+			size_t nameLen = SISWA_STRLEN(name);
+
+			if (nameLen < 8 || !siswa__nameEquals(&name[nameLen - 8], ".set.xml", 8)) {
+				continue;
+			}
+			if (itemCount == itemCap) {
+				itemCap = (itemCap != 0) ? itemCap * 2 : 64;
+				items = (siswa__setItem*)SISWA__REALLOC(SISWA_BUDGET_INDEXES, items,
+					itemCap * sizeof(siswa__setItem));
+				SISWA_ASSERT_NOT_NULL(items);
+			}
+			items[itemCount].archive = (uint32_t)i;
+			items[itemCount].entry = entry;
+			itemCount += 1;
+			index->bytes += SISWA__LE32(entry->dataSize);
+		}
+	}
+	index->sets = itemCount;
+
+#ifdef SISWA_USE_THREADS
+	if (threadCount > index->bytes / SISWA__SET_MIN_THREAD_BYTES) {
+		threadCount = index->bytes / SISWA__SET_MIN_THREAD_BYTES;
+	}
+	if (threadCount > 64) {
+		threadCount = 64;
+	}
+	jobCount = (threadCount > 1) ? threadCount : 1;
+#else
+	(void)threadCount;
+#endif
+
+	/* Give every job an equal amount of bytes, with the last one taking whatever
+	 * is left. Sets rarely have more than an object or a reference every 256
+	 * bytes, so most never have to be scanned twice. */
+	for (t = 0, i = 0; t < jobCount; t += 1) {
+		size_t target = index->bytes / jobCount, bytes = 0;
+		siswa__setJob* job = &jobs[t];
+
+		job->items = items;
+		job->start = i;
+		while (i < itemCount && (bytes < target || t == jobCount - 1)) {
+			bytes += SISWA__LE32(items[i].entry->dataSize);
+			i += 1;
+		}
+		job->end = i;
+
+		job->objectCount = job->refCount = 0;
+		job->objectCap = bytes / 256 + 16;
+		job->refCap = bytes / 256 + 16;
+		job->objects = (siSetObject*)SISWA__MALLOC(SISWA_BUDGET_INDEXES,
+			job->objectCap * sizeof(siSetObject));
+		job->refs = (siSetRef*)SISWA__MALLOC(SISWA_BUDGET_INDEXES,
+			job->refCap * sizeof(siSetRef));
+		SISWA_ASSERT_NOT_NULL(job->objects);
+		SISWA_ASSERT_NOT_NULL(job->refs);
+	}
+
+#ifdef SISWA_USE_THREADS
+	if (jobCount > 1) {
+		siswa__thread threads[64];
+		siBool running[64];
+
+		for (t = 0; t < jobCount - 1; t += 1) {
+			running[t] = siswa__threadCreate(&threads[t], siswa__setThread, &jobs[t]);
+			if (!running[t]) {
+				siswa__setScanJob(&jobs[t]);
+			}
+		}
+		siswa__setScanJob(&jobs[jobCount - 1]);
+
+		for (t = 0; t < jobCount - 1; t += 1) {
+			if (running[t]) {
+				siswa__threadJoin(threads[t]);
+			}
+		}
+	}
+	else
+#endif
+	{
+		siswa__setScanJob(&jobs[0]);
+	}
+
+	/* Merge the jobs in order, so that the index is the same on any amount of
+	 * threads. */
+	for (t = 0; t < jobCount; t += 1) {
+		index->objectCount += jobs[t].objectCount;
+		index->refCount += jobs[t].refCount;
+	}
+	index->objects = (siSetObject*)SISWA__MALLOC(SISWA_BUDGET_INDEXES,
+		(index->objectCount != 0 ? index->objectCount : 1) * sizeof(siSetObject));
+	index->refs = (siSetRef*)SISWA__MALLOC(SISWA_BUDGET_INDEXES,
+		(index->refCount != 0 ? index->refCount : 1) * sizeof(siSetRef));
+	SISWA_ASSERT_NOT_NULL(index->objects);
+	SISWA_ASSERT_NOT_NULL(index->refs);
+
+	{
+		size_t objectBase = 0, refBase = 0;
+
+		for (t = 0; t < jobCount; t += 1) {
+			siswa__setJob* job = &jobs[t];
+
+			for (i = 0; i < job->objectCount; i += 1) {
+				siSetObject* object = &index->objects[objectBase + i];
+				*object = job->objects[i];
+				object->firstRef += (uint32_t)refBase;
+			}
+			for (i = 0; i < job->refCount; i += 1) {
+				siSetRef* ref = &index->refs[refBase + i];
+				*ref = job->refs[i];
+				ref->object += (uint32_t)objectBase;
+			}
+			objectBase += job->objectCount;
+			refBase += job->refCount;
+
+			SISWA__FREE(job->objects);
+			SISWA__FREE(job->refs);
+		}
+	}
+	SISWA__FREE(items);
+
+	index->__byId = siswa__setSortedIds(index->objects, sizeof(siSetObject),
+		offsetof(siSetObject, id), index->objectCount);
+	index->__refsById = siswa__setSortedIds(index->refs, sizeof(siSetRef),
+		offsetof(siSetRef, id), index->refCount);
+
+	/* Every type gets a slot in the table, whose objects are a range of the
+	 * objects grouped by their type. */
+	capacity = siswa__hashtableCapacity(index->objectCount);
+	index->__types = SISWA__MALLOC(SISWA_BUDGET_INDEXES,
+		sizeof(siHashTable) + capacity * sizeof(siHashEntry));
+	index->__typeRanges = (uint32_t*)SISWA__MALLOC(SISWA_BUDGET_INDEXES,
+		capacity * 2 * sizeof(uint32_t));
+	index->__byType = (uint32_t*)SISWA__MALLOC(SISWA_BUDGET_INDEXES,
+		(index->objectCount != 0 ? index->objectCount : 1) * sizeof(uint32_t));
+	SISWA_ASSERT_NOT_NULL(index->__types);
+	SISWA_ASSERT_NOT_NULL(index->__typeRanges);
+	SISWA_ASSERT_NOT_NULL(index->__byType);
+
+	ht = siswa__hashtableMakeReserve(index->__types, capacity);
+	starts = index->__typeRanges;
+	ends = index->__typeRanges + capacity;
+	SISWA_MEMSET(ends, 0, capacity * sizeof(uint32_t));
+
+	for (i = 0; i < index->objectCount; i += 1) {
+		const siSetObject* object = &index->objects[i];
+		uint64_t hash = siswa__hashKey(object->type, object->typeLen);
+		siHashEntry* slot = siswa__hashtableGet(ht, object->type, object->typeLen, hash);
+
+		if (slot == NULL) {
+			slot = siswa__hashtableSet(ht, object->type, object->typeLen, hash);
+		}
+		ends[slot - ht->entries] += 1;
+	}
+	for (i = 0, sum = 0; i < capacity; i += 1) {
+		starts[i] = sum;
+		sum += ends[i];
+		ends[i] = starts[i];
+	}
+	/* The ends count up from the starts while the objects get placed. */
+	for (i = 0; i < index->objectCount; i += 1) {
+		const siSetObject* object = &index->objects[i];
+		siHashEntry* slot = siswa__hashtableGet(ht, object->type, object->typeLen,
+			siswa__hashKey(object->type, object->typeLen));
+		index->__byType[ends[slot - ht->entries]++] = (uint32_t)i;
+	}
+}
+
+void siswa_setIndexFree(siSetIndex* index) {
+	SISWA_ASSERT_NOT_NULL(index);
+
+	SISWA__FREE(index->objects);
+	SISWA__FREE(index->refs);
+	SISWA__FREE(index->__byId);
+	SISWA__FREE(index->__refsById);
+	SISWA__FREE(index->__byType);
+	SISWA__FREE(index->__typeRanges);
+	SISWA__FREE(index->__types);
+	SISWA_MEMSET(index, 0, sizeof(*index));
+}
+
+size_t siswa_setIndexFindId(const siSetIndex* index, uint32_t id, const uint32_t** out) {
+	SISWA_ASSERT_NOT_NULL(index);
+	return siswa__setFindRange(index->__byId, index->objectCount, index->objects,
+		sizeof(siSetObject), offsetof(siSetObject, id), id, out);
+}
+
+size_t siswa_setIndexFindType(const siSetIndex* index, const char* type, const uint32_t** out) {
+	siHashTable* ht;
+	siHashEntry* slot;
+	size_t typeLen, s;
+
+	SISWA_ASSERT_NOT_NULL(index);
+	SISWA_ASSERT_NOT_NULL(type);
+
+	ht = (siHashTable*)index->__types;
+	typeLen = SISWA_STRLEN(type);
+	slot = siswa__hashtableGet(ht, type, typeLen, siswa__hashKey(type, typeLen));
+	if (slot == NULL) {
+		if (out != NULL) {
+			*out = index->__byType;
+		}
+		return 0;
+	}
+
+	s = (size_t)(slot - ht->entries);
+	if (out != NULL) {
+		*out = &index->__byType[index->__typeRanges[s]];
+	}
+	return index->__typeRanges[ht->capacity + s] - index->__typeRanges[s];
+}
+
+size_t siswa_setIndexFindRefs(const siSetIndex* index, uint32_t id, const uint32_t** out) {
+	SISWA_ASSERT_NOT_NULL(index);
+	return siswa__setFindRange(index->__refsById, index->refCount, index->refs,
+		sizeof(siSetRef), offsetof(siSetRef, id), id, out);
+}
+#endif
+#endif
+
+
+size_t siswa_memoryWrite(void* user, const void* data, size_t len) {
+	siMemoryStream* stream = (siMemoryStream*)user;
+	if (len > stream->cap - stream->len) {
+		len = stream->cap - stream->len;
+	}
+	SISWA_MEMCPY(&stream->data[stream->len], data, len);
+	stream->len += len;
+	return len;
+}
+size_t siswa_memoryRead(void* user, void* out, size_t len) {
+	siMemoryStream* stream = (siMemoryStream*)user;
+	if (len > stream->len - stream->pos) {
+		len = stream->len - stream->pos;
+	}
+	SISWA_MEMCPY(out, &stream->data[stream->pos], len);
+	stream->pos += len;
+	return len;
+}
+#ifndef SISWA_NO_STDLIB
+size_t siswa_fileWrite(void* user, const void* data, size_t len) {
+	return fwrite(data, 1, len, (FILE*)user);
+}
+size_t siswa_fileRead(void* user, void* out, size_t len) {
+	return fread(out, 1, len, (FILE*)user);
+}
+#endif
+
+#if defined(SISWA_USE_DIRECT_IO) && !defined(SISWA_NO_STDLIB) && !defined(_WIN32)
+/* O_DIRECT requires the buffers, offsets and sizes to be aligned to the logical
+ * block size of the device, which is never above a page. */
+#define SISWA__DIRECT_ALIGN 4096
+
+typedef struct {
+	int fd;
+	siBool direct;
+	siByte* memory;
+	siByte* blocks[2];
+	size_t blockSize;
+	/* Length of each block, and the block and position being read from. */
+	size_t lens[2];
+	uint32_t cur;
+	size_t pos;
+	/* File offset of the next block. */
+	uint64_t offset;
+	/* Set once a block came up short, i.e. there's nothing left after it. */
+	siBool end;
+	siBool failed;
+#ifdef SISWA_USE_THREADS
+	/* Whether the other block is being read by 'thread'. */
+	siBool pending;
+	siswa__thread thread;
+#endif
+} siswa__directState;
+
+/* Reads the next block of the file into the block that isn't being read from. */
+static
+void siswa__directFill(siswa__directState* s) {
+	siByte* block = s->blocks[s->cur ^ 1];
+	size_t got = 0;
+
+	while (got < s->blockSize) {
+		ssize_t res = read(s->fd, block + got, s->blockSize - got);
+		if (res <= 0) {
+			s->failed |= (res < 0);
+			break;
+		}
+		got += (size_t)res;
+
+		/* A short read only happens at the end of the file, after which the file
+		 * offset isn't aligned anymore for another O_DIRECT read. */
+		if (s->direct && got % SISWA__DIRECT_ALIGN != 0) {
+			break;
+		}
+	}
+
+#ifdef POSIX_FADV_DONTNEED
+	if (!s->direct && got != 0) {
+		posix_fadvise(s->fd, (off_t)s->offset, (off_t)got, POSIX_FADV_DONTNEED);
+	}
+#endif
+	s->offset += got;
+	s->lens[s->cur ^ 1] = got;
+	s->end = (got < s->blockSize);
+}
+
+#ifdef SISWA_USE_THREADS
+static
+SISWA__THREAD_PROC(siswa__directFillProc) {
+	siswa__directFill((siswa__directState*)arg);
+	SISWA__THREAD_RETURN;
+}
+#endif
+
+/* Starts reading the next block, on another thread if possible. */
+static
+void siswa__directStart(siswa__directState* s) {
+	if (s->end) {
+		s->lens[s->cur ^ 1] = 0;
+		return;
+	}
+#ifdef SISWA_USE_THREADS
+	s->pending = siswa__threadCreate(&s->thread, siswa__directFillProc, s);
+	if (s->pending) {
+		return;
+	}
+#endif
+	siswa__directFill(s);
+}
+
+/* Waits for the next block and starts reading from it. */
+static
+void siswa__directSwap(siswa__directState* s) {
+#ifdef SISWA_USE_THREADS
+	if (s->pending) {
+		siswa__threadJoin(s->thread);
+		s->pending = SISWA_FALSE;
+	}
+#endif
+	s->cur ^= 1;
+	s->pos = 0;
+}
+
+siBool siswa_directReaderOpen(siDirectReader* reader, const char* path, size_t blockSize) {
+	siswa__directState* s;
+	struct stat st;
+	int fd = -1;
+	siBool direct = SISWA_FALSE;
+
+	SISWA_ASSERT_NOT_NULL(reader);
+	SISWA_ASSERT_NOT_NULL(path);
+
+#ifdef O_DIRECT
+	fd = open(path, O_RDONLY | O_DIRECT);
+	direct = (fd != -1);
+#endif
+	if (fd == -1) {
+		fd = open(path, O_RDONLY);
+		if (fd == -1) {
+			return SISWA_FALSE;
+		}
+#ifdef F_NOCACHE
+		direct = (fcntl(fd, F_NOCACHE, 1) != -1);
+#endif
+	}
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return SISWA_FALSE;
+	}
+#ifdef POSIX_FADV_SEQUENTIAL
+	if (!direct) {
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	}
+#endif
+
+	blockSize = (blockSize == 0) ? 0x100000 : blockSize;
+	blockSize = (blockSize + SISWA__DIRECT_ALIGN - 1) / SISWA__DIRECT_ALIGN * SISWA__DIRECT_ALIGN;
+
+	s = (siswa__directState*)SISWA__MALLOC(SISWA_BUDGET_OTHER, sizeof(siswa__directState));
+	SISWA_ASSERT_NOT_NULL(s);
+	s->memory = (siByte*)SISWA__MALLOC(SISWA_BUDGET_OTHER, blockSize * 2 + SISWA__DIRECT_ALIGN);
+	SISWA_ASSERT_NOT_NULL(s->memory);
+
+	s->fd = fd;
+	s->direct = direct;
+	s->blocks[0] = s->memory + siswa__alignPadding((size_t)s->memory, SISWA__DIRECT_ALIGN);
+	s->blocks[1] = s->blocks[0] + blockSize;
+	s->blockSize = blockSize;
+	s->offset = 0;
+	s->end = SISWA_FALSE;
+	s->failed = SISWA_FALSE;
+#ifdef SISWA_USE_THREADS
+	s->pending = SISWA_FALSE;
+#endif
+
+	/* The first block gets read right away, and the second one starts being
+	 * read in the background. */
+	s->cur = 1;
+	siswa__directFill(s);
+	siswa__directSwap(s);
+	siswa__directStart(s);
+
+	reader->size = (uint64_t)st.st_size;
+	reader->direct = direct;
+	reader->failed = s->failed;
+	reader->__state = s;
+	return SISWA_TRUE;
+}
+
+size_t siswa_directRead(void* user, void* out, size_t len) {
+	siDirectReader* reader = (siDirectReader*)user;
+	siswa__directState* s = (siswa__directState*)reader->__state;
+	siByte* dst = (siByte*)out;
+	size_t total = 0;
+
+	SISWA_ASSERT_NOT_NULL(s);
+
+	while (total < len) {
+		size_t left = s->lens[s->cur] - s->pos;
+		size_t copy = (len - total < left) ? len - total : left;
+
+		if (left == 0) {
+			/* A short block was the last one. */
+			if (s->lens[s->cur] < s->blockSize) {
+				break;
+			}
+			siswa__directSwap(s);
+			siswa__directStart(s);
+			continue;
+		}
+
+		SISWA_MEMCPY(dst + total, s->blocks[s->cur] + s->pos, copy);
+		s->pos += copy;
+		total += copy;
+	}
+
+#ifdef SISWA_USE_THREADS
+	/* Only read once the thread is done with it. */
+	if (!s->pending) {
+		reader->failed = s->failed;
+	}
+#else
+	reader->failed = s->failed;
+#endif
+	return total;
+}
+
+void siswa_directReaderClose(siDirectReader* reader) {
+	siswa__directState* s;
+
+	SISWA_ASSERT_NOT_NULL(reader);
+	s = (siswa__directState*)reader->__state;
+	if (s == NULL) {
+		return;
+	}
+
+#ifdef SISWA_USE_THREADS
+	if (s->pending) {
+		siswa__threadJoin(s->thread);
+	}
+#endif
+	reader->failed = s->failed;
+	close(s->fd);
+	SISWA__FREE(s->memory);
+	SISWA__FREE(s);
+	reader->__state = NULL;
+}
+
+siArFile siswa_arMakeDirect(const char* path) {
+	siDirectReader reader;
+	siArFile ar;
+	siByte* data;
+	size_t len;
+
+	SISWA_ASSERT_NOT_NULL(path);
+
+	if (!siswa_directReaderOpen(&reader, path, 0)) {
+		SISWA_MEMSET(&ar, 0, sizeof(ar));
+		ar.type = SISWA_FILE_INVALID;
+		return ar;
+	}
+
+	len = (size_t)reader.size;
+	data = (siByte*)SISWA__MALLOC(SISWA_BUDGET_ARCHIVES, len != 0 ? len : 1);
+	SISWA_ASSERT_NOT_NULL(data);
+
+	len = siswa_directRead(&reader, data, len);
+	siswa_directReaderClose(&reader);
+	if (reader.failed || len != reader.size || len < sizeof(uint32_t)) {
+		SISWA__FREE(data);
+		SISWA_MEMSET(&ar, 0, sizeof(ar));
+		ar.type = SISWA_FILE_INVALID;
+		return ar;
+	}
+
+	return siswa_arMakeBuffer(data, len);
+}
+#endif
+
+#ifdef SISWA_USE_MMAP
+#if defined(_WIN32)
+/* Same as 'siswa_arMap', except that it returns 'SISWA_FALSE' instead of asserting
+ * if the file can't be opened or mapped (e.g. it got deleted or emptied). */
+static
+siBool siswa__arMapFile(const char* path, siArFile* out) {
+	HANDLE file, mapping;
+	LARGE_INTEGER size;
+	void* data = NULL;
+
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return SISWA_FALSE;
+	}
+
+	/* The view keeps the mapping and the file alive after their handles are closed. */
+	if (GetFileSizeEx(file, &size) && size.QuadPart != 0) {
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping != NULL) {
+			data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+	if (data == NULL) {
+		return SISWA_FALSE;
+	}
+
+	*out = siswa_arMakeBuffer(data, (size_t)size.QuadPart);
+	return SISWA_TRUE;
+}
+void siswa_arUnmap(siArFile arFile) {
+	UnmapViewOfFile(arFile.data);
+}
+
+static
+size_t siswa__pageSize(void) {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwPageSize;
+}
+static
+siBool siswa__advise(siByte* start, size_t len, siAdvice advice) {
+	if (advice == SISWA_ADVISE_WILLNEED) {
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+		WIN32_MEMORY_RANGE_ENTRY range;
+		range.VirtualAddress = start;
+		range.NumberOfBytes = len;
+		return PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0) != 0;
+#else
+		return SISWA_FALSE;
+#endif
+	}
+	/* Unlocking pages that aren't locked fails, but still removes them from the
+	 * working set. */
+	VirtualUnlock(start, len);
+	return SISWA_TRUE;
+}
+#else
+/* Same as 'siswa_arMap', except that it returns 'SISWA_FALSE' instead of asserting
+ * if the file can't be opened or mapped (e.g. it got deleted or emptied). */
+static
+siBool siswa__arMapFile(const char* path, siArFile* out) {
+	struct stat st;
+	void* data = MAP_FAILED;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		return SISWA_FALSE;
+	}
+
+	/* The mapping keeps the file alive after the descriptor is closed. */
+	if (fstat(fd, &st) == 0 && st.st_size != 0) {
+		data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+	if (data == MAP_FAILED) {
+		return SISWA_FALSE;
+	}
+
+	*out = siswa_arMakeBuffer(data, (size_t)st.st_size);
+	return SISWA_TRUE;
+}
+void siswa_arUnmap(siArFile arFile) {
+	munmap(arFile.data, arFile.len);
+}
+
+static
+size_t siswa__pageSize(void) {
+	return (size_t)sysconf(_SC_PAGESIZE);
+}
+static
+siBool siswa__advise(siByte* start, size_t len, siAdvice advice) {
+#ifdef MADV_WILLNEED
+	return madvise(
+		start, len, (advice == SISWA_ADVISE_WILLNEED) ? MADV_WILLNEED : MADV_DONTNEED
+	) == 0;
+#else
+	/* 'madvise' is hidden by the C library (e.g. glibc with a strict '-std='). */
+	(void)start; (void)len; (void)advice;
+	return SISWA_FALSE;
+#endif
+}
+#endif
+
+siArFile siswa_arMap(const char* path) {
+	siArFile ar;
+	siBool res;
+
+	SISWA_ASSERT_NOT_NULL(path);
+	res = siswa__arMapFile(path, &ar);
+	SISWA_ASSERT_MSG(res, "Couldn't map the file");
+	(void)res;
+	return ar;
+}
+
+siBool siswa_arAdvise(siArFile arFile, size_t offset, size_t len, siAdvice advice) {
+	size_t page = siswa__pageSize();
+	size_t start, end;
+
+	SISWA_ASSERT_MSG(offset + len <= arFile.len, "The range is outside of the archive");
+
+	/* The mapping itself starts on a page, so file offsets and page boundaries
+	 * line up. */
+	if (advice == SISWA_ADVISE_WILLNEED) {
+		start = offset / page * page;
+		end = (offset + len + page - 1) / page * page;
+	}
+	else {
+		start = (offset + page - 1) / page * page;
+		end = (offset + len == arFile.len)
+			? (offset + len + page - 1) / page * page
+			: (offset + len) / page * page;
+	}
+
+	if (end <= start) {
+		return SISWA_TRUE;
+	}
+	return siswa__advise(arFile.data + start, end - start, advice);
+}
+siBool siswa_arEntryPrefetch(siArFile arFile, const siArEntry* entry) {
+	SISWA_ASSERT_NOT_NULL(entry);
+	return siswa_arAdvise(
+		arFile, (size_t)((const siByte*)entry - arFile.data), SISWA__LE32(entry->size),
+		SISWA_ADVISE_WILLNEED
+	);
+}
+siBool siswa_arEntryRelease(siArFile arFile, const siArEntry* entry) {
+	SISWA_ASSERT_NOT_NULL(entry);
+	return siswa_arAdvise(
+		arFile, (size_t)((const siByte*)entry - arFile.data), SISWA__LE32(entry->size),
+		SISWA_ADVISE_DONTNEED
+	);
+}
+
+static
+size_t siswa__arAdviseNames(siArFile arFile, const char* const* names, size_t count,
+		siAdvice advice) {
+	size_t found = 0, start = 0, end = 0, i;
+
+	SISWA_ASSERT(names != NULL || count == 0);
+
+	for (i = 0; i < count; i += 1) {
+		siArEntry* entry = siswa__arEntryFind(arFile, names[i], SISWA_STRLEN(names[i]));
+		size_t offset;
+
+		if (entry == NULL) {
+			continue;
+		}
+		found += 1;
+
+		offset = (size_t)((siByte*)entry - arFile.data);
+		if (end != 0 && offset == end) {
+			end += SISWA__LE32(entry->size);
+			continue;
+		}
+		if (end != 0) {
+			siswa_arAdvise(arFile, start, end - start, advice);
+		}
+		start = offset;
+		end = offset + SISWA__LE32(entry->size);
+	}
+	if (end != 0) {
+		siswa_arAdvise(arFile, start, end - start, advice);
+	}
+
+	return found;
+}
+size_t siswa_arPrefetch(siArFile arFile, const char* const* names, size_t count) {
+	return siswa__arAdviseNames(arFile, names, count, SISWA_ADVISE_WILLNEED);
+}
+size_t siswa_arRelease(siArFile arFile, const char* const* names, size_t count) {
+	return siswa__arAdviseNames(arFile, names, count, SISWA_ADVISE_DONTNEED);
+}
+#endif
+
+#if (defined(SISWA_USE_SHARED_CACHE) || defined(SISWA_USE_DAEMON) || defined(SISWA_USE_RELOAD) \
+		|| defined(SISWA_USE_VFS)) && !defined(SISWA_NO_STDLIB) && !defined(_WIN32)
+static
+void siswa__arUnloadRegular(siArFile ar, siBool mapped) {
+	if (mapped) {
+		siswa_arUnmap(ar);
+	}
+	else {
+		SISWA__FREE(ar.data);
+	}
+}
+
+/* Checks that every chunk of the SEGS file (an '.ar' or an '.arl') is inside of
+ * it and that together they decompress into the size of the header, as a file
+ * that's still being written can end anywhere. */
+static
+siBool siswa__segsIsComplete(const siByte* data, size_t len) {
+	const siSegsHeader* header = (const siSegsHeader*)data;
+	const siSegsEntry* table = (const siSegsEntry*)(header + 1);
+	size_t chunks, baseOffset, total = 0, i;
+
+	if (len < sizeof(siSegsHeader)) {
+		return SISWA_FALSE;
+	}
+	chunks = SISWA__BE16(header->chunks);
+	baseOffset = sizeof(siSegsHeader) + chunks * sizeof(siSegsEntry);
+	if (baseOffset > len) {
+		return SISWA_FALSE;
+	}
+
+	for (i = 0; i < chunks; i += 1) {
+		size_t size = SISWA__BE16(table[i].size);
+		size_t zSize = SISWA__BE16(table[i].zSize);
+		size_t offset = SISWA__BE32(table[i].offset);
+
+		/* The first chunk can also start right after the table. */
+		if (i == 0 && offset == 1) {
+			offset += baseOffset;
+		}
+		if (offset == 0 || offset - 1 > len || zSize > len - (offset - 1)) {
+			return SISWA_FALSE;
+		}
+		total += (size != 0) ? size : 0x10000;
+	}
+	return total == SISWA__BE32(header->fullSize);
+}
+
+/* Maps the archive, or decompresses it into memory if it's compressed, and
+ * validates it. '*mapped' tells whether it has to be unmapped or freed after. */
+static
+siBool siswa__arLoadRegular(const char* path, siArFile* out, siBool* mapped) {
+	siArFile ar;
+
+	/* The file can get deleted or truncated at any point before it's mapped,
+	 * e.g. while it's being replaced. */
+	if (!siswa__arMapFile(path, &ar)) {
+		return SISWA_FALSE;
+	}
+	*mapped = SISWA_TRUE;
+	/* XCompress can't be decompressed yet. */
+	if (ar.len < sizeof(siArHeader) || ar.type == SISWA_FILE_XCOMPRESS
+			|| (ar.type == SISWA_FILE_SEGS && !siswa__segsIsComplete(ar.data, ar.len))) {
+		siswa_arUnmap(ar);
+		return SISWA_FALSE;
+	}
+
+	if (ar.type == SISWA_FILE_SEGS) {
+#ifndef SISWA_NO_DECOMPRESSION
+		siArFile compressed = ar;
+		size_t len = (size_t)siswa_arGetDecompressedSize(ar);
+		siByte* data = (siByte*)SISWA__MALLOC(SISWA_BUDGET_DECOMPRESSION, len != 0 ? len : 1);
+
+		SISWA_ASSERT_NOT_NULL(data);
+		siswa_arDecompress(&ar, data, len, SISWA_FALSE);
+		siswa_arUnmap(compressed);
+		ar = siswa_arMakeBuffer(data, len);
+		*mapped = SISWA_FALSE;
+#endif
+	}
+	if (ar.type != SISWA_FILE_REGULAR || !siswa_arValidate(&ar)) {
+		siswa__arUnloadRegular(ar, *mapped);
+		return SISWA_FALSE;
+	}
+
+	*out = ar;
+	return SISWA_TRUE;
+}
+#endif
+
+#if defined(SISWA_USE_SHARED_CACHE) && !defined(SISWA_NO_STDLIB) && !defined(_WIN32)
+#define SISWA__SHARED_VERSION 2
+
+/* Every path gets a slot of its own, which it keeps for good. The slot's lock is
+ * held while its archive gets mapped or (re)built, so processes asking for an
+ * archive that's being built wait for it. Looking for a slot doesn't lock the
+ * ones of other paths. */
+typedef enum {
+	SISWA__SHARED_EMPTY = 0,
+	/* The builder died, the next process to lock the slot builds it again. */
+	SISWA__SHARED_BUILDING,
+	SISWA__SHARED_READY,
+	/* Building failed, the next process to lock the slot tries again. */
+	SISWA__SHARED_FAILED
+} siswa__sharedState;
+
+typedef struct {
+	/* Hash of the path, 0 if the slot is empty. Only ever set once. */
+	uint64_t key;
+	/* Another hash of the path with a different seed, so that paths whose 'key'
+	 * collides don't get each other's archive. */
+	uint64_t check;
+	/* The file that the current segment got built from. */
+	uint64_t mtime;
+	uint64_t size;
+	/* Length of the decompressed archive. */
+	uint64_t len;
+	/* Part of the segment's name, bumped on every build. A changed file gets a
+	 * new segment, while processes keep the old one until they unmap it. */
+	uint32_t generation;
+	/* 'siswa__sharedState'. */
+	uint32_t state;
+	/* Process holding the slot's lock, 0 if nobody does. */
+	uint32_t lock;
+	uint32_t padding;
+} siswa__sharedSlot;
+
+typedef struct {
+	uint32_t version;
+	uint32_t slotCount;
+	siswa__sharedSlot slots[SISWA_SHARED_CACHE_SLOTS];
+} siswa__sharedDirectory;
+
+static
+void siswa__sharedName(char* out, const char* name, uint64_t key, uint32_t generation) {
+	if (key == 0) {
+		sprintf(out, "/%s", name);
+	}
+	else {
+		sprintf(out, "/%s-%08lx%08lx-%lu", name, (unsigned long)(key >> 32),
+			(unsigned long)(key & 0xFFFFFFFF), (unsigned long)generation);
+	}
+}
+
+/* Takes the lock of the slot, or takes it over from a process that died while
+ * holding it. Gives up if the slot gets claimed by another path meanwhile. */
+static
+siBool siswa__sharedLock(siswa__sharedSlot* slot, uint64_t key, uint32_t self) {
+	for (;;) {
+		uint64_t cur = slot->key;
+		uint32_t holder;
+		struct timespec wait;
+
+		if (cur != 0 && cur != key) {
+			return SISWA_FALSE;
+		}
+		holder = __sync_val_compare_and_swap(&slot->lock, 0, self);
+		if (holder == 0) {
+			return SISWA_TRUE;
+		}
+		if (holder != self && kill((pid_t)holder, 0) == -1 && errno == ESRCH) {
+			if (__sync_bool_compare_and_swap(&slot->lock, holder, self)) {
+				return SISWA_TRUE;
+			}
+			continue;
+		}
+
+		wait.tv_sec = 0;
+		wait.tv_nsec = 1000000;
+		nanosleep(&wait, NULL);
+	}
+}
+
+static
+void siswa__sharedUnlock(siswa__sharedSlot* slot) {
+	__sync_lock_release(&slot->lock);
+}
+
+/* Maps the segment of the slot read-only. */
+static
+siArFile siswa__sharedMap(siSharedCache* cache, const siswa__sharedSlot* slot) {
+	char name[96];
+	siArFile ar;
+	void* data;
+	int fd;
+
+	SISWA_MEMSET(&ar, 0, sizeof(ar));
+	ar.type = SISWA_FILE_INVALID;
+
+	siswa__sharedName(name, cache->__name, slot->key, slot->generation);
+	fd = shm_open(name, O_RDONLY, 0);
+	if (fd == -1) {
+		return ar;
+	}
+	data = mmap(NULL, (size_t)slot->len, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return ar;
+	}
+	return siswa_arMakeBuffer(data, (size_t)slot->len);
+}
+
+/* Checks that the file is a regular or SEGS archive before a slot gets claimed
+ * for it. XCompress can't be decompressed yet (which would never finish while
+ * holding the slot), and files too small to be archives can't be read. */
+static
+siBool siswa__sharedSupported(const char* path, const struct stat* st) {
+	siByte identifier[4];
+	uint64_t type;
+	FILE* file;
+	size_t read;
+
+	if (st->st_size < (off_t)sizeof(siArHeader)) {
+		return SISWA_FALSE;
+	}
+	file = fopen(path, "rb");
+	if (file == NULL) {
+		return SISWA_FALSE;
+	}
+	read = fread(identifier, 1, sizeof(identifier), file);
+	fclose(file);
+
+	type = siswa__read32le(identifier);
+	return read == sizeof(identifier) && (type == 0 || type == SISWA_IDENTIFIER_SEGS);
+}
+
+/* Reads (and decompresses) the archive into the segment of the slot. Only
+ * complete archives that pass validation get built, the slot fails otherwise. */
+static
+siBool siswa__sharedBuild(siSharedCache* cache, siswa__sharedSlot* slot, const char* path) {
+	char name[96];
+	siArFile ar;
+	siBool mapped, res = SISWA_FALSE;
+	siByte* data;
+	int fd;
+
+	if (!siswa__arLoadRegular(path, &ar, &mapped)) {
+		return SISWA_FALSE;
+	}
+
+	/* A segment left behind by a process that died while building gets replaced. */
+	siswa__sharedName(name, cache->__name, slot->key, slot->generation);
+	shm_unlink(name);
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd == -1) {
+		siswa__arUnloadRegular(ar, mapped);
+		return SISWA_FALSE;
+	}
+
+	if (ftruncate(fd, (off_t)ar.len) == 0) {
+		data = (siByte*)mmap(NULL, ar.len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if ((void*)data != MAP_FAILED) {
+			SISWA_MEMCPY(data, ar.data, ar.len);
+			munmap(data, ar.len);
+			slot->len = ar.len;
+			res = SISWA_TRUE;
+		}
+	}
+	close(fd);
+	siswa__arUnloadRegular(ar, mapped);
+
+	if (!res) {
+		shm_unlink(name);
+	}
+	return res;
+}
+
+siBool siswa_sharedCacheOpen(siSharedCache* cache, const char* name) {
+	char segment[96];
+	siswa__sharedDirectory* dir;
+	size_t i;
+	int fd;
+
+	SISWA_ASSERT_NOT_NULL(cache);
+	SISWA_ASSERT_NOT_NULL(name);
+	SISWA_ASSERT_MSG(SISWA_STRLEN(name) < sizeof(cache->__name), "The name is too long");
+
+	for (i = 0; name[i] != '\0'; i += 1) {
+		char c = name[i];
+		if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+				|| c == '-' || c == '_')) {
+			return SISWA_FALSE;
+		}
+	}
+	SISWA_MEMCPY(cache->__name, name, i + 1);
+
+	siswa__sharedName(segment, name, 0, 0);
+	fd = shm_open(segment, O_RDWR | O_CREAT, 0644);
+	if (fd == -1) {
+		return SISWA_FALSE;
+	}
+	/* Every process sizes it the same way, so it doesn't matter who gets first.
+	 * New segments are zeroed, i.e. every slot starts out empty. */
+	if (ftruncate(fd, sizeof(siswa__sharedDirectory)) != 0) {
+		close(fd);
+		return SISWA_FALSE;
+	}
+	dir = (siswa__sharedDirectory*)mmap(NULL, sizeof(siswa__sharedDirectory),
+		PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if ((void*)dir == MAP_FAILED) {
+		return SISWA_FALSE;
+	}
+
+	__sync_bool_compare_and_swap(&dir->version, 0, SISWA__SHARED_VERSION);
+	if (dir->version != SISWA__SHARED_VERSION) {
+		munmap(dir, sizeof(siswa__sharedDirectory));
+		return SISWA_FALSE;
+	}
+	dir->slotCount = SISWA_SHARED_CACHE_SLOTS;
+
+	cache->__directory = dir;
+	return SISWA_TRUE;
+}
+
+void siswa_sharedCacheClose(siSharedCache* cache) {
+	SISWA_ASSERT_NOT_NULL(cache);
+	if (cache->__directory != NULL) {
+		munmap(cache->__directory, sizeof(siswa__sharedDirectory));
+		cache->__directory = NULL;
+	}
+}
+
+siArFile siswa_sharedCacheGet(siSharedCache* cache, const char* path, siBool* built) {
+	siswa__sharedDirectory* dir;
+	siswa__sharedSlot* slot = NULL;
+	struct stat st;
+	uint64_t key, check;
+	uint32_t self = (uint32_t)getpid();
+	size_t pathLen, i;
+	siArFile res;
+
+	SISWA_ASSERT_NOT_NULL(cache);
+	SISWA_ASSERT_NOT_NULL(cache->__directory);
+	SISWA_ASSERT_NOT_NULL(path);
+
+	SISWA_MEMSET(&res, 0, sizeof(res));
+	res.type = SISWA_FILE_INVALID;
+	if (built != NULL) {
+		*built = SISWA_FALSE;
+	}
+	if (stat(path, &st) != 0 || !siswa__sharedSupported(path, &st)) {
+		return res;
+	}
+
+	pathLen = SISWA_STRLEN(path);
+	key = SISWA_HASH64(path, pathLen, 0) | 1;
+	check = SISWA_HASH64(path, pathLen, SISWA__U64(0x9E3779B9, 0x7F4A7C15));
+	dir = (siswa__sharedDirectory*)cache->__directory;
+
+	/* Linear probing, claiming the first empty slot if the path isn't there yet. */
+	for (i = 0; i < SISWA_SHARED_CACHE_SLOTS; i += 1) {
+		siswa__sharedSlot* cur = &dir->slots[(key + i) % SISWA_SHARED_CACHE_SLOTS];
+
+		if (!siswa__sharedLock(cur, key, self)) {
+			continue;
+		}
+		if (cur->key == 0) {
+			cur->check = check;
+			cur->state = SISWA__SHARED_EMPTY;
+			__sync_synchronize();
+			cur->key = key;
+		}
+		else if (cur->key != key || cur->check != check) {
+			siswa__sharedUnlock(cur);
+			continue;
+		}
+		slot = cur;
+		break;
+	}
+	if (slot == NULL) {
+		return res;
+	}
+
+	if (slot->state != SISWA__SHARED_READY || slot->mtime != (uint64_t)st.st_mtime
+			|| slot->size != (uint64_t)st.st_size) {
+		char segment[96];
+		siBool ok;
+
+		/* The segment of the previous file, processes that mapped it keep it. */
+		siswa__sharedName(segment, cache->__name, slot->key, slot->generation);
+		shm_unlink(segment);
+
+		slot->generation += 1;
+		slot->mtime = (uint64_t)st.st_mtime;
+		slot->size = (uint64_t)st.st_size;
+		slot->state = SISWA__SHARED_BUILDING;
+		__sync_synchronize();
+
+		ok = siswa__sharedBuild(cache, slot, path);
+		__sync_synchronize();
+		slot->state = ok ? SISWA__SHARED_READY : SISWA__SHARED_FAILED;
+		if (ok && built != NULL) {
+			*built = SISWA_TRUE;
+		}
+	}
+
+	if (slot->state == SISWA__SHARED_READY) {
+		res = siswa__sharedMap(cache, slot);
+	}
+	siswa__sharedUnlock(slot);
+	return res;
+}
+
+void siswa_sharedCacheUnlink(const char* name) {
+	siSharedCache cache;
+	char segment[96];
+	size_t i;
+
+	SISWA_ASSERT_NOT_NULL(name);
+	if (!siswa_sharedCacheOpen(&cache, name)) {
+		return;
+	}
+
+	for (i = 0; i < SISWA_SHARED_CACHE_SLOTS; i += 1) {
+		const siswa__sharedSlot* slot = &((siswa__sharedDirectory*)cache.__directory)->slots[i];
+		if (slot->key != 0) {
+			siswa__sharedName(segment, name, slot->key, slot->generation);
+			shm_unlink(segment);
+		}
+	}
+	siswa_sharedCacheClose(&cache);
+
+	siswa__sharedName(segment, name, 0, 0);
+	shm_unlink(segment);
+}
+#endif
+
+#if defined(SISWA_USE_DAEMON) && !defined(SISWA_NO_STDLIB) && !defined(_WIN32)
+#define SISWA__DAEMON_MAX_CLIENTS 64
+#define SISWA__DAEMON_MAX_NAME 4096
+/* How long a client gets to make room for a response before it gets dropped. */
+#define SISWA__DAEMON_SEND_TIMEOUT 1000
+
+/* A peer that disconnects mid-response must only fail the send ('EPIPE') instead
+ * of raising SIGPIPE, which would kill the whole process. Systems without
+ * 'MSG_NOSIGNAL' (macOS) set 'SO_NOSIGPIPE' on the socket instead. */
+#ifdef MSG_NOSIGNAL
+	#define SISWA__DAEMON_SEND_FLAGS MSG_NOSIGNAL
+#else
+	#define SISWA__DAEMON_SEND_FLAGS 0
+#endif
+
+static
+void siswa__daemonNoSigpipe(int fd) {
+#ifdef SO_NOSIGPIPE
+	int on = 1;
+	setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#else
+	(void)fd;
+#endif
+}
+
+typedef struct {
+	char* path;
+	/* Descriptor of the decompressed archive, which gets sent to the clients. */
+	int fd;
+	siArFile ar;
+	/* Index of the entry names, pointing into the mapping. */
+	siHashTable* ht;
+	/* The file when it got loaded. An archive that got evicted to free memory
+	 * only gets loaded again if the file is still the same, as the clients keep
+	 * using the offsets they got. */
+	uint64_t mtime;
+	uint64_t size;
+	/* Bytes of decompressed data counted towards 'SISWA_BUDGET_CACHES'. */
+	size_t charged;
+	/* When the archive was last asked for, for evicting the oldest first. */
+	uint64_t lastUsed;
+} siswa__daemonArchive;
+
+typedef struct {
+	siswa__daemonArchive* archives;
+	size_t count;
+	size_t cap;
+	uint64_t clock;
+#ifdef SISWA_USE_BUDGETS
+	/* Held by the daemon while it answers requests, as the shrinker can get
+	 * called on any thread that allocates. */
+	volatile int lock;
+#endif
+} siswa__daemonState;
+
+/* The part of a client's request that arrived so far. Requests only get answered
+ * once all of them arrived, so that a slow client never stalls the others. */
+typedef struct {
+	siByte buf[sizeof(siDaemonRequest) + SISWA__DAEMON_MAX_NAME + 1];
+	size_t len;
+} siswa__daemonClient;
+
+/* Reads or writes all of 'len', retrying on interruptions and partial transfers. */
+static
+siBool siswa__daemonRecv(int fd, void* out, size_t len) {
+	siByte* ptr = (siByte*)out;
+	while (len != 0) {
+		ssize_t res = recv(fd, ptr, len, 0);
+		if (res <= 0) {
+			if (res < 0 && errno == EINTR) {
+				continue;
+			}
+			return SISWA_FALSE;
+		}
+		ptr += res;
+		len -= (size_t)res;
+	}
+	return SISWA_TRUE;
+}
+static
+siBool siswa__daemonSend(int fd, const void* data, size_t len) {
+	const siByte* ptr = (const siByte*)data;
+	while (len != 0) {
+		ssize_t res = send(fd, ptr, len, SISWA__DAEMON_SEND_FLAGS);
+		if (res <= 0) {
+			if (res < 0 && errno == EINTR) {
+				continue;
+			}
+			if (res < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+				/* The daemon's sockets don't block, so this waits for the client
+				 * to read instead. */
+				struct pollfd pfd;
+				pfd.fd = fd;
+				pfd.events = POLLOUT;
+				if (poll(&pfd, 1, SISWA__DAEMON_SEND_TIMEOUT) > 0) {
+					continue;
+				}
+			}
+			return SISWA_FALSE;
+		}
+		ptr += res;
+		len -= (size_t)res;
+	}
+	return SISWA_TRUE;
+}
+
+/* Sends the response along with a file descriptor. */
+static
+siBool siswa__daemonSendFd(int fd, const siDaemonResponse* res, int passedFd) {
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr* cmsg;
+	union {
+		char buf[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} control;
+
+	SISWA_MEMSET(&msg, 0, sizeof(msg));
+	SISWA_MEMSET(&control, 0, sizeof(control));
+	iov.iov_base = (void*)res;
+	iov.iov_len = sizeof(siDaemonResponse);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	SISWA_MEMCPY(CMSG_DATA(cmsg), &passedFd, sizeof(int));
+
+	return sendmsg(fd, &msg, SISWA__DAEMON_SEND_FLAGS) == (ssize_t)sizeof(siDaemonResponse);
+}
+
+/* Makes a descriptor that the decompressed archive can be written into. */
+static
+int siswa__daemonAnonFd(size_t len) {
+	int fd;
+#ifdef MFD_CLOEXEC
+	fd = memfd_create("siswa-archive", MFD_CLOEXEC);
+#else
+	char name[64];
+	sprintf(name, "/siswa-daemon-%lu", (unsigned long)getpid());
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	shm_unlink(name);
+#endif
+	if (fd != -1 && ftruncate(fd, (off_t)len) != 0) {
+		close(fd);
+		fd = -1;
+	}
+	return fd;
+}
+
+/* Opens, decompresses and indexes the archive. */
+static
+siBool siswa__daemonLoad(siswa__daemonArchive* archive, const char* path) {
+	siArFile ar;
+	siArEntry* entry;
+	struct stat st;
+	siBool mapped;
+	size_t count;
+	int fd = open(path, O_RDONLY);
+
+	if (fd == -1) {
+		return SISWA_FALSE;
+	}
+	if (fstat(fd, &st) != 0 || !siswa__arLoadRegular(path, &ar, &mapped)) {
+		close(fd);
+		return SISWA_FALSE;
+	}
+	archive->charged = 0;
+
+	if (mapped) {
+		/* The file could've been replaced between opening and mapping it, in
+		 * which case the descriptor isn't the archive that got validated. */
+		if ((off_t)ar.len != st.st_size) {
+			siswa_arUnmap(ar);
+			close(fd);
+			return SISWA_FALSE;
+		}
+	}
+	else {
+		/* Clients map the descriptor, so the decompressed archive has to be
+		 * moved into one. */
+		siArFile decompressed = ar;
+		void* data;
+
+		close(fd);
+		fd = siswa__daemonAnonFd(ar.len);
+		data = (fd != -1)
+			? mmap(NULL, ar.len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+			: MAP_FAILED;
+		if (data == MAP_FAILED) {
+			siswa__arUnloadRegular(decompressed, mapped);
+			if (fd != -1) {
+				close(fd);
+			}
+			return SISWA_FALSE;
+		}
+		SISWA_MEMCPY(data, decompressed.data, decompressed.len);
+		ar = siswa_arMakeBuffer(data, decompressed.len);
+		ar.validated = SISWA_TRUE;
+		siswa__arUnloadRegular(decompressed, mapped);
+		archive->charged = ar.len;
+	}
+#ifdef SISWA_USE_BUDGETS
+	siswa__budgetCharge(SISWA_BUDGET_CACHES, archive->charged, SISWA_FALSE);
+#endif
+
+	count = siswa_arGetEntryCount(ar);
+	archive->ht = (siHashTable*)SISWA__MALLOC(SISWA_BUDGET_INDEXES,
+		sizeof(siHashTable) + siswa__hashtableCapacity(count) * sizeof(siHashEntry)
+	);
+	SISWA_ASSERT_NOT_NULL(archive->ht);
+	siswa__hashtableMakeReserve(archive->ht, siswa__hashtableCapacity(count));
+	while (siswa_arEntryPoll(&ar, &entry)) {
+		const char* name = siswa_arEntryGetName(entry);
+		size_t nameLen = SISWA_STRLEN(name);
+		uint64_t hash = siswa__hashKey(name, nameLen);
+		if (!siswa__hashtableExists(archive->ht, name, nameLen, hash)) {
+			siswa__hashtableSet(archive->ht, name, nameLen, hash);
+		}
+	}
+
+	archive->mtime = (uint64_t)st.st_mtime;
+	archive->size = (uint64_t)st.st_size;
+	archive->fd = fd;
+	archive->ar = ar;
+	return SISWA_TRUE;
+}
+
+/* Drops the archive from memory, keeping its path so that its id stays valid.
+ * Returns the number of bytes freed. */
+static
+size_t siswa__daemonUnload(siswa__daemonArchive* archive) {
+	size_t freed = archive->charged + sizeof(siHashTable)
+		+ archive->ht->capacity * sizeof(siHashEntry);
+
+	siswa_arUnmap(archive->ar);
+	close(archive->fd);
+	SISWA__FREE(archive->ht);
+#ifdef SISWA_USE_BUDGETS
+	siswa__budgetCharge(SISWA_BUDGET_CACHES, archive->charged, SISWA_TRUE);
+#endif
+	archive->ar.data = NULL;
+	archive->ht = NULL;
+	archive->fd = -1;
+	archive->charged = 0;
+	return freed;
+}
+
+/* Loads the archive again if it got evicted. Fails if the file changed since. */
+static
+siBool siswa__daemonRestore(siswa__daemonState* state, siswa__daemonArchive* archive) {
+	uint64_t mtime = archive->mtime, size = archive->size;
+
+	archive->lastUsed = ++state->clock;
+	if (archive->ar.data != NULL) {
+		return SISWA_TRUE;
+	}
+	if (!siswa__daemonLoad(archive, archive->path)) {
+		return SISWA_FALSE;
+	}
+	if (archive->mtime != mtime || archive->size != size) {
+		siswa__daemonUnload(archive);
+		archive->mtime = mtime;
+		archive->size = size;
+		return SISWA_FALSE;
+	}
+	return SISWA_TRUE;
+}
+
+#ifdef SISWA_USE_BUDGETS
+#if defined(__GNUC__) || defined(__clang__)
+	#define SISWA__DAEMON_LOCK(state) while (__sync_lock_test_and_set(&(state)->lock, 1)) {}
+	#define SISWA__DAEMON_UNLOCK(state) __sync_lock_release(&(state)->lock)
+#else
+	#define SISWA__DAEMON_LOCK(state) (void)0
+	#define SISWA__DAEMON_UNLOCK(state) (void)0
+#endif
+
+/* The state the thread is serving, which already holds its lock. */
+static SISWA__THREAD_LOCAL siswa__daemonState* siswa__daemonServing;
+
+/* Evicts the least recently used archives until 'bytes' got freed. */
+static
+size_t siswa__daemonShrink(void* user, size_t bytes) {
+	siswa__daemonState* state = (siswa__daemonState*)user;
+	siBool locked = (siswa__daemonServing != state);
+	size_t freed = 0;
+
+	/* Other threads wait for the request that's being answered. */
+	if (locked) {
+		SISWA__DAEMON_LOCK(state);
+	}
+	while (freed < bytes) {
+		siswa__daemonArchive* oldest = NULL;
+		size_t i;
+
+		for (i = 0; i < state->count; i += 1) {
+			siswa__daemonArchive* archive = &state->archives[i];
+			if (archive->ar.data != NULL && (oldest == NULL || archive->lastUsed < oldest->lastUsed)) {
+				oldest = archive;
+			}
+		}
+		if (oldest == NULL) {
+			break;
+		}
+		freed += siswa__daemonUnload(oldest);
+	}
+	if (locked) {
+		SISWA__DAEMON_UNLOCK(state);
+	}
+	return freed;
+}
+#endif
+
+/* Answers one request, whose 'name' is NULL-terminated. Returns 'SISWA_FALSE' if
+ * the client should get dropped. */
+static
+siBool siswa__daemonHandle(siswa__daemonState* state, int fd, siDaemonRequest req,
+		const char* name) {
+	siDaemonResponse res;
+	siswa__daemonArchive* archive = NULL;
+
+	res.ok = SISWA_FALSE;
+	res.id = req.id;
+	res.value = 0;
+
+	if (req.op == SISWA_DAEMON_OPEN) {
+		size_t i;
+		/* An archive whose file changed after it got evicted gets a new id. */
+		for (i = 0; i < state->count; i += 1) {
+			if (strcmp(state->archives[i].path, name) == 0
+					&& siswa__daemonRestore(state, &state->archives[i])) {
+				archive = &state->archives[i];
+				break;
+			}
+		}
+
+		if (archive == NULL) {
+			if (state->count == state->cap) {
+				state->cap = (state->cap == 0) ? 16 : state->cap * 2;
+				state->archives = (siswa__daemonArchive*)SISWA__REALLOC(SISWA_BUDGET_OTHER,
+					state->archives, state->cap * sizeof(siswa__daemonArchive)
+				);
+				SISWA_ASSERT_NOT_NULL(state->archives);
+			}
+			if (siswa__daemonLoad(&state->archives[state->count], name)) {
+				archive = &state->archives[state->count];
+				archive->path = (char*)SISWA__MALLOC(SISWA_BUDGET_OTHER, req.len + 1);
+				SISWA_ASSERT_NOT_NULL(archive->path);
+				SISWA_MEMCPY(archive->path, name, req.len + 1);
+				archive->lastUsed = ++state->clock;
+				state->count += 1;
+			}
+		}
+
+		if (archive == NULL) {
+			return siswa__daemonSend(fd, &res, sizeof(res));
+		}
+		res.ok = SISWA_TRUE;
+		res.id = (uint32_t)(archive - state->archives);
+		res.value = archive->ar.len;
+		return siswa__daemonSendFd(fd, &res, archive->fd);
+	}
+
+	if (req.id >= state->count || !siswa__daemonRestore(state, &state->archives[req.id])) {
+		return siswa__daemonSend(fd, &res, sizeof(res));
+	}
+	archive = &state->archives[req.id];
+
+	if (req.op == SISWA_DAEMON_FIND) {
+		siHashEntry* entry = siswa__hashtableGet(
+			archive->ht, name, req.len, siswa__hashKey(name, req.len)
+		);
+		if (entry != NULL) {
+			res.ok = SISWA_TRUE;
+			res.value = (uint64_t)((const siByte*)entry->name - sizeof(siArEntry) - archive->ar.data);
+		}
+		return siswa__daemonSend(fd, &res, sizeof(res));
+	}
+	else if (req.op == SISWA_DAEMON_LIST) {
+		siArFile ar = archive->ar;
+		siArEntry* entry;
+
+		res.ok = SISWA_TRUE;
+		while (siswa_arEntryPoll(&ar, &entry)) {
+			res.value += SISWA_STRLEN(siswa_arEntryGetName(entry)) + 1;
+		}
+		if (!siswa__daemonSend(fd, &res, sizeof(res))) {
+			return SISWA_FALSE;
+		}
+
+		siswa_arOffsetReset(&ar);
+		while (siswa_arEntryPoll(&ar, &entry)) {
+			const char* entryName = siswa_arEntryGetName(entry);
+			if (!siswa__daemonSend(fd, entryName, SISWA_STRLEN(entryName) + 1)) {
+				return SISWA_FALSE;
+			}
+		}
+		return SISWA_TRUE;
+	}
+
+	return siswa__daemonSend(fd, &res, sizeof(res));
+}
+
+/* Reads whatever the client sent, answering every request that fully arrived.
+ * Returns 'SISWA_FALSE' if the client should get dropped. */
+static
+siBool siswa__daemonReceive(siswa__daemonState* state, int fd, siswa__daemonClient* client) {
+	for (;;) {
+		size_t needed = sizeof(siDaemonRequest);
+		ssize_t res;
+
+		if (client->len >= sizeof(siDaemonRequest)) {
+			siDaemonRequest req;
+
+			SISWA_MEMCPY(&req, client->buf, sizeof(req));
+			if (req.magic != SISWA_DAEMON_MAGIC || req.len > SISWA__DAEMON_MAX_NAME) {
+				return SISWA_FALSE;
+			}
+			needed += req.len;
+
+			if (client->len == needed) {
+				client->buf[needed] = '\0';
+				client->len = 0;
+				if (!siswa__daemonHandle(state, fd, req, (const char*)&client->buf[sizeof(req)])) {
+					return SISWA_FALSE;
+				}
+				continue;
+			}
+		}
+
+		res = recv(fd, &client->buf[client->len], needed - client->len, 0);
+		if (res < 0 && errno == EINTR) {
+			continue;
+		}
+		if (res < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			return SISWA_TRUE;
+		}
+		if (res <= 0) {
+			return SISWA_FALSE;
+		}
+		client->len += (size_t)res;
+	}
+}
+
+static
+int siswa__daemonSocket(const char* socketPath, struct sockaddr_un* addr) {
+	int fd;
+
+	if (SISWA_STRLEN(socketPath) >= sizeof(addr->sun_path)) {
+		return -1;
+	}
+	SISWA_MEMSET(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	SISWA_MEMCPY(addr->sun_path, socketPath, SISWA_STRLEN(socketPath) + 1);
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd != -1) {
+		siswa__daemonNoSigpipe(fd);
+	}
+	return fd;
+}
+
+siBool siswa_daemonServe(const char* socketPath, const volatile int* stop) {
+	struct pollfd fds[SISWA__DAEMON_MAX_CLIENTS + 1];
+	struct sockaddr_un addr;
+	siswa__daemonState state;
+	siswa__daemonClient* clients;
+	size_t clientCount = 0, i;
+	int listener;
+
+	SISWA_ASSERT_NOT_NULL(socketPath);
+	SISWA_ASSERT_NOT_NULL(stop);
+
+	listener = siswa__daemonSocket(socketPath, &addr);
+	if (listener == -1) {
+		return SISWA_FALSE;
+	}
+	unlink(socketPath);
+	/* The daemon opens any path it gets asked for, so only the user running it
+	 * may connect. Nobody can connect before 'listen', so there's no window
+	 * where the socket is open to others. */
+	if (bind(listener, (struct sockaddr*)&addr, sizeof(addr)) != 0
+			|| chmod(socketPath, 0600) != 0
+			|| listen(listener, SISWA__DAEMON_MAX_CLIENTS) != 0) {
+		close(listener);
+		return SISWA_FALSE;
+	}
+
+	/* 'clients[i]' belongs to 'fds[i + 1]'. */
+	clients = (siswa__daemonClient*)SISWA__MALLOC(SISWA_BUDGET_OTHER,
+		SISWA__DAEMON_MAX_CLIENTS * sizeof(siswa__daemonClient));
+	SISWA_ASSERT_NOT_NULL(clients);
+
+	state.archives = NULL;
+	state.count = 0;
+	state.cap = 0;
+	state.clock = 0;
+#ifdef SISWA_USE_BUDGETS
+	state.lock = 0;
+	siswa__daemonServing = &state;
+	siswa_budgetAddShrinker(siswa__daemonShrink, &state);
+#endif
+	fds[0].fd = listener;
+	fds[0].events = POLLIN;
+
+	/* Every request gets answered in full before the next one, on this thread.
+	 * Clients don't block, so requests get buffered until they arrived fully. */
+	while (!*stop) {
+		if (poll(fds, clientCount + 1, 100) <= 0) {
+			continue;
+		}
+#ifdef SISWA_USE_BUDGETS
+		SISWA__DAEMON_LOCK(&state);
+#endif
+
+		for (i = 1; i <= clientCount; i += 1) {
+			if (fds[i].revents == 0) {
+				continue;
+			}
+			if ((fds[i].revents & POLLIN) == 0
+					|| !siswa__daemonReceive(&state, fds[i].fd, &clients[i - 1])) {
+				close(fds[i].fd);
+				fds[i] = fds[clientCount];
+				clients[i - 1] = clients[clientCount - 1];
+				clientCount -= 1;
+				i -= 1;
+			}
+		}
+
+		if (fds[0].revents & POLLIN) {
+			int client = accept(listener, NULL, NULL);
+			if (client != -1 && clientCount < SISWA__DAEMON_MAX_CLIENTS
+					&& fcntl(client, F_SETFL, fcntl(client, F_GETFL) | O_NONBLOCK) == 0) {
+				clientCount += 1;
+				fds[clientCount].fd = client;
+				fds[clientCount].events = POLLIN;
+				fds[clientCount].revents = 0;
+				clients[clientCount - 1].len = 0;
+				siswa__daemonNoSigpipe(client);
+			}
+			else if (client != -1) {
+				close(client);
+			}
+		}
+#ifdef SISWA_USE_BUDGETS
+		SISWA__DAEMON_UNLOCK(&state);
+#endif
+	}
+
+	for (i = 1; i <= clientCount; i += 1) {
+		close(fds[i].fd);
+	}
+#ifdef SISWA_USE_BUDGETS
+	siswa_budgetRemoveShrinker(siswa__daemonShrink, &state);
+	siswa__daemonServing = NULL;
+#endif
+	for (i = 0; i < state.count; i += 1) {
+		if (state.archives[i].ar.data != NULL) {
+			siswa__daemonUnload(&state.archives[i]);
+		}
+		SISWA__FREE(state.archives[i].path);
+	}
+	SISWA__FREE(state.archives);
+	SISWA__FREE(clients);
+	close(listener);
+	unlink(socketPath);
+	return SISWA_TRUE;
+}
+
+siBool siswa_daemonConnect(siDaemonClient* client, const char* socketPath) {
+	struct sockaddr_un addr;
+
+	SISWA_ASSERT_NOT_NULL(client);
+	SISWA_ASSERT_NOT_NULL(socketPath);
+
+	client->__fd = siswa__daemonSocket(socketPath, &addr);
+	if (client->__fd == -1) {
+		return SISWA_FALSE;
+	}
+	if (connect(client->__fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+		close(client->__fd);
+		client->__fd = -1;
+		return SISWA_FALSE;
+	}
+	return SISWA_TRUE;
+}
+
+void siswa_daemonDisconnect(siDaemonClient* client) {
+	SISWA_ASSERT_NOT_NULL(client);
+	if (client->__fd != -1) {
+		close(client->__fd);
+		client->__fd = -1;
+	}
+}
+
+/* Sends a request along with its path or name. */
+static
+siBool siswa__daemonRequest(siDaemonClient* client, uint32_t op, uint32_t id, const char* name) {
+	siDaemonRequest req;
+	req.magic = SISWA_DAEMON_MAGIC;
+	req.op = op;
+	req.id = id;
+	req.len = (uint32_t)SISWA_STRLEN(name);
+
+	return req.len <= SISWA__DAEMON_MAX_NAME
+		&& siswa__daemonSend(client->__fd, &req, sizeof(req))
+		&& siswa__daemonSend(client->__fd, name, req.len);
+}
+
+siArFile siswa_daemonOpen(siDaemonClient* client, const char* path, uint32_t* id) {
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr* cmsg;
+	union {
+		char buf[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} control;
+	siDaemonResponse res;
+	siArFile ar;
+	void* data;
+	int fd = -1;
+
+	SISWA_ASSERT_NOT_NULL(client);
+	SISWA_ASSERT_NOT_NULL(path);
+	SISWA_ASSERT_NOT_NULL(id);
+
+	SISWA_MEMSET(&ar, 0, sizeof(ar));
+	ar.type = SISWA_FILE_INVALID;
+	if (!siswa__daemonRequest(client, SISWA_DAEMON_OPEN, 0, path)) {
+		return ar;
+	}
+
+	SISWA_MEMSET(&msg, 0, sizeof(msg));
+	iov.iov_base = &res;
+	iov.iov_len = sizeof(res);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+	if (recvmsg(client->__fd, &msg, MSG_WAITALL) != (ssize_t)sizeof(res)) {
+		return ar;
+	}
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+		SISWA_MEMCPY(&fd, CMSG_DATA(cmsg), sizeof(int));
+	}
+	if (!res.ok || fd == -1 || res.value == 0) {
+		if (fd != -1) {
+			close(fd);
+		}
+		return ar;
+	}
+
+	data = mmap(NULL, (size_t)res.value, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return ar;
+	}
+
+	*id = res.id;
+	ar = siswa_arMakeBuffer(data, (size_t)res.value);
+	/* The daemon already validated it. */
+	ar.validated = SISWA_TRUE;
+	return ar;
+}
+
+siArEntry* siswa_daemonFind(siDaemonClient* client, siArFile arFile, uint32_t id,
+		const char* name) {
+	siDaemonResponse res;
+
+	SISWA_ASSERT_NOT_NULL(client);
+	SISWA_ASSERT_NOT_NULL(name);
+
+	if (!siswa__daemonRequest(client, SISWA_DAEMON_FIND, id, name)
+			|| !siswa__daemonRecv(client->__fd, &res, sizeof(res))
+			|| !res.ok || res.value + sizeof(siArEntry) > arFile.len) {
+		return NULL;
+	}
+	return (siArEntry*)&arFile.data[res.value];
+}
+
+size_t siswa_daemonList(siDaemonClient* client, uint32_t id, siWriteProc proc, void* user) {
+	siDaemonResponse res;
+	siByte buffer[4096];
+	size_t left, written = 0;
+
+	SISWA_ASSERT_NOT_NULL(client);
+	SISWA_ASSERT_NOT_NULL(proc);
+
+	if (!siswa__daemonRequest(client, SISWA_DAEMON_LIST, id, "")
+			|| !siswa__daemonRecv(client->__fd, &res, sizeof(res)) || !res.ok) {
+		return 0;
+	}
+
+	/* Everything has to be read out, even if the writes fail. */
+	left = (size_t)res.value;
+	while (left != 0) {
+		size_t len = (left < sizeof(buffer)) ? left : sizeof(buffer);
+		if (!siswa__daemonRecv(client->__fd, buffer, len)) {
+			break;
+		}
+		if (written == (size_t)res.value - left) {
+			written += proc(user, buffer, len);
+		}
+		left -= len;
+	}
+	return written;
+}
+#endif
+
+#if defined(SISWA_USE_RELOAD) && !defined(SISWA_NO_STDLIB) && !defined(_WIN32)
+/* Readers get their own cache line, so that they don't slow each other down. */
+typedef struct {
+	/* The epoch the reader started reading at, 0 while it isn't reading. */
+	volatile uint64_t epoch;
+	char pad[64 - sizeof(uint64_t)];
+} siswa__reloadReader;
+
+/* Loads and indexes the file. Returns NULL if it isn't a valid archive. */
+static
+siArVersion* siswa__reloadLoad(const char* path) {
+	siArVersion* version;
+	siHashTable* ht;
+	siArEntry* entry;
+	siArFile ar;
+	siBool mapped;
+	size_t capacity;
+
+	if (!siswa__arLoadRegular(path, &ar, &mapped)) {
+		return NULL;
+	}
+
+	capacity = siswa__hashtableCapacity(siswa_arGetEntryCount(ar));
+	version = (siArVersion*)SISWA__MALLOC(SISWA_BUDGET_INDEXES,
+		sizeof(siArVersion) + sizeof(siHashTable) + capacity * sizeof(siHashEntry)
+	);
+	SISWA_ASSERT_NOT_NULL(version);
+	ht = siswa__hashtableMakeReserve(version + 1, capacity);
+
+	while (siswa_arEntryPoll(&ar, &entry)) {
+		const char* name = siswa_arEntryGetName(entry);
+		size_t nameLen = SISWA_STRLEN(name);
+		uint64_t hash = siswa__hashKey(name, nameLen);
+		if (!siswa__hashtableExists(ht, name, nameLen, hash)) {
+			siswa__hashtableSet(ht, name, nameLen, hash);
+		}
+	}
+	siswa_arOffsetReset(&ar);
+
+	version->ar = ar;
+	version->generation = 0;
+	version->__index = ht;
+	version->__mapped = mapped;
+	version->__retired = 0;
+	version->__next = NULL;
+	return version;
+}
+
+static
+void siswa__reloadFree(siArVersion* version) {
+	siswa__arUnloadRegular(version->ar, version->__mapped);
+	SISWA__FREE(version);
+}
+
+/* Frees the retired versions that no reader can still be using. A reader that
+ * started before a version got retired might have it, everyone else got a
+ * newer one. */
+static
+void siswa__reloadReclaim(siReloadable* r) {
+	siswa__reloadReader* readers = (siswa__reloadReader*)r->__readers;
+	siArVersion** link = &r->__retired;
+
+	__sync_synchronize();
+	while (*link != NULL) {
+		siArVersion* version = *link;
+		siBool inUse = SISWA_FALSE;
+		size_t i;
+
+		for (i = 0; i < r->__readerCount; i += 1) {
+			uint64_t epoch = readers[i].epoch;
+			if (epoch != 0 && epoch < version->__retired) {
+				inUse = SISWA_TRUE;
+				break;
+			}
+		}
+
+		if (inUse) {
+			link = &version->__next;
+		}
+		else {
+			*link = version->__next;
+			siswa__reloadFree(version);
+		}
+	}
+}
+
+/* Checks whether the file changed. */
+static
+siBool siswa__reloadChanged(siReloadable* r, int timeoutMs) {
+	struct stat st;
+
+#ifdef __linux__
+	if (r->__watch != -1) {
+		const char* base = strrchr(r->__path, '/');
+		char buffer[4096];
+		siBool changed = SISWA_FALSE;
+		struct pollfd pfd;
+		ssize_t len;
+
+		base = (base != NULL) ? base + 1 : r->__path;
+		pfd.fd = r->__watch;
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, timeoutMs) <= 0) {
+			return SISWA_FALSE;
+		}
+
+		/* Every event about the file counts, as deployments usually go through a
+		 * rename ('IN_MOVED_TO') or a new file ('IN_CLOSE_WRITE'). */
+		while ((len = read(r->__watch, buffer, sizeof(buffer))) > 0) {
+			ssize_t pos = 0;
+			while (pos < len) {
+				struct inotify_event* event = (struct inotify_event*)&buffer[pos];
+				if (event->len != 0 && strcmp(event->name, base) == 0) {
+					changed = SISWA_TRUE;
+				}
+				pos += (ssize_t)(sizeof(struct inotify_event) + event->len);
+			}
+		}
+		return changed;
+	}
+#endif
+
+	if (stat(r->__path, &st) == 0
+			&& ((uint64_t)st.st_mtime != r->__mtime || (uint64_t)st.st_size != r->__size)) {
+		return SISWA_TRUE;
+	}
+	if (timeoutMs > 0) {
+		struct timespec wait;
+		wait.tv_sec = timeoutMs / 1000;
+		wait.tv_nsec = (long)(timeoutMs % 1000) * 1000000;
+		nanosleep(&wait, NULL);
+	}
+	return SISWA_FALSE;
+}
+
+siBool siswa_reloadableOpen(siReloadable* r, const char* path, size_t readerCount) {
+	siArVersion* version;
+	struct stat st;
+	size_t len;
+
+	SISWA_ASSERT_NOT_NULL(r);
+	SISWA_ASSERT_NOT_NULL(path);
+	SISWA_ASSERT(readerCount != 0);
+
+	version = siswa__reloadLoad(path);
+	if (version == NULL || stat(path, &st) != 0) {
+		if (version != NULL) {
+			siswa__reloadFree(version);
+		}
+		return SISWA_FALSE;
+	}
+
+	len = SISWA_STRLEN(path);
+	r->__path = (char*)SISWA__MALLOC(SISWA_BUDGET_OTHER, len + 1);
+	SISWA_ASSERT_NOT_NULL(r->__path);
+	SISWA_MEMCPY(r->__path, path, len + 1);
+	r->__mtime = (uint64_t)st.st_mtime;
+	r->__size = (uint64_t)st.st_size;
+
+	r->__readers = SISWA__MALLOC(SISWA_BUDGET_OTHER, readerCount * sizeof(siswa__reloadReader));
+	SISWA_ASSERT_NOT_NULL(r->__readers);
+	SISWA_MEMSET(r->__readers, 0, readerCount * sizeof(siswa__reloadReader));
+	r->__readerCount = readerCount;
+	r->__current = version;
+	r->__epoch = 1;
+	r->__retired = NULL;
+	r->__watch = -1;
+
+#ifdef __linux__
+	/* The directory gets watched, as a rename replaces the file's inode. */
+	r->__watch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (r->__watch != -1) {
+		char* dir = (char*)SISWA__MALLOC(SISWA_BUDGET_OTHER, len + 2);
+		char* slash;
+
+		SISWA_ASSERT_NOT_NULL(dir);
+		SISWA_MEMCPY(dir, path, len + 1);
+		slash = strrchr(dir, '/');
+		if (slash == NULL) {
+			dir[0] = '.';
+			dir[1] = '\0';
+		}
+		else {
+			slash[slash == dir] = '\0';
+		}
+
+		if (inotify_add_watch(r->__watch, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) == -1) {
+			close(r->__watch);
+			r->__watch = -1;
+		}
+		SISWA__FREE(dir);
+	}
+#endif
+	return SISWA_TRUE;
+}
+
+void siswa_reloadableClose(siReloadable* r) {
+	siArVersion* version;
+
+	SISWA_ASSERT_NOT_NULL(r);
+
+	version = r->__retired;
+	while (version != NULL) {
+		siArVersion* next = version->__next;
+		siswa__reloadFree(version);
+		version = next;
+	}
+	siswa__reloadFree(r->__current);
+
+	if (r->__watch != -1) {
+		close(r->__watch);
+	}
+	SISWA__FREE(r->__readers);
+	SISWA__FREE(r->__path);
+	SISWA_MEMSET(r, 0, sizeof(*r));
+}
+
+const siArVersion* siswa_reloadableAcquire(siReloadable* r, size_t reader) {
+	siswa__reloadReader* readers = (siswa__reloadReader*)r->__readers;
+	SISWA_ASSERT(reader < r->__readerCount);
+
+	/* The epoch has to be visible before the version gets loaded, so that the
+	 * updater either sees the reader or the reader sees the newer version. */
+	readers[reader].epoch = r->__epoch;
+	__sync_synchronize();
+	return r->__current;
+}
+
+void siswa_reloadableRelease(siReloadable* r, size_t reader) {
+	siswa__reloadReader* readers = (siswa__reloadReader*)r->__readers;
+	SISWA_ASSERT(reader < r->__readerCount);
+
+	__sync_synchronize();
+	readers[reader].epoch = 0;
+}
+
+siArEntry* siswa_arVersionFind(const siArVersion* version, const char* name) {
+	size_t nameLen;
+	siHashEntry* entry;
+
+	SISWA_ASSERT_NOT_NULL(version);
+	SISWA_ASSERT_NOT_NULL(name);
+
+	nameLen = SISWA_STRLEN(name);
+	entry = siswa__hashtableGet(
+		(siHashTable*)version->__index, name, nameLen, siswa__hashKey(name, nameLen)
+	);
+	return (entry != NULL) ? (siArEntry*)(entry->name - sizeof(siArEntry)) : NULL;
+}
+
+siBool siswa_reloadableUpdate(siReloadable* r, int timeoutMs) {
+	siArVersion* version;
+	siArVersion* old;
+	struct stat st;
+
+	SISWA_ASSERT_NOT_NULL(r);
+
+	siswa__reloadReclaim(r);
+	if (!siswa__reloadChanged(r, timeoutMs) || stat(r->__path, &st) != 0) {
+		return SISWA_FALSE;
+	}
+	r->__mtime = (uint64_t)st.st_mtime;
+	r->__size = (uint64_t)st.st_size;
+
+	version = siswa__reloadLoad(r->__path);
+	if (version == NULL) {
+		return SISWA_FALSE;
+	}
+
+	/* Readers that start after the epoch goes up are guaranteed to see the new
+	 * version, so the old one is only needed by the ones before it. */
+	old = r->__current;
+	version->generation = old->generation + 1;
+	__sync_synchronize();
+	r->__current = version;
+	old->__retired = __sync_add_and_fetch(&r->__epoch, 1);
+	old->__next = r->__retired;
+	r->__retired = old;
+
+	siswa__reloadReclaim(r);
+	return SISWA_TRUE;
+}
+#endif
+
+#if defined(SISWA_USE_VFS) && !defined(SISWA_NO_STDLIB) && !defined(_WIN32)
+/* The names and sizes of the loose files found so far. */
+typedef struct {
+	char* names;
+	size_t namesLen;
+	size_t namesCap;
+	uint64_t* sizes;
+	size_t count;
+	size_t sizesCap;
+} siswa__vfsScan;
+
+static
+void siswa__vfsLayerFree(siVfsLayer* layer) {
+	size_t i;
+	for (i = 0; i < layer->arCount; i += 1) {
+		siswa__arUnloadRegular(layer->ars[i], layer->__mapped[i]);
+	}
+	SISWA__FREE(layer->ars);
+	SISWA__FREE(layer->__mapped);
+	SISWA__FREE(layer->__names);
+	SISWA__FREE(layer->__sizes);
+	SISWA__FREE(layer->path);
+}
+
+static
+void siswa__vfsLayerInit(siVfsLayer* layer, const char* path, siVfsLayerType type,
+		int32_t priority, size_t arCount) {
+	size_t len = SISWA_STRLEN(path);
+
+	SISWA_MEMSET(layer, 0, sizeof(*layer));
+	layer->path = (char*)SISWA__MALLOC(SISWA_BUDGET_OTHER, len + 1);
+	SISWA_ASSERT_NOT_NULL(layer->path);
+	SISWA_MEMCPY(layer->path, path, len + 1);
+	layer->type = type;
+	layer->priority = priority;
+
+	if (arCount != 0) {
+		layer->ars = (siArFile*)SISWA__MALLOC(SISWA_BUDGET_OTHER, arCount * sizeof(siArFile));
+		layer->__mapped = (siBool*)SISWA__MALLOC(SISWA_BUDGET_OTHER, arCount * sizeof(siBool));
+		SISWA_ASSERT_NOT_NULL(layer->ars);
+		SISWA_ASSERT_NOT_NULL(layer->__mapped);
+	}
+}
+
+/* Loads the archive into the layer, freeing the layer on failure. */
+static
+siBool siswa__vfsLayerLoad(siVfsLayer* layer, const char* path) {
+	siArFile* ar = &layer->ars[layer->arCount];
+	siArEntry* entry;
+
+	if (!siswa__arLoadRegular(path, ar, &layer->__mapped[layer->arCount])) {
+		siswa__vfsLayerFree(layer);
+		return SISWA_FALSE;
+	}
+	layer->arCount += 1;
+
+	while (siswa_arEntryPoll(ar, &entry)) {
+		layer->fileCount += 1;
+	}
+	siswa_arOffsetReset(ar);
+	return SISWA_TRUE;
+}
+
+static
+void siswa__vfsLayerPush(siVfs* vfs, const siVfsLayer* layer) {
+	if (vfs->layerCount == vfs->__layerCapacity) {
+		vfs->__layerCapacity = (vfs->__layerCapacity != 0) ? vfs->__layerCapacity * 2 : 8;
+		vfs->layers = (siVfsLayer*)SISWA__REALLOC(SISWA_BUDGET_OTHER,
+			vfs->layers, vfs->__layerCapacity * sizeof(siVfsLayer)
+		);
+		SISWA_ASSERT_NOT_NULL(vfs->layers);
+	}
+	vfs->layers[vfs->layerCount] = *layer;
+	vfs->layerCount += 1;
+}
+
+/* Walks the directory in 'path', whose name inside of the layer starts at
+ * 'path[rootLen]'. */
+static
+siBool siswa__vfsScanDirectory(siswa__vfsScan* scan, char* path, size_t pathLen,
+		size_t rootLen) {
+	struct dirent* dirent;
+	DIR* dir = opendir(path);
+
+	if (dir == NULL) {
+		return SISWA_FALSE;
+	}
+
+	while ((dirent = readdir(dir)) != NULL) {
+		const char* name = dirent->d_name;
+		size_t nameLen = SISWA_STRLEN(name);
+		struct stat st;
+
+		if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+			continue;
+		}
+		if (pathLen + 1 + nameLen >= PATH_MAX) {
+			continue;
+		}
+		path[pathLen] = '/';
+		SISWA_MEMCPY(&path[pathLen + 1], name, nameLen + 1);
+
+		if (stat(path, &st) != 0) {
+			continue;
+		}
+		if (S_ISDIR(st.st_mode)) {
+			siswa__vfsScanDirectory(scan, path, pathLen + 1 + nameLen, rootLen);
+			continue;
+		}
+		if (!S_ISREG(st.st_mode)) {
+			continue;
+		}
+
+		nameLen = pathLen + 1 + nameLen - rootLen;
+		if (scan->namesLen + nameLen + 1 > scan->namesCap) {
+			scan->namesCap = (scan->namesCap + nameLen + 1) * 2;
+			scan->names = (char*)SISWA__REALLOC(SISWA_BUDGET_OTHER, scan->names, scan->namesCap);
+			SISWA_ASSERT_NOT_NULL(scan->names);
+		}
+		if (scan->count == scan->sizesCap) {
+			scan->sizesCap = (scan->sizesCap != 0) ? scan->sizesCap * 2 : 64;
+			scan->sizes = (uint64_t*)SISWA__REALLOC(SISWA_BUDGET_OTHER, scan->sizes, scan->sizesCap * sizeof(uint64_t));
+			SISWA_ASSERT_NOT_NULL(scan->sizes);
+		}
+		SISWA_MEMCPY(&scan->names[scan->namesLen], &path[rootLen], nameLen + 1);
+		scan->namesLen += nameLen + 1;
+		scan->sizes[scan->count] = (uint64_t)st.st_size;
+		scan->count += 1;
+	}
+	closedir(dir);
+	return SISWA_TRUE;
+}
+
+/* Reads 'size' bytes of the loose file into 'out'. */
+static
+siBool siswa__vfsReadLoose(const siVfsLayer* layer, const char* name, void* out,
+		size_t size) {
+	size_t dirLen = SISWA_STRLEN(layer->path), nameLen = SISWA_STRLEN(name);
+	char path[PATH_MAX];
+	siBool res;
+	FILE* file;
+
+	if (dirLen + 1 + nameLen >= sizeof(path)) {
+		return SISWA_FALSE;
+	}
+	SISWA_MEMCPY(path, layer->path, dirLen);
+	path[dirLen] = '/';
+	SISWA_MEMCPY(&path[dirLen + 1], name, nameLen + 1);
+
+	file = fopen(path, "rb");
+	if (file == NULL) {
+		return SISWA_FALSE;
+	}
+	res = fread(out, 1, size, file) == size;
+	fclose(file);
+	return res;
+}
+
+
+void siswa_vfsInit(siVfs* vfs) {
+	SISWA_ASSERT_NOT_NULL(vfs);
+	SISWA_MEMSET(vfs, 0, sizeof(*vfs));
+}
+
+void siswa_vfsFree(siVfs* vfs) {
+	size_t i;
+
+	SISWA_ASSERT_NOT_NULL(vfs);
+	for (i = 0; i < vfs->layerCount; i += 1) {
+		siswa__vfsLayerFree(&vfs->layers[i]);
+	}
+	SISWA__FREE(vfs->layers);
+	SISWA__FREE(vfs->__index);
+	SISWA__FREE(vfs->__nodes);
+	SISWA_MEMSET(vfs, 0, sizeof(*vfs));
+}
+
+siBool siswa_vfsAddDirectory(siVfs* vfs, const char* path, int32_t priority) {
+	siswa__vfsScan scan;
+	siVfsLayer layer;
+	char buffer[PATH_MAX];
+	size_t len;
+
+	SISWA_ASSERT_NOT_NULL(vfs);
+	SISWA_ASSERT_NOT_NULL(path);
+
+	len = SISWA_STRLEN(path);
+	while (len > 1 && path[len - 1] == '/') {
+		len -= 1;
+	}
+	if (len >= sizeof(buffer)) {
+		return SISWA_FALSE;
+	}
+	SISWA_MEMCPY(buffer, path, len);
+	buffer[len] = '\0';
+
+	SISWA_MEMSET(&scan, 0, sizeof(scan));
+	if (!siswa__vfsScanDirectory(&scan, buffer, len, len + 1)) {
+		return SISWA_FALSE;
+	}
+	/* The scan used the buffer for the paths of the files. */
+	buffer[len] = '\0';
+
+	siswa__vfsLayerInit(&layer, buffer, SISWA_VFS_DIRECTORY, priority, 0);
+	layer.fileCount = scan.count;
+	layer.__names = scan.names;
+	layer.__sizes = scan.sizes;
+	siswa__vfsLayerPush(vfs, &layer);
+	return SISWA_TRUE;
+}
+
+siBool siswa_vfsAddArchive(siVfs* vfs, const char* path, int32_t priority) {
+	siVfsLayer layer;
+
+	SISWA_ASSERT_NOT_NULL(vfs);
+	SISWA_ASSERT_NOT_NULL(path);
+
+	siswa__vfsLayerInit(&layer, path, SISWA_VFS_ARCHIVE, priority, 1);
+	if (!siswa__vfsLayerLoad(&layer, path)) {
+		return SISWA_FALSE;
+	}
+	siswa__vfsLayerPush(vfs, &layer);
+	return SISWA_TRUE;
+}
+
+siBool siswa_vfsAddSplit(siVfs* vfs, const char* arlPath, int32_t priority) {
+	siVfsLayer layer;
+	siArlFile arl;
+	struct stat st;
+	char path[PATH_MAX];
+	size_t len, count, i;
+
+	SISWA_ASSERT_NOT_NULL(vfs);
+	SISWA_ASSERT_NOT_NULL(arlPath);
+
+	/* 'Stage.arl' gives 'Stage.ar' followed by the split number. */
+	len = SISWA_STRLEN(arlPath);
+	if (len < 4 || len + 3 >= sizeof(path) || strcmp(&arlPath[len - 4], ".arl") != 0) {
+		return SISWA_FALSE;
+	}
+	if (stat(arlPath, &st) != 0 || st.st_size < (off_t)sizeof(siArlHeader)) {
+		return SISWA_FALSE;
+	}
+
+	arl = siswa_arlMake(arlPath);
+	/* XCompress can't be decompressed yet, and the '.arl' might still be
+	 * getting written. */
+	if (arl.type == SISWA_FILE_XCOMPRESS
+			|| (arl.type == SISWA_FILE_SEGS && !siswa__segsIsComplete(arl.data, arl.len))) {
+		siswa_arlFree(arl);
+		return SISWA_FALSE;
+	}
+	if (arl.type == SISWA_FILE_SEGS) {
+#ifndef SISWA_NO_DECOMPRESSION
+		size_t size = (size_t)siswa_arlGetDecompressedSize(arl);
+		siByte* data = (siByte*)SISWA__MALLOC(SISWA_BUDGET_DECOMPRESSION, size != 0 ? size : 1);
+
+		SISWA_ASSERT_NOT_NULL(data);
+		siswa_arlDecompress(&arl, data, size, SISWA_TRUE);
+#endif
+	}
+	if (arl.type != SISWA_FILE_REGULAR || arl.len < sizeof(siArlHeader)) {
+		siswa_arlFree(arl);
+		return SISWA_FALSE;
+	}
+	count = SISWA__LE32(siswa_arlGetHeader(arl)->archiveCount);
+	siswa_arlFree(arl);
+	if (count == 0 || count > 100) {
+		return SISWA_FALSE;
+	}
+
+	siswa__vfsLayerInit(&layer, arlPath, SISWA_VFS_SPLIT, priority, count);
+	SISWA_MEMCPY(path, arlPath, len - 1);
+	for (i = 0; i < count; i += 1) {
+		sprintf(&path[len - 1], ".%02lu", (unsigned long)i);
+		if (!siswa__vfsLayerLoad(&layer, path)) {
+			return SISWA_FALSE;
+		}
+	}
+	siswa__vfsLayerPush(vfs, &layer);
+	return SISWA_TRUE;
+}
+
+void siswa_vfsMount(siVfs* vfs) {
+	siHashTable* ht;
+	size_t* order;
+	size_t total = 0, capacity, i, j;
+
+	SISWA_ASSERT_NOT_NULL(vfs);
+
+	SISWA__FREE(vfs->__index);
+	SISWA__FREE(vfs->__nodes);
+	vfs->fileCount = 0;
+
+	/* Highest priority first, so that every name gets set only once by the
+	 * layer that wins it. */
+	order = (size_t*)SISWA__MALLOC(SISWA_BUDGET_OTHER, (vfs->layerCount + 1) * sizeof(size_t));
+	SISWA_ASSERT_NOT_NULL(order);
+	for (i = 0; i < vfs->layerCount; i += 1) {
+		const siVfsLayer* layer = &vfs->layers[i];
+
+		for (j = i; j != 0 && vfs->layers[order[j - 1]].priority <= layer->priority; j -= 1) {
+			order[j] = order[j - 1];
+		}
+		order[j] = i;
+		total += layer->fileCount;
+	}
+
+	capacity = siswa__hashtableCapacity(total);
+	vfs->__index = SISWA__MALLOC(SISWA_BUDGET_INDEXES, sizeof(siHashTable) + capacity * sizeof(siHashEntry));
+	vfs->__nodes = (siVfsNode*)SISWA__MALLOC(SISWA_BUDGET_INDEXES, capacity * sizeof(siVfsNode));
+	SISWA_ASSERT_NOT_NULL(vfs->__index);
+	SISWA_ASSERT_NOT_NULL(vfs->__nodes);
+	ht = siswa__hashtableMakeReserve(vfs->__index, capacity);
+
+	for (i = 0; i < vfs->layerCount; i += 1) {
+		const siVfsLayer* layer = &vfs->layers[order[i]];
+		siVfsNode node;
+		node.layer = (uint32_t)order[i];
+
+		if (layer->type == SISWA_VFS_DIRECTORY) {
+			const char* name = layer->__names;
+			node.archive = 0;
+			node.data = NULL;
+
+			for (j = 0; j < layer->fileCount; j += 1) {
+				size_t nameLen = SISWA_STRLEN(name);
+				uint64_t hash = siswa__hashKey(name, nameLen);
+
+				if (!siswa__hashtableExists(ht, name, nameLen, hash)) {
+					node.size = (size_t)layer->__sizes[j];
+					vfs->__nodes[siswa__hashtableSet(ht, name, nameLen, hash) - ht->entries] = node;
+					vfs->fileCount += 1;
+				}
+				name += nameLen + 1;
+			}
+			continue;
+		}
+
+		for (j = 0; j < layer->arCount; j += 1) {
+			siArFile ar = layer->ars[j];
+			siArEntry* entry;
+			node.archive = (uint32_t)j;
+
+			while (siswa_arEntryPoll(&ar, &entry)) {
+				const char* name = siswa_arEntryGetName(entry);
+				size_t nameLen = SISWA_STRLEN(name);
+				uint64_t hash = siswa__hashKey(name, nameLen);
+
+				if (!siswa__hashtableExists(ht, name, nameLen, hash)) {
+					node.size = SISWA__LE32(entry->dataSize);
+					node.data = siswa_arEntryGetData(entry);
+					vfs->__nodes[siswa__hashtableSet(ht, name, nameLen, hash) - ht->entries] = node;
+					vfs->fileCount += 1;
+				}
+			}
+		}
+	}
+
+	SISWA__FREE(order);
+}
+
+const siVfsNode* siswa_vfsFind(const siVfs* vfs, const char* name) {
+	siHashTable* ht;
+	siHashEntry* entry;
+	size_t nameLen;
+
+	SISWA_ASSERT_NOT_NULL(vfs);
+	SISWA_ASSERT_NOT_NULL(name);
+	SISWA_ASSERT_MSG(vfs->__index != NULL, "The VFS must be mounted first");
+
+	ht = (siHashTable*)vfs->__index;
+	nameLen = SISWA_STRLEN(name);
+	entry = siswa__hashtableGet(ht, name, nameLen, siswa__hashKey(name, nameLen));
+	return (entry != NULL) ? &vfs->__nodes[entry - ht->entries] : NULL;
+}
+
+siBool siswa_vfsOpen(const siVfs* vfs, const char* name, siVfsFile* file) {
+	const siVfsNode* node = siswa_vfsFind(vfs, name);
+	void* data;
+
+	SISWA_ASSERT_NOT_NULL(file);
+	if (node == NULL) {
+		return SISWA_FALSE;
+	}
+
+	file->size = node->size;
+	file->layer = &vfs->layers[node->layer];
+	file->__owned = (node->data == NULL);
+	if (node->data != NULL) {
+		file->data = node->data;
+		return SISWA_TRUE;
+	}
+
+	data = SISWA__MALLOC(SISWA_BUDGET_OTHER, node->size != 0 ? node->size : 1);
+	SISWA_ASSERT_NOT_NULL(data);
+	if (!siswa__vfsReadLoose(file->layer, name, data, node->size)) {
+		SISWA__FREE(data);
+		return SISWA_FALSE;
+	}
+	file->data = data;
+	return SISWA_TRUE;
+}
+
+void siswa_vfsClose(siVfsFile* file) {
+	SISWA_ASSERT_NOT_NULL(file);
+	if (file->__owned) {
+		SISWA__FREE((void*)file->data);
+	}
+	SISWA_MEMSET(file, 0, sizeof(*file));
+}
+
+size_t siswa_vfsRead(const siVfs* vfs, const char* name, void* out, size_t capacity) {
+	const siVfsNode* node = siswa_vfsFind(vfs, name);
+
+	SISWA_ASSERT(out != NULL || capacity == 0);
+	if (node == NULL || node->size > capacity) {
+		return 0;
+	}
+
+	if (node->data != NULL) {
+		SISWA_MEMCPY(out, node->data, node->size);
+	}
+	else if (!siswa__vfsReadLoose(&vfs->layers[node->layer], name, out, node->size)) {
+		return 0;
+	}
+	return node->size;
+}
+#endif
+
+#if defined(SISWA_USE_SCHEDULER) && !defined(SISWA_NO_STDLIB)
+enum {
+	SISWA__LOAD_CONTINUE = 0,
+	SISWA__LOAD_DONE,
+	SISWA__LOAD_FAILED
+};
+
+typedef struct {
+	char* path;
+	char* name;
+	size_t nameLen;
+	/* Position of the request in the queue. */
+	size_t index;
+	uint64_t order;
+
+	FILE* file;
+	size_t fileSize;
+	/* The file as it's read. For uncompressed archives the parts that got
+	 * skipped are left uninitialized. */
+	siByte* raw;
+	size_t readPos;
+	siFileType type;
+
+	/* The decompressed archive of SEGS files. */
+	siByte* out;
+	size_t outLen;
+	size_t outPos;
+	size_t chunk;
+	size_t chunks;
+
+	/* Position of the next entry to check for 'SISWA_LOAD_ENTRY'. */
+	size_t scanPos;
+} siswa__loadJob;
+
+#define SISWA__LOAD_JOB(request) ((siswa__loadJob*)(request)->__job)
+
+uint64_t siswa_schedulerNow(void) {
+#if defined(_WIN32)
+	LARGE_INTEGER freq, counter;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&counter);
+	return (uint64_t)((double)counter.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/* Returns whether 'a' goes before 'b'. */
+static
+siBool siswa__loadBefore(const siLoadRequest* a, const siLoadRequest* b) {
+	if (a->priority != b->priority) {
+		return a->priority > b->priority;
+	}
+	if (a->deadline != b->deadline) {
+		/* Having a deadline at all beats having none. */
+		return a->deadline != 0 && (b->deadline == 0 || a->deadline < b->deadline);
+	}
+	return SISWA__LOAD_JOB(a)->order < SISWA__LOAD_JOB(b)->order;
+}
+
+static
+void siswa__loadQueueSet(siScheduler* s, size_t index, siLoadRequest* request) {
+	s->__queue[index] = request;
+	SISWA__LOAD_JOB(request)->index = index;
+}
+
+/* Moves the request at 'index' to where it belongs in the queue (a binary heap). */
+static
+void siswa__loadQueueFix(siScheduler* s, size_t index) {
+	siLoadRequest* request = s->__queue[index];
+
+	while (index != 0 && siswa__loadBefore(request, s->__queue[(index - 1) / 2])) {
+		siswa__loadQueueSet(s, index, s->__queue[(index - 1) / 2]);
+		index = (index - 1) / 2;
+	}
+	for (;;) {
+		size_t child = index * 2 + 1;
+		if (child >= s->pending) {
+			break;
+		}
+		if (child + 1 < s->pending && siswa__loadBefore(s->__queue[child + 1], s->__queue[child])) {
+			child += 1;
+		}
+		if (!siswa__loadBefore(s->__queue[child], request)) {
+			break;
+		}
+		siswa__loadQueueSet(s, index, s->__queue[child]);
+		index = child;
+	}
+	siswa__loadQueueSet(s, index, request);
+}
+
+static
+void siswa__loadQueueRemove(siScheduler* s, siLoadRequest* request) {
+	size_t index = SISWA__LOAD_JOB(request)->index;
+
+	s->pending -= 1;
+	if (index != s->pending) {
+		siswa__loadQueueSet(s, index, s->__queue[s->pending]);
+		siswa__loadQueueFix(s, index);
+	}
+}
+
+/* Frees what the request loaded, except for the results. */
+static
+void siswa__loadJobEnd(siLoadRequest* request, siLoadState state) {
+	siswa__loadJob* job = SISWA__LOAD_JOB(request);
+
+	if (job->file != NULL) {
+		fclose(job->file);
+	}
+	if (request->ar.data != job->raw) {
+		SISWA__FREE(job->raw);
+	}
+	if (request->ar.data != job->out) {
+		SISWA__FREE(job->out);
+	}
+	job->file = NULL;
+	job->raw = NULL;
+	job->out = NULL;
+
+	request->state = state;
+	request->finished = siswa_schedulerNow();
+}
+
+/* Checks the entries of the archive in 'data' (valid up to 'end') for the
+ * requested one, copying it out once all of it is there. */
+static
+uint32_t siswa__loadScan(siLoadRequest* request, const siByte* data, size_t end,
+		size_t total) {
+	siswa__loadJob* job = SISWA__LOAD_JOB(request);
+
+	while (job->scanPos < total) {
+		size_t pos = job->scanPos;
+		size_t size, dataSize, offset;
+
+		if (pos + sizeof(siArEntry) > end) {
+			return SISWA__LOAD_CONTINUE;
+		}
+		size = (size_t)siswa__read32le(&data[pos]);
+		dataSize = (size_t)siswa__read32le(&data[pos + 4]);
+		offset = (size_t)siswa__read32le(&data[pos + 8]);
+		if (offset <= sizeof(siArEntry) || offset > size || dataSize > size - offset
+				|| size > total - pos) {
+			return SISWA__LOAD_FAILED;
+		}
+
+		if (job->nameLen < offset - sizeof(siArEntry)) {
+			const char* name = (const char*)&data[pos + sizeof(siArEntry)];
+			if (pos + sizeof(siArEntry) + job->nameLen + 1 > end) {
+				return SISWA__LOAD_CONTINUE;
+			}
+
+			if (name[job->nameLen] == '\0' && siswa__nameEquals(name, job->name, job->nameLen)) {
+				if (pos + offset + dataSize > end) {
+					return SISWA__LOAD_CONTINUE;
+				}
+				request->data = SISWA__MALLOC(SISWA_BUDGET_ARCHIVES, dataSize != 0 ? dataSize : 1);
+				SISWA_ASSERT_NOT_NULL(request->data);
+				SISWA_MEMCPY(request->data, &data[pos + offset], dataSize);
+				request->size = dataSize;
+				return SISWA__LOAD_DONE;
+			}
+		}
+		job->scanPos = pos + size;
+	}
+	return SISWA__LOAD_FAILED;
+}
+
+/* Figures out the type of the archive once its start has been read. */
+static
+uint32_t siswa__loadIdentify(siLoadRequest* request) {
+	siswa__loadJob* job = SISWA__LOAD_JOB(request);
+	const siByte* raw = job->raw;
+
+	switch (siswa__read32le(raw)) {
+		case 0: {
+			job->type = SISWA_FILE_REGULAR;
+			return SISWA__LOAD_CONTINUE;
+		}
+#ifndef SISWA_NO_DECOMPRESSION
+		case SISWA_IDENTIFIER_SEGS: {
+			job->chunks = siswa__read16be(&raw[6]);
+			job->outLen = siswa__read32be(&raw[8]);
+			if (job->fileSize < sizeof(siSegsHeader) + job->chunks * sizeof(siSegsEntry)) {
+				return SISWA__LOAD_FAILED;
+			}
+
+			job->out = (siByte*)SISWA__MALLOC(SISWA_BUDGET_DECOMPRESSION, job->outLen != 0 ? job->outLen : 1);
+			SISWA_ASSERT_NOT_NULL(job->out);
+			job->type = SISWA_FILE_SEGS;
+			return SISWA__LOAD_CONTINUE;
+		}
+#endif
+	}
+	return SISWA__LOAD_FAILED;
+}
+
+#ifndef SISWA_NO_DECOMPRESSION
+/* Decompresses the next SEGS chunk if all of it has been read. Returns
+ * 'SISWA_FALSE' if it hasn't. */
+static
+siBool siswa__loadInflate(siLoadRequest* request, uint32_t* res) {
+	siswa__loadJob* job = SISWA__LOAD_JOB(request);
+	size_t tableEnd = sizeof(siSegsHeader) + job->chunks * sizeof(siSegsEntry);
+	const siByte* chunk;
+	size_t zSize, size, offset;
+
+	if (job->readPos < tableEnd) {
+		return SISWA_FALSE;
+	}
+	chunk = &job->raw[sizeof(siSegsHeader) + job->chunk * sizeof(siSegsEntry)];
+	zSize = siswa__read16be(&chunk[0]);
+	size = siswa__read16be(&chunk[2]);
+	offset = (size_t)siswa__read32be(&chunk[4]) - 1;
+	if (job->chunk == 0 && offset == 0) {
+		offset = tableEnd;
+	}
+	size += (size == 0) * 0x10000;
+
+	if (offset > job->fileSize || zSize > job->fileSize - offset || size > job->outLen - job->outPos) {
+		*res = SISWA__LOAD_FAILED;
+		return SISWA_TRUE;
+	}
+	if (offset + zSize > job->readPos) {
+		return SISWA_FALSE;
+	}
+
+	if (size == zSize) {
+		SISWA_MEMCPY(&job->out[job->outPos], &job->raw[offset], size);
+	}
+	else {
+		siswa_decompressDeflate(&job->raw[offset], zSize, &job->out[job->outPos],
+			job->outLen - job->outPos);
+	}
+	job->outPos += size;
+	job->chunk += 1;
+	request->chunksInflated += 1;
+
+	if (request->type == SISWA_LOAD_ENTRY) {
+		*res = siswa__loadScan(request, job->out, job->outPos, job->outLen);
+		if (*res == SISWA__LOAD_CONTINUE && job->chunk == job->chunks) {
+			*res = SISWA__LOAD_FAILED;
+		}
+	}
+	else if (job->chunk == job->chunks) {
+		request->ar = siswa_arMakeBuffer(job->out, job->outLen);
+		*res = siswa_arValidate(&request->ar) ? SISWA__LOAD_DONE : SISWA__LOAD_FAILED;
+	}
+	else {
+		*res = SISWA__LOAD_CONTINUE;
+	}
+	return SISWA_TRUE;
+}
+#endif
+
+/* Does one unit of work for the request. */
+static
+uint32_t siswa__loadWork(siLoadRequest* request) {
+	siswa__loadJob* job = SISWA__LOAD_JOB(request);
+	uint32_t res = SISWA__LOAD_CONTINUE;
+	size_t len;
+
+	if (job->raw == NULL) {
+		long size;
+
+		job->file = fopen(job->path, "rb");
+		if (job->file == NULL || fseek(job->file, 0, SEEK_END) != 0) {
+			return SISWA__LOAD_FAILED;
+		}
+		size = ftell(job->file);
+		if (size < (long)sizeof(siArHeader) || fseek(job->file, 0, SEEK_SET) != 0) {
+			return SISWA__LOAD_FAILED;
+		}
+		job->fileSize = (size_t)size;
+		job->raw = (siByte*)SISWA__MALLOC(SISWA_BUDGET_ARCHIVES, job->fileSize);
+		SISWA_ASSERT_NOT_NULL(job->raw);
+	}
+
+#ifndef SISWA_NO_DECOMPRESSION
+	if (job->type == SISWA_FILE_SEGS && siswa__loadInflate(request, &res)) {
+		return res;
+	}
+#endif
+
+	/* Entries that come before the requested one don't have to be read. */
+	if (job->type == SISWA_FILE_REGULAR && request->type == SISWA_LOAD_ENTRY
+			&& job->scanPos > job->readPos) {
+		if (job->scanPos >= job->fileSize || fseek(job->file, (long)job->scanPos, SEEK_SET) != 0) {
+			return SISWA__LOAD_FAILED;
+		}
+		job->readPos = job->scanPos;
+	}
+
+	len = job->fileSize - job->readPos;
+	if (len == 0) {
+		return SISWA__LOAD_FAILED;
+	}
+	if (len > SISWA_SCHEDULER_BLOCK_SIZE) {
+		len = SISWA_SCHEDULER_BLOCK_SIZE;
+	}
+	if (fread(&job->raw[job->readPos], 1, len, job->file) != len) {
+		return SISWA__LOAD_FAILED;
+	}
+	job->readPos += len;
+	request->bytesRead += len;
+
+	if (job->type == 0) {
+		res = siswa__loadIdentify(request);
+		if (res != SISWA__LOAD_CONTINUE) {
+			return res;
+		}
+	}
+
+	if (job->type == SISWA_FILE_REGULAR) {
+		if (request->type == SISWA_LOAD_ENTRY) {
+			res = siswa__loadScan(request, job->raw, job->readPos, job->fileSize);
+		}
+		else if (job->readPos == job->fileSize) {
+			request->ar = siswa_arMakeBuffer(job->raw, job->fileSize);
+			res = siswa_arValidate(&request->ar) ? SISWA__LOAD_DONE : SISWA__LOAD_FAILED;
+		}
+	}
+	if (job->readPos == job->fileSize) {
+		/* Nothing else gets read, the file can be closed early. */
+		fclose(job->file);
+		job->file = NULL;
+	}
+	return res;
+}
+
+
+void siswa_schedulerInit(siScheduler* s) {
+	SISWA_ASSERT_NOT_NULL(s);
+	SISWA_MEMSET(s, 0, sizeof(*s));
+}
+
+void siswa_schedulerFree(siScheduler* s) {
+	SISWA_ASSERT_NOT_NULL(s);
+	while (s->pending != 0) {
+		siswa_schedulerCancel(s, s->__queue[s->pending - 1]);
+	}
+	SISWA__FREE(s->__queue);
+	SISWA_MEMSET(s, 0, sizeof(*s));
+}
+
+siLoadRequest* siswa_schedulerSubmit(siScheduler* s, siLoadType type, const char* path,
+		const char* name, int32_t priority, uint64_t deadline, void* user) {
+	siLoadRequest* request;
+	siswa__loadJob* job;
+	size_t pathLen, nameLen;
+
+	SISWA_ASSERT_NOT_NULL(s);
+	SISWA_ASSERT_NOT_NULL(path);
+	SISWA_ASSERT(type == SISWA_LOAD_ARCHIVE || type == SISWA_LOAD_ENTRY);
+	SISWA_ASSERT_MSG(type != SISWA_LOAD_ENTRY || name != NULL, "Entry loads need a name");
+
+	pathLen = SISWA_STRLEN(path);
+	nameLen = (type == SISWA_LOAD_ENTRY) ? SISWA_STRLEN(name) : 0;
+	request = (siLoadRequest*)SISWA__MALLOC(SISWA_BUDGET_OTHER,
+		sizeof(siLoadRequest) + sizeof(siswa__loadJob) + pathLen + nameLen + 2
+	);
+	SISWA_ASSERT_NOT_NULL(request);
+	job = (siswa__loadJob*)(request + 1);
+
+	SISWA_MEMSET(request, 0, sizeof(siLoadRequest) + sizeof(siswa__loadJob));
+	request->type = type;
+	request->state = SISWA_LOAD_PENDING;
+	request->priority = priority;
+	request->deadline = deadline;
+	request->user = user;
+	request->ar.type = SISWA_FILE_INVALID;
+	request->queued = siswa_schedulerNow();
+	request->__job = job;
+
+	job->path = (char*)(job + 1);
+	job->name = job->path + pathLen + 1;
+	job->nameLen = nameLen;
+	job->order = s->__submitted;
+	job->scanPos = sizeof(siArHeader);
+	SISWA_MEMCPY(job->path, path, pathLen + 1);
+	SISWA_MEMCPY(job->name, (nameLen != 0) ? name : "", nameLen + 1);
+	s->__submitted += 1;
+
+	if (s->pending == s->__capacity) {
+		s->__capacity = (s->__capacity != 0) ? s->__capacity * 2 : 64;
+		s->__queue = (siLoadRequest**)SISWA__REALLOC(SISWA_BUDGET_OTHER, s->__queue, s->__capacity * sizeof(siLoadRequest*));
+		SISWA_ASSERT_NOT_NULL(s->__queue);
+	}
+	s->pending += 1;
+	siswa__loadQueueSet(s, s->pending - 1, request);
+	siswa__loadQueueFix(s, s->pending - 1);
+
+	return request;
+}
+
+void siswa_schedulerUpdate(siScheduler* s, siLoadRequest* request, int32_t priority,
+		uint64_t deadline) {
+	SISWA_ASSERT_NOT_NULL(s);
+	SISWA_ASSERT_NOT_NULL(request);
+
+	request->priority = priority;
+	request->deadline = deadline;
+	if (request->state == SISWA_LOAD_PENDING) {
+		siswa__loadQueueFix(s, SISWA__LOAD_JOB(request)->index);
+	}
+}
+
+void siswa_schedulerCancel(siScheduler* s, siLoadRequest* request) {
+	SISWA_ASSERT_NOT_NULL(s);
+	SISWA_ASSERT_NOT_NULL(request);
+
+	if (request->state == SISWA_LOAD_PENDING) {
+		siswa__loadQueueRemove(s, request);
+		siswa__loadJobEnd(request, SISWA_LOAD_CANCELLED);
+	}
+}
+
+void siswa_schedulerRelease(siScheduler* s, siLoadRequest* request) {
+	if (request != NULL) {
+		siswa_schedulerCancel(s, request);
+		SISWA__FREE(request);
+	}
+}
+
+siLoadRequest* siswa_schedulerStep(siScheduler* s) {
+	siLoadRequest* request;
+	uint32_t res;
+
+	SISWA_ASSERT_NOT_NULL(s);
+	if (s->pending == 0) {
+		return NULL;
+	}
+
+	request = s->__queue[0];
+	if (request->started == 0) {
+		request->started = siswa_schedulerNow();
+	}
+	res = siswa__loadWork(request);
+	if (res == SISWA__LOAD_CONTINUE) {
+		return NULL;
+	}
+
+	if (res == SISWA__LOAD_FAILED && request->ar.data != NULL) {
+		request->ar.data = NULL;
+		request->ar.type = SISWA_FILE_INVALID;
+	}
+	siswa__loadQueueRemove(s, request);
+	siswa__loadJobEnd(request, (res == SISWA__LOAD_DONE) ? SISWA_LOAD_DONE : SISWA_LOAD_FAILED);
+	return request;
+}
+
+size_t siswa_schedulerRun(siScheduler* s, uint64_t budget) {
+	uint64_t start = siswa_schedulerNow();
+	size_t finished = 0;
+
+	SISWA_ASSERT_NOT_NULL(s);
+	while (s->pending != 0) {
+		finished += (siswa_schedulerStep(s) != NULL);
+		if (budget != 0 && siswa_schedulerNow() - start >= budget) {
+			break;
+		}
+	}
+	return finished;
+}
+#endif
+
+
+static const siByte siswa__zeroes[64] = {0};
+
+static
+siBool siswa__arWriterPut(siArWriter* writer, const void* data, size_t len) {
+	if (writer->ok && len != 0 && writer->proc(writer->user, data, len) != len) {
+		writer->ok = SISWA_FALSE;
+	}
+	writer->len += len;
+	return writer->ok;
+}
+static
+siBool siswa__arWriterPad(siArWriter* writer, size_t len) {
+	while (len != 0) {
+		size_t n = (len < sizeof(siswa__zeroes)) ? len : sizeof(siswa__zeroes);
+		siswa__arWriterPut(writer, siswa__zeroes, n);
+		len -= n;
+	}
+	return writer->ok;
+}
+
+void siswa_arWriterInit(siArWriter* writer, siWriteProc proc, void* user, uint32_t alignment) {
+	siArHeader header;
+	SISWA_ASSERT_NOT_NULL(writer);
+	SISWA_ASSERT_NOT_NULL(proc);
+
+	writer->proc = proc;
+	writer->user = user;
+	writer->len = 0;
+	writer->alignment = alignment;
+	writer->ok = SISWA_TRUE;
+	writer->__left = 0;
+	writer->__trailing = 0;
+
+	header.unknown = 0;
+	header.headerSizeof = SISWA__LE32(sizeof(siArHeader));
+	header.entrySizeof = SISWA__LE32(sizeof(siArEntry));
+	header.alignment = SISWA__LE32(alignment);
+	siswa__arWriterPut(writer, &header, sizeof(header));
+}
+siBool siswa_arWriterEntryBegin(siArWriter* writer, const char* name, size_t nameLen,
+		uint32_t dataSize, const uint8_t filedate[8]) {
+	siArEntry entry;
+	size_t dataStart = writer->len + sizeof(siArEntry) + nameLen + 1;
+
+	if (writer->alignment > 1) {
+		dataStart += (writer->alignment - dataStart % writer->alignment) % writer->alignment;
+	}
+	entry.offset = SISWA__LE32((uint32_t)(dataStart - writer->len));
+	entry.dataSize = SISWA__LE32(dataSize);
+	entry.size = SISWA__LE32((uint32_t)(dataStart - writer->len) + dataSize);
+	if (filedate != NULL) {
+		SISWA_MEMCPY(entry.filedate, filedate, sizeof(entry.filedate));
+	}
+	else {
+		SISWA_MEMSET(entry.filedate, 0, sizeof(entry.filedate));
+	}
+
+	return siswa_arWriterEntryBeginRaw(writer, &entry, name, nameLen);
+}
+siBool siswa_arWriterEntryBeginRaw(siArWriter* writer, const siArEntry* header,
+		const char* name, size_t nameLen) {
+	SISWA_ASSERT_NOT_NULL(writer);
+	SISWA_ASSERT_NOT_NULL(header);
+	SISWA_ASSERT_NOT_NULL(name);
+	SISWA_ASSERT_MSG(writer->__left == 0, "The data of the previous entry wasn't fully written");
+	SISWA_ASSERT_MSG(
+		SISWA__LE32(header->offset) > sizeof(siArEntry) + nameLen && SISWA__LE32(header->offset) <= SISWA__LE32(header->size)
+			&& SISWA__LE32(header->dataSize) <= SISWA__LE32(header->size) - SISWA__LE32(header->offset),
+		"Malformed entry header"
+	);
+
+	siswa__arWriterPut(writer, header, sizeof(siArEntry));
+	siswa__arWriterPut(writer, name, nameLen);
+	siswa__arWriterPad(writer, SISWA__LE32(header->offset) - sizeof(siArEntry) - nameLen);
+
+	writer->__left = SISWA__LE32(header->dataSize);
+	writer->__trailing = SISWA__LE32(header->size) - SISWA__LE32(header->offset) - SISWA__LE32(header->dataSize);
+	if (writer->__left == 0) {
+		siswa__arWriterPad(writer, writer->__trailing);
+	}
+	return writer->ok;
+}
+siBool siswa_arWriterEntryWrite(siArWriter* writer, const void* data, size_t len) {
+	SISWA_ASSERT_NOT_NULL(writer);
+	SISWA_ASSERT_MSG(len <= writer->__left, "Written more data than the entry's size");
+
+	siswa__arWriterPut(writer, data, len);
+	writer->__left -= (uint32_t)len;
+	if (writer->__left == 0 && len != 0) {
+		siswa__arWriterPad(writer, writer->__trailing);
+	}
+	return writer->ok;
+}
+siBool siswa_arWriterAdd(siArWriter* writer, const char* name, size_t nameLen,
+		const void* data, uint32_t dataSize, const uint8_t filedate[8]) {
+	siswa_arWriterEntryBegin(writer, name, nameLen, dataSize, filedate);
+	return siswa_arWriterEntryWrite(writer, data, dataSize);
+}
+siBool siswa_arWriterEnd(siArWriter* writer) {
+	SISWA_ASSERT_NOT_NULL(writer);
+	SISWA_ASSERT_MSG(writer->__left == 0, "The data of the last entry wasn't fully written");
+	return writer->ok;
+}
+
+
+/* Buffered reader over a 'siReadProc', so that the patch can be read a byte at
+ * a time without a callback for each. */
+typedef struct {
+	siReadProc proc;
+	void* user;
+	size_t pos;
+	size_t len;
+	/* Total amount of consumed bytes. */
+	size_t total;
+	siByte buf[SISWA_READER_BUFFER_SIZE];
+} siswa__reader;
+
+static
+size_t siswa__readerRead(siswa__reader* r, void* out, size_t len) {
+	siByte* dst = (siByte*)out;
+	size_t left = len;
+
+	while (left != 0) {
+		size_t n;
+		if (r->pos == r->len) {
+			r->pos = 0;
+			r->len = r->proc(r->user, r->buf, sizeof(r->buf));
+			if (r->len == 0) {
+				break;
+			}
+		}
+		n = (left < r->len - r->pos) ? left : r->len - r->pos;
+		SISWA_MEMCPY(dst, &r->buf[r->pos], n);
+		r->pos += n;
+		dst += n;
+		left -= n;
+	}
+
+	r->total += len - left;
+	return len - left;
+}
+static
+siBool siswa__readerVarint(siswa__reader* r, uint64_t* out) {
+	uint64_t value = 0;
+	uint32_t shift;
+
+	for (shift = 0; shift < 64; shift += 7) {
+		siByte byte;
+		if (siswa__readerRead(r, &byte, 1) != 1) {
+			return SISWA_FALSE;
+		}
+		value |= (uint64_t)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0) {
+			*out = value;
+			return SISWA_TRUE;
+		}
+	}
+	return SISWA_FALSE;
+}
+/* Moves 'len' bytes from the reader into the writer. */
+static
+siBool siswa__readerPipe(siswa__reader* r, siArWriter* writer, size_t len) {
+	while (len != 0) {
+		size_t n;
+		if (r->pos == r->len) {
+			r->pos = 0;
+			r->len = r->proc(r->user, r->buf, sizeof(r->buf));
+			if (r->len == 0) {
+				return SISWA_FALSE;
+			}
+		}
+		n = (len < r->len - r->pos) ? len : r->len - r->pos;
+		siswa_arWriterEntryWrite(writer, &r->buf[r->pos], n);
+		r->pos += n;
+		r->total += n;
+		len -= n;
+	}
+	return writer->ok;
+}
+
+/* Forwards the output of the patch while hashing it. */
+typedef struct {
+	siWriteProc proc;
+	void* user;
+	siXxh64State xxh;
+} siswa__hashingWriter;
+
+static
+size_t siswa__hashingWrite(void* user, const void* data, size_t len) {
+	siswa__hashingWriter* hw = (siswa__hashingWriter*)user;
+	siswa_xxh64Update(&hw->xxh, data, len);
+	return (hw->proc != NULL) ? hw->proc(hw->user, data, len) : len;
+}
+
+
+/* Size of the blocks that get indexed in the old data. Matches shorter than
+ * this aren't found. */
+#define SISWA__DELTA_BLOCK 16
+#define SISWA__DELTA_MUL 0x01000193u
+
+static
+size_t siswa__varintWrite(siByte* out, uint64_t value) {
+	size_t len = 0;
+	while (value >= 0x80) {
+		out[len] = (siByte)(value | 0x80);
+		value >>= 7;
+		len += 1;
+	}
+	out[len] = (siByte)value;
+	return len + 1;
+}
+
+static
+uint32_t siswa__deltaHash(const siByte* p) {
+	uint32_t h = 0;
+	size_t i;
+	for (i = 0; i < SISWA__DELTA_BLOCK; i += 1) {
+		h = h * SISWA__DELTA_MUL + p[i];
+	}
+	return h;
+}
+
+/* Appends an insert operation, returns SISWA_FALSE if 'out' is full. */
+static
+siBool siswa__deltaInsert(siByte* out, size_t* outLen, size_t cap, const siByte* data,
+		size_t len) {
+	siByte varint[10];
+	size_t n;
+
+	if (len == 0) {
+		return SISWA_TRUE;
+	}
+	n = siswa__varintWrite(varint, (uint64_t)len << 1);
+	if (cap - *outLen < n + len) {
+		return SISWA_FALSE;
+	}
+	SISWA_MEMCPY(&out[*outLen], varint, n);
+	SISWA_MEMCPY(&out[*outLen + n], data, len);
+	*outLen += n + len;
+	return SISWA_TRUE;
+}
+
+/* Encodes 'newData' as copy/insert operations against 'oldData' into 'out'.
+ * Returns 0 if the operations don't fit in 'cap' bytes. 'table' must have
+ * '1 << tableBits' entries. */
+static
+size_t siswa__deltaEncode(const siByte* oldData, size_t oldLen, const siByte* newData,
+		size_t newLen, uint32_t* table, uint32_t tableBits, siByte* out, size_t cap) {
+	size_t outLen = 0, i = 0, literal = 0, p;
+	uint32_t h = 0, power = 1;
+
+	SISWA_MEMSET(table, 0, ((size_t)1 << tableBits) * sizeof(uint32_t));
+	for (p = 0; p + SISWA__DELTA_BLOCK <= oldLen; p += SISWA__DELTA_BLOCK) {
+		uint32_t slot = (siswa__deltaHash(&oldData[p]) * 0x9E3779B1u) >> (32 - tableBits);
+		table[slot] = (uint32_t)p + 1;
+	}
+	for (p = 1; p < SISWA__DELTA_BLOCK; p += 1) {
+		power *= SISWA__DELTA_MUL;
+	}
+
+	if (newLen >= SISWA__DELTA_BLOCK) {
+		h = siswa__deltaHash(newData);
+	}
+	while (i + SISWA__DELTA_BLOCK <= newLen) {
+		uint32_t candidate = table[(h * 0x9E3779B1u) >> (32 - tableBits)];
+
+		if (candidate != 0 && siswa__nameEquals(
+				(const char*)&oldData[candidate - 1], (const char*)&newData[i], SISWA__DELTA_BLOCK
+			)) {
+			size_t src = candidate - 1, len = SISWA__DELTA_BLOCK;
+			siByte varint[20];
+			size_t n;
+
+			/* Extend the match in both directions. */
+			while (i > literal && src > 0 && oldData[src - 1] == newData[i - 1]) {
+				i -= 1;
+				src -= 1;
+				len += 1;
+			}
+			while (i + len < newLen && src + len < oldLen && oldData[src + len] == newData[i + len]) {
+				len += 1;
+			}
+
+			if (!siswa__deltaInsert(out, &outLen, cap, &newData[literal], i - literal)) {
+				return 0;
+			}
+			n = siswa__varintWrite(varint, ((uint64_t)len << 1) | 1);
+			n += siswa__varintWrite(&varint[n], src);
+			if (cap - outLen < n) {
+				return 0;
+			}
+			SISWA_MEMCPY(&out[outLen], varint, n);
+			outLen += n;
+
+			i += len;
+			literal = i;
+			if (i + SISWA__DELTA_BLOCK <= newLen) {
+				h = siswa__deltaHash(&newData[i]);
+			}
+			continue;
+		}
+
+		/* Roll the hash over by one byte. */
+		if (i + SISWA__DELTA_BLOCK < newLen) {
+			h = (h - newData[i] * power) * SISWA__DELTA_MUL + newData[i + SISWA__DELTA_BLOCK];
+		}
+		i += 1;
+	}
+
+	if (!siswa__deltaInsert(out, &outLen, cap, &newData[literal], newLen - literal)) {
+		return 0;
+	}
+	return outLen;
+}
+
+
+#ifndef SISWA_NO_STDLIB
+size_t siswa_arPatchCreate(siArFile a, siArFile b, siWriteProc proc, void* user) {
+	siPatchHeader header;
+	siswa__hashingWriter hw;
+	siArWriter writer;
+	siDiffEntry* records;
+	size_t recordCount, count, i, total = 0;
+	uint32_t* table = NULL;
+	uint32_t tableBits = 0;
+	siByte* ops = NULL;
+	size_t opsCap = 0;
+	siBool ok = SISWA_TRUE;
+
+	SISWA_ASSERT_NOT_NULL(proc);
+	SISWA_ASSERT_MSG(
+		a.type == SISWA_FILE_REGULAR && b.type == SISWA_FILE_REGULAR,
+		"The archives must be decompressed"
+	);
+
+	count = siswa_arGetEntryCount(a) + siswa_arGetEntryCount(b);
+	records = (siDiffEntry*)SISWA__MALLOC(SISWA_BUDGET_OTHER, (count + 1) * sizeof(siDiffEntry));
+	SISWA_ASSERT_NOT_NULL(records);
+	count = siswa__arDiff(a, NULL, b, NULL, records, count, 1, SISWA_TRUE);
+
+	/* Removed entries come last and aren't part of the new archive. */
+	recordCount = 0;
+	while (recordCount < count && records[recordCount].type != SISWA_DIFF_REMOVED) {
+		recordCount += 1;
+	}
+
+	/* The header needs the hash of what applying the patch gives, which is
+	 * 'b' with all of its padding zeroed out. */
+	hw.proc = NULL;
+	siswa_xxh64Init(&hw.xxh, 0);
+	siswa_arWriterInit(&writer, siswa__hashingWrite, &hw, SISWA__LE32(siswa_arGetHeader(b)->alignment));
+	for (i = 0; i < recordCount; i += 1) {
+		const siArEntry* entry = records[i].b;
+		const char* name = siswa_arEntryGetName(entry);
+		siswa_arWriterEntryBeginRaw(&writer, entry, name, SISWA_STRLEN(name));
+		siswa_arWriterEntryWrite(&writer, siswa_arEntryGetData(entry), SISWA__LE32(entry->dataSize));
+	}
+
+	header.identifier = SISWA__LE32(SISWA_IDENTIFIER_PATCH);
+	header.version = SISWA__LE32(SISWA_PATCH_VERSION);
+	header.recordCount = SISWA__LE32((uint32_t)recordCount);
+	/* Already little-endian. */
+	header.alignment = siswa_arGetHeader(b)->alignment;
+	header.oldLen = SISWA__LE32((uint32_t)a.len);
+	header.newLen = SISWA__LE32((uint32_t)writer.len);
+	header.newHash = SISWA__LE64(siswa_xxh64Digest(&hw.xxh));
+	ok &= (proc(user, &header, sizeof(header)) == sizeof(header));
+	total += sizeof(header);
+
+	for (i = 0; i < recordCount && ok; i += 1) {
+		const siDiffEntry* change = &records[i];
+		const char* name = siswa_arEntryGetName(change->b);
+		const siByte* data = (const siByte*)siswa_arEntryGetData(change->b);
+		const siByte* payload = data;
+		siPatchRecord record, stored;
+
+		record.type = SISWA_PATCH_ADD;
+		record.source = 0;
+		record.nameLen = (uint32_t)SISWA_STRLEN(name);
+		record.payloadSize = SISWA__LE32(change->b->dataSize);
+		SISWA_MEMCPY(&record.entry, change->b, sizeof(siArEntry));
+
+		if (change->type == SISWA__DIFF_UNCHANGED) {
+			record.type = SISWA_PATCH_KEEP;
+			record.payloadSize = 0;
+		}
+		else if (change->type == SISWA_DIFF_CHANGED && SISWA__LE32(change->a->dataSize) >= SISWA__DELTA_BLOCK) {
+			size_t oldLen = SISWA__LE32(change->a->dataSize), opsLen;
+			uint32_t bits = 4;
+
+			while (((size_t)1 << bits) < (oldLen / SISWA__DELTA_BLOCK) * 2 && bits < 24) {
+				bits += 1;
+			}
+			if (bits > tableBits) {
+				SISWA__FREE(table);
+				table = (uint32_t*)SISWA__MALLOC(SISWA_BUDGET_OTHER, ((size_t)1 << bits) * sizeof(uint32_t));
+				SISWA_ASSERT_NOT_NULL(table);
+				tableBits = bits;
+			}
+			if (record.payloadSize > opsCap) {
+				SISWA__FREE(ops);
+				opsCap = record.payloadSize;
+				ops = (siByte*)SISWA__MALLOC(SISWA_BUDGET_OTHER, opsCap);
+				SISWA_ASSERT_NOT_NULL(ops);
+			}
+
+			/* Stored whole if the delta isn't any smaller than the data. */
+			opsLen = siswa__deltaEncode(
+				(const siByte*)siswa_arEntryGetData(change->a), oldLen, data,
+				SISWA__LE32(change->b->dataSize), table, bits, ops, record.payloadSize
+			);
+			if (opsLen != 0) {
+				record.type = SISWA_PATCH_DELTA;
+				record.payloadSize = (uint32_t)opsLen;
+				payload = ops;
+			}
+		}
+
+		if (record.type != SISWA_PATCH_ADD) {
+			record.source = (uint32_t)((siByte*)change->a - a.data);
+			record.nameLen = 0;
+		}
+
+		stored = record;
+		stored.type = SISWA__LE32(record.type);
+		stored.source = SISWA__LE32(record.source);
+		stored.nameLen = SISWA__LE32(record.nameLen);
+		stored.payloadSize = SISWA__LE32(record.payloadSize);
+		ok &= (proc(user, &stored, sizeof(stored)) == sizeof(stored));
+		if (record.nameLen != 0) {
+			ok &= (proc(user, name, record.nameLen) == record.nameLen);
+		}
+		if (record.payloadSize != 0) {
+			ok &= (proc(user, payload, record.payloadSize) == record.payloadSize);
+		}
+		total += sizeof(record) + record.nameLen + record.payloadSize;
+	}
+
+	SISWA__FREE(ops);
+	SISWA__FREE(table);
+	SISWA__FREE(records);
+	return ok ? total : 0;
+}
+#endif
+
+/* Checks if 'offset' is the start of an entry, with 'offsets' being the sorted
+ * offsets of every entry. */
+static
+siBool siswa__offsetIsEntry(const uint32_t* offsets, size_t count, size_t offset) {
+	size_t low = 0, high = count;
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		if (offsets[mid] < offset) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+	return low < count && offsets[low] == offset;
+}
+
+static
+siBool siswa__arPatchApply(siArFile a, const uint32_t* offsets, size_t count,
+		siReadProc patch, void* patchUser, siWriteProc out, void* outUser) {
+	siswa__reader r;
+	siswa__hashingWriter hw;
+	siArWriter writer;
+	siPatchHeader header;
+	uint32_t i;
+	char name[1024];
+
+	r.proc = patch;
+	r.user = patchUser;
+	r.pos = r.len = r.total = 0;
+	if (siswa__readerRead(&r, &header, sizeof(header)) != sizeof(header)
+			|| SISWA__LE32(header.identifier) != SISWA_IDENTIFIER_PATCH
+			|| SISWA__LE32(header.version) != SISWA_PATCH_VERSION
+			|| SISWA__LE32(header.oldLen) != a.len) {
+		return SISWA_FAILURE;
+	}
+
+	hw.proc = out;
+	hw.user = outUser;
+	siswa_xxh64Init(&hw.xxh, 0);
+	siswa_arWriterInit(&writer, siswa__hashingWrite, &hw, SISWA__LE32(header.alignment));
+
+	for (i = 0; i < SISWA__LE32(header.recordCount) && writer.ok; i += 1) {
+		siPatchRecord record;
+		const siArEntry* old = NULL;
+		const siByte* oldData = NULL;
+		const char* entryName = name;
+		size_t nameLen, start;
+
+		if (siswa__readerRead(&r, &record, sizeof(record)) != sizeof(record)) {
+			return SISWA_FAILURE;
+		}
+		/* Converted in place, except for the entry that gets written as-is. */
+		record.type = SISWA__LE32(record.type);
+		record.source = SISWA__LE32(record.source);
+		record.nameLen = SISWA__LE32(record.nameLen);
+		record.payloadSize = SISWA__LE32(record.payloadSize);
+		if (record.type < SISWA_PATCH_KEEP || record.type > SISWA_PATCH_DELTA
+				|| record.nameLen >= sizeof(name)) {
+			return SISWA_FAILURE;
+		}
+
+		if (record.type != SISWA_PATCH_ADD) {
+			/* The source comes from the patch, which might not belong to the
+			 * archive even if the archive itself got validated. */
+			if (!siswa__offsetIsEntry(offsets, count, record.source)
+					|| !siswa__arEntryIsValid(&a, record.source)) {
+				return SISWA_FAILURE;
+			}
+			old = (const siArEntry*)&a.data[record.source];
+			oldData = (const siByte*)siswa_arEntryGetData(old);
+		}
+
+		if (record.nameLen != 0) {
+			if (siswa__readerRead(&r, name, record.nameLen) != record.nameLen) {
+				return SISWA_FAILURE;
+			}
+			nameLen = record.nameLen;
+		}
+		else if (old != NULL) {
+			entryName = siswa_arEntryGetName(old);
+			nameLen = SISWA_STRLEN(entryName);
+		}
+		else {
+			return SISWA_FAILURE;
+		}
+
+		if (SISWA__LE32(record.entry.offset) <= sizeof(siArEntry) + nameLen
+				|| SISWA__LE32(record.entry.offset) > SISWA__LE32(record.entry.size)
+				|| SISWA__LE32(record.entry.dataSize) > SISWA__LE32(record.entry.size) - SISWA__LE32(record.entry.offset)) {
+			return SISWA_FAILURE;
+		}
+		siswa_arWriterEntryBeginRaw(&writer, &record.entry, entryName, nameLen);
+
+		switch (record.type) {
+			case SISWA_PATCH_KEEP: {
+				if (SISWA__LE32(old->dataSize) != SISWA__LE32(record.entry.dataSize)) {
+					return SISWA_FAILURE;
+				}
+				siswa_arWriterEntryWrite(&writer, oldData, SISWA__LE32(old->dataSize));
+				break;
+			}
+			case SISWA_PATCH_ADD: {
+				if (record.payloadSize != SISWA__LE32(record.entry.dataSize)
+						|| !siswa__readerPipe(&r, &writer, record.payloadSize)) {
+					return SISWA_FAILURE;
+				}
+				break;
+			}
+			case SISWA_PATCH_DELTA: {
+				size_t left = SISWA__LE32(record.entry.dataSize);
+				start = r.total;
+
+				while (r.total - start < record.payloadSize) {
+					uint64_t op, len;
+					if (!siswa__readerVarint(&r, &op)) {
+						return SISWA_FAILURE;
+					}
+					len = op >> 1;
+					if (len > left) {
+						return SISWA_FAILURE;
+					}
+
+					if (op & 1) {
+						uint64_t src;
+						if (!siswa__readerVarint(&r, &src) || src > SISWA__LE32(old->dataSize)
+								|| len > SISWA__LE32(old->dataSize) - src) {
+							return SISWA_FAILURE;
+						}
+						siswa_arWriterEntryWrite(&writer, &oldData[src], (size_t)len);
+					}
+					else if (!siswa__readerPipe(&r, &writer, (size_t)len)) {
+						return SISWA_FAILURE;
+					}
+					left -= (size_t)len;
+				}
+				if (left != 0 || r.total - start != record.payloadSize) {
+					return SISWA_FAILURE;
+				}
+				break;
+			}
+		}
+	}
+
+	return siswa_arWriterEnd(&writer) && writer.len == SISWA__LE32(header.newLen)
+		&& siswa_xxh64Digest(&hw.xxh) == SISWA__LE64(header.newHash);
+}
+
+siBool siswa_arPatchApply(siArFile a, siReadProc patch, void* patchUser,
+		siWriteProc out, void* outUser) {
+	size_t count, memSize, i = 0;
+	uint32_t* offsets;
+	siArEntry* entry;
+	siBool res;
+	void* memory;
+	char allocator[SISWA_DEFAULT_STACK_SIZE];
+
+	SISWA_ASSERT_NOT_NULL(patch);
+	SISWA_ASSERT_NOT_NULL(out);
+	SISWA_ASSERT_MSG(a.type == SISWA_FILE_REGULAR, "The archive must be decompressed");
+
+	count = siswa_arGetEntryCount(a);
+	memSize = count * sizeof(uint32_t) + 1;
+	memory = allocator;
+	if (memSize > sizeof(allocator)) {
+#ifndef SISWA_NO_STDLIB
+		memory = SISWA__MALLOC(SISWA_BUDGET_INDEXES, memSize);
+		SISWA_ASSERT_NOT_NULL(memory);
+#else
+		SISWA_ASSERT_MSG(memSize <= sizeof(allocator),
+			"Too many entries to patch, increase 'SISWA_DEFAULT_STACK_SIZE'");
+#endif
+	}
+
+	/* The sources of the patch get checked against the offsets of the entries,
+	 * which come out sorted. */
+	offsets = (uint32_t*)memory;
+	a.__curOffset = sizeof(siArHeader);
+	while (i < count && siswa_arEntryPoll(&a, &entry)) {
+		offsets[i] = (uint32_t)((siByte*)entry - a.data);
+		i += 1;
+	}
+	siswa_arOffsetReset(&a);
+
+	res = siswa__arPatchApply(a, offsets, i, patch, patchUser, out, outUser);
+
+#ifndef SISWA_NO_STDLIB
+	if (memory != allocator) {
+		SISWA__FREE(memory);
+	}
+#endif
+	return res;
+}
+
+
+size_t siswa_arRefsCreate(siArFile ar, const siByte* sha256, siWriteProc proc, void* user) {
+	siRefsHeader header;
+	siswa__hashingWriter hw;
+	siArWriter writer;
+	siArEntry* entry;
+	size_t total, count, i;
+	siBool ok;
+
+	SISWA_ASSERT_NOT_NULL(proc);
+	SISWA_ASSERT_MSG(ar.type == SISWA_FILE_REGULAR, "The archive must be decompressed");
+
+	/* The header needs the hash of the rebuilt archive, which is the archive
+	 * with all of its padding zeroed out. */
+	hw.proc = NULL;
+	siswa_xxh64Init(&hw.xxh, 0);
+	siswa_arWriterInit(&writer, siswa__hashingWrite, &hw, SISWA__LE32(siswa_arGetHeader(ar)->alignment));
+
+	count = 0;
+	ar.__curOffset = sizeof(siArHeader);
+	while (siswa_arEntryPoll(&ar, &entry)) {
+		const char* name = siswa_arEntryGetName(entry);
+		siswa_arWriterEntryBeginRaw(&writer, entry, name, SISWA_STRLEN(name));
+		siswa_arWriterEntryWrite(&writer, siswa_arEntryGetData(entry), SISWA__LE32(entry->dataSize));
+		count += 1;
+	}
+
+	header.identifier = SISWA__LE32(SISWA_IDENTIFIER_REFS);
+	header.version = SISWA__LE32(SISWA_REFS_VERSION);
+	header.entryCount = SISWA__LE32((uint32_t)count);
+	/* Already little-endian. */
+	header.alignment = siswa_arGetHeader(ar)->alignment;
+	header.len = SISWA__LE32((uint32_t)writer.len);
+	header.reserved = 0;
+	header.hash = SISWA__LE64(siswa_xxh64Digest(&hw.xxh));
+	ok = (proc(user, &header, sizeof(header)) == sizeof(header));
+	total = sizeof(header);
+
+	i = 0;
+	ar.__curOffset = sizeof(siArHeader);
+	while (ok && siswa_arEntryPoll(&ar, &entry)) {
+		siRefsRecord record;
+		const char* name = siswa_arEntryGetName(entry);
+		uint32_t nameLen;
+
+		if (sha256 != NULL) {
+			SISWA_MEMCPY(record.sha256, &sha256[i * SISWA_SHA256_SIZE], SISWA_SHA256_SIZE);
+		}
+		else {
+			siSha256State state;
+			siswa_sha256Init(&state);
+			siswa_sha256Update(&state, siswa_arEntryGetData(entry), SISWA__LE32(entry->dataSize));
+			siswa_sha256Final(&state, record.sha256);
+		}
+		nameLen = (uint32_t)SISWA_STRLEN(name);
+		record.nameLen = SISWA__LE32(nameLen);
+		SISWA_MEMCPY(&record.entry, entry, sizeof(siArEntry));
+
+		ok &= (proc(user, &record, sizeof(record)) == sizeof(record));
+		ok &= (proc(user, name, nameLen) == nameLen);
+		total += sizeof(record) + nameLen;
+		i += 1;
+	}
+
+	return ok ? total : 0;
+}
+
+siBool siswa_arRefsRebuild(siReadProc refs, void* refsUser, siFetchProc fetch,
+		void* fetchUser, siWriteProc out, void* outUser) {
+	siswa__reader r;
+	siswa__hashingWriter hw;
+	siArWriter writer;
+	siRefsHeader header;
+	uint32_t i;
+	char name[1024];
+
+	SISWA_ASSERT_NOT_NULL(refs);
+	SISWA_ASSERT_NOT_NULL(fetch);
+	SISWA_ASSERT_NOT_NULL(out);
+
+	r.proc = refs;
+	r.user = refsUser;
+	r.pos = r.len = r.total = 0;
+	if (siswa__readerRead(&r, &header, sizeof(header)) != sizeof(header)
+			|| SISWA__LE32(header.identifier) != SISWA_IDENTIFIER_REFS
+			|| SISWA__LE32(header.version) != SISWA_REFS_VERSION) {
+		return SISWA_FAILURE;
+	}
+
+	hw.proc = out;
+	hw.user = outUser;
+	siswa_xxh64Init(&hw.xxh, 0);
+	siswa_arWriterInit(&writer, siswa__hashingWrite, &hw, SISWA__LE32(header.alignment));
+
+	for (i = 0; i < SISWA__LE32(header.entryCount) && writer.ok; i += 1) {
+		siRefsRecord record;
+		const siArEntry* entry = &record.entry;
+		uint32_t nameLen;
+
+		if (siswa__readerRead(&r, &record, sizeof(record)) != sizeof(record)) {
+			return SISWA_FAILURE;
+		}
+		nameLen = SISWA__LE32(record.nameLen);
+		if (nameLen >= sizeof(name)
+				|| siswa__readerRead(&r, name, nameLen) != nameLen
+				|| SISWA__LE32(entry->offset) <= sizeof(siArEntry) + nameLen
+				|| SISWA__LE32(entry->offset) > SISWA__LE32(entry->size)
+				|| SISWA__LE32(entry->dataSize) > SISWA__LE32(entry->size) - SISWA__LE32(entry->offset)) {
+			return SISWA_FAILURE;
+		}
+
+		siswa_arWriterEntryBeginRaw(&writer, entry, name, nameLen);
+		if (!fetch(fetchUser, record.sha256, SISWA__LE32(entry->dataSize), &writer)
+				|| writer.__left != 0) {
+			return SISWA_FAILURE;
+		}
+	}
+
+	return siswa_arWriterEnd(&writer) && writer.len == SISWA__LE32(header.len)
+		&& siswa_xxh64Digest(&hw.xxh) == SISWA__LE64(header.hash);
+}
+
+
+/* POSIX ustar header. Numbers are octal text, except for GNU tar's base-256
+ * numbers (flagged by the top bit) that it uses for whatever doesn't fit. */
+typedef struct {
+	char name[100];
+	char mode[8];
+	char uid[8];
+	char gid[8];
+	char size[12];
+	char mtime[12];
+	char checksum[8];
+	char type;
+	char linkname[100];
+	char magic[6];
+	char version[2];
+	char uname[32];
+	char gname[32];
+	char devmajor[8];
+	char devminor[8];
+	char prefix[155];
+	char pad[12];
+} siswa__tarHeader;
+SISWA_STATIC_ASSERT(sizeof(siswa__tarHeader) == 512);
+
+#define SISWA__TAR_BLOCK 512
+/* Biggest number that fits into the 11 digits of the size and date fields. */
+#define SISWA__TAR_MAX_OCTAL (((uint64_t)1 << 33) - 1)
+#define SISWA__TAR_PADDING(len) ((SISWA__TAR_BLOCK - (size_t)((len) % SISWA__TAR_BLOCK)) % SISWA__TAR_BLOCK)
+
+/* What pax and GNU headers say about the file that comes after them. */
+typedef struct {
+	char name[1024];
+	size_t nameLen;
+	uint64_t size;
+	uint64_t mtime;
+	uint32_t nanoseconds;
+	siBool hasSize;
+	siBool hasMtime;
+} siswa__tarOverride;
+
+static
+siBool siswa__readerSkip(siswa__reader* r, uint64_t len) {
+	while (len != 0) {
+		size_t n;
+		if (r->pos == r->len) {
+			r->pos = 0;
+			r->len = r->proc(r->user, r->buf, sizeof(r->buf));
+			if (r->len == 0) {
+				return SISWA_FALSE;
+			}
+		}
+		n = (len < r->len - r->pos) ? (size_t)len : r->len - r->pos;
+		r->pos += n;
+		r->total += n;
+		len -= n;
+	}
+	return SISWA_TRUE;
+}
+
+static
+siBool siswa__tarNumber(const char* field, size_t len, uint64_t* out) {
+	uint64_t value = 0;
+	size_t i = 0;
+
+	if ((siByte)field[0] & 0x80) {
+		/* Negative numbers are never valid here. */
+		if ((siByte)field[0] != 0x80) {
+			return SISWA_FALSE;
+		}
+		for (i = 1; i < len; i += 1) {
+			if ((value >> 56) != 0) {
+				return SISWA_FALSE;
+			}
+			value = (value << 8) | (siByte)field[i];
+		}
+		*out = value;
+		return SISWA_TRUE;
+	}
+
+	while (i < len && field[i] == ' ') {
+		i += 1;
+	}
+	while (i < len && field[i] >= '0' && field[i] <= '7') {
+		value = (value << 3) | (uint64_t)(field[i] - '0');
+		i += 1;
+	}
+	if (i < len && field[i] != ' ' && field[i] != '\0') {
+		return SISWA_FALSE;
+	}
+	*out = value;
+	return SISWA_TRUE;
+}
+
+/* Writes the number as 'len - 1' octal digits and a NUL. */
+static
+void siswa__tarOctal(char* field, size_t len, uint64_t value) {
+	size_t i = len - 1;
+
+	field[i] = '\0';
+	while (i != 0) {
+		i -= 1;
+		field[i] = (char)('0' + (value & 7));
+		value >>= 3;
+	}
+}
+
+/* Sum of every byte of the header, with the checksum itself counting as spaces. */
+static
+uint32_t siswa__tarChecksum(const siswa__tarHeader* header) {
+	const siByte* bytes = (const siByte*)header;
+	uint32_t sum = 8 * ' ';
+	size_t i;
+
+	for (i = 0; i < sizeof(siswa__tarHeader); i += 1) {
+		if (i < offsetof(siswa__tarHeader, checksum)
+				|| i >= offsetof(siswa__tarHeader, checksum) + sizeof(header->checksum)) {
+			sum += bytes[i];
+		}
+	}
+	return sum;
+}
+
+/* Applies the 'length key=value\n' records of a pax header. Records that are
+ * too long for the buffer get skipped, unless it's the name. */
+static
+siBool siswa__tarReadPax(siswa__reader* r, uint64_t size, siswa__tarOverride* o) {
+	char record[sizeof(o->name) + 16];
+
+	while (size != 0) {
+		uint64_t len = 0, rest;
+		size_t digits = 0, n, i;
+		const char* value;
+		char c;
+
+		for (;;) {
+			if (siswa__readerRead(r, &c, 1) != 1) {
+				return SISWA_FALSE;
+			}
+			digits += 1;
+			if (c == ' ' && digits != 1) {
+				break;
+			}
+			if (c < '0' || c > '9' || digits > 19) {
+				return SISWA_FALSE;
+			}
+			len = len * 10 + (uint64_t)(c - '0');
+		}
+		if (len <= digits || len > size) {
+			return SISWA_FALSE;
+		}
+		size -= len;
+		rest = len - digits;
+
+		n = (rest < sizeof(record)) ? (size_t)rest : sizeof(record);
+		if (siswa__readerRead(r, record, n) != n || !siswa__readerSkip(r, rest - n)) {
+			return SISWA_FALSE;
+		}
+		if (n != rest) {
+			if (n >= 5 && SISWA_STRNCMP(record, "path=", 5) == 0) {
+				return SISWA_FALSE;
+			}
+			continue;
+		}
+		if (record[n - 1] != '\n') {
+			return SISWA_FALSE;
+		}
+		record[n - 1] = '\0';
+
+		value = (const char*)SISWA_MEMCHR(record, '=', n - 1);
+		if (value == NULL) {
+			return SISWA_FALSE;
+		}
+		value += 1;
+
+		if (value - record == 5 && SISWA_STRNCMP(record, "path", 4) == 0) {
+			/* The record has room for a few more bytes than the name. */
+			if (n - 1 - 5 >= sizeof(o->name)) {
+				return SISWA_FAILURE;
+			}
+			o->nameLen = n - 1 - 5;
+			SISWA_MEMCPY(o->name, value, o->nameLen);
+		}
+		else if ((value - record == 5 && SISWA_STRNCMP(record, "size", 4) == 0)
+				|| (value - record == 6 && SISWA_STRNCMP(record, "mtime", 5) == 0)) {
+			uint64_t number = 0;
+			uint32_t nanoseconds = 0, scale = 100000000;
+
+			for (i = 0; value[i] >= '0' && value[i] <= '9'; i += 1) {
+				number = number * 10 + (uint64_t)(value[i] - '0');
+			}
+			if (record[0] == 'm') {
+				/* Dates before 1970 are negative, which file dates of 0 stand for too. */
+				if (value[0] == '-') {
+					number = 0;
+				}
+				else if (value[i] == '.') {
+					for (i += 1; value[i] >= '0' && value[i] <= '9' && scale != 0; i += 1) {
+						nanoseconds += (uint32_t)(value[i] - '0') * scale;
+						scale /= 10;
+					}
+				}
+				o->mtime = number;
+				o->nanoseconds = nanoseconds;
+				o->hasMtime = SISWA_TRUE;
+			}
+			else {
+				if (i == 0 || value[i] != '\0') {
+					return SISWA_FALSE;
+				}
+				o->size = number;
+				o->hasSize = SISWA_TRUE;
+			}
+		}
+	}
+
+	return SISWA_TRUE;
+}
+
+siBool siswa_tarToAr(siReadProc in, void* inUser, siWriteProc out, void* outUser,
+		uint32_t alignment) {
+	siswa__reader r;
+	siswa__tarOverride o;
+	siArWriter writer;
+
+	SISWA_ASSERT_NOT_NULL(in);
+	SISWA_ASSERT_NOT_NULL(out);
+
+	r.proc = in;
+	r.user = inUser;
+	r.pos = r.len = r.total = 0;
+	siswa_arWriterInit(&writer, out, outUser, alignment);
+	SISWA_MEMSET(&o, 0, sizeof(o));
+
+	while (writer.ok) {
+		siswa__tarHeader header;
+		uint64_t size, mtime, checksum;
+		size_t n = siswa__readerRead(&r, &header, sizeof(header)), i;
+
+		/* The tar ends with two empty blocks, but a stream that stops right
+		 * after a file is accepted too (like GNU tar does). */
+		if (n == 0) {
+			break;
+		}
+		if (n != sizeof(header)) {
+			return SISWA_FAILURE;
+		}
+		for (i = 0; i < sizeof(header) && ((const siByte*)&header)[i] == 0; i += 1) {}
+		if (i == sizeof(header)) {
+			break;
+		}
+
+		if (!siswa__tarNumber(header.checksum, sizeof(header.checksum), &checksum)
+				|| checksum != siswa__tarChecksum(&header)
+				|| !siswa__tarNumber(header.size, sizeof(header.size), &size)
+				|| !siswa__tarNumber(header.mtime, sizeof(header.mtime), &mtime)) {
+			return SISWA_FAILURE;
+		}
+		if (o.hasSize && header.type != 'x' && header.type != 'L') {
+			size = o.size;
+		}
+
+		switch (header.type) {
+			case 'x': {
+				if (!siswa__tarReadPax(&r, size, &o)
+						|| !siswa__readerSkip(&r, SISWA__TAR_PADDING(size))) {
+					return SISWA_FAILURE;
+				}
+				continue;
+			}
+			case 'L': {
+				/* GNU long name, stored as the data of its own entry. */
+				if (size >= sizeof(o.name)
+						|| siswa__readerRead(&r, o.name, (size_t)size) != size
+						|| !siswa__readerSkip(&r, SISWA__TAR_PADDING(size))) {
+					return SISWA_FAILURE;
+				}
+				for (o.nameLen = 0; o.nameLen < size && o.name[o.nameLen] != '\0'; o.nameLen += 1) {}
+				continue;
+			}
+			case '0': case '\0': case '7': {
+				siArEntry dated;
+				const char* name = o.name;
+				size_t nameLen = o.nameLen;
+				char full[sizeof(o.name)];
+
+				if (nameLen == 0) {
+					size_t prefixLen = 0;
+
+					for (nameLen = 0; nameLen < sizeof(header.name) && header.name[nameLen] != '\0'; nameLen += 1) {}
+					if (SISWA_STRNCMP(header.magic, "ustar", 5) == 0) {
+						while (prefixLen < sizeof(header.prefix) && header.prefix[prefixLen] != '\0') {
+							prefixLen += 1;
+						}
+					}
+					if (prefixLen != 0) {
+						SISWA_MEMCPY(full, header.prefix, prefixLen);
+						full[prefixLen] = '/';
+						prefixLen += 1;
+					}
+					SISWA_MEMCPY(&full[prefixLen], header.name, nameLen);
+					name = full;
+					nameLen += prefixLen;
+				}
+				while (nameLen > 2 && name[0] == '.' && name[1] == '/') {
+					name += 2;
+					nameLen -= 2;
+				}
+
+				if (nameLen == 0 || size > 0xFFFFFFFF - sizeof(siArEntry) - nameLen - 1 - alignment) {
+					return SISWA_FAILURE;
+				}
+				if (o.hasMtime) {
+					mtime = o.mtime;
+				}
+				siswa_arEntrySetFiledate(&dated, (mtime != 0 || o.nanoseconds != 0)
+					? siswa_filedateFromUnix(mtime, o.nanoseconds) : 0);
+
+				siswa_arWriterEntryBegin(&writer, name, nameLen, (uint32_t)size, dated.filedate);
+				if (!siswa__readerPipe(&r, &writer, (size_t)size)) {
+					return SISWA_FAILURE;
+				}
+				break;
+			}
+			default: {
+				/* Directories and links have no data, but anything unknown might. */
+				if (header.type == '1' || header.type == '2' || header.type == '5') {
+					size = 0;
+				}
+				if (!siswa__readerSkip(&r, size)) {
+					return SISWA_FAILURE;
+				}
+			}
+		}
+
+		if (!siswa__readerSkip(&r, SISWA__TAR_PADDING(size))) {
+			return SISWA_FAILURE;
+		}
+		SISWA_MEMSET(&o, 0, sizeof(o));
+	}
+
+	return siswa_arWriterEnd(&writer);
+}
+
+
+/* Writes the number in decimal with at least 'width' digits. Returns the amount
+ * of digits. */
+static
+size_t siswa__tarDecimal(char* out, uint64_t value, size_t width) {
+	size_t len = 0, i;
+	uint64_t n;
+
+	for (n = value; n != 0 || len < width; n /= 10) {
+		len += 1;
+	}
+	for (i = len; i != 0; i -= 1, value /= 10) {
+		out[i - 1] = (char)('0' + value % 10);
+	}
+	return len;
+}
+
+/* Writes a 'length key=value\n' pax record. Returns its length. */
+static
+size_t siswa__tarPaxRecord(char* out, const char* key, const char* value, size_t valueLen) {
+	size_t keyLen = SISWA_STRLEN(key);
+	size_t len = keyLen + valueLen + 3;
+	char digits[24];
+
+	/* The length counts its own digits. */
+	len += siswa__tarDecimal(digits, len + siswa__tarDecimal(digits, len, 1), 1);
+	out += siswa__tarDecimal(out, len, 1);
+	*out = ' ';
+	SISWA_MEMCPY(out + 1, key, keyLen);
+	out[1 + keyLen] = '=';
+	SISWA_MEMCPY(out + 2 + keyLen, value, valueLen);
+	out[2 + keyLen + valueLen] = '\n';
+	return len;
+}
+
+/* Finds the slash at which a name too long for the name field can be split into
+ * the prefix and name fields. Returns 0 if it can't be split. */
+static
+size_t siswa__tarSplit(const char* name, size_t nameLen) {
+	size_t split;
+
+	for (split = nameLen - 1; split != 0; split -= 1) {
+		if (name[split] == '/' && split <= sizeof(((siswa__tarHeader*)0)->prefix)
+				&& nameLen - split - 1 <= sizeof(((siswa__tarHeader*)0)->name)
+				&& nameLen - split - 1 != 0) {
+			break;
+		}
+	}
+	return split;
+}
+
+/* Writes the header of a file. Names that don't fit get cut, so they need a pax
+ * header before it. */
+static
+siBool siswa__tarWriteHeader(siArWriter* writer, const char* name, size_t nameLen,
+		uint64_t size, uint64_t mtime, char type) {
+	siswa__tarHeader header;
+
+	SISWA_MEMSET(&header, 0, sizeof(header));
+	if (nameLen > sizeof(header.name)) {
+		size_t split = siswa__tarSplit(name, nameLen);
+		if (split != 0) {
+			SISWA_MEMCPY(header.prefix, name, split);
+			name += split + 1;
+			nameLen -= split + 1;
+		}
+		else {
+			nameLen = sizeof(header.name);
+		}
+	}
+	SISWA_MEMCPY(header.name, name, nameLen);
+
+	siswa__tarOctal(header.mode, sizeof(header.mode), 0644);
+	siswa__tarOctal(header.uid, sizeof(header.uid), 0);
+	siswa__tarOctal(header.gid, sizeof(header.gid), 0);
+	siswa__tarOctal(header.size, sizeof(header.size), size);
+	siswa__tarOctal(header.mtime, sizeof(header.mtime),
+		(mtime <= SISWA__TAR_MAX_OCTAL) ? mtime : SISWA__TAR_MAX_OCTAL);
+	header.type = type;
+	SISWA_MEMCPY(header.magic, "ustar", 6);
+	SISWA_MEMCPY(header.version, "00", 2);
+
+	siswa__tarOctal(header.checksum, sizeof(header.checksum) - 1, siswa__tarChecksum(&header));
+	header.checksum[sizeof(header.checksum) - 1] = ' ';
+	return siswa__arWriterPut(writer, &header, sizeof(header));
+}
+
+siBool siswa_arToTar(siReadProc in, void* inUser, siWriteProc out, void* outUser) {
+	siswa__reader r;
+	siArHeader header;
+	/* Only used for its output, which tracks failed writes and the length. */
+	siArWriter writer;
+	char name[1024];
+
+	SISWA_ASSERT_NOT_NULL(in);
+	SISWA_ASSERT_NOT_NULL(out);
+
+	r.proc = in;
+	r.user = inUser;
+	r.pos = r.len = r.total = 0;
+	if (siswa__readerRead(&r, &header, sizeof(header)) != sizeof(header)
+			|| SISWA__LE32(header.unknown) != 0
+			|| SISWA__LE32(header.headerSizeof) != sizeof(siArHeader)
+			|| SISWA__LE32(header.entrySizeof) != sizeof(siArEntry)) {
+		return SISWA_FAILURE;
+	}
+
+	writer.proc = out;
+	writer.user = outUser;
+	writer.len = 0;
+	writer.ok = SISWA_TRUE;
+
+	while (writer.ok) {
+		siArEntry entry;
+		uint32_t size, offset, dataSize, n;
+		size_t nameLen, got = siswa__readerRead(&r, &entry, sizeof(entry));
+
+		if (got == 0) {
+			break;
+		}
+		size = SISWA__LE32(entry.size);
+		offset = SISWA__LE32(entry.offset);
+		dataSize = SISWA__LE32(entry.dataSize);
+		if (got != sizeof(entry) || offset <= sizeof(siArEntry) || offset > size
+				|| dataSize > size - offset) {
+			return SISWA_FAILURE;
+		}
+
+		/* The name is followed by the padding before the data, if there's any. */
+		n = offset - (uint32_t)sizeof(siArEntry);
+		if (n > sizeof(name)) {
+			n = sizeof(name);
+		}
+		if (siswa__readerRead(&r, name, n) != n) {
+			return SISWA_FAILURE;
+		}
+		for (nameLen = 0; nameLen < n && name[nameLen] != '\0'; nameLen += 1) {}
+		if (nameLen == n || !siswa__readerSkip(&r, offset - sizeof(siArEntry) - n)) {
+			return SISWA_FAILURE;
+		}
+
+		{
+			/* Names and dates that don't fit into the header (or aren't whole
+			 * seconds) go into a pax header, so that converting back gives the
+			 * same archive. */
+			char pax[sizeof(name) + 64];
+			size_t paxLen = 0;
+			uint64_t filedate = siswa_arEntryGetFiledate(&entry);
+			uint64_t mtime = siswa_filedateToUnix(filedate);
+
+			if (nameLen > sizeof(((siswa__tarHeader*)0)->name) && siswa__tarSplit(name, nameLen) == 0) {
+				paxLen += siswa__tarPaxRecord(&pax[paxLen], "path", name, nameLen);
+			}
+			if (filedate > SISWA__FILEDATE_UNIX_EPOCH
+					&& ((filedate - SISWA__FILEDATE_UNIX_EPOCH) % 10000000 != 0
+						|| mtime > SISWA__TAR_MAX_OCTAL)) {
+				uint32_t fraction = (uint32_t)((filedate - SISWA__FILEDATE_UNIX_EPOCH) % 10000000);
+				char value[32];
+				size_t len = siswa__tarDecimal(value, mtime, 1);
+
+				if (fraction != 0) {
+					value[len] = '.';
+					len += 1 + siswa__tarDecimal(&value[len + 1], fraction, 7);
+				}
+				paxLen += siswa__tarPaxRecord(&pax[paxLen], "mtime", value, len);
+			}
+
+			if (paxLen != 0) {
+				siswa__tarWriteHeader(&writer, "././@PaxHeader", 14, paxLen, 0, 'x');
+				siswa__arWriterPut(&writer, pax, paxLen);
+				siswa__arWriterPad(&writer, SISWA__TAR_PADDING(paxLen));
+			}
+			siswa__tarWriteHeader(&writer, name, nameLen, dataSize, mtime, '0');
+		}
+		while (dataSize != 0 && writer.ok) {
+			size_t chunk;
+			if (r.pos == r.len) {
+				r.pos = 0;
+				r.len = r.proc(r.user, r.buf, sizeof(r.buf));
+				if (r.len == 0) {
+					return SISWA_FAILURE;
+				}
+			}
+			chunk = (dataSize < r.len - r.pos) ? dataSize : r.len - r.pos;
+			siswa__arWriterPut(&writer, &r.buf[r.pos], chunk);
+			r.pos += chunk;
+			r.total += chunk;
+			dataSize -= (uint32_t)chunk;
+		}
+		siswa__arWriterPad(&writer, SISWA__TAR_PADDING(SISWA__LE32(entry.dataSize)));
+
+		if (!siswa__readerSkip(&r, size - offset - SISWA__LE32(entry.dataSize))) {
+			return SISWA_FAILURE;
+		}
+	}
+
+	/* The end of the tar is marked by two empty blocks. */
+	siswa__arWriterPad(&writer, 2 * SISWA__TAR_BLOCK);
+	return writer.ok;
+}
+
+
+#ifndef SISWA_NO_STDLIB
+siBool siswa_arRepack(siArFile old, const siRepackSource* sources, size_t count,
+		siSourceProc read, void* readUser, siWriteProc out, void* outUser,
+		siRepackStats* stats) {
+	size_t oldCount, htCapacity, i;
+	siManifestEntry* manifest;
+	siRepackStats own;
+	siArWriter writer;
+	siArEntry* entry;
+	siHashTable* ht;
+	uint32_t* slots;
+	siByte* used;
+	siByte* memory;
+
+	SISWA_ASSERT(sources != NULL || count == 0);
+	SISWA_ASSERT_NOT_NULL(read);
+	SISWA_ASSERT_NOT_NULL(out);
+	SISWA_ASSERT_MSG(old.type == SISWA_FILE_REGULAR, "The archive must be decompressed");
+
+	if (stats == NULL) {
+		stats = &own;
+	}
+	SISWA_MEMSET(stats, 0, sizeof(*stats));
+
+	/* Only the offsets and sizes of the old entries are needed up front. Their
+	 * data only gets hashed for telling apart sources that got touched. */
+	oldCount = siswa_arGetEntryCount(old);
+	htCapacity = siswa__hashtableCapacity(oldCount);
+	memory = (siByte*)SISWA__MALLOC(SISWA_BUDGET_INDEXES,
+		oldCount * sizeof(siManifestEntry) + sizeof(siHashTable)
+			+ htCapacity * (sizeof(siHashEntry) + sizeof(uint32_t)) + oldCount
+	);
+	SISWA_ASSERT_NOT_NULL(memory);
+
+	manifest = (siManifestEntry*)(void*)memory;
+	ht = siswa__hashtableMakeReserve(&manifest[oldCount], htCapacity);
+	slots = (uint32_t*)(void*)&ht->entries[htCapacity];
+	used = (siByte*)&slots[htCapacity];
+	SISWA_MEMSET(used, 0, oldCount);
+
+	i = 0;
+	old.__curOffset = sizeof(siArHeader);
+	while (siswa_arEntryPoll(&old, &entry)) {
+		manifest[i].dataSize = SISWA__LE32(entry->dataSize);
+		manifest[i].offset = (uint32_t)((siByte*)entry - old.data);
+		i += 1;
+	}
+	siswa__arNameIndex(old, manifest, oldCount, ht, slots);
+
+	siswa_arWriterInit(&writer, out, outUser, SISWA__LE32(siswa_arGetHeader(old)->alignment));
+	for (i = 0; i < count && writer.ok; i += 1) {
+		const siRepackSource* src = &sources[i];
+		uint64_t hash = siswa__hashKey(src->name, src->nameLen);
+		siHashEntry* slot = siswa__hashtableGet(ht, src->name, src->nameLen, hash);
+		const siManifestEntry* m = NULL;
+		siArEntry dated;
+		const void* data;
+
+		if (slot != NULL) {
+			uint32_t index = slots[slot - ht->entries];
+			m = &manifest[index];
+			entry = (siArEntry*)&old.data[m->offset];
+			used[index] = SISWA_TRUE;
+
+			if (m->dataSize == src->dataSize && siswa_arEntryGetFiledate(entry) == src->filedate) {
+				/* The data gets copied over as-is, only the padding can differ
+				 * if an entry before it changed. */
+				siswa_arWriterAdd(
+					&writer, src->name, src->nameLen, siswa_arEntryGetData(entry),
+					m->dataSize, entry->filedate
+				);
+				stats->reused += 1;
+				continue;
+			}
+		}
+
+		data = read(readUser, src);
+		if (data == NULL) {
+			SISWA__FREE(memory);
+			return SISWA_FAILURE;
+		}
+
+		if (m == NULL) {
+			stats->added += 1;
+		}
+		else if (m->dataSize == src->dataSize
+				&& siswa_xxh64(siswa_arEntryGetData(entry), m->dataSize, 0)
+					== siswa_xxh64(data, src->dataSize, 0)) {
+			stats->touched += 1;
+		}
+		else {
+			stats->changed += 1;
+		}
+
+		/* Only used for converting the date into its stored form. */
+		siswa_arEntrySetFiledate(&dated, src->filedate);
+		siswa_arWriterAdd(&writer, src->name, src->nameLen, data, src->dataSize, dated.filedate);
+	}
+
+	for (i = 0; i < oldCount; i += 1) {
+		stats->removed += !used[i];
+	}
+
+	SISWA__FREE(memory);
+	return siswa_arWriterEnd(&writer);
+}
+#endif
+
+
+siBool siswa_arReorder(siArFile ar, const char* const* names, size_t count,
+		siWriteProc proc, void* user) {
+	size_t entryCount, htCapacity, memSize, i;
+	siManifestEntry* offsets;
+	siArWriter writer;
+	siArEntry* entry;
+	siHashTable* ht;
+	uint32_t* slots;
+	siByte* written;
+	void* memory;
+	char allocator[SISWA_DEFAULT_STACK_SIZE];
+
+	SISWA_ASSERT(names != NULL || count == 0);
+	SISWA_ASSERT_NOT_NULL(proc);
+	SISWA_ASSERT_MSG(ar.type == SISWA_FILE_REGULAR, "The archive must be decompressed");
+
+	entryCount = siswa_arGetEntryCount(ar);
+	htCapacity = siswa__hashtableCapacity(entryCount);
+	memSize = entryCount * sizeof(siManifestEntry) + sizeof(siHashTable)
+		+ htCapacity * (sizeof(siHashEntry) + sizeof(uint32_t)) + entryCount;
+	memory = allocator;
+	if (memSize > sizeof(allocator)) {
+#ifndef SISWA_NO_STDLIB
+		memory = SISWA__MALLOC(SISWA_BUDGET_INDEXES, memSize);
+		SISWA_ASSERT_NOT_NULL(memory);
+#else
+		SISWA_ASSERT_MSG(memSize <= sizeof(allocator),
+			"Too many entries to reorder, increase 'SISWA_DEFAULT_STACK_SIZE'");
+#endif
+	}
+
+	/* Only the offsets are needed for the name index, nothing gets hashed. */
+	offsets = (siManifestEntry*)memory;
+	ht = siswa__hashtableMakeReserve(&offsets[entryCount], htCapacity);
+	slots = (uint32_t*)(void*)&ht->entries[htCapacity];
+	written = (siByte*)&slots[htCapacity];
+	SISWA_MEMSET(written, 0, entryCount);
+
+	i = 0;
+	ar.__curOffset = sizeof(siArHeader);
+	while (siswa_arEntryPoll(&ar, &entry)) {
+		offsets[i].offset = (uint32_t)((siByte*)entry - ar.data);
+		i += 1;
+	}
+	siswa__arNameIndex(ar, offsets, entryCount, ht, slots);
+
+	siswa_arWriterInit(&writer, proc, user, SISWA__LE32(siswa_arGetHeader(ar)->alignment));
+	for (i = 0; i < count + entryCount && writer.ok; i += 1) {
+		uint32_t index;
+		const char* name;
+		size_t nameLen;
+
+		if (i < count) {
+			siHashEntry* slot;
+			nameLen = SISWA_STRLEN(names[i]);
+			slot = siswa__hashtableGet(ht, names[i], nameLen, siswa__hashKey(names[i], nameLen));
+			if (slot == NULL) {
+				continue;
+			}
+			index = slots[slot - ht->entries];
+		}
+		else {
+			index = (uint32_t)(i - count);
+		}
+		if (written[index]) {
+			continue;
+		}
+		written[index] = SISWA_TRUE;
+
+		entry = (siArEntry*)&ar.data[offsets[index].offset];
+		name = siswa_arEntryGetName(entry);
+		siswa_arWriterAdd(
+			&writer, name, SISWA_STRLEN(name), siswa_arEntryGetData(entry),
+			SISWA__LE32(entry->dataSize), entry->filedate
+		);
+	}
+
+#ifndef SISWA_NO_STDLIB
+	if (memory != allocator) {
+		SISWA__FREE(memory);
+	}
+#endif
+	return siswa_arWriterEnd(&writer);
+}
+
+
+#ifndef SISWA_NO_STDLIB
+/* Returns the amount of loads in both sorted lists. */
+static
+size_t siswa__traceOverlap(const uint32_t* a, size_t countA, const uint32_t* b, size_t countB) {
+	size_t i = 0, j = 0, res = 0;
+	while (i < countA && j < countB) {
+		if (a[i] == b[j]) {
+			res += 1;
+			i += 1;
+			j += 1;
+		}
+		else if (a[i] < b[j]) {
+			i += 1;
+		}
+		else {
+			j += 1;
+		}
+	}
+	return res;
+}
+
+size_t siswa_traceCluster(const char* const* names, const uint32_t* loads, size_t count,
+		const char** out) {
+	size_t htCapacity, entryCount = 0, clusterCount = 0, current = 0, i, j;
+	siHashTable* entryHt;
+	siHashTable* clusterHt;
+	uint32_t* entrySlots;
+	uint32_t* clusterSlots;
+	uint32_t* accesses;
+	uint32_t* first;
+	uint32_t* loadStart;
+	uint32_t* loadEnd;
+	uint32_t* loadList;
+	uint32_t* clusters;
+	uint32_t* members;
+	uint32_t* memberStart;
+	uint32_t* order;
+	siByte* placed;
+	siByte* memory;
+
+	SISWA_ASSERT(names != NULL || count == 0);
+	SISWA_ASSERT(loads != NULL || count == 0);
+	SISWA_ASSERT(out != NULL || count == 0);
+
+	htCapacity = siswa__hashtableCapacity(count);
+	memory = (siByte*)SISWA__MALLOC(SISWA_BUDGET_INDEXES,
+		2 * (sizeof(siHashTable) + htCapacity * (sizeof(siHashEntry) + sizeof(uint32_t)))
+			+ (9 * count + 1) * sizeof(uint32_t) + count
+	);
+	SISWA_ASSERT_NOT_NULL(memory);
+
+	entryHt = siswa__hashtableMakeReserve(memory, htCapacity);
+	clusterHt = siswa__hashtableMakeReserve(&entryHt->entries[htCapacity], htCapacity);
+	entrySlots = (uint32_t*)(void*)&clusterHt->entries[htCapacity];
+	clusterSlots = &entrySlots[htCapacity];
+	accesses = &clusterSlots[htCapacity];
+	first = &accesses[count];
+	loadStart = &first[count];
+	loadEnd = &loadStart[count];
+	loadList = &loadEnd[count];
+	clusters = &loadList[count];
+	members = &clusters[count];
+	memberStart = &members[count];
+	order = &memberStart[count + 1];
+	placed = (siByte*)&order[count];
+
+	/* Every name becomes an entry, numbered by its first access. */
+	for (i = 0; i < count; i += 1) {
+		size_t len = SISWA_STRLEN(names[i]);
+		uint64_t hash = siswa__hashKey(names[i], len);
+		siHashEntry* slot = siswa__hashtableGet(entryHt, names[i], len, hash);
+
+		if (slot == NULL) {
+			slot = siswa__hashtableSet(entryHt, names[i], len, hash);
+			entrySlots[slot - entryHt->entries] = (uint32_t)entryCount;
+			first[entryCount] = (uint32_t)i;
+			loadEnd[entryCount] = 0;
+			entryCount += 1;
+		}
+		accesses[i] = entrySlots[slot - entryHt->entries];
+		loadEnd[accesses[i]] += 1;
+	}
+
+	/* The loads of every entry, without repeats. They come out sorted, as the
+	 * loads of the trace never go back. */
+	for (i = 0, j = 0; i < entryCount; i += 1) {
+		loadStart[i] = (uint32_t)j;
+		j += loadEnd[i];
+		loadEnd[i] = loadStart[i];
+	}
+	for (i = 0; i < count; i += 1) {
+		uint32_t e = accesses[i];
+		if (loadEnd[e] == loadStart[e] || loadList[loadEnd[e] - 1] != loads[i]) {
+			SISWA_ASSERT_MSG(loadEnd[e] == loadStart[e] || loadList[loadEnd[e] - 1] < loads[i],
+				"The loads of the trace must never go back");
+			loadList[loadEnd[e]] = loads[i];
+			loadEnd[e] += 1;
+		}
+	}
+
+	/* Entries with the same loads share a cluster, which is numbered by the
+	 * first access of its first entry. */
+	for (i = 0; i < entryCount; i += 1) {
+		const char* key = (const char*)&loadList[loadStart[i]];
+		size_t len = (loadEnd[i] - loadStart[i]) * sizeof(uint32_t);
+		uint64_t hash = siswa__hashKey(key, len);
+		siHashEntry* slot = siswa__hashtableGet(clusterHt, key, len, hash);
+
+		if (slot == NULL) {
+			slot = siswa__hashtableSet(clusterHt, key, len, hash);
+			clusterSlots[slot - clusterHt->entries] = (uint32_t)clusterCount;
+			memberStart[clusterCount] = 0;
+			placed[clusterCount] = SISWA_FALSE;
+			clusterCount += 1;
+		}
+		clusters[i] = clusterSlots[slot - clusterHt->entries];
+		memberStart[clusters[i]] += 1;
+	}
+	for (i = 0, j = 0; i < clusterCount; i += 1) {
+		size_t n = memberStart[i];
+		memberStart[i] = (uint32_t)j;
+		j += n;
+	}
+	memberStart[clusterCount] = (uint32_t)j;
+	for (i = 0; i < entryCount; i += 1) {
+		members[memberStart[clusters[i]]] = (uint32_t)i;
+		memberStart[clusters[i]] += 1;
+	}
+	for (i = clusterCount; i != 0; i -= 1) {
+		memberStart[i] = memberStart[i - 1];
+	}
+	memberStart[0] = 0;
+
+	/* Every cluster is followed by the most similar one (shared loads over the
+	 * loads of either), starting from the first accessed one. */
+	for (i = 0; i < clusterCount; i += 1) {
+		const uint32_t* cur = NULL;
+		size_t curCount = 0, best = clusterCount, bestShared = 0, bestUnion = 1, c;
+
+		if (i != 0) {
+			uint32_t e = members[memberStart[current]];
+			cur = &loadList[loadStart[e]];
+			curCount = loadEnd[e] - loadStart[e];
+		}
+		for (c = 0; c < clusterCount; c += 1) {
+			uint32_t e = members[memberStart[c]];
+			size_t n = loadEnd[e] - loadStart[e], shared;
+
+			if (placed[c]) {
+				continue;
+			}
+			shared = siswa__traceOverlap(cur, curCount, &loadList[loadStart[e]], n);
+			if (best == clusterCount
+					|| (uint64_t)shared * bestUnion > (uint64_t)bestShared * (curCount + n - shared)) {
+				best = c;
+				bestShared = shared;
+				bestUnion = curCount + n - shared;
+			}
+		}
+		placed[best] = SISWA_TRUE;
+		order[i] = (uint32_t)best;
+		current = best;
+	}
+
+	for (i = 0, j = 0; i < clusterCount; i += 1) {
+		size_t m;
+		for (m = memberStart[order[i]]; m < memberStart[order[i] + 1]; m += 1) {
+			out[j] = names[first[members[m]]];
+			j += 1;
+		}
+	}
+
+	SISWA__FREE(memory);
+	return entryCount;
+}
+#endif
+
+
+#define SISWA__SEGS_CHUNK_SIZE 0x10000
+/* Chunks that can't be compressed get split in half and stored as they are, as
+ * a stored chunk of 64 KiB would have the same sizes as a compressed one. */
+#define SISWA__SEGS_STORED_SIZE (SISWA__SEGS_CHUNK_SIZE / 2)
+#define SISWA__SEGS_ALIGN(x) (((x) + 15) & ~(size_t)15)
+
+size_t siswa_segsCompressBound(size_t len) {
+	size_t maxChunks = 2 * ((len + SISWA__SEGS_CHUNK_SIZE - 1) / SISWA__SEGS_CHUNK_SIZE);
+	return SISWA__SEGS_ALIGN(sizeof(siSegsHeader) + maxChunks * sizeof(siSegsEntry))
+		+ len + maxChunks * 15 + 15;
+}
+
+siArFile siswa_arCompressSegs(siArFile ar, void* out, size_t capacity, int level,
+		siCompressProc compress, void* compressUser, const siChunkCache* cache,
+		siSegsStats* stats) {
+	siByte* data = (siByte*)out;
+	size_t maxChunks, reserved, base, pos, i, chunks = 0;
+	siSegsStats own;
+	siArFile res;
+
+	SISWA_ASSERT_NOT_NULL(out);
+	SISWA_ASSERT_MSG(
+		capacity >= siswa_segsCompressBound(ar.len),
+		"Capacity must be equal to or be higher than 'siswa_segsCompressBound()'"
+	);
+	SISWA_ASSERT_MSG(ar.len <= 0xFFFFFFFF, "The archive is too big for SEGS");
+
+	if (stats == NULL) {
+		stats = &own;
+	}
+	SISWA_MEMSET(stats, 0, sizeof(*stats));
+
+	/* The chunk count is only known at the end, so the chunks get written after
+	 * the biggest possible chunk table and moved back once it's known. */
+	maxChunks = 2 * ((ar.len + SISWA__SEGS_CHUNK_SIZE - 1) / SISWA__SEGS_CHUNK_SIZE);
+	SISWA_ASSERT_MSG(maxChunks <= 0xFFFF * 2, "The archive is too big for SEGS");
+	reserved = SISWA__SEGS_ALIGN(sizeof(siSegsHeader) + maxChunks * sizeof(siSegsEntry));
+	pos = reserved;
+
+	for (i = 0; i < ar.len; i += SISWA__SEGS_CHUNK_SIZE) {
+		const siByte* in = &ar.data[i];
+		size_t size = (ar.len - i < SISWA__SEGS_CHUNK_SIZE) ? ar.len - i : SISWA__SEGS_CHUNK_SIZE;
+		siByte* entry = &data[sizeof(siSegsHeader) + chunks * sizeof(siSegsEntry)];
+		size_t zSize = 0, part, partSize;
+		siChunkKey key;
+
+		if (cache != NULL) {
+			siSha256State sha;
+			siswa_sha256Init(&sha);
+			siswa_sha256Update(&sha, in, size);
+			siswa_sha256Final(&sha, key.sha256);
+			key.size = (uint32_t)size;
+			key.level = level;
+
+			zSize = cache->get(cache->user, &key, &data[pos], size - 1);
+			stats->cached += (zSize != 0);
+		}
+		if (zSize == 0 && compress != NULL) {
+			zSize = compress(compressUser, in, size, &data[pos], size - 1, level);
+			if (zSize != 0 && zSize < size) {
+				stats->compressed += 1;
+				if (cache != NULL) {
+					cache->put(cache->user, &key, &data[pos], zSize);
+				}
+			}
+		}
+
+		if (zSize != 0 && zSize < size) {
+			siswa__write16be(&entry[0], (uint16_t)zSize);
+			siswa__write16be(&entry[2], (uint16_t)size); /* 64 KiB is written as 0. */
+			siswa__write32be(&entry[4], (uint32_t)pos + 1);
+			chunks += 1;
+
+			SISWA_MEMSET(&data[pos + zSize], 0, SISWA__SEGS_ALIGN(zSize) - zSize);
+			pos += SISWA__SEGS_ALIGN(zSize);
+			continue;
+		}
+
+		/* Anything that doesn't get smaller is stored as-is. */
+		partSize = (size == SISWA__SEGS_CHUNK_SIZE) ? SISWA__SEGS_STORED_SIZE : size;
+		for (part = 0; part < size; part += partSize) {
+			entry = &data[sizeof(siSegsHeader) + chunks * sizeof(siSegsEntry)];
+			siswa__write16be(&entry[0], (uint16_t)partSize);
+			siswa__write16be(&entry[2], (uint16_t)partSize);
+			siswa__write32be(&entry[4], (uint32_t)pos + 1);
+			chunks += 1;
+			stats->stored += 1;
+
+			SISWA_MEMCPY(&data[pos], &in[part], partSize);
+			SISWA_MEMSET(&data[pos + partSize], 0, SISWA__SEGS_ALIGN(partSize) - partSize);
+			pos += SISWA__SEGS_ALIGN(partSize);
+		}
+	}
+	SISWA_ASSERT_MSG(chunks <= 0xFFFF, "The archive is too big for SEGS");
+
+	/* Moves the chunks right after the actual chunk table. */
+	base = SISWA__SEGS_ALIGN(sizeof(siSegsHeader) + chunks * sizeof(siSegsEntry));
+	SISWA_MEMMOVE(&data[base], &data[reserved], pos - reserved);
+	SISWA_MEMSET(&data[sizeof(siSegsHeader) + chunks * sizeof(siSegsEntry)], 0,
+		base - sizeof(siSegsHeader) - chunks * sizeof(siSegsEntry));
+	for (i = 0; i < chunks; i += 1) {
+		siByte* entry = &data[sizeof(siSegsHeader) + i * sizeof(siSegsEntry)];
+		siswa__write32be(&entry[4], siswa__read32be(&entry[4]) - (uint32_t)(reserved - base));
+	}
+	pos -= reserved - base;
+
+	SISWA_MEMCPY(&data[0], "segs", 4);
+	siswa__write16be(&data[4], 4); /* Always 4 in the game's archives. */
+	siswa__write16be(&data[6], (uint16_t)chunks);
+	siswa__write32be(&data[8], (uint32_t)ar.len);
+	siswa__write32be(&data[12], (uint32_t)pos);
+	stats->chunks = chunks;
+
+	res.data = data;
+	res.len = pos;
+	res.cap = capacity;
+	res.type = SISWA_FILE_SEGS;
+	res.validated = SISWA_FALSE;
+	res.__curOffset = 0;
+	return res;
+}
+
+#ifndef SISWA_NO_STDLIB
+/* Writes the path of the chunk's file into 'out', as '<SHA-256>-<size>-<level>'. */
+static
+siBool siswa__chunkCachePath(const char* directory, const siChunkKey* key, char* out,
+		size_t capacity) {
+	static const char digits[] = "0123456789abcdef";
+	size_t len, i;
+
+	SISWA_ASSERT_NOT_NULL(directory);
+	len = SISWA_STRLEN(directory);
+	if (len + 1 + SISWA_SHA256_SIZE * 2 + 32 > capacity) {
+		return SISWA_FALSE;
 	}
 
-	arl->data = out;
-	arl->type = SISWA_FILE_REGULAR;
+	SISWA_MEMCPY(out, directory, len);
+	out[len] = '/';
+	len += 1;
+	for (i = 0; i < SISWA_SHA256_SIZE; i += 1) {
+		out[len + i * 2] = digits[key->sha256[i] >> 4];
+		out[len + i * 2 + 1] = digits[key->sha256[i] & 0xF];
+	}
+	len += SISWA_SHA256_SIZE * 2;
+	sprintf(&out[len], "-%lu-%ld", (unsigned long)key->size, (long)key->level);
+	return SISWA_TRUE;
 }
-void siswa_arlDecompressXComp(siArlFile* arl, siByte* out, size_t capacity, siBool freeCompData) {
-	siXCompHeader* header;
-	uint32_t uncompBlockSize;
-	uint32_t compBlockMax;
-	uint64_t fullSize;
 
-#if 0
-	siByte* curDataOffset;
-	siByte* curOutOffset;
-	size_t baseOffset;
-	siSegsEntry* entry;
-	siSegsEntry* end;
-	size_t leftCapacity;
-#endif
+size_t siswa_chunkCacheFileGet(void* directory, const siChunkKey* key, void* out,
+		size_t capacity) {
+	char path[1024];
+	FILE* file;
+	long len;
 
+	if (!siswa__chunkCachePath((const char*)directory, key, path, sizeof(path))) {
+		return 0;
+	}
+	file = fopen(path, "rb");
+	if (file == NULL) {
+		return 0;
+	}
 
-	SISWA_ASSERT_NOT_NULL(arl);
-	SISWA_ASSERT_NOT_NULL(out);
-	SISWA_ASSERT_MSG(arl->type == SISWA_FILE_XCOMPRESS, "Wrong compression type.");
+	fseek(file, 0, SEEK_END);
+	len = ftell(file);
+	rewind(file);
+	if (len <= 0 || (size_t)len > capacity || fread(out, 1, (size_t)len, file) != (size_t)len) {
+		len = 0;
+	}
+	fclose(file);
+	return (size_t)len;
+}
+void siswa_chunkCacheFilePut(void* directory, const siChunkKey* key, const void* data,
+		size_t len) {
+	char path[1024], tmp[1024 + 4];
+	siBool ok;
+	FILE* file;
 
-	header = (siXCompHeader*)arl->data;
-	uncompBlockSize = header->uncompressedBlockSize;
-	compBlockMax = header->compressedBlockSizeMax;
-	fullSize = header->uncompressedSize;
+	if (!siswa__chunkCachePath((const char*)directory, key, path, sizeof(path))) {
+		return;
+	}
 
-	if (siswa_isLittleEndian()) {
-		uncompBlockSize = siswa_swap32(uncompBlockSize);
-		compBlockMax = siswa_swap32(compBlockMax);
-		fullSize = siswa_swap64(fullSize);
+	/* Written under a temporary name first, so that an interrupted write never
+	 * leaves a truncated chunk in the cache. */
+	sprintf(tmp, "%s.tmp", path);
+	file = fopen(tmp, "wb");
+	if (file == NULL) {
+		return;
 	}
+	ok = (fwrite(data, 1, len, file) == len);
+	ok &= (fclose(file) == 0);
 
-	SISWA_ASSERT_MSG(
-		capacity >= fullSize,
-		"Capacity must be equal to or be higher than 'siswa_<ar/arl>GetDecompressedSize()'"
-	);
-#if 0
-	curDataOffset = arl->data;
+	if (!ok || rename(tmp, path) != 0) {
+		remove(tmp);
+	}
+}
 #endif
 
-	while (SISWA_TRUE) {
+#if !defined(SISWA_NO_DECOMPRESSION) && !defined(SISWA_DEFINE_CUSTOM_DEFLATE_DECOMPRESSION) \
+	&& !defined(SISWA_NO_STDLIB)
+/* Biggest possible size of a decompressed SEGS chunk. */
+#define SISWA__MANIFEST_OUT_SIZE 0x10000
+
+enum {
+	SISWA__MANIFEST_HEADER = 0,
+	SISWA__MANIFEST_ENTRY,
+	SISWA__MANIFEST_NAME,
+	SISWA__MANIFEST_DATA,
+	SISWA__MANIFEST_PADDING,
+	SISWA__MANIFEST_ERROR
+};
+
+/* Walks the entries of an archive that's given to it in pieces, hashing the
+ * data of every entry as it goes. */
+typedef struct {
+	siManifestEntry* out;
+	size_t capacity;
+	siByte* sha256;
+	size_t count;
 
+	uint32_t phase;
+	/* Position in the decompressed archive and where the current phase ends. */
+	size_t pos;
+	size_t target;
+	size_t entryStart;
+	size_t next;
+	siByte entry[sizeof(siArEntry)];
 
-#if 0
-		unknown = *(uint8_t*)curDataOffset;
-		curDataOffset += sizeof(uint8_t);
+	siXxh64State xxh;
+	siSha256State sha;
 
-		if (unknown == 0) {
+	siInflateState inflate;
+	siByte buf[SISWA__MANIFEST_OUT_SIZE];
+} siswa__manifestStream;
+
+/* Moves onto the next phase once the current one has reached its target. */
+static
+void siswa__manifestStreamNext(siswa__manifestStream* ms) {
+	switch (ms->phase) {
+		case SISWA__MANIFEST_HEADER:
+		case SISWA__MANIFEST_PADDING: {
+			ms->phase = SISWA__MANIFEST_ENTRY;
+			ms->entryStart = ms->pos;
+			ms->target = ms->pos + sizeof(siArEntry);
 			break;
 		}
+		case SISWA__MANIFEST_ENTRY: {
+			uint32_t size = (uint32_t)siswa__read32le(&ms->entry[0]);
+			uint32_t dataSize = (uint32_t)siswa__read32le(&ms->entry[4]);
+			uint32_t offset = (uint32_t)siswa__read32le(&ms->entry[8]);
 
-		uncompressedBlockSize = *(uint16_t*)curDataOffset;
-		curDataOffset += 20;
-
+			if (offset <= sizeof(siArEntry) || offset > size || dataSize > size - offset) {
+				ms->phase = SISWA__MANIFEST_ERROR;
+				break;
+			}
+			if (ms->count < ms->capacity) {
+				ms->out[ms->count].dataSize = dataSize;
+				ms->out[ms->count].offset = (uint32_t)ms->entryStart;
+			}
+			siswa_xxh64Init(&ms->xxh, 0);
+			if (ms->sha256 != NULL) {
+				siswa_sha256Init(&ms->sha);
+			}
 
-		if (siswa_isLittleEndian()) {
-			compressedBlockSize = siswa_swap32(compressedBlockSize);
-			uncompressedBlockSize = siswa_swap16(uncompressedBlockSize);
+			ms->phase = SISWA__MANIFEST_NAME;
+			ms->target = ms->entryStart + offset;
+			ms->next = ms->entryStart + size;
+			break;
 		}
-		SISWA_ASSERT_MSG(uncompressedBlockSize == uncompressedBlockSize, "Cannot decompress this XCompressed file.");
+		case SISWA__MANIFEST_NAME: {
+			ms->phase = SISWA__MANIFEST_DATA;
+			ms->target = ms->pos + (size_t)siswa__read32le(&ms->entry[4]);
+			break;
+		}
+		case SISWA__MANIFEST_DATA: {
+			if (ms->count < ms->capacity) {
+				ms->out[ms->count].hash = siswa_xxh64Digest(&ms->xxh);
+				if (ms->sha256 != NULL) {
+					siswa_sha256Final(&ms->sha, &ms->sha256[ms->count * SISWA_SHA256_SIZE]);
+				}
+			}
+			ms->count += 1;
+			ms->phase = SISWA__MANIFEST_PADDING;
+			ms->target = ms->next;
+			break;
+		}
+	}
+}
 
-		if (uncompressedBlockSize == uncompBlockSize) {
-			SISWA_MEMCPY(out, curDataOffset, uncompressedBlockSize);
+static
+void siswa__manifestStreamFeed(siswa__manifestStream* ms, const siByte* p, size_t len) {
+	while (ms->phase != SISWA__MANIFEST_ERROR) {
+		size_t n = ms->target - ms->pos;
+		if (n > len) {
+			n = len;
 		}
-		else {
-			siswa_decompressLZXDelta(data, compressedBlockSize, out, leftCapacity);
 
+		if (ms->phase == SISWA__MANIFEST_ENTRY) {
+			SISWA_MEMCPY(&ms->entry[ms->pos - ms->entryStart], p, n);
+		}
+		else if (ms->phase == SISWA__MANIFEST_DATA) {
+			siswa_xxh64Update(&ms->xxh, p, n);
+			if (ms->sha256 != NULL) {
+				siswa_sha256Update(&ms->sha, p, n);
+			}
 		}
+		ms->pos += n;
+		p += n;
+		len -= n;
 
-		curDataOffset += compressedBlockSize;
-#endif
+		if (ms->pos != ms->target) {
+			break;
+		}
+		siswa__manifestStreamNext(ms);
 	}
+}
 
-	arl->len = fullSize;
-	arl->cap = capacity;
+size_t siswa_arManifestSegs(siArFile segs, siManifestEntry* out, size_t capacity,
+		siByte* sha256Out) {
+	siswa__manifestStream* ms;
+	const siByte* table;
+	size_t chunks, i, count;
+	siBool ok = SISWA_TRUE;
 
-	if (freeCompData) {
-		free(arl->data);
+	SISWA_ASSERT_NOT_NULL(out);
+	SISWA_ASSERT_MSG(segs.type == SISWA_FILE_SEGS, "Wrong compression type");
+	SISWA_ASSERT(segs.len >= sizeof(siSegsHeader));
+
+	ms = (siswa__manifestStream*)SISWA__MALLOC(SISWA_BUDGET_OTHER, sizeof(siswa__manifestStream));
+	SISWA_ASSERT_NOT_NULL(ms);
+	ms->out = out;
+	ms->capacity = capacity;
+	ms->sha256 = sha256Out;
+	ms->count = 0;
+	ms->phase = SISWA__MANIFEST_HEADER;
+	ms->pos = 0;
+	ms->target = sizeof(siArHeader);
+
+	chunks = siswa__read16be(&segs.data[6]);
+	table = &segs.data[sizeof(siSegsHeader)];
+	if (segs.len < sizeof(siSegsHeader) + chunks * sizeof(siSegsEntry)) {
+		chunks = 0;
 	}
-	arl->data = out;
-	arl->type = SISWA_FILE_REGULAR;
-}
 
-uint64_t siswa_arlGetDecompressedSize(siArlFile arl) {
-	switch (arl.type) {
-		case SISWA_FILE_REGULAR: return arl.len;
-		case SISWA_FILE_XCOMPRESS: {
-			uint64_t length = ((siXCompHeader*)arl.data)->uncompressedSize;
-			if (siswa_isLittleEndian()) {
-				length = siswa_swap64(length);
-			}
-			return length;
+	for (i = 0; i < chunks && ok && ms->phase != SISWA__MANIFEST_ERROR; i += 1) {
+		const siByte* chunk = &table[i * sizeof(siSegsEntry)];
+		size_t zSize = siswa__read16be(&chunk[0]);
+		size_t size = siswa__read16be(&chunk[2]);
+		size_t offset = (size_t)siswa__read32be(&chunk[4]) - 1;
+
+		if (i == 0 && offset == 0) {
+			offset = sizeof(siSegsHeader) + chunks * sizeof(siSegsEntry);
 		}
-		case SISWA_FILE_SEGS: {
-			uint32_t data = ((siSegsHeader*)arl.data)->fullSize;
-			if (siswa_isLittleEndian()) {
-				data = siswa_swap32(data);
-			}
-			return data;
+		size += (size == 0) * 0x10000;
+		if (offset > segs.len || zSize > segs.len - offset) {
+			break;
 		}
-		default: SISWA_PANIC();
-	}
-}
 
-#endif
+		if (size == zSize) {
+			siswa__manifestStreamFeed(ms, &segs.data[offset], zSize);
+			continue;
+		}
 
-#ifndef SISWA_NO_STDLIB
-void siswa_arlFree(siArlFile arlFile) {
-	free(arlFile.data);
+		/* Every chunk is its own Deflate stream, so it gets decompressed into
+		 * a buffer small enough to stay in the cache while it's being hashed. */
+		siswa_decompressDeflateInit(&ms->inflate, NULL);
+		ms->inflate.in = &segs.data[offset];
+		ms->inflate.inLen = zSize;
+		ms->inflate.out = ms->buf;
+		ms->inflate.outLen = size;
+
+		ok = (siswa_decompressDeflateStream(&ms->inflate) == SISWA_INFLATE_DONE);
+		siswa__manifestStreamFeed(ms, ms->buf, ms->inflate.totalOut);
+	}
+
+	count = ms->count;
+	SISWA__FREE(ms);
+	return count;
 }
 #endif
 
 
 #if !defined(SISWA_NO_DECOMPRESSION) && !defined(SISWA_DEFINE_CUSTOM_DEFLATE_DECOMPRESSION)
 
-#define SINFL_PRE_TBL_SIZE 128
-#define SINFL_LIT_TBL_SIZE 1334
-#define SINFL_OFF_TBL_SIZE 402
-
+#define SINFL_FAST_IN_MARGIN 16
+#define SINFL_FAST_OUT_MARGIN 320
+
+enum {
+	SINFL_HDR = 0,
+	SINFL_STORED_HDR,
+	SINFL_STORED,
+	SINFL_FIXED,
+	SINFL_DYNAMIC_HDR,
+	SINFL_DYNAMIC_PRE,
+	SINFL_DYNAMIC_LENS,
+	SINFL_BLOCK,
+	SINFL_MATCH,
+	SINFL_DONE,
+	SINFL_ERROR
+};
+
+/* Bit reader over the current input window. Only the fast loop uses 'sinfl_refill',
+ * which reads 8 bytes at once and must only be called with at least 8 bytes of
+ * input left. Everything else uses 'sinfl_refillSafe'. */
 typedef struct {
-	uint8_t* bitptr;
-	size_t bitbuf;
+	const siByte* in;
+	const siByte* inEnd;
+	uint64_t bitbuf;
 	int32_t bitcnt;
-
-	uint32_t lits[SINFL_LIT_TBL_SIZE];
-	uint32_t dsts[SINFL_OFF_TBL_SIZE];
 } sinfl;
 
 #if defined(__GNUC__) || defined(__clang__)
@@ -1560,11 +10003,20 @@ int32_t sinfl_bsr(uint32_t n) {
 #elif defined(__GNUC__) || defined(__clang__)
 	return 31 - __builtin_clz(n);
 #else
-	/* TODO(EimaMei): add a cross-compiler version */
+	int32_t res = 0;
+	while (n >>= 1) {
+		res += 1;
+	}
+	return res;
 #endif
 }
-#define sinfl_read64(ptr) (*(uint64_t*)ptr)
-#define sinfl_copy64(dst, src) sinfl_read64(dst) = sinfl_read64(src); dst += 8; src += 8
+static
+uint64_t sinfl_read64(const siByte* ptr) {
+	uint64_t n;
+	SISWA_MEMCPY(&n, ptr, sizeof(n));
+	return SISWA__LE64(n);
+}
+#define sinfl_copy64(dst, src) SISWA_MEMCPY(dst, src, 8); dst += 8; src += 8
 
 #ifndef SINFL_NO_SIMD
 static
@@ -1579,17 +10031,30 @@ void sinfl_copy128(unsigned char** dst, unsigned char** src) {
 	*dst += 16;
 	*src += 16;
 }
+#else
+static
+siByte* sinfl_write64(siByte* dst, uint64_t w) {
+	SISWA_MEMCPY(dst, &w, sizeof(w));
+	return dst + 8;
+}
 #endif
 static
 void sinfl_refill(sinfl* s) {
-	s->bitbuf |= sinfl_read64(s->bitptr) << s->bitcnt;
-	s->bitptr += (63 - s->bitcnt) >> 3;
+	s->bitbuf |= sinfl_read64(s->in) << s->bitcnt;
+	s->in += (63 - s->bitcnt) >> 3;
 	s->bitcnt |= 56; /* bitcount in range [56,63] */
 }
 static
+void sinfl_refillSafe(sinfl* s) {
+	while (s->bitcnt < 56 && s->in < s->inEnd) {
+		s->bitbuf |= (uint64_t)*s->in << s->bitcnt;
+		s->in += 1;
+		s->bitcnt += 8;
+	}
+}
+static
 size_t sinfl_peek(sinfl* s, int32_t cnt) {
 	SISWA_ASSERT(cnt >= 0 && cnt <= 56);
-	SISWA_ASSERT(cnt <= s->bitcnt);
 	return s->bitbuf & (((uint64_t)1 << cnt) - 1);
 }
 static
@@ -1604,11 +10069,6 @@ int32_t sinfl__get(sinfl* s, int32_t cnt) {
 	sinfl_eat(s, cnt);
 	return res;
 }
-static
-uint32_t sinfl_get(sinfl* s, int32_t cnt) {
-	sinfl_refill(s);
-	return sinfl__get(s, cnt);
-}
 typedef struct {
 	size_t len;
 	size_t cnt;
@@ -1754,291 +10214,593 @@ int32_t sinfl_decode(sinfl* s, uint32_t* tbl, size_t bit_len) {
 
 	return (key >> 16) & 0x0fff;
 }
-extern
-size_t siswa_decompressDeflate(siByte* data, size_t length, siByte* out, size_t capacity) {
-#if 1
-	static uint8_t order[] = {
-		16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
-	};
-	static uint16_t dbase[30 + 2] = {
-		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513,
-		769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
-	};
-	static siByte dbits[30 + 2] = {
-		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10,
-		11, 11, 12, 12, 13, 13, 0, 0
-	};
-	static uint16_t lbase[29 + 2] = {
-		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
-		67, 83, 99, 115, 131, 163, 195, 227, 258, 0, 0
-	};
-	static uint8_t lbits[29 + 2] = {
-		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4,
-		5, 5, 5, 5, 0, 0, 0
-	};
+/* Same as 'sinfl_decode', except it returns -1 without consuming anything if
+ * the bit buffer doesn't hold the entire code. */
+static
+int32_t sinfl_decodeSafe(sinfl* s, uint32_t* tbl, size_t bit_len) {
+	size_t idx = sinfl_peek(s, bit_len);
+	uint32_t key = tbl[idx];
+	int32_t len = key & 0x0f;
+
+	if (key & 0x10) {
+		/* sub-table lookup */
+		idx = (s->bitbuf >> bit_len) & (((uint64_t)1 << len) - 1);
+		key = tbl[((key >> 16) & 0xffff) + (unsigned)idx];
+		len = (int32_t)bit_len + (key & 0x0f);
+	}
+	if (len > s->bitcnt) {
+		return -1;
+	}
+	sinfl_eat(s, len);
+
+	return (key >> 16) & 0x0fff;
+}
+
+static const uint8_t sinfl_order[] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+static const uint16_t sinfl_dbase[30 + 2] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513,
+	769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const siByte sinfl_dbits[30 + 2] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10,
+	11, 11, 12, 12, 13, 13, 0, 0
+};
+static const uint16_t sinfl_lbase[29 + 2] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+	67, 83, 99, 115, 131, 163, 195, 227, 258, 0, 0
+};
+static const uint8_t sinfl_lbits[29 + 2] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4,
+	5, 5, 5, 5, 0, 0, 0
+};
+
+/* Copies a match byte by byte, taking the bytes that are further back than
+ * 'hist' from the history window. */
+static
+siByte* sinfl_copyHistory(siInflateState* state, siByte* out, const siByte* hist,
+		size_t dist, size_t len) {
+	size_t produced = (size_t)(out - hist);
+
+	while (len != 0 && dist > produced) {
+		size_t back = dist - produced;
+		*out = state->__window[(state->__windowPos - back) & (SISWA_INFLATE_WINDOW_SIZE - 1)];
+		out += 1;
+		produced += 1;
+		len -= 1;
+	}
+	while (len != 0) {
+		*out = *(out - dist);
+		out += 1;
+		len -= 1;
+	}
+
+	return out;
+}
+
+/* Decodes the current block until it ends or either of the windows get too
+ * close to their ends. Returns SINFL_BLOCK to continue with the careful loop,
+ * SINFL_HDR/SINFL_DONE when the block ended, or SINFL_ERROR. */
+static
+uint32_t sinfl_decodeFast(siInflateState* state, sinfl* s, siByte** outPtr,
+		siByte* outEnd, const siByte* hist) {
+	siByte* out = *outPtr;
+	uint32_t res = SINFL_BLOCK;
+
+	while (s->inEnd - s->in >= SINFL_FAST_IN_MARGIN && outEnd - out >= SINFL_FAST_OUT_MARGIN) {
+		int32_t sym;
+		sinfl_refill(s);
+		sym = sinfl_decode(s, state->__lits, 10);
+		if (sym < 256) {
+			/* literal */
+			*out++ = (uint8_t)sym;
+			sym = sinfl_decode(s, state->__lits, 10);
+			if (sym < 256) {
+				*out++ = (uint8_t)sym;
+				continue;
+			}
+		}
+		if (sinfl_unlikely(sym == 256)) {
+			/* end of block */
+			res = state->__last ? SINFL_DONE : SINFL_HDR;
+			break;
+		}
+		/* match */
+		if (sym >= 286) {
+			/* length codes 286 and 287 must not appear in compressed data */
+			res = SINFL_ERROR;
+			break;
+		}
+		sym -= 257;
+		if (s->bitcnt < 48) {
+			sinfl_refill(s);
+		}
+		{
+			int32_t len = sinfl__get(s, sinfl_lbits[sym]) + sinfl_lbase[sym];
+			int32_t dsym = sinfl_decode(s, state->__dsts, 8);
+			int32_t offs;
+			siByte* dst = out;
+			siByte* src;
+
+			if (sinfl_unlikely(dsym >= 30)) {
+				res = SINFL_ERROR;
+				break;
+			}
+			offs = sinfl__get(s, sinfl_dbits[dsym]) + sinfl_dbase[dsym];
+
+			if (sinfl_unlikely(offs > out - hist)) {
+				/* The match reaches into the history window. */
+				if ((size_t)offs > (size_t)(out - hist) + state->__windowLen) {
+					res = SINFL_ERROR;
+					break;
+				}
+				out = sinfl_copyHistory(state, out, hist, offs, len);
+				continue;
+			}
+			src = out - offs;
+			out = out + len;
+
+#ifndef SINFL_NO_SIMD
+			if (offs >= 16) {
+				/* simd copy match */
+				sinfl_copy128(&dst, &src);
+				sinfl_copy128(&dst, &src);
+				do {
+					sinfl_copy128(&dst, &src);
+				} while (dst < out);
+			}
+			else if (offs >= 8) {
+				/* word copy match */
+				sinfl_copy64(dst, src);
+				sinfl_copy64(dst, src);
+				do {
+					sinfl_copy64(dst, src);
+				} while (dst < out);
+			}
+			else if (offs == 1) {
+				/* rle match copying */
+				sinfl_char16 w = sinfl_char16_char(src[0]);
+				dst = sinfl_write128(dst, w);
+				dst = sinfl_write128(dst, w);
+				do {
+					dst = sinfl_write128(dst, w);
+				} while (dst < out);
+			}
+#else
+			if (offs >= 8) {
+				/* word copy match */
+				sinfl_copy64(dst, src);
+				sinfl_copy64(dst, src);
+				do {
+					sinfl_copy64(dst, src);
+				} while (dst < out);
+			}
+			else if (offs == 1) {
+				/* rle match copying */
+				uint64_t w = (uint64_t)src[0] * (uint64_t)0x0101010101010101;
+				dst = sinfl_write64(dst, w);
+				dst = sinfl_write64(dst, w);
+				do {
+					dst = sinfl_write64(dst, w);
+				} while (dst < out);
+			}
 #endif
+			else {
+				/* byte copy match */
+				*dst++ = *src++;
+				*dst++ = *src++;
+				do {
+					*dst++ = *src++;
+				} while (dst < out);
+			}
+		}
+	}
+
+	*outPtr = out;
+	return res;
+}
 
-	siByte* capacityEnd = out + capacity;
-	siByte* offsetEnd = data + length;
-	siByte* offset = out;
+void siswa_decompressDeflateInit(siInflateState* state, siByte* window) {
+	SISWA_ASSERT_NOT_NULL(state);
+
+	state->in = NULL;
+	state->inLen = 0;
+	state->out = NULL;
+	state->outLen = 0;
+	state->totalIn = 0;
+	state->totalOut = 0;
+
+	state->__window = window;
+	state->__windowPos = 0;
+	state->__windowLen = 0;
+	state->__bitbuf = 0;
+	state->__bitcnt = 0;
+	state->__state = SINFL_HDR;
+	state->__last = 0;
+	state->__len = 0;
+	state->__dist = 0;
+	state->__index = 0;
+	state->__nlit = 0;
+	state->__ndist = 0;
+	state->__nlen = 0;
+}
 
-	typedef enum { HDR, STORED, FIXED, DYNAMIC, BULK} sinfl_states;
-	sinfl_states state = HDR;
-	sinfl s = {0};
-	int32_t last = 0;
+siInflateStatus siswa_decompressDeflateStream(siInflateState* state) {
+	siInflateStatus status;
+	sinfl s;
+	sinfl snapshot;
+	siByte* out;
+	siByte* outStart;
+	siByte* outEnd;
+	const siByte* hist;
+
+	SISWA_ASSERT_NOT_NULL(state);
+	SISWA_ASSERT(state->in != NULL || state->inLen == 0);
+	SISWA_ASSERT(state->out != NULL || state->outLen == 0);
+
+	s.in = state->in;
+	s.inEnd = state->in + state->inLen;
+	s.bitbuf = state->__bitbuf;
+	s.bitcnt = state->__bitcnt;
+
+	out = state->out;
+	outStart = out;
+	outEnd = out + state->outLen;
+	/* Without a history window the previous output must directly precede 'out'. */
+	hist = (state->__window != NULL) ? outStart : outStart - state->totalOut;
 
-	s.bitptr = data;
 	while (1) {
-		switch (state) {
-			case HDR: {
+		switch (state->__state) {
+			case SINFL_HDR: {
 				/* block header */
 				int32_t type;
-				sinfl_refill(&s);
-				last = sinfl__get(&s, 1);
+				sinfl_refillSafe(&s);
+				if (s.bitcnt < 3) {
+					goto need_input;
+				}
+				state->__last = sinfl__get(&s, 1);
 				type = sinfl__get(&s, 2);
 
 				switch (type) {
-					case 0x00: state = STORED; break;
-					case 0x01: state = FIXED; break;
-					case 0x02: state = DYNAMIC; break;
-					default: return (out - offset);
+					case 0x00: state->__state = SINFL_STORED_HDR; break;
+					case 0x01: state->__state = SINFL_FIXED; break;
+					case 0x02: state->__state = SINFL_DYNAMIC_HDR; break;
+					default: goto error;
 				}
 				break;
 			}
-			case STORED: {
-				/* uncompressed block */
+			case SINFL_STORED_HDR: {
+				/* uncompressed block header */
 				size_t len, nlen;
-				sinfl__get(&s, s.bitcnt & 7);
-				len = (uint16_t)sinfl__get(&s,16);
-				nlen = (uint16_t)sinfl__get(&s,16);
-				s.bitptr -= s.bitcnt / 8;
-				s.bitbuf = s.bitcnt = 0;
+				sinfl_refillSafe(&s);
+				if (s.bitcnt < (s.bitcnt & 7) + 32) {
+					goto need_input;
+				}
+				sinfl_eat(&s, s.bitcnt & 7);
+				len = (uint16_t)sinfl__get(&s, 16);
+				nlen = (uint16_t)sinfl__get(&s, 16);
 
-				if (
-					((uint16_t)len != (uint16_t)~nlen)
-					|| len > (size_t)(offsetEnd - s.bitptr)
-					|| !len
-				) {
-					return (out - offset);
+				if ((uint16_t)len != (uint16_t)~nlen) {
+					goto error;
+				}
+				state->__len = (uint32_t)len;
+				state->__state = SINFL_STORED;
+				break;
+			}
+			case SINFL_STORED: {
+				/* uncompressed block. Whole bytes that are still inside of the
+				 * bit buffer go first. */
+				size_t n;
+				while (state->__len != 0 && s.bitcnt >= 8 && out < outEnd) {
+					*out++ = (siByte)sinfl__get(&s, 8);
+					state->__len -= 1;
 				}
 
-				SISWA_MEMCPY(out, s.bitptr, len);
-				s.bitptr += len;
-				out += len;
+				n = state->__len;
+				if (n > (size_t)(outEnd - out)) {
+					n = (size_t)(outEnd - out);
+				}
+				if (n > (size_t)(s.inEnd - s.in)) {
+					n = (size_t)(s.inEnd - s.in);
+				}
+				/* Empty blocks (used for flushing) can come without any input or
+				 * output buffer, which 'memcpy' doesn't allow even for 0 bytes. */
+				if (n != 0) {
+					SISWA_MEMCPY(out, s.in, n);
+					out += n;
+					s.in += n;
+					state->__len -= (uint32_t)n;
+				}
 
-				if (last) {
-					return (out - offset);
+				if (state->__len != 0) {
+					if (out == outEnd) {
+						goto need_output;
+					}
+					goto need_input;
 				}
-				state = HDR;
+				state->__state = state->__last ? SINFL_DONE : SINFL_HDR;
 				break;
 			}
-			case FIXED: {
-			  /* fixed huffman codes */
-				uint8_t lens[288 + 32]; /* TODO(EimaMei): Imrpove performance? */
+			case SINFL_FIXED: {
+				/* fixed huffman codes */
 				size_t n;
-				for (n = 0; n <= 143; n++) lens[n] = 8;
-				for (n = 144; n <= 255; n++) lens[n] = 9;
-				for (n = 256; n <= 279; n++) lens[n] = 7;
-				for (n = 280; n <= 287; n++) lens[n] = 8;
-				for (n = 0; n < 32; n++) lens[288+n] = 5;
+				for (n = 0; n <= 143; n++) state->__lens[n] = 8;
+				for (n = 144; n <= 255; n++) state->__lens[n] = 9;
+				for (n = 256; n <= 279; n++) state->__lens[n] = 7;
+				for (n = 280; n <= 287; n++) state->__lens[n] = 8;
+				for (n = 0; n < 32; n++) state->__lens[288 + n] = 5;
 
 				/* build lit/dist tables */
-				sinfl_build(s.lits, lens, 10, 15, 288);
-				sinfl_build(s.dsts, lens + 288, 8, 15, 32);
-				state = BULK;
+				sinfl_build(state->__lits, state->__lens, 10, 15, 288);
+				sinfl_build(state->__dsts, state->__lens + 288, 8, 15, 32);
+				state->__state = SINFL_BLOCK;
 				break;
 			}
-			case DYNAMIC: {
-			  /* dynamic huffman codes */
-				size_t n, i;
-				uint32_t hlens[SINFL_PRE_TBL_SIZE];
-				uint8_t nlens[19] = {0};
-				uint8_t lens[288 + 32];
-
-				sinfl_refill(&s);
-				{
-					size_t nlit = 257 + sinfl__get(&s,5);
-					size_t ndist = 1 + sinfl__get(&s,5);
-					size_t nlen = 4 + sinfl__get(&s,4);
-
-					for (n = 0; n < nlen; n++) {
-						nlens[order[n]] = (unsigned char)sinfl_get(&s,3);
-					}
-					sinfl_build(hlens, nlens, 7, 7, 19);
-
-					/* decode code lengths */
-					for (n = 0; n < nlit + ndist;) {
-						int32_t sym = 0;
-						sinfl_refill(&s);
-						sym = sinfl_decode(&s, hlens, 7);
-						switch (sym) {
-							case 16: {
-								i = 3 + sinfl_get(&s, 2);
-								while (i) {
-									lens[n] = lens[n - 1];
-									i -= 1;
-									n += 1;
-								}
-								break;
-							}
-							case 17: {
-								i = 3 + sinfl_get(&s, 3);
-								while (i) {
-									lens[n] = 0;
-									i -= 1;
-									n += 1;
-								}
-								break;
-							}
-							case 18: {
-								i = 11 + sinfl_get(&s, 7);
-								while (i) {
-									lens[n] = 0;
-									i -= 1;
-									n += 1;
-								}
-								break;
-							}
-							default: lens[n++] = (uint8_t)sym; break;
-						}
-					}
-					/* build lit/dist tables */
-					sinfl_build(s.lits, lens, 10, 15, nlit);
-					sinfl_build(s.dsts, lens + nlit, 8, 15, ndist);
-					state = BULK;
+			case SINFL_DYNAMIC_HDR: {
+				/* dynamic huffman codes */
+				sinfl_refillSafe(&s);
+				if (s.bitcnt < 14) {
+					goto need_input;
 				}
+				state->__nlit = 257 + sinfl__get(&s, 5);
+				state->__ndist = 1 + sinfl__get(&s, 5);
+				state->__nlen = 4 + sinfl__get(&s, 4);
+				state->__index = 0;
+				SISWA_MEMSET(state->__lens, 0, 19);
+
+				if (state->__nlit > 286 || state->__ndist > 30) {
+					goto error;
+				}
+				state->__state = SINFL_DYNAMIC_PRE;
 				break;
 			}
-			case BULK: {
-				/* decompress block */
-				while (1) {
-					int sym;
-					sinfl_refill(&s);
-					sym = sinfl_decode(&s, s.lits, 10);
-					if (sym < 256) {
-						/* literal */
-						if (sinfl_unlikely(out >= capacityEnd)) {
-							return out - offset;
-						}
-						*out++ = (uint8_t)sym;
-						sym = sinfl_decode(&s, s.lits, 10);
-						if (sym < 256) {
-							*out++ = (uint8_t)sym;
-							continue;
-						}
-					}
-					if (sinfl_unlikely(sym == 256)) {
-						/* end of block */
-						if (last) {
-							return out - offset;
-						}
-						state = HDR;
-						break;
+			case SINFL_DYNAMIC_PRE: {
+				/* code length code lengths */
+				while (state->__index < state->__nlen) {
+					sinfl_refillSafe(&s);
+					if (s.bitcnt < 3) {
+						goto need_input;
 					}
-					/* match */
-					if (sym >= 286) {
-						/* length codes 286 and 287 must not appear in compressed data */
-						return out - offset;
+					state->__lens[sinfl_order[state->__index]] = (siByte)sinfl__get(&s, 3);
+					state->__index += 1;
+				}
+				sinfl_build(state->__hlens, state->__lens, 7, 7, 19);
+				state->__index = 0;
+				state->__state = SINFL_DYNAMIC_LENS;
+				break;
+			}
+			case SINFL_DYNAMIC_LENS: {
+				/* decode code lengths */
+				uint32_t total = state->__nlit + state->__ndist;
+
+				while (state->__index < total) {
+					int32_t sym;
+					uint32_t n = state->__index;
+					uint32_t i = 0;
+					siByte value = 0;
+
+					sinfl_refillSafe(&s);
+					snapshot = s;
+					sym = sinfl_decodeSafe(&s, state->__hlens, 7);
+					if (sym < 0) {
+						goto need_input;
 					}
-					sym -= 257;
-					{
-						int32_t len = sinfl__get(&s, lbits[sym]) + lbase[sym];
-						int32_t dsym = sinfl_decode(&s, s.dsts, 8);
-						int32_t offs = sinfl__get(&s, dbits[dsym]) + dbase[dsym];
-						siByte* dst = out;
-						siByte* src =  out - offs;
-						if (sinfl_unlikely(offs >  out - offset)) {
-							return out - offset;
-						}
-						out = out + len;
 
-#ifndef SINFL_NO_SIMD
-						if (sinfl_likely(capacityEnd - out >= 16 * 3)) {
-							if (offs >= 16) {
-								/* simd copy match */
-								sinfl_copy128(&dst, &src);
-								sinfl_copy128(&dst, &src);
-								do {
-									sinfl_copy128(&dst, &src);
-								} while (dst < out);
-							}
-							else if (offs >= 8) {
-								/* word copy match */
-								sinfl_copy64(dst, src);
-								sinfl_copy64(dst, src);
-								do {
-									sinfl_copy64(dst, src);
-								} while (dst < out);
-							}
-							else if (offs == 1) {
-								/* rle match copying */
-								sinfl_char16 w = sinfl_char16_char(src[0]);
-								dst = sinfl_write128(dst, w);
-								dst = sinfl_write128(dst, w);
-								do {
-									dst = sinfl_write128(dst, w);
-								} while (dst < out);
+					switch (sym) {
+						case 16: {
+							if (s.bitcnt < 2) {
+								s = snapshot;
+								goto need_input;
 							}
-							else {
-								/* byte copy match */
-								*dst++ = *src++;
-								*dst++ = *src++;
-								do {
-									*dst++ = *src++;
-								} while (dst < out);
+							if (n == 0) {
+								goto error;
 							}
+							i = 3 + sinfl__get(&s, 2);
+							value = state->__lens[n - 1];
+							break;
 						}
-#else
-					 if (sinfl_likely(oe - out >= 3 * 8 - 3)) {
-						if (offs >= 8) {
-							/* word copy match */
-							sinfl_copy64(dst, src);
-							sinfl_copy64(dst, src);
-							do {
-								sinfl_copy64(dst, src);
-							} while (dst < out);
+						case 17: {
+							if (s.bitcnt < 3) {
+								s = snapshot;
+								goto need_input;
+							}
+							i = 3 + sinfl__get(&s, 3);
+							break;
 						}
-						else if (offs == 1) {
-							/* rle match copying */
-							unsigned int c = src[0];
-							unsigned int hw = (c << 24u) | (c << 16u) | (c << 8u) | (unsigned)c;
-							unsigned long long w = (unsigned long long)hw << 32llu | hw;
-							dst = sinfl_write64(dst, w);
-							dst = sinfl_write64(dst, w);
-							do {
-								dst = sinfl_write64(dst, w);
-							} while (dst < out);
+						case 18: {
+							if (s.bitcnt < 7) {
+								s = snapshot;
+								goto need_input;
+							}
+							i = 11 + sinfl__get(&s, 7);
+							break;
 						}
-						else {
-							/* byte copy match */
-							*dst++ = *src++;
-							*dst++ = *src++;
-							do {
-								*dst++ = *src++;
-							} while (dst < out);
+						default: {
+							i = 1;
+							value = (siByte)sym;
 						}
 					}
-#endif
-						else {
-							*dst++ = *src++;
-							*dst++ = *src++;
-							do {
-								*dst++ = *src++;
-							} while (dst < out);
-						}
+
+					if (n + i > total) {
+						goto error;
+					}
+					SISWA_MEMSET(&state->__lens[n], value, i);
+					state->__index += i;
+				}
+
+				/* build lit/dist tables */
+				sinfl_build(state->__lits, state->__lens, 10, 15, state->__nlit);
+				sinfl_build(state->__dsts, state->__lens + state->__nlit, 8, 15, state->__ndist);
+				state->__state = SINFL_BLOCK;
+				break;
+			}
+			case SINFL_BLOCK: {
+				/* decompress block */
+				int32_t sym, dsym;
+
+				if (s.inEnd - s.in >= SINFL_FAST_IN_MARGIN && outEnd - out >= SINFL_FAST_OUT_MARGIN) {
+					state->__state = sinfl_decodeFast(state, &s, &out, outEnd, hist);
+					if (state->__state == SINFL_ERROR) {
+						goto error;
+					}
+					break;
+				}
+
+				/* The careful loop, which decodes one symbol or match at a time
+				 * and rolls back if the input runs out in the middle of it. */
+				sinfl_refillSafe(&s);
+				snapshot = s;
+				sym = sinfl_decodeSafe(&s, state->__lits, 10);
+				if (sym < 0) {
+					goto need_input;
+				}
+
+				if (sym < 256) {
+					/* literal */
+					if (out == outEnd) {
+						s = snapshot;
+						goto need_output;
 					}
+					*out++ = (uint8_t)sym;
+					break;
+				}
+				if (sym == 256) {
+					/* end of block */
+					state->__state = state->__last ? SINFL_DONE : SINFL_HDR;
+					break;
+				}
+				if (sym >= 286) {
+					goto error;
+				}
+				sym -= 257;
+
+				if (s.bitcnt < sinfl_lbits[sym]) {
+					s = snapshot;
+					goto need_input;
+				}
+				state->__len = sinfl__get(&s, sinfl_lbits[sym]) + sinfl_lbase[sym];
+
+				dsym = sinfl_decodeSafe(&s, state->__dsts, 8);
+				if (dsym < 0 || s.bitcnt < sinfl_dbits[dsym]) {
+					s = snapshot;
+					goto need_input;
+				}
+				if (dsym >= 30) {
+					goto error;
+				}
+				state->__dist = sinfl__get(&s, sinfl_dbits[dsym]) + sinfl_dbase[dsym];
+				state->__state = SINFL_MATCH;
+				break;
+			}
+			case SINFL_MATCH: {
+				/* copy (the rest of) a match */
+				size_t n = state->__len;
+				if (state->__dist > (size_t)(out - hist) + state->__windowLen) {
+					goto error;
+				}
+				if (n > (size_t)(outEnd - out)) {
+					n = (size_t)(outEnd - out);
+				}
+				out = sinfl_copyHistory(state, out, hist, state->__dist, n);
+				state->__len -= (uint32_t)n;
+
+				if (state->__len != 0) {
+					goto need_output;
 				}
+				state->__state = SINFL_BLOCK;
 				break;
 			}
+			case SINFL_DONE: {
+				/* Give back the whole bytes that were read past the end of the
+				 * stream, as long as they belong to the current input window. */
+				size_t unused = (size_t)(s.bitcnt / 8);
+				if (unused > (size_t)(s.in - state->in)) {
+					unused = (size_t)(s.in - state->in);
+				}
+				s.in -= unused;
+				s.bitcnt -= (int32_t)unused * 8;
+				s.bitbuf &= ((uint64_t)1 << s.bitcnt) - 1;
+
+				status = SISWA_INFLATE_DONE;
+				goto exit;
+			}
+			default: goto error;
+		}
+	}
+
+need_input:
+	status = SISWA_INFLATE_NEED_INPUT;
+	goto exit;
+need_output:
+	status = SISWA_INFLATE_NEED_OUTPUT;
+	goto exit;
+error:
+	state->__state = SINFL_ERROR;
+	status = SISWA_INFLATE_ERROR;
+
+exit:
+	state->totalIn += (size_t)(s.in - state->in);
+	state->inLen -= (size_t)(s.in - state->in);
+	state->in = s.in;
+	state->__bitbuf = s.bitbuf;
+	state->__bitcnt = s.bitcnt;
+
+	if (state->__window != NULL && out != outStart) {
+		/* Keep the last 32 KiB of output for the matches of the next call. */
+		size_t produced = (size_t)(out - outStart);
+		const siByte* src = outStart;
+
+		if (produced >= SISWA_INFLATE_WINDOW_SIZE) {
+			src = out - SISWA_INFLATE_WINDOW_SIZE;
+			produced = SISWA_INFLATE_WINDOW_SIZE;
+		}
+		while (produced != 0) {
+			size_t n = SISWA_INFLATE_WINDOW_SIZE - state->__windowPos;
+			if (n > produced) {
+				n = produced;
+			}
+			SISWA_MEMCPY(&state->__window[state->__windowPos], src, n);
+			state->__windowPos = (state->__windowPos + n) & (SISWA_INFLATE_WINDOW_SIZE - 1);
+			state->__windowLen += n;
+			src += n;
+			produced -= n;
+		}
+		if (state->__windowLen > SISWA_INFLATE_WINDOW_SIZE) {
+			state->__windowLen = SISWA_INFLATE_WINDOW_SIZE;
 		}
 	}
-	return (out - offset);
+
+	state->totalOut += (size_t)(out - outStart);
+	state->outLen -= (size_t)(out - outStart);
+	state->out = out;
+
+	return status;
+}
+
+size_t siswa_decompressDeflate(siByte* data, size_t length, siByte* out, size_t capacity) {
+	siInflateState state;
+	siswa_decompressDeflateInit(&state, NULL);
+
+	state.in = data;
+	state.inLen = length;
+	state.out = out;
+	state.outLen = capacity;
+	siswa_decompressDeflateStream(&state);
+
+	return state.totalOut;
 }
 #endif
 
 #undef siswa_swap16
 #undef siswa_swap32
 #undef siswa_swap64
+#undef SISWA__LE16
+#undef SISWA__LE32
+#undef SISWA__LE64
+#undef SISWA__BE16
+#undef SISWA__BE32
+#undef SISWA__BE64
 
 #endif /* SISWA_ARCHIVE_IMPLEMENTATION */
 